@@ -1,8 +1,10 @@
+#include <array>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <optional>
 #include <remu/common/log.hpp>
+#include <remu/devices/virtio/virtio_console.hpp>
 #include <remu/loaders/image_loader.hpp>
 #include <remu/platform/virt.hpp>
 #include <remu/runtime/arguments.hpp>
@@ -12,14 +14,55 @@
 
 using remu::common::log_error;
 using remu::common::log_info;
+using remu::common::log_warn;
 
 namespace {
 
 void print_usage(const char* prog) {
-    std::cout << "Usage: " << prog << " -k <kernel_image> [-m <mem_size>]\n"
+    std::cout << "Usage: " << prog << " -k <kernel_image> [-m <mem_size>] [options]\n"
               << "  -k <path>     Kernel image path (required)\n"
               << "  -m <size>     Memory size (e.g. 128M, 256M, 1G, or bytes). "
                  "Default: 128M\n"
+              << "  --smp <n>     Number of harts (default 1): taking turns on one\n"
+              << "                thread with --timebase icount, each on its own host\n"
+              << "                thread with --timebase realtime\n"
+              << "  --quantum <n> Instructions per turn when harts share a thread\n"
+              << "                (default 1000)\n"
+              << "  -d <path>     Load this DTB instead of generating one for the\n"
+              << "                configured machine\n"
+              << "  --bootargs <str>\n"
+              << "                Kernel command line for the generated DTB\n"
+              << "  --drive <path>[,readonly]\n"
+              << "                Attach a raw disk image as a virtio-blk device\n"
+              << "                (repeatable)\n"
+              << "  --virtio-console <spec>[,name=NAME]\n"
+              << "                Add a virtio-console port backed by stdout, file:PATH,\n"
+              << "                pipe:PATH or unix:PATH (repeatable; the first is hvc0)\n"
+              << "  --netdev unix:LOCAL,peer=PEER[,mac=XX:XX:XX:XX:XX:XX]\n"
+              << "                Add a virtio-net device exchanging frames over a unix\n"
+              << "                datagram socket bound to LOCAL, sent to PEER (repeatable)\n"
+              << "  --share <dir>[,tag=TAG]\n"
+              << "                Export a host directory over virtio-9p; mount it with\n"
+              << "                mount -t 9p -o trans=virtio TAG /mnt (default tag share0,\n"
+              << "                share1, ...; repeatable)\n"
+              << "  --balloon <size>\n"
+              << "                Add a virtio-balloon with free page reporting, asking\n"
+              << "                the guest for <size> (e.g. 0, 32M) of its RAM up front\n"
+              << "  --ivshmem <name>,size=SIZE[,peer=N]\n"
+              << "                Join the host shared-memory region NAME (created on\n"
+              << "                first use) as peer N (default 0), mapped at 0x40000000,\n"
+              << "                with doorbell interrupts between the VMs sharing it\n"
+              << "  --semihosting Serve RISC-V semihosting calls (M-mode) with host\n"
+              << "                files and the console\n"
+              << "  --trap-misaligned  Raise address-misaligned exceptions instead of\n"
+              << "                     emulating misaligned loads/stores\n"
+              << "  --timebase <icount|realtime>\n"
+              << "                Source of mtime: retired instructions (deterministic,\n"
+              << "                default) or the host clock\n"
+              << "  --console-out <spec>\n"
+              << "                Where guest UART output goes: stdout (default),\n"
+              << "                file:PATH, pipe:PATH (named pipe) or unix:PATH\n"
+              << "                (connect to a listening unix socket)\n"
               << "  -h            Show help\n";
 }
 
@@ -68,6 +111,80 @@ std::optional<std::uint64_t> parse_mem_size(std::string_view s) {
     return static_cast<std::uint64_t>(base) * multiplier;
 }
 
+std::optional<std::array<std::uint8_t, 6>> parse_mac(std::string_view s) {
+    // xx:xx:xx:xx:xx:xx
+    std::array<std::uint8_t, 6> mac{};
+    if (s.size() != 17) return std::nullopt;
+    for (std::size_t i = 0; i < mac.size(); ++i) {
+        if (i > 0 && s[3 * i - 1] != ':') return std::nullopt;
+        const std::string byte(s.substr(3 * i, 2));
+        char* end = nullptr;
+        const unsigned long v = std::strtoul(byte.c_str(), &end, 16);
+        if (end != byte.c_str() + 2) return std::nullopt;
+        mac[i] = static_cast<std::uint8_t>(v);
+    }
+    return mac;
+}
+
+// unix:LOCAL,peer=PEER[,mac=MAC]
+bool parse_netdev(std::string_view spec, remu::runtime::NetdevSpec& out) {
+    if (!spec.starts_with("unix:")) return false;
+    spec.remove_prefix(5);
+
+    bool first = true;
+    while (!spec.empty()) {
+        const auto comma = spec.find(',');
+        const std::string_view item = spec.substr(0, comma);
+        spec = comma == std::string_view::npos ? std::string_view{} : spec.substr(comma + 1);
+
+        if (first) {
+            out.local_path = std::string(item);
+            first = false;
+        } else if (item.starts_with("peer=")) {
+            out.peer_path = std::string(item.substr(5));
+        } else if (item.starts_with("mac=")) {
+            const auto mac = parse_mac(item.substr(4));
+            if (!mac) return false;
+            out.mac = *mac;
+            out.has_mac = true;
+        } else {
+            return false;
+        }
+    }
+    return !out.local_path.empty() && !out.peer_path.empty();
+}
+
+// NAME,size=SIZE[,peer=N]
+bool parse_ivshmem(std::string_view spec, remu::runtime::IvshmemSpec& out) {
+    bool first = true;
+    while (!spec.empty()) {
+        const auto comma = spec.find(',');
+        const std::string_view item = spec.substr(0, comma);
+        spec = comma == std::string_view::npos ? std::string_view{} : spec.substr(comma + 1);
+
+        if (first) {
+            out.name = std::string(item);
+            first = false;
+        } else if (item.starts_with("size=")) {
+            const auto size = parse_mem_size(item.substr(5));
+            if (!size) return false;
+            out.size = *size;
+        } else if (item.starts_with("peer=")) {
+            const std::string peer(item.substr(5));
+            char* end = nullptr;
+            const unsigned long v = std::strtoul(peer.c_str(), &end, 10);
+            if (peer.empty() || *end != '\0' || v >= remu::devices::IvShmem::kMaxPeers) {
+                return false;
+            }
+            out.peer = static_cast<std::uint32_t>(v);
+        } else {
+            return false;
+        }
+    }
+    return !out.name.empty() && out.size != 0 &&
+           out.size <= remu::platform::VirtMachine::kIvshmemMaxSize;
+}
+
 bool parse_args(int argc, char** argv, remu::runtime::Arguments& out) {
     if (argc <= 1) return false;
 
@@ -95,12 +212,157 @@ bool parse_args(int argc, char** argv, remu::runtime::Arguments& out) {
                 return false;
             }
             out.mem_size_bytes = *parsed;
+        } else if (std::strcmp(arg, "--smp") == 0) {
+            if (i + 1 >= argc) {
+                log_error("Missing value after --smp");
+                return false;
+            }
+            const std::string n = argv[++i];
+            char* end = nullptr;
+            const unsigned long v = std::strtoul(n.c_str(), &end, 10);
+            if (n.empty() || *end != '\0' || v == 0 ||
+                v > remu::platform::VirtMachine::kMaxHarts) {
+                log_error("Invalid --smp (expected 1 to " +
+                          std::to_string(remu::platform::VirtMachine::kMaxHarts) + ")");
+                return false;
+            }
+            out.harts = static_cast<std::uint32_t>(v);
+        } else if (std::strcmp(arg, "--quantum") == 0) {
+            if (i + 1 >= argc) {
+                log_error("Missing value after --quantum");
+                return false;
+            }
+            const std::string n = argv[++i];
+            char* end = nullptr;
+            const unsigned long long v = std::strtoull(n.c_str(), &end, 10);
+            if (n.empty() || *end != '\0' || v == 0) {
+                log_error("Invalid --quantum (expected a positive instruction count)");
+                return false;
+            }
+            out.quantum = v;
         } else if (std::strcmp(arg, "-d") == 0) {
             if (i + 1 >= argc) {
                 log_error("Missing value after -d");
                 return false;
             }
             out.dtb_path = argv[++i];
+        } else if (std::strcmp(arg, "--trap-misaligned") == 0) {
+            out.trap_misaligned = true;
+        } else if (std::strcmp(arg, "--timebase") == 0) {
+            if (i + 1 >= argc) {
+                log_error("Missing value after --timebase");
+                return false;
+            }
+            const std::string_view tb = argv[++i];
+            if (tb == "icount") {
+                out.timebase = remu::devices::Timebase::Icount;
+            } else if (tb == "realtime") {
+                out.timebase = remu::devices::Timebase::Realtime;
+            } else {
+                log_error("Invalid --timebase (expected icount or realtime)");
+                return false;
+            }
+        } else if (std::strcmp(arg, "--console-out") == 0) {
+            if (i + 1 >= argc) {
+                log_error("Missing value after --console-out");
+                return false;
+            }
+            out.console_out = argv[++i];
+        } else if (std::strcmp(arg, "--bootargs") == 0) {
+            if (i + 1 >= argc) {
+                log_error("Missing value after --bootargs");
+                return false;
+            }
+            out.bootargs = argv[++i];
+        } else if (std::strcmp(arg, "--drive") == 0) {
+            if (i + 1 >= argc) {
+                log_error("Missing value after --drive");
+                return false;
+            }
+            std::string_view spec = argv[++i];
+            remu::runtime::DriveSpec drive;
+            if (const auto comma = spec.rfind(','); comma != std::string_view::npos) {
+                if (spec.substr(comma + 1) != "readonly") {
+                    log_error("Invalid --drive option (expected PATH or PATH,readonly)");
+                    return false;
+                }
+                drive.read_only = true;
+                spec = spec.substr(0, comma);
+            }
+            drive.path = std::string(spec);
+            out.drives.push_back(std::move(drive));
+        } else if (std::strcmp(arg, "--virtio-console") == 0) {
+            if (i + 1 >= argc) {
+                log_error("Missing value after --virtio-console");
+                return false;
+            }
+            std::string_view spec = argv[++i];
+            remu::runtime::ConsolePortSpec port;
+            if (const auto at = spec.rfind(",name="); at != std::string_view::npos) {
+                port.name = std::string(spec.substr(at + 6));
+                spec = spec.substr(0, at);
+            }
+            port.endpoint = std::string(spec);
+            if (out.console_ports.size() == remu::devices::VirtioConsole::kMaxPorts) {
+                log_error("Too many --virtio-console ports (at most " +
+                          std::to_string(remu::devices::VirtioConsole::kMaxPorts) + ")");
+                return false;
+            }
+            out.console_ports.push_back(std::move(port));
+        } else if (std::strcmp(arg, "--netdev") == 0) {
+            if (i + 1 >= argc) {
+                log_error("Missing value after --netdev");
+                return false;
+            }
+            remu::runtime::NetdevSpec netdev;
+            if (!parse_netdev(argv[++i], netdev)) {
+                log_error("Invalid --netdev (expected unix:LOCAL,peer=PEER[,mac=XX:XX:XX:XX:XX:XX])");
+                return false;
+            }
+            out.netdevs.push_back(std::move(netdev));
+        } else if (std::strcmp(arg, "--share") == 0) {
+            if (i + 1 >= argc) {
+                log_error("Missing value after --share");
+                return false;
+            }
+            std::string_view spec = argv[++i];
+            remu::runtime::ShareSpec share;
+            if (const auto at = spec.rfind(",tag="); at != std::string_view::npos) {
+                share.tag = std::string(spec.substr(at + 5));
+                spec = spec.substr(0, at);
+            } else {
+                share.tag = "share" + std::to_string(out.shares.size());
+            }
+            share.path = std::string(spec);
+            if (share.path.empty() || share.tag.empty()) {
+                log_error("Invalid --share (expected DIR or DIR,tag=TAG)");
+                return false;
+            }
+            out.shares.push_back(std::move(share));
+        } else if (std::strcmp(arg, "--semihosting") == 0) {
+            out.semihosting = true;
+        } else if (std::strcmp(arg, "--balloon") == 0) {
+            if (i + 1 >= argc) {
+                log_error("Missing value after --balloon");
+                return false;
+            }
+            const auto parsed = parse_mem_size(argv[++i]);
+            if (!parsed) {
+                log_error("Invalid size for --balloon (examples: 0, 32M)");
+                return false;
+            }
+            out.balloon_bytes = *parsed;
+        } else if (std::strcmp(arg, "--ivshmem") == 0) {
+            if (i + 1 >= argc) {
+                log_error("Missing value after --ivshmem");
+                return false;
+            }
+            remu::runtime::IvshmemSpec ivshmem;
+            if (!parse_ivshmem(argv[++i], ivshmem)) {
+                log_error("Invalid --ivshmem (expected NAME,size=SIZE[,peer=N], size at most 1G)");
+                return false;
+            }
+            out.ivshmem = std::move(ivshmem);
         } else {
             log_error(std::string("Unknown argument: ") + arg);
             return false;
@@ -112,6 +374,20 @@ bool parse_args(int argc, char** argv, remu::runtime::Arguments& out) {
         return false;
     }
 
+    if (out.balloon_bytes && *out.balloon_bytes >= out.mem_size_bytes) {
+        log_error("--balloon must be smaller than the memory size");
+        return false;
+    }
+
+    // Realtime harts run on threads of their own, with no turns to size
+    if (out.quantum && out.timebase == remu::devices::Timebase::Realtime) {
+        log_warn("--quantum only applies to the icount timebase; ignored");
+    }
+
+    if (!out.dtb_path.empty() && !out.bootargs.empty()) {
+        log_warn("--bootargs only applies to the generated DTB; ignored with -d");
+    }
+
     return true;
 }
 
@@ -128,9 +404,7 @@ int main(int argc, char** argv) {
 
     log_info(std::string("Kernel: ") + args.kernel_path);
     log_info("Memory bytes: " + std::to_string(args.mem_size_bytes));
-    log_info(std::string("DTB: ") + args.dtb_path);
-
-    remu::runtime::run(args);
+    log_info(std::string("DTB: ") + (args.dtb_path.empty() ? "generated" : args.dtb_path));
 
-    return 0;
+    return remu::runtime::run(args);
 }
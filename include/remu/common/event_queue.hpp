@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace remu::common {
+
+// Per-machine queue of device callbacks keyed on virtual time (the CLINT's
+// timebase ticks: the instruction-driven clock in icount mode, the scaled
+// host clock in realtime mode).
+//
+// A binary min-heap: schedule/pop are O(log n), peeking at the next
+// deadline is O(1), cancel is O(n) — a machine only ever has a handful of
+// outstanding events (timer compare, device completions), so that's fine.
+// Events with the same deadline fire in scheduling order, which keeps icount
+// runs deterministic.
+//
+// Not thread-safe: schedule/cancel/run_due are for the hart thread (device
+// register handlers and event callbacks). Other threads signal the machine
+// through interrupt lines instead.
+class EventQueue {
+public:
+    using Callback = std::function<void()>;
+    using Id = std::uint64_t; // 0 is never a valid id
+
+    static constexpr std::uint64_t kNever = ~0ull;
+
+    // Queue `cb` to run once virtual time reaches `when`.
+    Id schedule(std::uint64_t when, Callback cb);
+
+    // Drop a pending event; no-op for 0, fired or already cancelled ids.
+    void cancel(Id id);
+
+    // Deadline of the earliest pending event, or kNever.
+    std::uint64_t next_deadline() const { return heap_.empty() ? kNever : heap_.front().when; }
+
+    bool empty() const { return heap_.empty(); }
+    std::size_t size() const { return heap_.size(); }
+
+    // Fire every event due at `now`, earliest first. Callbacks may schedule
+    // or cancel events; newly due ones fire in the same call. Returns the
+    // number of callbacks run.
+    std::size_t run_due(std::uint64_t now);
+
+    // Called whenever schedule() makes the new event the earliest one, so
+    // the owner can pull its next service point forward.
+    void set_rearm_hook(std::function<void()> hook) { rearm_hook_ = std::move(hook); }
+
+private:
+    struct Event {
+        std::uint64_t when;
+        Id id;          // also the FIFO tie-breaker
+        Callback cb;
+    };
+    // std::*_heap build a max-heap; invert for earliest-first.
+    static bool later_(const Event& a, const Event& b) {
+        return a.when != b.when ? a.when > b.when : a.id > b.id;
+    }
+
+    std::vector<Event> heap_;
+    Id next_id_ = 1;
+    std::function<void()> rearm_hook_;
+};
+
+} // namespace remu::common
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace remu::common {
+
+// Bounded lock-free single-producer/single-consumer ring of bytes.
+//
+// One thread push()es, one other thread pop()s; neither ever blocks the
+// other. Indices are free-running 32-bit counters (capacity is a power of
+// two), so full/empty need no extra flag. A producer that finds the ring
+// full can sleep in wait_for_space() until the consumer frees some.
+template <std::size_t Capacity>
+class SpscRing {
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0,
+                  "capacity must be a power of two");
+    static_assert(Capacity <= (1u << 31), "capacity must fit the 32-bit indices");
+
+public:
+    static constexpr std::size_t kCapacity = Capacity;
+
+    // Producer: copy in as much of [data, data + len) as fits; returns the
+    // number of bytes taken.
+    std::size_t push(const std::uint8_t* data, std::size_t len) {
+        const std::uint32_t tail = tail_.load(std::memory_order_relaxed);
+        const std::uint32_t head = head_.load(std::memory_order_acquire);
+        const std::size_t n = std::min(len, Capacity - (tail - head));
+        for (std::size_t i = 0; i < n; ++i) {
+            buf_[(tail + i) & (Capacity - 1)] = data[i];
+        }
+        tail_.store(tail + static_cast<std::uint32_t>(n), std::memory_order_release);
+        return n;
+    }
+
+    // Producer: block until the ring has room for at least one byte.
+    void wait_for_space() {
+        while (true) {
+            const std::uint32_t head = head_.load(std::memory_order_acquire);
+            if (tail_.load(std::memory_order_relaxed) - head < Capacity) return;
+            head_.wait(head, std::memory_order_acquire);
+        }
+    }
+
+    // Consumer: copy out up to `len` bytes; returns the number copied.
+    std::size_t pop(std::uint8_t* out, std::size_t len) {
+        const std::uint32_t head = head_.load(std::memory_order_relaxed);
+        const std::uint32_t tail = tail_.load(std::memory_order_acquire);
+        const std::size_t n = std::min(len, static_cast<std::size_t>(tail - head));
+        if (n == 0) return 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            out[i] = buf_[(head + i) & (Capacity - 1)];
+        }
+        head_.store(head + static_cast<std::uint32_t>(n), std::memory_order_release);
+        head_.notify_one(); // only costs a syscall if the producer is waiting
+        return n;
+    }
+
+    // Consumer side: anything queued?
+    bool empty() const {
+        return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    std::array<std::uint8_t, Capacity> buf_{};
+    alignas(64) std::atomic<std::uint32_t> head_{0}; // consumer position
+    alignas(64) std::atomic<std::uint32_t> tail_{0}; // producer position
+};
+
+} // namespace remu::common
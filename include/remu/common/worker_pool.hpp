@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace remu::common {
+
+// Fixed set of host threads running submitted jobs in FIFO order.
+//
+// For device backends that do blocking host I/O (disk reads/writes, file
+// system calls) off the hart thread. Jobs run concurrently on up to
+// `threads` workers and must do their own synchronization when they touch
+// shared device state. The destructor finishes every queued job before
+// joining.
+class WorkerPool {
+public:
+    using Job = std::function<void()>;
+
+    explicit WorkerPool(std::size_t threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Any thread
+    void submit(Job job);
+
+    std::size_t size() const { return threads_.size(); }
+
+private:
+    void run_();
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<Job> jobs_;
+    bool stop_ = false;
+    std::vector<std::thread> threads_;
+};
+
+} // namespace remu::common
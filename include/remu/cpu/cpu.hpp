@@ -5,9 +5,13 @@
 #include <remu/cpu/regs.hpp>
 #include <remu/cpu/csr.hpp>
 #include <remu/cpu/exception.hpp>
+#include <remu/cpu/tlb.hpp>
 
 namespace remu::cpu {
 
+class ReservationSets;
+class Semihosting;
+
 // Full hart state (RV32)
 class Cpu {
 public:
@@ -22,9 +26,31 @@ public:
     RegFile regs;
     CsrFile csr;
 
-    // RV32A reservation (for LR/SC). Optional but useful for "A".
+    // Software TLB for Sv32 (see mmu.hpp). Must be flushed whenever satp or
+    // mstatus.SUM/MXR change, and by SFENCE.VMA.
+    Tlb tlb;
+
+    // RV32A reservation (for LR/SC): the physical word LR loaded, the value
+    // it saw and its line's version in `reservations` (see reservation.hpp)
     bool reservation_valid = false;
     std::uint32_t reservation_addr = 0;
+    std::uint32_t reservation_value = 0;
+    std::uint32_t reservation_version = 0;
+
+    // The machine's reservation sets, shared by all its harts; null keeps
+    // LR/SC to a compare of the reserved word alone
+    ReservationSets* reservations = nullptr;
+
+    // Misaligned LH/LHU/LW/SH/SW: emulated natively by default (and counted);
+    // with trap_misaligned set they raise the address-misaligned exception
+    // like hardware without misaligned support, leaving it to the guest's
+    // trap handler. Misaligned LR/SC/AMOs always trap.
+    bool trap_misaligned = false;
+    std::uint64_t misaligned_accesses = 0;
+
+    // Host services for the semihosting trap sequence; null (the default)
+    // leaves EBREAK a plain breakpoint exception
+    Semihosting* semihosting = nullptr;
 
     // Linux boot convention helpers (a0/a1)
     void set_boot_args(std::uint32_t a0_hartid, std::uint32_t a1_dtb_ptr);
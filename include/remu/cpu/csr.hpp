@@ -4,14 +4,69 @@
 
 namespace remu::cpu {
 
-// Privilege modes (minimal for now)
+// Privilege modes
 enum class PrivMode : std::uint8_t {
     User = 0,
     Supervisor = 1,
     Machine = 3,
 };
 
-// Minimal CSR file for RV32 (M-mode first)
+// CSR addresses used outside csr.cpp
+namespace csr_addr {
+constexpr std::uint16_t Sstatus = 0x100;
+constexpr std::uint16_t Satp    = 0x180;
+constexpr std::uint16_t Mstatus = 0x300;
+constexpr std::uint16_t Mip     = 0x344;
+}  // namespace csr_addr
+
+// mstatus fields (sstatus is a restricted view of the same register)
+namespace status {
+constexpr std::uint32_t SIE      = 1u << 1;
+constexpr std::uint32_t MIE      = 1u << 3;
+constexpr std::uint32_t SPIE     = 1u << 5;
+constexpr std::uint32_t MPIE     = 1u << 7;
+constexpr std::uint32_t SPP      = 1u << 8;
+constexpr std::uint32_t MPP_SHIFT = 11;
+constexpr std::uint32_t MPP_MASK = 3u << MPP_SHIFT;
+constexpr std::uint32_t MPRV     = 1u << 17;
+constexpr std::uint32_t SUM      = 1u << 18;
+constexpr std::uint32_t MXR      = 1u << 19;
+constexpr std::uint32_t TVM      = 1u << 20;
+constexpr std::uint32_t TW       = 1u << 21;
+constexpr std::uint32_t TSR      = 1u << 22;
+}  // namespace status
+
+// Interrupt bits, shared by mip/mie/sip/sie and used as cause codes
+namespace irq {
+constexpr std::uint32_t SSI = 1;
+constexpr std::uint32_t MSI = 3;
+constexpr std::uint32_t STI = 5;
+constexpr std::uint32_t MTI = 7;
+constexpr std::uint32_t SEI = 9;
+constexpr std::uint32_t MEI = 11;
+
+constexpr std::uint32_t bit(std::uint32_t cause) { return 1u << cause; }
+}  // namespace irq
+
+// satp (Sv32)
+namespace satp {
+constexpr std::uint32_t MODE_SV32 = 1u << 31;
+constexpr std::uint32_t PPN_MASK  = 0x003F'FFFFu;
+}  // namespace satp
+
+// Backing for the read-only time/timeh CSRs: the platform timer (CLINT
+// mtime), bound as a context pointer plus a plain function.
+struct TimeSource {
+    const void* ctx = nullptr;
+    std::uint64_t (*read)(const void* ctx) = nullptr;
+
+    template <class Timer>
+    static TimeSource bind(const Timer& t) {
+        return TimeSource{&t, [](const void* c) { return static_cast<const Timer*>(c)->mtime(); }};
+    }
+};
+
+// CSR file for an RV32 hart with M, S and U modes
 class CsrFile {
 public:
     CsrFile();
@@ -22,6 +77,11 @@ public:
     bool read(std::uint16_t csr_addr, std::uint32_t& out) const;
     bool write(std::uint16_t csr_addr, std::uint32_t value);
 
+    // Privilege/permission check for a CSR instruction: the CSR's minimum
+    // privilege (addr[9:8]), read-only space (addr[11:10] == 3), TVM for satp
+    // and the counter-enable gates. Existence is checked by read/write.
+    bool accessible(std::uint16_t csr_addr, PrivMode priv, bool writes) const;
+
     // Direct accessors (handy for trap logic later)
     std::uint32_t mstatus() const { return mstatus_; }
     std::uint32_t misa() const { return misa_; }
@@ -31,8 +91,19 @@ public:
     std::uint32_t mtval() const { return mtval_; }
     std::uint32_t mie() const { return mie_; }
     std::uint32_t mip() const { return mip_; }
+    // SEIP as last written by software; mip.SEIP reads this OR'd with the
+    // PLIC's S-context level
+    bool software_seip() const { return seip_sw_; }
     std::uint32_t mscratch() const { return mscratch_; }
     std::uint32_t mhartid() const { return mhartid_; }
+    std::uint32_t medeleg() const { return medeleg_; }
+    std::uint32_t mideleg() const { return mideleg_; }
+
+    std::uint32_t stvec() const { return stvec_; }
+    std::uint32_t sepc() const { return sepc_; }
+    std::uint32_t scause() const { return scause_; }
+    std::uint32_t stval() const { return stval_; }
+    std::uint32_t satp() const { return satp_; }
 
     void set_mstatus(std::uint32_t v) { mstatus_ = v; }
     void set_mepc(std::uint32_t v) { mepc_ = v; }
@@ -43,6 +114,13 @@ public:
     void set_mtvec(std::uint32_t v) { mtvec_ = v; }
     void set_mhartid(std::uint32_t v) { mhartid_ = v; }
 
+    void set_sepc(std::uint32_t v) { sepc_ = v; }
+    void set_scause(std::uint32_t v) { scause_ = v; }
+    void set_stval(std::uint32_t v) { stval_ = v; }
+
+    // time/timeh read through this; without one they are unimplemented
+    void set_time_source(TimeSource src) { time_ = src; }
+
     // Counters (very minimal)
     void increment_cycle(std::uint64_t delta = 1);
     void increment_instret(std::uint64_t delta = 1);
@@ -58,6 +136,10 @@ private:
     std::uint32_t mtval_{0};
     std::uint32_t mie_{0};
     std::uint32_t mip_{0};
+    bool seip_sw_{false};
+    std::uint32_t medeleg_{0};
+    std::uint32_t mideleg_{0};
+    std::uint32_t mcounteren_{0};
     std::uint32_t pmpcfg0_{0};
     std::uint32_t pmpaddr0_{0};
     std::uint32_t mhartid_{0};
@@ -65,10 +147,21 @@ private:
     std::uint32_t marchid_{0};
     std::uint32_t mimpid_{0};
 
-    // Basic counters (lower 32; you can extend to 64-bit CSRs later)
+    // S-mode CSRs (sstatus/sie/sip are views of the M-mode registers)
+    std::uint32_t stvec_{0};
+    std::uint32_t sscratch_{0};
+    std::uint32_t sepc_{0};
+    std::uint32_t scause_{0};
+    std::uint32_t stval_{0};
+    std::uint32_t satp_{0};
+    std::uint32_t scounteren_{0};
+
+    // 64-bit counters, exposed as low/high CSR halves
     std::uint64_t mcycle_{0};
     std::uint64_t minstret_{0};
 
+    TimeSource time_{};
+
 private:
     static std::uint32_t build_misa_rv32ima_();
 };
@@ -51,10 +51,15 @@ enum class InsnKind : std::uint16_t {
     AND,
 
     FENCE,
+    PAUSE,   // Zihintpause: the FENCE hint with pred = W, succ = 0
     ECALL,
     EBREAK,
     WFI,
+    WRS_NTO, // Zawrs
+    WRS_STO,
     MRET,
+    SRET,
+    SFENCE_VMA,
     CSRRW,
     CSRRS,
     CSRRC,
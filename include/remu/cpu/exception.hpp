@@ -5,10 +5,20 @@ namespace remu::cpu {
 
 // Synchronous exception causes (mcause, interrupt bit = 0)
 namespace exc {
+constexpr std::uint32_t InstructionAddressMisaligned = 0;
+constexpr std::uint32_t InstructionAccessFault = 1;
+constexpr std::uint32_t IllegalInstruction = 2;
 constexpr std::uint32_t Breakpoint = 3;
+constexpr std::uint32_t LoadAddressMisaligned = 4;
+constexpr std::uint32_t LoadAccessFault = 5;
+constexpr std::uint32_t StoreAddressMisaligned = 6;  // also AMO
+constexpr std::uint32_t StoreAccessFault = 7;        // also AMO
 constexpr std::uint32_t EcallFromU = 8;
 constexpr std::uint32_t EcallFromS = 9;
 constexpr std::uint32_t EcallFromM = 11;
+constexpr std::uint32_t InstructionPageFault = 12;
+constexpr std::uint32_t LoadPageFault = 13;
+constexpr std::uint32_t StorePageFault = 15;       // also AMO
 }  // namespace exc
 
 }  // namespace remu::cpu
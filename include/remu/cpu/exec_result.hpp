@@ -6,7 +6,10 @@ enum class ExecResult {
     Ok = 0,        // normal instruction executed
     Wfi = 2,           // wait-for-interrupt requested
     TrapRaised = 3,    // synchronous trap was raised (ecall/ebreak/etc)
-    Fault = 4          // execution fault (bus error, unimplemented)
+    Fault = 4,         // execution fault (bus error, unimplemented)
+    Pause = 5,         // spin-wait hint (PAUSE)
+    WrsNto = 6,        // wait on the reservation set, no timeout (WRS.NTO)
+    WrsSto = 7         // wait on the reservation set, short timeout (WRS.STO)
 };
 
 } // namespace remu::cpu
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#include <remu/cpu/cpu.hpp>
+#include <remu/cpu/exec_result.hpp>
+#include <remu/cpu/tlb.hpp>
+#include <remu/mem/bus.hpp>
+#include <remu/mem/memory.hpp>
+
+namespace remu::cpu {
+
+// Virtual memory (Sv32) front end for CPU loads, stores and fetches.
+//
+// Every access first looks in the hart's software TLB; a hit on a RAM page
+// is a tag compare plus a memcpy through the cached host pointer, with no
+// bus region lookup. Misses, MMIO pages and misaligned accesses take the
+// out-of-line slow path, which walks the page table, raises page faults and
+// refills the TLB. In M-mode (and with satp.MODE = Bare) translation is the
+// identity, but it still goes through the TLB so RAM hits stay fast.
+//
+// Return values follow ExecResult: Ok, TrapRaised (page fault, misaligned
+// trap; the exception is pending on the cpu) or Fault (physical address not
+// mapped at all, which stops the simulation as before).
+
+static_assert(std::endian::native == std::endian::little,
+              "the TLB fast path copies guest little-endian data as-is");
+
+// Privilege used for loads/stores: mstatus.MPP when M-mode sets MPRV.
+inline PrivMode data_priv(const Cpu& cpu) {
+    const std::uint32_t ms = cpu.csr.mstatus();
+    if (cpu.priv == PrivMode::Machine && (ms & status::MPRV) != 0) {
+        return static_cast<PrivMode>((ms & status::MPP_MASK) >> status::MPP_SHIFT);
+    }
+    return cpu.priv;
+}
+
+// Slow paths (mmu.cpp)
+ExecResult mmu_translate(Cpu& cpu, remu::mem::Bus& bus, std::uint32_t vaddr,
+                         Access acc, std::uint32_t& paddr);
+ExecResult mmu_load_slow(Cpu& cpu, remu::mem::Bus& bus, std::uint32_t vaddr,
+                         std::uint32_t len, std::uint32_t& out);
+ExecResult mmu_store_slow(Cpu& cpu, remu::mem::Bus& bus, std::uint32_t vaddr,
+                          std::uint32_t len, std::uint32_t val);
+ExecResult mmu_fetch32_slow(Cpu& cpu, remu::mem::Bus& bus, std::uint32_t vaddr,
+                            std::uint32_t& out);
+
+template <class T>
+inline ExecResult mmu_load(Cpu& cpu, remu::mem::Bus& bus, std::uint32_t vaddr, T& out) {
+    const TlbEntry& e = cpu.tlb.entry(data_priv(cpu), Access::Load, vaddr);
+    if (e.tag == (vaddr >> 12) && (vaddr & (sizeof(T) - 1)) == 0) {
+        std::memcpy(&out, reinterpret_cast<const void*>(e.addend + vaddr), sizeof(T));
+        return ExecResult::Ok;
+    }
+
+    std::uint32_t v = 0;
+    const ExecResult r = mmu_load_slow(cpu, bus, vaddr, sizeof(T), v);
+    out = static_cast<T>(v);
+    return r;
+}
+
+template <class T>
+inline ExecResult mmu_store(Cpu& cpu, remu::mem::Bus& bus, std::uint32_t vaddr, T val) {
+    const TlbEntry& e = cpu.tlb.entry(data_priv(cpu), Access::Store, vaddr);
+    if (e.tag == (vaddr >> 12) && (vaddr & (sizeof(T) - 1)) == 0) {
+        std::memcpy(reinterpret_cast<void*>(e.addend + vaddr), &val, sizeof(T));
+        e.ram->mark_dirty(e.ppage | (vaddr & 0xFFFu), sizeof(T));
+        return ExecResult::Ok;
+    }
+    return mmu_store_slow(cpu, bus, vaddr, sizeof(T), val);
+}
+
+inline ExecResult mmu_fetch32(Cpu& cpu, remu::mem::Bus& bus, std::uint32_t vaddr, std::uint32_t& out) {
+    const TlbEntry& e = cpu.tlb.entry(cpu.priv, Access::Fetch, vaddr);
+    if (e.tag == (vaddr >> 12) && (vaddr & 0x3u) == 0) {
+        std::memcpy(&out, reinterpret_cast<const void*>(e.addend + vaddr), sizeof(out));
+        return ExecResult::Ok;
+    }
+    return mmu_fetch32_slow(cpu, bus, vaddr, out);
+}
+
+} // namespace remu::cpu
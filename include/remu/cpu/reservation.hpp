@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+namespace remu::cpu {
+
+// LR/SC reservation sets shared by the harts of one machine.
+//
+// A reservation set is the kLineSize-byte line of guest-physical memory
+// holding the LR address. Each line hashes to a version counter that every
+// successful SC and every AMO bumps; LR records the version together with
+// the value it loaded. An SC succeeds only if its line's version is
+// unchanged and a compare-exchange of the loaded value for the new one
+// succeeds, so:
+// - another hart's SC or AMO anywhere in the line breaks the reservation;
+// - a plain store breaks it when it changes the reserved word (plain
+//   stores stay plain host stores, so one that writes back the same value
+//   goes unnoticed: the usual emulator trade-off).
+// Lines that share a counter only cause spurious SC failures, which the
+// ISA allows.
+//
+// A hart waiting in WRS on its reservation watch()es the sets: while any
+// hart does, bump() passes the line to the watch hook, which wakes the
+// harts waiting on it. The bump and the watcher count are sequentially
+// consistent, so a waiter either sees the new version or gets the call.
+class ReservationSets {
+public:
+    using WatchHook = std::function<void(std::uint32_t line)>;
+
+    static constexpr std::uint32_t kLineSize = 64;
+    static constexpr std::size_t kSlots = 1024; // power of two
+
+    static std::uint32_t line(std::uint32_t paddr) { return paddr & ~(kLineSize - 1); }
+
+    std::uint32_t version(std::uint32_t paddr) const {
+        return slot_(paddr).load(std::memory_order_seq_cst);
+    }
+
+    // After an SC or AMO has written the line
+    void bump(std::uint32_t paddr) {
+        slot_(paddr).fetch_add(1, std::memory_order_seq_cst);
+        if (watchers_.load(std::memory_order_seq_cst) != 0) watch_hook_(line(paddr));
+    }
+
+    // Set before any hart runs
+    void set_watch_hook(WatchHook hook) { watch_hook_ = std::move(hook); }
+    void watch() { watchers_.fetch_add(1, std::memory_order_seq_cst); }
+    void unwatch() { watchers_.fetch_sub(1, std::memory_order_relaxed); }
+
+private:
+    // One host cache line per counter, so harts working on unrelated lines
+    // don't contend
+    struct alignas(64) Slot {
+        std::atomic<std::uint32_t> version{0};
+    };
+
+    std::atomic<std::uint32_t>& slot_(std::uint32_t paddr) const {
+        return slots_[(paddr / kLineSize) & (kSlots - 1)].version;
+    }
+
+    mutable std::array<Slot, kSlots> slots_{};
+    alignas(64) std::atomic<std::uint32_t> watchers_{0};
+    WatchHook watch_hook_;
+};
+
+} // namespace remu::cpu
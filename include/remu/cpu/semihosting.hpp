@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace remu::mem {
+class Bus;
+}
+
+namespace remu::cpu {
+
+class Cpu;
+
+// RISC-V semihosting: the Arm semihosting calls, entered with the RISC-V
+// trap sequence
+//
+//     slli x0, x0, 0x1f
+//     ebreak
+//     srai x0, x0, 7
+//
+// (uncompressed, in that order). a0 holds the operation and a1 its argument,
+// usually the address of a block of 32-bit parameters; the result goes to
+// a0. Only M-mode calls are served, with physical addresses, which is what
+// bare-metal programs use; anywhere else the EBREAK traps as usual.
+//
+// Served: SYS_OPEN, CLOSE, WRITEC, WRITE0, WRITE, READ, ISERROR, ISTTY,
+// SEEK, FLEN, REMOVE, CLOCK, TIME, ERRNO, EXIT, EXIT_EXTENDED, ELAPSED and
+// TICKFREQ; anything else returns -1. Files are host paths, relative to
+// remu's working directory, opened with remu's own permissions. ":tt" is the
+// console: writes go to the console sink, reads see end of file.
+class Semihosting {
+public:
+    // Called on SYS_EXIT / SYS_EXIT_EXTENDED: success, and the exit code
+    using ExitHook = std::function<void(bool success, std::uint32_t code)>;
+
+    Semihosting();
+    ~Semihosting();
+
+    Semihosting(const Semihosting&) = delete;
+    Semihosting& operator=(const Semihosting&) = delete;
+
+    void set_exit_hook(ExitHook hook) { exit_hook_ = std::move(hook); }
+    void set_console_sink(std::function<void(std::uint8_t)> sink) { console_ = std::move(sink); }
+
+    // Whether the EBREAK at `pc` is the middle of the trap sequence
+    static bool is_call(remu::mem::Bus& bus, std::uint32_t pc);
+
+    // Perform the call in a0/a1 and write a0. The caller advances pc. Calls
+    // from several harts are serialized on the bus's device lock.
+    void call(Cpu& cpu, remu::mem::Bus& bus);
+
+private:
+    // An open handle: a host fd, or the console
+    struct File {
+        int fd = -1;
+        bool tty = false;
+        bool open = false;
+    };
+
+    std::uint32_t open_(remu::mem::Bus& bus, std::uint32_t args);
+    std::uint32_t close_(std::uint32_t handle);
+    std::uint32_t write_(remu::mem::Bus& bus, std::uint32_t handle, std::uint32_t buf,
+                         std::uint32_t len);
+    std::uint32_t read_(remu::mem::Bus& bus, std::uint32_t handle, std::uint32_t buf,
+                        std::uint32_t len);
+    std::uint32_t seek_(std::uint32_t handle, std::uint32_t pos);
+    std::uint32_t flen_(std::uint32_t handle);
+    std::uint32_t remove_(remu::mem::Bus& bus, std::uint32_t args);
+    void exit_(bool success, std::uint32_t code);
+
+    File* file_(std::uint32_t handle);
+    void put_(std::uint8_t c);
+    std::uint32_t fail_(int err); // sets errno_, returns -1
+
+    std::vector<File> files_; // handle n is files_[n - 1]
+    int errno_ = 0;
+    std::chrono::steady_clock::time_point start_;
+
+    ExitHook exit_hook_;
+    std::function<void(std::uint8_t)> console_;
+};
+
+} // namespace remu::cpu
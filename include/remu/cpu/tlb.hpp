@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace remu::mem {
+class Memory;
+}
+
+namespace remu::cpu {
+
+enum class PrivMode : std::uint8_t;
+
+// Kind of access being translated (selects the TLB set and the permission
+// bits a walk checks).
+enum class Access : std::uint8_t {
+    Fetch = 0,
+    Load  = 1,
+    Store = 2, // also LR/SC/AMO write intent
+};
+
+// One cached translation of a 4 KiB virtual page.
+//
+// RAM pages carry a host "addend": the host address of any byte in the page
+// is addend + vaddr, so a hit costs one tag compare and one add. Pages that
+// are not plain RAM (MMIO, or a page that straddles a region edge) are
+// cached with kMmioTag or'ed into the tag, so they never match the fast-path
+// compare but still skip the page-table walk on the slow path.
+struct TlbEntry {
+    static constexpr std::uint32_t kInvalid = 0xFFFF'FFFFu;
+    static constexpr std::uint32_t kMmioTag = 1u << 20; // above any 20-bit VPN
+
+    std::uint32_t tag = kInvalid;       // vaddr >> 12 (| kMmioTag)
+    std::uint32_t ppage = 0;            // physical page base address
+    std::uintptr_t addend = 0;          // RAM only: host = addend + vaddr
+    remu::mem::Memory* ram = nullptr;   // RAM only: for dirty-page tracking
+    bool mega = false;                  // filled from a 4 MiB megapage
+};
+
+// Direct-mapped software TLB for one hart.
+//
+// There is one set per (effective privilege, access type), so permission
+// checks are folded into which set an access looks in: a hit never needs to
+// re-check R/W/X/U/SUM/MXR. Privilege changes (traps, xRET, MPRV) just pick a
+// different set; only satp writes, SFENCE.VMA and SUM/MXR changes flush.
+// The M-mode sets only ever hold identity (bare) translations.
+class Tlb {
+public:
+    static constexpr std::size_t kEntries = 256; // per set, power of two
+
+    TlbEntry& entry(PrivMode priv, Access acc, std::uint32_t vaddr) {
+        return sets_[set_index_(priv)][static_cast<std::size_t>(acc)]
+                    [(vaddr >> 12) & (kEntries - 1)];
+    }
+
+    // Drop every translated (S/U) entry; identity M-mode entries stay valid.
+    void flush();
+
+    // SFENCE.VMA with rs1 != x0: drop entries mapping vaddr, including any
+    // 4 KiB pieces cached from the megapage that covers it.
+    void flush_va(std::uint32_t vaddr);
+
+private:
+    static std::size_t set_index_(PrivMode priv) {
+        // User=0, Supervisor=1, Machine=3 -> 0, 1, 2
+        const auto p = static_cast<std::size_t>(priv);
+        return p > 2 ? 2 : p;
+    }
+
+    using Set = std::array<TlbEntry, kEntries>;
+    std::array<std::array<Set, 3>, 3> sets_{}; // [priv][access]
+};
+
+} // namespace remu::cpu
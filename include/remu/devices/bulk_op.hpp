@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include <remu/common/worker_pool.hpp>
+#include <remu/devices/reg_map.hpp>
+
+namespace remu::mem {
+class Bus;
+class Memory;
+}
+
+namespace remu::devices {
+
+// Paravirtual bulk-operation engine ("remu,bulkop" in the DTB).
+//
+// The guest programs SRC/DST/LEN/VALUE and writes an operation to CMD; the
+// host runs it on guest RAM with its own memcpy/memset/memcmp and table
+// CRCs, so a large copy costs one host call instead of an interpreted loop.
+// Both ranges must each lie in one RAM region (guest RAM or a shared
+// window), otherwise the operation fails with ERROR and touches nothing.
+//
+// Completion: by default the operation runs inside the CMD store, so it is
+// done once the store retires. With CMD_IRQ it runs on a host thread
+// instead; STATUS reads BUSY until it finishes, then IntrStatus bit 0 is
+// set and the interrupt line raised. A CMD written while BUSY is ignored.
+//
+// Registers (32-bit, in a kWindowSize MMIO window):
+//   0x00 ID          R   kId ("bulk")
+//   0x08 SRC         RW  source address
+//   0x0C DST         RW  destination address
+//   0x10 LEN         RW  length in bytes
+//   0x14 VALUE       RW  fill byte (FILL) or running CRC (CRC32, CRC32C)
+//   0x18 CMD         W   operation | CMD_IRQ
+//   0x1C STATUS      R   BUSY, ERROR (of the last operation)
+//   0x20 RESULT      R   CRC, or memcmp sign (-1, 0, 1)
+//   0x24 IntrStatus  R   bit 0: an interrupt-mode operation completed;
+//                        write 1 to clear
+class BulkOp final {
+public:
+    static constexpr std::uint32_t kId = 0x6B6C'7562; // "bulk"
+    static constexpr std::uint32_t kWindowSize = 0x1000;
+
+    // CMD values. The CRCs are reflected (LSB-first) and take VALUE as the
+    // running CRC with no pre/post inversion, like Linux crc32_le() and
+    // __crc32c_le(); zlib-style crc32(c, buf) is ~op(~c).
+    enum Op : std::uint32_t {
+        kCopy    = 1, // DST <- SRC (overlap allowed, i.e. memmove)
+        kFill    = 2, // DST <- VALUE & 0xFF
+        kCrc32   = 3, // RESULT <- CRC-32 (IEEE 802.3) of SRC
+        kCrc32c  = 4, // RESULT <- CRC-32C (Castagnoli) of SRC
+        kCompare = 5, // RESULT <- sign of memcmp(SRC, DST)
+    };
+    static constexpr std::uint32_t kCmdIrq = 1u << 31;
+
+    static constexpr std::uint32_t kStatusBusy  = 1u << 0;
+    static constexpr std::uint32_t kStatusError = 1u << 1;
+
+    explicit BulkOp(remu::mem::Bus& bus);
+
+    BulkOp(const BulkOp&) = delete;
+    BulkOp& operator=(const BulkOp&) = delete;
+
+    // Level-triggered interrupt output; called from the hart thread and the
+    // worker thread
+    void set_irq_line(std::function<void(bool)> line);
+
+    // MMIO interface (mapped via Bus::map_mmio)
+    bool read (std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t& out);
+    bool write(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t  val);
+
+private:
+    struct Job {
+        std::uint32_t op, src, dst, len, value;
+    };
+
+    // Run one operation; false if an operand isn't RAM or the op is unknown
+    bool run_(const Job& job, std::uint32_t& result);
+    // Host pointer to a RAM range, the region it is in through `ram`
+    std::uint8_t* host_(std::uint32_t addr, std::uint32_t len, remu::mem::Memory** ram = nullptr);
+    void update_irq_();
+
+    bool id_read_    (std::uint32_t off, std::uint32_t& out);
+    bool param_read_ (std::uint32_t off, std::uint32_t& out);
+    bool status_read_(std::uint32_t off, std::uint32_t& out);
+    bool result_read_(std::uint32_t off, std::uint32_t& out);
+    bool intr_read_  (std::uint32_t off, std::uint32_t& out);
+
+    bool param_write_(std::uint32_t off, std::uint32_t val);
+    bool cmd_write_  (std::uint32_t off, std::uint32_t val);
+    bool intr_write_ (std::uint32_t off, std::uint32_t val);
+
+    using Regs = RegMap<BulkOp, 16, 2>;
+    static constexpr Regs kRegs_{{
+        {0x00, 4,  &BulkOp::id_read_,     nullptr},
+        {0x08, 16, &BulkOp::param_read_,  &BulkOp::param_write_},
+        {0x18, 4,  nullptr,               &BulkOp::cmd_write_},
+        {0x1C, 4,  &BulkOp::status_read_, nullptr},
+        {0x20, 4,  &BulkOp::result_read_, nullptr},
+        {0x24, 4,  &BulkOp::intr_read_,   &BulkOp::intr_write_},
+    }};
+
+    remu::mem::Bus& bus_;
+
+    // SRC, DST, LEN, VALUE; hart thread only
+    std::uint32_t params_[4] = {};
+
+    std::atomic<std::uint32_t> status_{0};
+    std::atomic<std::uint32_t> result_{0};
+    std::atomic<std::uint32_t> intr_{0};
+
+    // Serializes computing the line level with driving it
+    std::mutex irq_mu_;
+    std::function<void(bool)> irq_line_;
+
+    // Interrupt-mode operations; started on first use
+    std::unique_ptr<remu::common::WorkerPool> worker_;
+};
+
+} // namespace remu::devices
@@ -1,34 +1,97 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
-#include <mutex>
+#include <functional>
+#include <memory>
 
-#include <remu/mem/region.hpp> // remu::mem::MmioDevice
+#include <remu/common/event_queue.hpp>
+#include <remu/devices/reg_map.hpp>
 
 namespace remu::devices {
 
-// Minimal single-hart CLINT for QEMU virt style map.
-// - msip[0] at offset 0x0000 (32-bit)
-// - mtimecmp[0] at offset 0x4000 (64-bit split into 0x4000/0x4004)
-// - mtime at offset 0xBFF8 (64-bit split into 0xBFF8/0xBFFC)
-class Clint final : public remu::mem::MmioDevice {
+// Where mtime comes from.
+// - Icount: one timebase tick per retired instruction, plus whatever idle
+//   time WFI skips. Fully deterministic: the same guest run sees the same
+//   timer interrupts at the same points.
+// - Realtime: the host monotonic clock scaled to the timebase frequency
+//   (the DTB's timebase-frequency), so guest time tracks wall-clock time.
+enum class Timebase : std::uint8_t {
+    Icount,
+    Realtime,
+};
+
+// CLINT for QEMU virt style map, one msip/mtimecmp pair per hart.
+// - msip[h] at offset 0x0000 + 4*h (32-bit)
+// - mtimecmp[h] at offset 0x4000 + 8*h (64-bit split into low/high words)
+// - mtime at offset 0xBFF8 (64-bit split into 0xBFF8/0xBFFC), shared
+//
+// The CLINT also owns the machine's clock: now() is the raw time source
+// (instruction count or scaled host clock) that the event queue is keyed
+// on. mtime is never stored: it is derived on read as now() + offset, where
+// the offset absorbs guest writes to mtime. mtimecmp is turned into a
+// deadline in raw units when written and scheduled as an event, so MTIP is
+// only re-evaluated on timer writes and when that event fires. All state is
+// atomic; register writes and timer events come from one hart thread at a
+// time (with several harts, under the bus's device lock), while the
+// pending-interrupt queries are lock-free for every hart.
+class Clint final {
 public:
-    Clint();
+    static constexpr std::uint64_t kDefaultFreqHz = 1'000'000; // matches mini.dtb
+    static constexpr std::uint32_t kMaxHarts = 512;           // mtimecmp block size / 8
+
+    explicit Clint(std::uint32_t num_harts = 1);
 
-    // MmioDevice interface
-    bool read (std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t& out) override;
-    bool write(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t  val) override;
+    std::uint32_t num_harts() const { return num_harts_; }
 
-    // Advance time
-    void tick(std::uint64_t cycles);
+    // Select the time source. Resets mtime to 0.
+    void set_timebase(Timebase tb, std::uint64_t freq_hz = kDefaultFreqHz);
+    Timebase timebase() const { return timebase_; }
+    std::uint64_t freq_hz() const { return freq_hz_; }
 
-    // Query pending interrupts for hart0
-    bool msip_pending() const;
-    bool mtip_pending() const;
+    // Schedule the mtimecmp compares on `events`, and call `on_change` with
+    // the hart whenever its MSIP/MTIP may have changed.
+    void attach(remu::common::EventQueue& events, std::function<void(std::uint32_t)> on_change);
+
+    // MMIO interface (mapped via Bus::map_mmio)
+    bool read (std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t& out);
+    bool write(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t  val);
+
+    // Account retired instructions (the icount time source; one thread)
+    void tick(std::uint64_t instructions) {
+        icount_.store(icount_.load(std::memory_order_relaxed) + instructions,
+                      std::memory_order_relaxed);
+    }
+    std::uint64_t icount() const { return icount_.load(std::memory_order_relaxed); }
 
-    // Optional: direct access for debug
-    std::uint64_t mtime() const;
-    std::uint64_t mtimecmp() const;
+    // Raw time source, in timebase ticks (the event queue's clock)
+    std::uint64_t now() const;
+
+    // Icount mode only: jump the time source forward to `raw` (an idle hart
+    // in WFI). Returns the ticks skipped.
+    std::uint64_t advance_to(std::uint64_t raw);
+
+    // Realtime mode only: host time at which now() reaches `raw`, or
+    // time_point::max() for kNever (or in icount mode).
+    std::chrono::steady_clock::time_point host_time_at(std::uint64_t raw) const;
+
+    // Re-evaluate every hart's MTIP against the current time.
+    void sync();
+
+    // Query pending interrupts for a hart
+    bool msip_pending(std::uint32_t hart) const {
+        return harts_[hart].msip.load(std::memory_order_relaxed) != 0;
+    }
+    bool mtip_pending(std::uint32_t hart) const {
+        return harts_[hart].mtip.load(std::memory_order_relaxed);
+    }
+
+    // Current mtime
+    std::uint64_t mtime() const { return now() + offset_.load(std::memory_order_relaxed); }
+    std::uint64_t mtimecmp(std::uint32_t hart) const {
+        return harts_[hart].mtimecmp.load(std::memory_order_relaxed);
+    }
 
 private:
     static std::uint32_t off_(std::uint32_t addr) {
@@ -36,12 +99,50 @@ private:
         return (addr & 0xFFFFu);
     }
 
+    void set_mtime_(std::uint64_t value);
+    void update_deadline_(std::uint32_t hart);
+    void update_mtip_(std::uint32_t hart);
+    void changed_(std::uint32_t hart) { if (on_change_) on_change_(hart); }
+
+    // Register handlers; one per 4 KiB block of the window, decoding the
+    // exact word within the block.
+    bool msip_read_    (std::uint32_t off, std::uint32_t& out);
+    bool mtimecmp_read_(std::uint32_t off, std::uint32_t& out);
+    bool mtime_read_   (std::uint32_t off, std::uint32_t& out);
+
+    bool msip_write_    (std::uint32_t off, std::uint32_t val);
+    bool mtimecmp_write_(std::uint32_t off, std::uint32_t val);
+    bool mtime_write_   (std::uint32_t off, std::uint32_t val);
+
+    using Regs = RegMap<Clint, 16, 12>;
+    static constexpr Regs kRegs_{{
+        {0x0000, 0x1000, &Clint::msip_read_,     &Clint::msip_write_},
+        {0x4000, 0x1000, &Clint::mtimecmp_read_, &Clint::mtimecmp_write_},
+        {0xB000, 0x1000, &Clint::mtime_read_,    &Clint::mtime_write_},
+    }};
+
 private:
-    mutable std::mutex mu_;
+    // One hart's registers and its timer compare
+    struct HartTimer {
+        std::atomic<std::uint32_t> msip{0};            // bit0 used
+        std::atomic<std::uint64_t> mtimecmp{~0ull};    // default: never fire
+        std::atomic<std::uint64_t> deadline{~0ull};    // mtimecmp in raw units
+        std::atomic<bool> mtip{false};
+        remu::common::EventQueue::Id timer_event = 0;
+    };
+
+    const std::uint32_t num_harts_;
+    std::unique_ptr<HartTimer[]> harts_;
+
+    Timebase timebase_ = Timebase::Icount;
+    std::uint64_t freq_hz_ = kDefaultFreqHz;
+    std::chrono::steady_clock::time_point epoch_{};
+
+    std::atomic<std::uint64_t> icount_{0};
+    std::atomic<std::uint64_t> offset_{0};           // mtime = now() + offset (mod 2^64)
 
-    std::uint32_t msip0_ = 0;     // bit0 used
-    std::uint64_t mtimecmp0_ = ~0ull; // default: never fire
-    std::uint64_t mtime_ = 0;
+    remu::common::EventQueue* events_ = nullptr;
+    std::function<void(std::uint32_t)> on_change_;
 };
 
 } // namespace remu::devices
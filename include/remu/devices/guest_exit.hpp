@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+namespace remu::devices {
+
+// Guest software asking to end the run (test finisher, HTIF)
+enum class GuestExit : std::uint8_t {
+    Pass,  // poweroff, or a bare-metal test passing
+    Fail,  // a test failing, with a status code
+    Reset, // reboot
+};
+
+// Called on the hart thread, from the device's register write
+using ExitHook = std::function<void(GuestExit kind, std::uint32_t code)>;
+
+} // namespace remu::devices
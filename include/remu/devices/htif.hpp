@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include <remu/devices/guest_exit.hpp>
+
+namespace remu::mem {
+class Bus;
+}
+
+namespace remu::devices {
+
+// Berkeley HTIF tohost/fromhost mailbox ("ucb,htif0"), for bare-metal
+// programs and test suites built for Spike.
+//
+// remu has no ELF loader to find a `tohost` symbol, so the pair lives in a
+// fixed MMIO window instead: tohost at offset 0, fromhost at offset 8 (each
+// 64-bit, accessed as two 32-bit words). Link programs with tohost and
+// fromhost at those addresses.
+//
+// A command is tohost = device << 56 | cmd << 48 | payload. It is taken
+// only when the high word is written, so write the low word first, as
+// Spike programs do on RV32. Programs that only store 32 bits exit through
+// the exit word at offset 0x10 instead: writing (code << 1) | 1 there exits
+// with `code`, like the device 0 exit below.
+//   device 0, cmd 0  payload bit 0 set: exit with code payload >> 1 (0 is
+//                    a pass); otherwise payload points at a syscall block
+//                    (eight 64-bit words: number, then arguments). Only
+//                    SYS_write (64) to fd 1 or 2 is served, into the
+//                    console sink; the return value replaces the number.
+//   device 1, cmd 1  write character payload & 0xFF to the console sink
+// Handled commands clear tohost and, apart from exits, are acknowledged in
+// fromhost (device << 56 | cmd << 48 | 1), which the program clears.
+class Htif final {
+public:
+    static constexpr std::uint32_t kWindowSize = 0x1000;
+    // 32-bit exit-only word
+    static constexpr std::uint32_t kExitOffset = 0x10;
+
+    explicit Htif(remu::mem::Bus& bus);
+
+    void set_exit_hook(ExitHook hook) { exit_hook_ = std::move(hook); }
+    void set_tx_sink(std::function<void(std::uint8_t)> sink) { tx_sink_ = std::move(sink); }
+
+    // MMIO interface (mapped via Bus::map_mmio)
+    bool read (std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t& out);
+    bool write(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t  val);
+
+private:
+    void command_(std::uint64_t cmd);
+    void syscall_(std::uint32_t block);
+    void put_(std::uint8_t c);
+
+    remu::mem::Bus& bus_;
+    ExitHook exit_hook_;
+    std::function<void(std::uint8_t)> tx_sink_;
+
+    // Hart thread only
+    std::uint64_t tohost_ = 0;
+    std::uint64_t fromhost_ = 0;
+};
+
+} // namespace remu::devices
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <remu/common/result.hpp>
+#include <remu/devices/reg_map.hpp>
+#include <remu/mem/memory.hpp>
+
+namespace remu::devices {
+
+// Shared-memory inter-VM device, after QEMU's ivshmem.
+//
+// Every VM that opens the same name gets the same host shared-memory object
+// (shm_open("/remu-ivshmem-NAME")), whether the VMs live in one remu process
+// or several. The data part is mapped into guest-physical space as plain RAM
+// (shm(), for Bus::map_ram), so the guests exchange data with ordinary loads
+// and stores at memory bandwidth.
+//
+// Each VM joins as a peer number (0..kMaxPeers-1). Writing (peer << 16) |
+// vector to Doorbell latches bit `vector` in that peer's IntrStatus and
+// raises its interrupt line (wired to the PLIC). Doorbells travel through a
+// control page at the start of the object, outside what the guests see: a
+// pending-vector word and a futex sequence word per peer, which a listener
+// thread in the receiving VM sleeps on. Vectors rung while a peer isn't
+// running stay pending until it opens.
+//
+// Registers (32-bit, in a kWindowSize MMIO window):
+//   0x00 IntrMask    RW  vectors allowed to raise the line
+//   0x04 IntrStatus  R   latched vectors; write 1s to clear
+//   0x08 IVPosition  R   this VM's peer number
+//   0x0C Doorbell    W   (peer << 16) | vector
+//   0x10 ShmSize     R   size of the shared window in bytes
+//   0x14 MaxPeers    R   kMaxPeers
+class IvShmem final {
+public:
+    static constexpr std::uint32_t kMaxPeers = 16;
+    static constexpr std::uint32_t kVectors = 32;
+    static constexpr std::uint32_t kWindowSize = 0x1000;
+
+    // Open (creating it if needed) the object for `name` with a `size`-byte
+    // shared window, as peer `peer`. Every peer must give the same size.
+    // The object outlives remu; remove /dev/shm/remu-ivshmem-NAME to reset it.
+    static remu::common::Result<std::unique_ptr<IvShmem>> open(const std::string& name,
+                                                               std::uint32_t base,
+                                                               std::uint32_t size,
+                                                               std::uint32_t peer);
+    ~IvShmem();
+
+    IvShmem(const IvShmem&) = delete;
+    IvShmem& operator=(const IvShmem&) = delete;
+
+    // The shared window, at the guest-physical base given to open()
+    remu::mem::Memory& shm() { return *shm_; }
+    std::uint32_t peer() const { return peer_; }
+
+    // Level-triggered interrupt output; called from the hart thread and the
+    // listener thread. Driven right away with the current level.
+    void set_irq_line(std::function<void(bool)> line);
+
+    // Any thread: ring `vector` of `peer`, as a guest Doorbell write does
+    void ring(std::uint32_t peer, std::uint32_t vector);
+
+    // MMIO interface (mapped via Bus::map_mmio)
+    bool read (std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t& out);
+    bool write(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t  val);
+
+private:
+    struct Control;
+
+    IvShmem(Control* control, std::unique_ptr<remu::mem::Memory> shm, std::uint32_t peer);
+
+    // Listener thread: move this peer's pending vectors into IntrStatus
+    void listen_();
+    void latch_(std::uint32_t vectors);
+    void update_irq_();
+
+    bool mask_read_    (std::uint32_t off, std::uint32_t& out);
+    bool status_read_  (std::uint32_t off, std::uint32_t& out);
+    bool position_read_(std::uint32_t off, std::uint32_t& out);
+    bool size_read_    (std::uint32_t off, std::uint32_t& out);
+    bool peers_read_   (std::uint32_t off, std::uint32_t& out);
+
+    bool mask_write_    (std::uint32_t off, std::uint32_t val);
+    bool status_write_  (std::uint32_t off, std::uint32_t val);
+    bool doorbell_write_(std::uint32_t off, std::uint32_t val);
+
+    using Regs = RegMap<IvShmem, 8, 2>;
+    static constexpr Regs kRegs_{{
+        {0x00, 4, &IvShmem::mask_read_,     &IvShmem::mask_write_},
+        {0x04, 4, &IvShmem::status_read_,   &IvShmem::status_write_},
+        {0x08, 4, &IvShmem::position_read_, nullptr},
+        {0x0C, 4, nullptr,                  &IvShmem::doorbell_write_},
+        {0x10, 4, &IvShmem::size_read_,     nullptr},
+        {0x14, 4, &IvShmem::peers_read_,    nullptr},
+    }};
+
+    Control* control_; // mmap'd control page
+    std::unique_ptr<remu::mem::Memory> shm_;
+    std::uint32_t peer_;
+
+    std::atomic<std::uint32_t> mask_{0};
+    std::atomic<std::uint32_t> status_{0};
+
+    // Serializes computing the line level with driving it
+    std::mutex irq_mu_;
+    std::function<void(bool)> irq_line_;
+
+    std::atomic<bool> stop_{false};
+    std::thread listener_;
+};
+
+} // namespace remu::devices
@@ -2,33 +2,55 @@
 
 #include <cstdint>
 #include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <mutex>
 
-#include <remu/mem/region.hpp> // rvemu::mem::MmioDevice
+#include <remu/devices/reg_map.hpp>
 
 namespace remu::devices {
 
-// Minimal single-hart PLIC (QEMU virt style address layout).
-// - Interrupt IDs: 1..N (0 means "no interrupt").
-// - Supports: priority, pending, enable (hart0), threshold (hart0), claim/complete (hart0).
-class Plic final : public remu::mem::MmioDevice {
+// SiFive/RISC-V PLIC (QEMU virt style address layout).
+// - Interrupt IDs: 1..1023 (0 means "no interrupt").
+// - Priorities 0..7 per source; per-context enable bits, threshold and
+//   claim/complete. The machine decides which hart/mode each context
+//   drives (see VirtMachine).
+// - Sources are level-triggered: pending follows the device line, a claim
+//   takes the source out of selection until it is completed, and
+//   completing a source whose line is still high re-pends it.
+//
+// raise_irq/clear_irq are lock-free (atomic bit ops), so device threads
+// never contend with the hart. Selection keeps one bitset of sources per
+// priority level and walks levels from highest to lowest, ANDing
+// pending & enabled & ~claimed a 64-bit word at a time and taking the
+// lowest ID with ctz. Guest register accesses serialize on a mutex.
+class Plic final {
 public:
-    // Keep this small at first. QEMU virt uses many IDs, but Linux UART is usually one ID.
-    // You can increase later.
-    static constexpr std::uint32_t kMaxIrq = 64; // IDs 1..64 supported
+    static constexpr std::uint32_t kMaxIrq = 1023;      // IDs 1..1023 supported
+    static constexpr std::uint32_t kMaxPriority = 7;
+    static constexpr std::uint32_t kWords = (kMaxIrq + 1) / 64;
 
-    Plic();
+    explicit Plic(std::uint32_t num_contexts = 1);
 
-    // MmioDevice interface
-    bool read (std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t& out) override;
-    bool write(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t  val) override;
+    std::uint32_t num_contexts() const { return num_contexts_; }
 
-    // Device-facing API
-    void raise_irq(std::uint32_t irq_id); // set pending
-    void clear_irq(std::uint32_t irq_id); // clear pending
+    // MMIO interface (mapped via Bus::map_mmio)
+    bool read (std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t& out);
+    bool write(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t  val);
 
-    // Query: should MEIP be asserted for hart0?
-    bool has_pending_for_hart0() const;
+    // Device-facing API (any thread): drive a source's line high/low
+    void raise_irq(std::uint32_t irq_id);
+    void clear_irq(std::uint32_t irq_id);
+
+    // Called (outside the PLIC lock) after anything that may change a
+    // context's external-interrupt output: raise/clear from any thread
+    // (which is also what wakes a hart sleeping in WFI) and guest register
+    // accesses (claim, complete, enable, threshold, priority).
+    void set_change_hook(std::function<void()> hook) { change_hook_ = std::move(hook); }
+
+    // Query: should `ctx`'s interrupt output (MEIP/SEIP) be asserted?
+    bool has_pending(std::uint32_t ctx) const { return pick_best_irq_(ctx) != 0; }
 
 private:
     // Address decode helpers (offset within PLIC window)
@@ -37,25 +59,54 @@ private:
         return (addr & 0x00FF'FFFFu); // 16 MiB window is plenty for virt
     }
 
-    // Compute best IRQ to claim for hart0 (0 if none)
-    std::uint32_t pick_best_irq_() const;
+    using Bitset = std::array<std::atomic<std::uint64_t>, kWords>;
+
+    struct Context {
+        Bitset enable{};
+        std::atomic<std::uint32_t> threshold{0};
+    };
+
+    static std::uint64_t bit_(std::uint32_t id) { return 1ull << (id % 64); }
+    static std::uint32_t word_(std::uint32_t id) { return id / 64; }
+
+    // Best IRQ to claim for `ctx` (0 if none)
+    std::uint32_t pick_best_irq_(std::uint32_t ctx) const;
+
+    void set_priority_(std::uint32_t id, std::uint32_t pri);
+    void hook_() const { if (change_hook_) change_hook_(); }
+
+    // Register handlers (called with mu_ held). The window is decoded in
+    // 2 MiB blocks: block 0 holds the per-source registers (priority,
+    // pending, enable), the rest are per-context threshold/claim pages.
+    bool sources_read_(std::uint32_t off, std::uint32_t& out);
+    bool context_read_(std::uint32_t off, std::uint32_t& out);
+
+    bool sources_write_(std::uint32_t off, std::uint32_t val);
+    bool context_write_(std::uint32_t off, std::uint32_t val);
+
+    using Regs = RegMap<Plic, 8, 21>;
+    static constexpr Regs kRegs_{{
+        {0x000000, 0x200000, &Plic::sources_read_, &Plic::sources_write_},
+        {0x200000, 0xE00000, &Plic::context_read_, &Plic::context_write_},
+    }};
 
 private:
     mutable std::mutex mu_;
 
-    // priority[irq] for irq 0..kMaxIrq (irq 0 unused)
-    std::array<std::uint32_t, kMaxIrq + 1> priority_{};
-
-    // pending bitset for irq 0..kMaxIrq (we store as 64-bit)
-    std::uint64_t pending_ = 0;
+    const std::uint32_t num_contexts_;
+    std::unique_ptr<Context[]> contexts_;
 
-    // enable bitset for hart0 (same encoding as pending)
-    std::uint64_t enable0_ = 0;
+    // priority[irq] for irq 0..kMaxIrq (irq 0 unused), and the same
+    // information as one source bitset per priority level (level 0 never
+    // interrupts, so it isn't kept)
+    std::array<std::uint32_t, kMaxIrq + 1> priority_{};
+    std::array<Bitset, kMaxPriority + 1> by_priority_{};
 
-    // threshold for hart0
-    std::uint32_t threshold0_ = 0;
+    Bitset level_{};   // device line state
+    Bitset pending_{}; // gateway output: level, minus claimed-and-not-yet-re-raised
+    Bitset claimed_{}; // claimed, not yet completed
 
-    // "in service" is optional; we keep it minimal.
+    std::function<void()> change_hook_;
 };
 
 } // namespace rvemu::devices
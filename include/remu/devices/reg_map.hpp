@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace remu::devices {
+
+// Constexpr offset -> handler table for a device's MMIO register file.
+//
+// A device lists its registers as {offset, span, read, write} entries; the
+// constructor folds them into a dense array indexed by (offset >> Shift), so
+// dispatching an access is one shift, one bounds check and one direct
+// member-function call instead of a switch or an if-chain.
+//
+// - Shift selects the slot granularity (0 for byte registers like the 16550,
+//   12 for page-sized blocks like the CLINT).
+// - Handlers receive the full window offset so a block handler can decode
+//   its own sub-registers (e.g. per-hart mtimecmp).
+// - Slots with no handler read as 0 and ignore writes, which is what the
+//   simple models here already did for unmapped offsets.
+template <class Dev, std::size_t Slots, unsigned Shift = 0>
+class RegMap {
+public:
+    using ReadFn  = bool (Dev::*)(std::uint32_t off, std::uint32_t& out);
+    using WriteFn = bool (Dev::*)(std::uint32_t off, std::uint32_t val);
+
+    struct Reg {
+        std::uint32_t offset;
+        std::uint32_t span;  // bytes covered (rounded to whole slots)
+        ReadFn  read;        // nullptr: reads as 0
+        WriteFn write;       // nullptr: writes ignored
+    };
+
+    template <std::size_t N>
+    constexpr explicit RegMap(const Reg (&regs)[N]) {
+        for (const Reg& r : regs) {
+            const std::size_t first = r.offset >> Shift;
+            const std::size_t last  = (r.offset + r.span - 1) >> Shift;
+            for (std::size_t i = first; i <= last && i < Slots; ++i) {
+                slots_[i] = Slot{r.read, r.write};
+            }
+        }
+    }
+
+    bool read(Dev& dev, std::uint32_t off, std::uint32_t& out) const {
+        const std::size_t i = off >> Shift;
+        if (i >= Slots || slots_[i].read == nullptr) {
+            out = 0;
+            return true;
+        }
+        return (dev.*slots_[i].read)(off, out);
+    }
+
+    bool write(Dev& dev, std::uint32_t off, std::uint32_t val) const {
+        const std::size_t i = off >> Shift;
+        if (i >= Slots || slots_[i].write == nullptr) return true;
+        return (dev.*slots_[i].write)(off, val);
+    }
+
+private:
+    struct Slot {
+        ReadFn  read  = nullptr;
+        WriteFn write = nullptr;
+    };
+
+    std::array<Slot, Slots> slots_{};
+};
+
+} // namespace remu::devices
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+#include <remu/devices/guest_exit.hpp>
+
+namespace remu::devices {
+
+// SiFive test finisher ("sifive,test0"), which is also the syscon that
+// Linux's syscon-poweroff and syscon-reboot drivers write.
+//
+// One 32-bit register at offset 0. The low 16 bits select the action and
+// the high 16 bits carry a status code:
+//   0x5555  pass / poweroff
+//   0x3333  fail, with the code (a code of 0 still counts as a failure)
+//   0x7777  reset / reboot
+// Other values are ignored; reads return 0.
+class TestFinisher final {
+public:
+    static constexpr std::uint32_t kWindowSize = 0x1000;
+
+    static constexpr std::uint32_t kPass  = 0x5555;
+    static constexpr std::uint32_t kFail  = 0x3333;
+    static constexpr std::uint32_t kReset = 0x7777;
+
+    void set_exit_hook(ExitHook hook) { exit_hook_ = std::move(hook); }
+
+    // MMIO interface (mapped via Bus::map_mmio)
+    bool read (std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t& out);
+    bool write(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t  val);
+
+private:
+    ExitHook exit_hook_;
+};
+
+} // namespace remu::devices
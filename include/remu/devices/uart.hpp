@@ -1,64 +1,163 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <mutex>
 
-#include <remu/mem/region.hpp> // for remu::mem::MmioDevice
+#include <remu/common/spsc_ring.hpp>
+#include <remu/devices/reg_map.hpp>
 
 namespace remu::devices {
 
-// Minimal NS16550-compatible UART (enough for early printk)
-// - MMIO register behavior for basic TX.
-// - RX interrupt (data-ready) modeled: raises/clears an external line via a
-//   host-supplied callback (typically wired to a PLIC) whenever IER's
-//   "Received Data Available" bit is enabled and DR changes.
-class UartNs16550 final : public remu::mem::MmioDevice {
+// NS16550A-compatible UART with FIFOs.
+// - FCR enables 16-byte RX/TX FIFOs (64-byte with fifo_depth = 64, as on a
+//   16750), clears them, and sets the RX trigger level; IIR reports FIFO
+//   mode in bits 7:6 so the guest driver moves data in bursts.
+// - Interrupts, in 16550 priority order: receiver line status (overrun),
+//   received data (FIFO at the trigger level), character timeout (data
+//   below the trigger level), THR empty. IIR reports the highest pending
+//   enabled source; the line is driven through a host-supplied callback
+//   (typically wired to a PLIC).
+// - The transmitter is infinitely fast: THR writes go straight to the TX
+//   sink, so THRE/TEMT always read set and the THRE interrupt is re-raised
+//   after every write (and when ETBEI is enabled). Reading IIR while THRE
+//   is the reported source clears it, as on real parts.
+// - Host input arrives through a lock-free ring (push_rx(), from the console
+//   thread) and is moved into the RX FIFO on the hart thread as the FIFO
+//   has room, so the host side never drops bytes or takes the UART lock.
+// - The character timeout fires as soon as the host has nothing more queued
+//   and the RX FIFO is below its trigger level, standing in for "no new
+//   data for four character times".
+class UartNs16550 final {
 public:
-    UartNs16550();
-
-    // MmioDevice interface
-    bool read (std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t& out) override;
-    bool write(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t  val) override;
+    static constexpr std::size_t kDefaultFifoDepth = 16;
+    static constexpr std::size_t kMaxFifoDepth = 64;
+
+    // fifo_depth is 16 (16550A) or 64 (16750-style)
+    explicit UartNs16550(std::size_t fifo_depth = kDefaultFifoDepth);
+
+    // MMIO interface (mapped via Bus::map_mmio)
+    bool read (std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t& out);
+    bool write(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t  val);
+
+    // Host input thread (single producer): queue bytes for the guest without
+    // blocking the hart. Returns the number accepted, which is less than
+    // `len` only when the ring is full; wait_rx_space() then blocks until
+    // the guest has drained some. Rings the doorbell for every push.
+    std::size_t push_rx(const std::uint8_t* data, std::size_t len);
+    void wait_rx_space() { rx_ring_.wait_for_space(); }
+
+    // Called after push_rx() queues bytes, from the input thread: should get
+    // the hart to call poll_rx() soon (and wake it from WFI).
+    void set_rx_doorbell(std::function<void()> doorbell) { rx_doorbell_ = std::move(doorbell); }
+
+    // Hart thread: if the doorbell rang, move queued host bytes into the RX
+    // FIFO and update the interrupt line. One atomic load otherwise.
+    void poll_rx() {
+        if (rx_ready_.load(std::memory_order_relaxed)) poll_rx_slow_();
+    }
 
-    // Allow test/dev code (or a host stdin reader) to inject a received byte
-    // (sets DR bit, and raises the RX interrupt line if enabled).
-    void inject_rx_byte(std::uint8_t byte);
+    // Allow test/dev code to inject received bytes straight into the RX
+    // FIFO, bypassing the host ring. Bytes that don't fit are dropped and
+    // flagged as an overrun (LSR.OE). Raises the RX interrupt if enabled.
+    void inject_rx(const std::uint8_t* data, std::size_t len);
+    void inject_rx_byte(std::uint8_t byte) { inject_rx(&byte, 1); }
 
     // Wire this UART's interrupt line to an external sink (e.g. a PLIC's
     // raise_irq/clear_irq for a specific IRQ id). Called with `true` when the
     // line should be asserted, `false` when it should be deasserted.
     void set_irq_line(std::function<void(bool)> set_irq) { set_irq_ = std::move(set_irq); }
 
+    // Route transmitted bytes to a host sink (e.g. a buffered
+    // platform::ConsoleOutput). Without one, each byte is written to stdout
+    // and flushed immediately.
+    void set_tx_sink(std::function<void(std::uint8_t)> sink) { tx_sink_ = std::move(sink); }
+
 private:
     void update_irq_locked_();
-    // 8-bit accessors (NS16550 registers are byte-based)
-    bool read8_(std::uint32_t addr, std::uint8_t& out);
-    bool write8_(std::uint32_t addr, std::uint8_t val);
 
-    // Map absolute address to register offset within 0x100 window
-    static std::uint8_t reg_off_(std::uint32_t addr) {
-        return static_cast<std::uint8_t>(addr & 0xFFu);
+    // Map absolute address to register offset (8 byte registers, aliased
+    // across the 0x100 window)
+    static std::uint32_t reg_off_(std::uint32_t addr) {
+        return addr & 0x07u;
     }
 
+    // Register handlers (NS16550 registers are byte-based; values are the
+    // low 8 bits of the 32-bit handler argument)
+    bool rbr_read_(std::uint32_t off, std::uint32_t& out);
+    bool ier_read_(std::uint32_t off, std::uint32_t& out);
+    bool iir_read_(std::uint32_t off, std::uint32_t& out);
+    bool lcr_read_(std::uint32_t off, std::uint32_t& out);
+    bool mcr_read_(std::uint32_t off, std::uint32_t& out);
+    bool lsr_read_(std::uint32_t off, std::uint32_t& out);
+    bool msr_read_(std::uint32_t off, std::uint32_t& out);
+    bool scr_read_(std::uint32_t off, std::uint32_t& out);
+
+    bool thr_write_(std::uint32_t off, std::uint32_t val);
+    bool ier_write_(std::uint32_t off, std::uint32_t val);
+    bool fcr_write_(std::uint32_t off, std::uint32_t val);
+    bool lcr_write_(std::uint32_t off, std::uint32_t val);
+    bool mcr_write_(std::uint32_t off, std::uint32_t val);
+    bool scr_write_(std::uint32_t off, std::uint32_t val);
+
+    using Regs = RegMap<UartNs16550, 8>;
+    static constexpr Regs kRegs_{{
+        {0x0, 1, &UartNs16550::rbr_read_, &UartNs16550::thr_write_}, // RBR/THR/DLL
+        {0x1, 1, &UartNs16550::ier_read_, &UartNs16550::ier_write_}, // IER/DLM
+        {0x2, 1, &UartNs16550::iir_read_, &UartNs16550::fcr_write_}, // IIR/FCR
+        {0x3, 1, &UartNs16550::lcr_read_, &UartNs16550::lcr_write_}, // LCR
+        {0x4, 1, &UartNs16550::mcr_read_, &UartNs16550::mcr_write_}, // MCR
+        {0x5, 1, &UartNs16550::lsr_read_, nullptr},                  // LSR (read-only)
+        {0x6, 1, &UartNs16550::msr_read_, nullptr},                  // MSR (read-only)
+        {0x7, 1, &UartNs16550::scr_read_, &UartNs16550::scr_write_}, // SCR
+    }};
+
     // Register helpers for DLAB mode (LCR[7])
     bool dlab_() const { return (lcr_ & 0x80u) != 0; }
 
+    bool fifo_enabled_() const { return (fcr_ & 0x01u) != 0; }
+
+    // Effective RX capacity: the FIFO, or the single RBR in 16450 mode
+    std::size_t rx_capacity_() const { return fifo_enabled_() ? fifo_depth_ : 1; }
+    std::size_t rx_trigger_() const;
+
+    void reset_rx_fifo_();
+    void refill_rx_fifo_locked_();
+    void poll_rx_slow_();
+
+    // Highest-priority pending, enabled source as an IIR ID (bits 3:0)
+    std::uint8_t irq_id_() const;
+
     void write_tx_(std::uint8_t ch);
 
 private:
     std::mutex mu_;
 
+    const std::size_t fifo_depth_;
+
+    // RX FIFO (ring); in non-FIFO mode only one slot is used (the RBR)
+    std::array<std::uint8_t, kMaxFifoDepth> rx_fifo_{};
+    std::size_t rx_head_{0};
+    std::size_t rx_count_{0};
+
+    bool thre_pending_{false}; // THR-empty interrupt latched
+
+    // Host input queued for the RX FIFO, and its doorbell
+    remu::common::SpscRing<16 * 1024> rx_ring_;
+    std::atomic<bool> rx_ready_{false};
+    std::function<void()> rx_doorbell_;
+
     // Registers (minimal)
-    std::uint8_t rbr_{0}; // receive buffer (read @ 0 when DLAB=0)
     std::uint8_t thr_{0}; // transmit holding (write @ 0 when DLAB=0)
     std::uint8_t ier_{0}; // interrupt enable (offset 1, DLAB=0)
 
-    std::uint8_t iir_{0x01}; // interrupt identification (bit0=1 => no interrupt pending)
-    std::uint8_t fcr_{0};    // fifo control (write offset 2)
+    std::uint8_t fcr_{0};    // fifo control (write offset 2; FIFO enable + trigger bits kept)
     std::uint8_t lcr_{0};    // line control (offset 3)
     std::uint8_t mcr_{0};    // modem control (offset 4)
-    std::uint8_t lsr_{0x60}; // line status (THRE|TEMT set by default)
+    std::uint8_t lsr_{0x60}; // line status (THRE|TEMT set by default; DR derived from the FIFO)
     std::uint8_t msr_{0};    // modem status (offset 6)
     std::uint8_t scr_{0};    // scratch (offset 7)
 
@@ -66,6 +165,9 @@ private:
     std::uint8_t dll_{0};
     std::uint8_t dlm_{0};
 
+    // Host side of TX
+    std::function<void(std::uint8_t)> tx_sink_;
+
     // External interrupt line (e.g. wired to a PLIC).
     std::function<void(bool)> set_irq_;
     bool irq_asserted_{false};
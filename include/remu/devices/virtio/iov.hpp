@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <sys/uio.h>
+
+namespace remu::devices {
+
+// Helpers for scattered buffers, i.e. the iovec lists of a VirtqChain.
+// Lengths are clamped to what the lists hold; each returns the bytes moved.
+
+// [skip, skip + len) of `src` as a list of its own, into `out` (cleared
+// first, capacity reused)
+void iov_slice(std::span<const iovec> src, std::size_t skip, std::size_t len,
+               std::vector<iovec>& out);
+
+// Gather from / scatter to the start of a list
+std::size_t iov_to_buf(std::span<const iovec> src, void* dst, std::size_t len);
+std::size_t iov_from_buf(std::span<const iovec> dst, const void* src, std::size_t len);
+
+// List to list, e.g. one guest's buffer into another's
+std::size_t iov_copy(std::span<const iovec> dst, std::span<const iovec> src, std::size_t len);
+
+// Drop the first `n` bytes of iov[first..], advancing `first` past
+// exhausted entries; used to resume after a short readv/writev.
+void iov_advance(std::vector<iovec>& iov, std::size_t& first, std::size_t n);
+
+} // namespace remu::devices
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <span>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+namespace remu::devices {
+
+// The receive side of a virtio-net device, as seen by its backend.
+class NetReceiver {
+public:
+    // Writes one frame into the buffer space it is given (guest RAM, after
+    // the virtio-net header) and returns the frame length, or -1 if no
+    // frame could be produced after all.
+    using Fill = std::function<ssize_t(std::span<const iovec> buffer)>;
+
+    virtual ~NetReceiver() = default;
+
+    // Any thread: put one frame into the next receive buffer the guest has
+    // posted. False, without calling `fill`, if there is none (or the
+    // device isn't running); the caller drops the frame or waits for
+    // NetBackend::rx_buffers_posted(). Also false when `fill` produced no
+    // frame: the buffer goes back to the guest empty.
+    virtual bool receive(const Fill& fill) = 0;
+
+    // Any thread: interrupt the guest for the frames received since the
+    // last flush, subject to its interrupt suppression. Backends call it
+    // once per batch rather than per frame.
+    virtual void flush_rx() = 0;
+};
+
+// Where a virtio-net device's frames go: an in-process NetSwitch port or a
+// socket to another process.
+class NetBackend {
+public:
+    virtual ~NetBackend() = default;
+
+    // Frames arriving for this device go to `rx`; nullptr detaches.
+    virtual void set_receiver(NetReceiver* rx) = 0;
+
+    // Hart thread of the sending machine: transmit one Ethernet frame
+    // (scattered over guest RAM). The buffers stay valid until end_batch().
+    virtual void send(std::span<const iovec> frame, std::size_t len) = 0;
+
+    // The current transmit batch is complete: flush anything queued and
+    // signal whichever receivers got frames.
+    virtual void end_batch() {}
+
+    // The guest posted receive buffers (after the device had run out).
+    virtual void rx_buffers_posted() {}
+};
+
+} // namespace remu::devices
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <remu/devices/virtio/net_backend.hpp>
+
+namespace remu::devices {
+
+// An in-process learning Ethernet switch for virtio-net devices of several
+// machines running in the same process (each on its own thread).
+//
+// A frame is copied once, from the sender's transmit buffer in its guest
+// RAM straight into a posted receive buffer of each destination guest, on
+// the sender's hart thread. Unicast goes to the port the destination MAC
+// was last seen on; broadcast, multicast and unknown destinations flood to
+// every other port. A destination without a free receive buffer drops the
+// frame, like a full NIC ring. Receivers are signalled once per transmit
+// batch.
+//
+// The switch must outlive the ports connected to it.
+class NetSwitch {
+public:
+    NetSwitch() = default;
+
+    NetSwitch(const NetSwitch&) = delete;
+    NetSwitch& operator=(const NetSwitch&) = delete;
+
+    // A new port, to be passed to a VirtioNet. Thread-safe.
+    std::unique_ptr<NetBackend> connect();
+
+private:
+    class Port;
+    using MacKey = std::uint64_t;
+
+    void attach_(Port* port);
+    void detach_(Port* port);
+    void forward_(Port& src, std::span<const iovec> frame, std::size_t len);
+    void deliver_(Port& src, Port& dst, std::span<const iovec> frame, std::size_t len);
+
+    // Ports and their receivers: shared while forwarding, exclusive to
+    // connect, disconnect or change a receiver
+    std::shared_mutex ports_mu_;
+    std::vector<Port*> ports_;
+
+    // MAC learning table (forwarding database)
+    std::mutex fdb_mu_;
+    std::unordered_map<MacKey, Port*> fdb_;
+};
+
+} // namespace remu::devices
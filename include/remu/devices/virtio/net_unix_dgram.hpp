@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <remu/common/result.hpp>
+#include <remu/devices/virtio/net_backend.hpp>
+
+namespace remu::devices {
+
+// A virtio-net backend that exchanges Ethernet frames, one per datagram,
+// over a unix datagram socket: bound to `local_path`, sending to
+// `peer_path`. Two remu processes pointed at each other form a link.
+//
+// Transmit: frames are queued by send() and go out in one sendmmsg() per
+// batch, straight from guest RAM; they are dropped (as on a wire) while
+// the peer isn't there or its socket buffer is full. Receive: a reader
+// thread waits for datagrams and recvmsg()s each into the next receive
+// buffer of the guest, signalling once per burst. With no buffer posted it
+// leaves datagrams in the socket until the guest posts more.
+class UnixDgramBackend final : public NetBackend {
+public:
+    static remu::common::Result<std::unique_ptr<UnixDgramBackend>>
+    open(const std::string& local_path, const std::string& peer_path);
+
+    ~UnixDgramBackend() override;
+
+    UnixDgramBackend(const UnixDgramBackend&) = delete;
+    UnixDgramBackend& operator=(const UnixDgramBackend&) = delete;
+
+    void set_receiver(NetReceiver* rx) override;
+    void send(std::span<const iovec> frame, std::size_t len) override;
+    void end_batch() override;
+    void rx_buffers_posted() override;
+
+private:
+    UnixDgramBackend(int fd, const std::string& local_path, const sockaddr_un& peer,
+                     const int wake_fds[2]);
+
+    void reader_loop_();
+    void wake_reader_();
+
+    int fd_;
+    std::string local_path_; // unlinked on close
+    sockaddr_un peer_;
+
+    // Transmit batch (hart thread): iovecs of all queued frames, then one
+    // header per frame pointing into them
+    std::vector<iovec> tx_iov_;
+    std::vector<std::size_t> tx_frame_start_;
+    std::vector<mmsghdr> tx_msgs_;
+
+    // Held by the reader while it delivers, so set_receiver(nullptr) waits
+    // for a delivery in progress
+    std::mutex rx_mu_;
+    NetReceiver* receiver_ = nullptr;
+
+    std::atomic<bool> stop_{false};
+    int wake_fds_[2] = {-1, -1};
+    std::thread reader_;
+};
+
+} // namespace remu::devices
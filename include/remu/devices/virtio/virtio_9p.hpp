@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <sys/stat.h>
+
+#include <remu/common/result.hpp>
+#include <remu/common/worker_pool.hpp>
+#include <remu/devices/virtio/virtio_mmio.hpp>
+
+namespace remu::devices {
+
+// virtio-9p exporting a host directory over 9P2000.L, for the Linux v9fs
+// client (mount -t 9p -o trans=virtio,version=9p2000.L TAG /mnt).
+//
+// Requests are popped on the hart thread and served by a worker pool, so
+// several are in flight at once and the hart keeps running during host
+// I/O. Tread and Twrite payloads go between the host file and the guest's
+// buffers with preadv()/pwritev() on the chain's iovecs, without an
+// intermediate copy.
+//
+// Every path is resolved beneath the exported directory (openat2 with
+// RESOLVE_BENEATH), so neither ".." nor a symlink created by the guest
+// leads outside it. Files are accessed with remu's own host credentials;
+// ownership changes the host user can't make fail with EPERM.
+class Virtio9p final : public VirtioDevice {
+public:
+    static constexpr std::uint16_t kQueueSize = 128;
+    static constexpr std::size_t kWorkers = 4;
+    static constexpr std::uint32_t kMaxMsize = 512 * 1024;
+
+    static remu::common::Result<std::unique_ptr<Virtio9p>> open(const std::string& root,
+                                                                const std::string& tag);
+    ~Virtio9p() override;
+
+    Virtio9p(const Virtio9p&) = delete;
+    Virtio9p& operator=(const Virtio9p&) = delete;
+
+    std::uint32_t device_id() const override { return virtio::ID_9P; }
+    std::uint64_t device_features() const override;
+    std::uint32_t num_queues() const override { return 1; }
+    std::uint16_t queue_max_size(std::uint32_t) const override { return kQueueSize; }
+    void read_config(std::uint32_t off, std::span<std::uint8_t> out) override;
+    void queue_notify(std::uint32_t q) override;
+    void reset() override;
+
+private:
+    struct Fid;
+    class Request;
+
+    Virtio9p(int root_fd, std::string tag);
+
+    // Worker thread: decode one request, reply and complete it
+    void handle_(const VirtqChain& chain);
+    int dispatch_(Request& req); // 0 or the errno for Rlerror
+
+    // Fid table; entries are shared so a clunk doesn't pull an open file
+    // from under a request still using it
+    std::shared_ptr<Fid> fid_(std::uint32_t id);
+    bool put_fid_(std::uint32_t id, std::shared_ptr<Fid> fid);
+    std::string path_of_(const Fid& fid);
+    void rename_fids_(const std::string& from, const std::string& to);
+
+    // Path helpers (paths are relative to root_fd_, "" being the root)
+    int open_path_(const std::string& path, int flags, int mode = 0) const;
+    int open_parent_(const std::string& path, std::string& leaf) const;
+    int stat_path_(const std::string& path, struct stat& st) const;
+
+    // Message handlers; each returns 0 or an errno for Rlerror
+    int version_(Request& req);
+    int attach_(Request& req);
+    int walk_(Request& req);
+    int getattr_(Request& req);
+    int setattr_(Request& req);
+    int lopen_(Request& req);
+    int lcreate_(Request& req);
+    int read_(Request& req);
+    int write_(Request& req);
+    int readdir_(Request& req);
+    int clunk_(Request& req, bool remove);
+    int statfs_(Request& req);
+    int mkdir_(Request& req);
+    int symlink_(Request& req);
+    int mknod_(Request& req);
+    int readlink_(Request& req);
+    int link_(Request& req);
+    int rename_(Request& req);
+    int renameat_(Request& req);
+    int unlinkat_(Request& req);
+    int fsync_(Request& req);
+    int lock_(Request& req);
+    int getlock_(Request& req);
+
+    int root_fd_;
+    std::string tag_;
+    std::atomic<std::uint32_t> msize_{8192}; // negotiated by Tversion
+
+    std::mutex fids_mu_;
+    std::unordered_map<std::uint32_t, std::shared_ptr<Fid>> fids_;
+
+    // Requests handed to the pool and not yet completed; reset() waits
+    // for them before the ring goes away
+    std::mutex inflight_mu_;
+    std::condition_variable inflight_cv_;
+    std::size_t inflight_ = 0;
+
+    remu::common::WorkerPool pool_; // last: joined before the rest goes
+};
+
+} // namespace remu::devices
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <remu/devices/virtio/virtio_mmio.hpp>
+
+namespace remu::mem {
+class Memory;
+}
+
+namespace remu::devices {
+
+// virtio-balloon: lets the host take guest RAM back.
+//
+// The host sets a target balloon size (set_target_pages()); the driver
+// inflates towards it by handing over page frame numbers on the inflate
+// queue, and deflates by taking them back. With free page reporting
+// (REPORTING), the driver also hands over ranges of pages it has free on
+// the reporting queue. Pages given up either way are discarded from the
+// RAM backing store (madvise MADV_DONTNEED), so the host memory goes back
+// to the OS until the guest touches the pages again. Deflated pages need
+// nothing: they are simply faulted in, zeroed, on next use.
+//
+// Offers DEFLATE_ON_OOM (the guest may deflate under memory pressure
+// without asking) and REPORTING.
+class VirtioBalloon final : public VirtioDevice {
+public:
+    static constexpr std::uint32_t kPageSize = 4096; // fixed by the spec
+
+    explicit VirtioBalloon(remu::mem::Memory& ram, std::uint32_t target_pages = 0);
+
+    // Any thread: ask the guest to grow or shrink the balloon to `pages`
+    void set_target_pages(std::uint32_t pages);
+    std::uint32_t target_pages() const { return target_.load(std::memory_order_relaxed); }
+    // Balloon size the driver last reported
+    std::uint32_t actual_pages() const { return actual_.load(std::memory_order_relaxed); }
+    // Bytes handed back to the host so far (inflated and reported pages)
+    std::uint64_t released_bytes() const { return released_.load(std::memory_order_relaxed); }
+
+    std::uint32_t device_id() const override { return virtio::ID_BALLOON; }
+    std::uint64_t device_features() const override;
+    std::uint32_t num_queues() const override { return 3; }
+    void read_config(std::uint32_t off, std::span<std::uint8_t> out) override;
+    void write_config(std::uint32_t off, std::span<const std::uint8_t> in) override;
+    void queue_notify(std::uint32_t q) override;
+    void reset() override;
+
+private:
+    // Queue indices with DEFLATE_ON_OOM and REPORTING (no stats or hinting
+    // queues in between)
+    static constexpr std::uint32_t kInflateQueue = 0;
+    static constexpr std::uint32_t kDeflateQueue = 1;
+    static constexpr std::uint32_t kReportingQueue = 2;
+
+    void inflate_(const VirtqChain& chain);
+    void report_(const VirtqChain& chain);
+
+    remu::mem::Memory& ram_;
+    std::atomic<std::uint32_t> target_;
+    std::atomic<std::uint32_t> actual_{0};
+    std::atomic<std::uint64_t> released_{0};
+};
+
+} // namespace remu::devices
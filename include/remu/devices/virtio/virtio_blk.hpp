@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <remu/common/result.hpp>
+#include <remu/common/worker_pool.hpp>
+#include <remu/devices/virtio/virtio_mmio.hpp>
+
+namespace remu::devices {
+
+// virtio-blk backed by a host file (raw disk image).
+//
+// Requests are popped on the hart thread and handed to a small worker pool,
+// which does the host I/O with preadv()/pwritev() straight into/out of the
+// guest's buffers (the chain's iovecs point into guest RAM), so the hart
+// keeps running while the disk works and several requests are in flight at
+// once. Each completion publishes its used element and raises the interrupt
+// from the worker; the driver's used_event (EVENT_IDX) keeps that to one
+// interrupt per batch.
+//
+// Offers SEG_MAX, BLK_SIZE, FLUSH (fsync) and, for read-only images, RO.
+// The capacity is the file size rounded down to 512-byte sectors.
+class VirtioBlk final : public VirtioDevice {
+public:
+    static constexpr std::uint16_t kQueueSize = 256;
+    static constexpr std::size_t kWorkers = 4;
+
+    static remu::common::Result<std::unique_ptr<VirtioBlk>> open(const std::string& path,
+                                                                 bool read_only);
+    ~VirtioBlk() override;
+
+    VirtioBlk(const VirtioBlk&) = delete;
+    VirtioBlk& operator=(const VirtioBlk&) = delete;
+
+    std::uint32_t device_id() const override { return virtio::ID_BLOCK; }
+    std::uint64_t device_features() const override;
+    std::uint32_t num_queues() const override { return 1; }
+    std::uint16_t queue_max_size(std::uint32_t) const override { return kQueueSize; }
+    void read_config(std::uint32_t off, std::span<std::uint8_t> out) override;
+    void queue_notify(std::uint32_t q) override;
+    void reset() override;
+
+private:
+    VirtioBlk(int fd, std::uint64_t capacity, bool read_only);
+
+    // Worker thread: carry out one request and complete it
+    void handle_(const VirtqChain& chain);
+    std::uint8_t do_io_(std::uint32_t type, std::uint64_t sector, const VirtqChain& chain,
+                        std::size_t data_out, std::size_t data_in, std::uint32_t& written);
+    void complete_(const VirtqChain& chain, std::uint32_t written);
+
+    int fd_;
+    std::uint64_t capacity_; // in 512-byte sectors
+    bool read_only_;
+
+    // Requests handed to the pool and not yet completed; reset() waits
+    // for them to drain before the rings are torn down.
+    std::mutex inflight_mu_;
+    std::condition_variable inflight_cv_;
+    std::size_t inflight_ = 0;
+
+    remu::common::WorkerPool pool_; // last: joined before the rest goes
+};
+
+} // namespace remu::devices
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <remu/common/worker_pool.hpp>
+#include <remu/devices/virtio/virtio_mmio.hpp>
+
+namespace remu::devices {
+
+// virtio-console with multiport: a bulk byte channel to the host per port.
+//
+// Port 0 is the console port (hvc0 in Linux); further ports show up as
+// /dev/vportNpM, and as /dev/virtio-ports/NAME when named. Each port is
+// backed by host file descriptors:
+// - guest -> host: transmit chains are written with writev() straight from
+//   guest RAM by a per-port writer thread, in order, one syscall per chain;
+// - host -> guest: a per-port reader thread readv()s into the receive
+//   buffers the guest posted, again without an intermediate copy.
+// The hart thread only pops chains and runs the control protocol (port
+// discovery, names, open/close), so a slow host endpoint never stalls it.
+//
+// Also offers EMERG_WRITE: a config-space write emits one byte on port 0,
+// usable before the queues are set up.
+class VirtioConsole final : public VirtioDevice {
+public:
+    static constexpr std::uint32_t kMaxPorts = 16;
+
+    struct PortConfig {
+        std::string name;      // reported to the guest; empty for none
+        int in_fd = -1;        // host -> guest, -1 for an output-only port
+        int out_fd = -1;       // guest -> host, -1 to discard
+        bool owns_fds = false; // close them when the device goes away
+    };
+
+    // 1..kMaxPorts ports; ports[0] is the console.
+    explicit VirtioConsole(std::vector<PortConfig> ports);
+    ~VirtioConsole() override;
+
+    VirtioConsole(const VirtioConsole&) = delete;
+    VirtioConsole& operator=(const VirtioConsole&) = delete;
+
+    std::uint32_t device_id() const override { return virtio::ID_CONSOLE; }
+    std::uint64_t device_features() const override;
+    std::uint32_t num_queues() const override;
+    void read_config(std::uint32_t off, std::span<std::uint8_t> out) override;
+    void write_config(std::uint32_t off, std::span<const std::uint8_t> in) override;
+    void activate() override;
+    void queue_notify(std::uint32_t q) override;
+    void reset() override;
+
+private:
+    struct Port {
+        std::uint32_t id = 0;
+        PortConfig cfg;
+        bool output_failed = false;         // writer thread only
+
+        std::unique_ptr<remu::common::WorkerPool> writer; // one thread: keeps order
+        std::thread reader;                 // only with an in_fd
+        int wake_fds[2] = {-1, -1};         // interrupts the reader's poll()
+
+        std::mutex mu;
+        std::condition_variable cv;
+        std::size_t tx_inflight = 0;
+        bool rx_enabled = false; // between activate() and reset()
+        bool rx_kick = false;    // the guest posted receive buffers
+        bool rx_busy = false;    // reader is using the receive queue
+        bool in_eof = false;     // host side closed its end
+        bool stop = false;
+    };
+
+    // Queue layout with MULTIPORT: port 0 rx/tx, control rx/tx, then
+    // ports 1.. as rx/tx pairs.
+    static std::uint32_t rx_queue_(std::uint32_t port) { return port == 0 ? 0 : 2 + 2 * port; }
+    static std::uint32_t tx_queue_(std::uint32_t port) { return rx_queue_(port) + 1; }
+    static constexpr std::uint32_t kCtrlRx = 2;
+    static constexpr std::uint32_t kCtrlTx = 3;
+
+    void transmit_(Port& port, std::uint32_t q);
+    void write_out_(Port& port, const VirtqChain& chain);
+    void reader_loop_(Port& port);
+    bool wait_readable_(Port& port);
+    void stop_reader_io_(Port& port);
+
+    // Control protocol (hart thread)
+    void handle_control_();
+    void send_control_(std::uint32_t id, std::uint16_t event, std::uint16_t value,
+                       std::string_view extra = {});
+    void flush_control_();
+
+    std::vector<std::unique_ptr<Port>> ports_;
+    std::deque<std::vector<std::uint8_t>> control_out_; // waiting for guest buffers
+};
+
+} // namespace remu::devices
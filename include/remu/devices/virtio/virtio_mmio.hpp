@@ -0,0 +1,197 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+
+#include <remu/devices/reg_map.hpp>
+#include <remu/devices/virtio/virtqueue.hpp>
+
+namespace remu::mem {
+class Bus;
+}
+
+namespace remu::devices {
+
+namespace virtio {
+// Device IDs (virtio 1.x, section 5)
+constexpr std::uint32_t ID_NET     = 1;
+constexpr std::uint32_t ID_BLOCK   = 2;
+constexpr std::uint32_t ID_CONSOLE = 3;
+constexpr std::uint32_t ID_BALLOON = 5;
+constexpr std::uint32_t ID_9P      = 9;
+
+// Transport feature bits the MMIO transport always offers
+constexpr std::uint64_t F_RING_INDIRECT_DESC = 1ull << 28;
+constexpr std::uint64_t F_RING_EVENT_IDX     = 1ull << 29;
+constexpr std::uint64_t F_VERSION_1          = 1ull << 32;
+} // namespace virtio
+
+class VirtioMmio;
+
+// A virtio device model (block, console, net, ...), independent of the
+// transport. The transport owns the virtqueues and negotiates features;
+// the device consumes queue notifications and returns buffers through
+// queue(q).push() followed by notify_used(q).
+//
+// queue_notify(), activate() and reset() run on the hart thread with the
+// transport's register lock held, so they are serialized with each other.
+// notify_used()/notify_config() may be called from any thread (e.g. I/O
+// completions on worker threads).
+class VirtioDevice {
+public:
+    virtual ~VirtioDevice() = default;
+
+    virtual std::uint32_t device_id() const = 0;
+    // Device-specific feature bits (the transport adds VERSION_1,
+    // INDIRECT_DESC and EVENT_IDX)
+    virtual std::uint64_t device_features() const = 0;
+    virtual std::uint32_t num_queues() const = 0;
+    virtual std::uint16_t queue_max_size(std::uint32_t /*q*/) const { return 256; }
+
+    // Device configuration space, at offset 0x100 of the MMIO window.
+    // Reads outside the device's layout return zeros.
+    virtual void read_config(std::uint32_t off, std::span<std::uint8_t> out);
+    virtual void write_config(std::uint32_t /*off*/, std::span<const std::uint8_t> /*in*/) {}
+
+    // The driver set DRIVER_OK: features are final and the queues set up.
+    virtual void activate() {}
+
+    // The driver kicked queue `q`.
+    virtual void queue_notify(std::uint32_t q) = 0;
+
+    // The driver reset the device (status = 0). Finish or cancel any
+    // in-flight work before returning; the queues are reset afterwards.
+    virtual void reset() {}
+
+protected:
+    Virtqueue& queue(std::uint32_t q);
+    bool has_feature(std::uint64_t f) const; // negotiated
+    void notify_used(std::uint32_t q);       // interrupt if the driver wants one
+    void notify_config();                    // configuration changed
+
+    // Helper for read_config(): copy the part of `layout` (the device's
+    // config struct as bytes) that overlaps [off, off + out.size()).
+    static void copy_config(std::span<const std::uint8_t> layout, std::uint32_t off,
+                            std::span<std::uint8_t> out);
+
+private:
+    friend class VirtioMmio;
+    VirtioMmio* transport_ = nullptr;
+};
+
+// virtio-mmio transport, version 2 ("modern"), for one device.
+//
+// Registers follow virtio 1.x section 4.2.2; 32-bit accesses only, except
+// the device configuration space, which takes 8/16/32-bit accesses. The
+// interrupt line (used-buffer and config-change causes, cleared by
+// InterruptACK) is driven through a host callback, typically a PLIC source.
+class VirtioMmio final {
+public:
+    static constexpr std::uint32_t kWindowSize = 0x1000;
+
+    VirtioMmio(remu::mem::Bus& bus, std::unique_ptr<VirtioDevice> dev);
+    ~VirtioMmio();
+
+    VirtioMmio(const VirtioMmio&) = delete;
+    VirtioMmio& operator=(const VirtioMmio&) = delete;
+
+    // MMIO interface (mapped via Bus::map_mmio)
+    bool read (std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t& out);
+    bool write(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t  val);
+
+    void set_irq_line(std::function<void(bool)> set_irq) { set_irq_ = std::move(set_irq); }
+
+    VirtioDevice& device() { return *dev_; }
+
+    // Device-facing (see VirtioDevice)
+    Virtqueue& queue(std::uint32_t q) { return queues_[q]; }
+    bool has_feature(std::uint64_t f) const { return (driver_features_ & f) == f; }
+    void interrupt_used()   { raise_interrupt_(INT_USED); }
+    void interrupt_config() {
+        config_generation_.fetch_add(1, std::memory_order_relaxed);
+        raise_interrupt_(INT_CONFIG);
+    }
+
+private:
+    static constexpr std::uint32_t INT_USED   = 1u << 0;
+    static constexpr std::uint32_t INT_CONFIG = 1u << 1;
+
+    static std::uint32_t off_(std::uint32_t addr) { return addr & (kWindowSize - 1); }
+
+    void raise_interrupt_(std::uint32_t cause);
+    void ack_interrupt_(std::uint32_t cause);
+    void reset_();
+    void set_status_(std::uint32_t val);
+    Virtqueue* selected_();
+
+    // Register handlers (called with mu_ held); one per 32-bit register
+    bool magic_read_       (std::uint32_t off, std::uint32_t& out);
+    bool version_read_     (std::uint32_t off, std::uint32_t& out);
+    bool device_id_read_   (std::uint32_t off, std::uint32_t& out);
+    bool vendor_id_read_   (std::uint32_t off, std::uint32_t& out);
+    bool dev_features_read_(std::uint32_t off, std::uint32_t& out);
+    bool queue_num_max_read_(std::uint32_t off, std::uint32_t& out);
+    bool queue_ready_read_ (std::uint32_t off, std::uint32_t& out);
+    bool int_status_read_  (std::uint32_t off, std::uint32_t& out);
+    bool status_read_      (std::uint32_t off, std::uint32_t& out);
+    bool config_gen_read_  (std::uint32_t off, std::uint32_t& out);
+
+    bool dev_features_sel_write_(std::uint32_t off, std::uint32_t val);
+    bool drv_features_write_    (std::uint32_t off, std::uint32_t val);
+    bool drv_features_sel_write_(std::uint32_t off, std::uint32_t val);
+    bool queue_sel_write_       (std::uint32_t off, std::uint32_t val);
+    bool queue_num_write_       (std::uint32_t off, std::uint32_t val);
+    bool queue_ready_write_     (std::uint32_t off, std::uint32_t val);
+    bool queue_notify_write_    (std::uint32_t off, std::uint32_t val);
+    bool int_ack_write_         (std::uint32_t off, std::uint32_t val);
+    bool status_write_          (std::uint32_t off, std::uint32_t val);
+    bool queue_addr_write_      (std::uint32_t off, std::uint32_t val);
+
+    using Regs = RegMap<VirtioMmio, 64, 2>;
+    static constexpr Regs kRegs_{{
+        {0x000, 4, &VirtioMmio::magic_read_,        nullptr},
+        {0x004, 4, &VirtioMmio::version_read_,      nullptr},
+        {0x008, 4, &VirtioMmio::device_id_read_,    nullptr},
+        {0x00C, 4, &VirtioMmio::vendor_id_read_,    nullptr},
+        {0x010, 4, &VirtioMmio::dev_features_read_, nullptr},
+        {0x014, 4, nullptr, &VirtioMmio::dev_features_sel_write_},
+        {0x020, 4, nullptr, &VirtioMmio::drv_features_write_},
+        {0x024, 4, nullptr, &VirtioMmio::drv_features_sel_write_},
+        {0x030, 4, nullptr, &VirtioMmio::queue_sel_write_},
+        {0x034, 4, &VirtioMmio::queue_num_max_read_, nullptr},
+        {0x038, 4, nullptr, &VirtioMmio::queue_num_write_},
+        {0x044, 4, &VirtioMmio::queue_ready_read_, &VirtioMmio::queue_ready_write_},
+        {0x050, 4, nullptr, &VirtioMmio::queue_notify_write_},
+        {0x060, 4, &VirtioMmio::int_status_read_, nullptr},
+        {0x064, 4, nullptr, &VirtioMmio::int_ack_write_},
+        {0x070, 4, &VirtioMmio::status_read_, &VirtioMmio::status_write_},
+        {0x080, 0x28, nullptr, &VirtioMmio::queue_addr_write_}, // desc/driver/device lo/hi
+        {0x0FC, 4, &VirtioMmio::config_gen_read_, nullptr},
+    }};
+
+private:
+    std::mutex mu_;
+    remu::mem::Bus& bus_;
+    std::unique_ptr<VirtioDevice> dev_;
+    std::unique_ptr<Virtqueue[]> queues_;
+    std::uint32_t num_queues_;
+
+    std::uint64_t device_features_;
+    std::uint64_t driver_features_ = 0;
+    std::uint32_t dev_features_sel_ = 0;
+    std::uint32_t drv_features_sel_ = 0;
+    std::uint32_t queue_sel_ = 0;
+    std::uint32_t status_ = 0;
+    std::atomic<std::uint32_t> config_generation_{0}; // bumped by interrupt_config()
+
+    // Interrupt cause bits and the line they drive; any thread
+    std::mutex irq_mu_;
+    std::uint32_t interrupt_status_ = 0;
+    std::function<void(bool)> set_irq_;
+};
+
+} // namespace remu::devices
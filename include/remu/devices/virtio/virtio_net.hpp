@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <remu/devices/virtio/net_backend.hpp>
+#include <remu/devices/virtio/virtio_mmio.hpp>
+
+namespace remu::devices {
+
+// virtio-net with one receive and one transmit queue, attached to a
+// NetBackend.
+//
+// Transmit: a kick pops up to kTxBatch chains, hands each frame (still in
+// guest RAM) to the backend, ends the batch, then returns the whole batch
+// with a single interrupt decision. Receive: backends call receive() from
+// their own thread (or, for the in-process switch, the sending machine's
+// hart thread), which writes the frame straight into the next posted
+// buffer, and flush_rx() once per batch. With EVENT_IDX both directions
+// coalesce kicks and interrupts.
+//
+// Offers MAC and STATUS (link always up). No checksum or segmentation
+// offloads, so every frame is a plain Ethernet frame.
+class VirtioNet final : public VirtioDevice, public NetReceiver {
+public:
+    using Mac = std::array<std::uint8_t, 6>;
+
+    static constexpr std::uint16_t kQueueSize = 256;
+    static constexpr std::size_t kTxBatch = 64;
+
+    VirtioNet(const Mac& mac, std::unique_ptr<NetBackend> backend);
+    ~VirtioNet() override;
+
+    VirtioNet(const VirtioNet&) = delete;
+    VirtioNet& operator=(const VirtioNet&) = delete;
+
+    // VirtioDevice
+    std::uint32_t device_id() const override { return virtio::ID_NET; }
+    std::uint64_t device_features() const override;
+    std::uint32_t num_queues() const override { return 2; }
+    std::uint16_t queue_max_size(std::uint32_t) const override { return kQueueSize; }
+    void read_config(std::uint32_t off, std::span<std::uint8_t> out) override;
+    void activate() override;
+    void queue_notify(std::uint32_t q) override;
+    void reset() override;
+
+    // NetReceiver
+    bool receive(const Fill& fill) override;
+    void flush_rx() override;
+
+private:
+    static constexpr std::uint32_t kRxQueue = 0;
+    static constexpr std::uint32_t kTxQueue = 1;
+
+    void transmit_();
+
+    Mac mac_;
+    std::unique_ptr<NetBackend> backend_;
+
+    // Transmit batch (hart thread); entries are reused across batches
+    std::vector<VirtqChain> tx_chains_;
+    std::vector<iovec> tx_frame_;
+
+    // Receive side; receive() may run on several threads at once
+    std::mutex rx_mu_;
+    bool rx_enabled_ = false;
+    VirtqChain rx_chain_;
+    std::vector<iovec> rx_frame_;
+    std::atomic<bool> rx_unsignalled_{false};
+};
+
+} // namespace remu::devices
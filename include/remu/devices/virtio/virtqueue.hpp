@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <sys/uio.h>
+
+namespace remu::mem {
+class Bus;
+class Memory;
+}
+
+namespace remu::devices {
+
+// One descriptor chain popped from a virtqueue, resolved to host memory.
+// `out` are the device-readable buffers (driver -> device), `in` the
+// device-writable ones, each in chain order; the iovecs point straight into
+// guest RAM, so backends can hand them to readv/writev/preadv/pwritev.
+struct VirtqChain {
+    // Where a device-writable buffer lives, for dirty tracking at push()
+    struct InRange {
+        remu::mem::Memory* mem;
+        std::uint32_t addr;
+        std::uint32_t len;
+    };
+
+    std::uint16_t head = 0;
+    std::vector<iovec> out;
+    std::vector<iovec> in;
+    std::vector<InRange> in_ranges; // parallel to `in`
+    std::size_t out_len = 0;
+    std::size_t in_len = 0;
+
+    void clear() {
+        out.clear();
+        in.clear();
+        in_ranges.clear();
+        out_len = in_len = 0;
+    }
+};
+
+// Device side of a split virtqueue (virtio 1.x, section 2.7).
+//
+// The transport fills in the ring addresses and size and calls enable(),
+// which resolves the three rings to host pointers once. After that:
+// - pop() walks the next available chain, following NEXT links and indirect
+//   tables, and must only be called from one thread at a time (normally
+//   the hart thread, from a queue notification);
+// - push() publishes a used element and may be called from any thread
+//   (I/O completions), as may should_interrupt().
+//
+// With VIRTIO_F_EVENT_IDX negotiated, pop() keeps avail_event current (the
+// driver only kicks for new work past it) and should_interrupt() honours the
+// driver's used_event; otherwise the ring flags are used.
+class Virtqueue {
+public:
+    static constexpr std::uint16_t kMaxSize = 1024;
+
+    // Transport-facing configuration (hart thread, queue not ready)
+    void set_size(std::uint16_t n) { size_ = n; }
+    std::uint16_t size() const { return size_; }
+    void set_desc_addr(std::uint64_t a) { desc_addr_ = a; }
+    void set_avail_addr(std::uint64_t a) { avail_addr_ = a; }
+    void set_used_addr(std::uint64_t a) { used_addr_ = a; }
+    std::uint64_t desc_addr() const { return desc_addr_; }
+    std::uint64_t avail_addr() const { return avail_addr_; }
+    std::uint64_t used_addr() const { return used_addr_; }
+
+    // Resolve the rings in guest RAM and start processing. False if the
+    // size or an address is invalid (the queue stays disabled).
+    bool enable(remu::mem::Bus& bus, bool event_idx);
+    bool ready() const { return ready_; }
+
+    // Back to the post-reset state (addresses, size and indices cleared).
+    void reset();
+
+    // Next available chain, or false if there is none. A malformed chain
+    // (loops, bad addresses, readable after writable) marks the queue
+    // broken and also returns false.
+    bool pop(VirtqChain& chain);
+    bool broken() const { return broken_; }
+
+    // Return a chain to the driver, `written` bytes having been stored in
+    // its device-writable buffers. Those are marked dirty here, once the
+    // device is done writing them, rather than at pop().
+    void push(const VirtqChain& chain, std::uint32_t written);
+
+    // After one or more push()es: does the driver want an interrupt?
+    bool should_interrupt();
+
+private:
+    struct Desc {
+        std::uint64_t addr;
+        std::uint32_t len;
+        std::uint16_t flags;
+        std::uint16_t next;
+    };
+
+    bool add_buffer_(VirtqChain& chain, const Desc& d);
+    bool walk_indirect_(VirtqChain& chain, const Desc& d);
+
+    std::uint16_t avail_idx_() const;
+    std::uint16_t avail_flags_() const;
+    std::uint16_t used_event_() const;
+    void set_avail_event_(std::uint16_t v);
+
+    remu::mem::Bus* bus_ = nullptr;
+
+    std::uint16_t size_ = 0;
+    std::uint64_t desc_addr_ = 0;
+    std::uint64_t avail_addr_ = 0;
+    std::uint64_t used_addr_ = 0;
+
+    // Host views of the rings (valid while ready_)
+    const std::uint8_t* desc_ = nullptr;
+    std::uint8_t* avail_ = nullptr;
+    std::uint8_t* used_ = nullptr;
+    remu::mem::Memory* used_mem_ = nullptr;
+
+    bool ready_ = false;
+    bool event_idx_ = false;
+    bool broken_ = false;
+
+    // Consumer side (pop)
+    std::uint16_t last_avail_ = 0;
+
+    // Producer side (push/should_interrupt)
+    std::mutex used_mu_;
+    std::uint16_t used_idx_ = 0;
+    std::uint16_t signalled_used_ = 0;
+    bool signalled_valid_ = false;
+};
+
+} // namespace remu::devices
@@ -14,4 +14,9 @@ namespace remu::loaders {
 remu::common::Result<long> load_file_into_guest(remu::mem::Memory& ram,
                                                const std::string& path);
 
+// Copy an in-memory image (e.g. a generated DTB) to the start of `mem`.
+// Fails if it doesn't fit.
+remu::common::Result<long> load_bytes_into_guest(remu::mem::Memory& mem,
+                                                std::span<const std::uint8_t> image);
+
 }  // namespace remu::loaders
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cstdint>
+#include <mutex>
+#include <span>
 #include <vector>
 
 #include <remu/mem/region.hpp>
@@ -11,7 +13,25 @@ class Bus {
 public:
     // Map regions (call from platform/machine setup)
     void map_ram (std::uint32_t base, std::uint32_t size, Memory& ram);
-    void map_mmio(std::uint32_t base, std::uint32_t size, MmioDevice& dev);
+
+    // Dev is bound by its concrete type (see MmioOps::bind); passing an
+    // MmioDevice& keeps the old virtual dispatch.
+    template <class Dev>
+    void map_mmio(std::uint32_t base, std::uint32_t size, Dev& dev) {
+        regions_.push_back(Region::make_mmio(base, size, MmioOps::bind(dev)));
+    }
+
+    // Several harts on host threads: serialize device-side work on `mu`.
+    // Every MMIO access made through the bus holds it, as should anything
+    // else a hart thread does to device state (event processing, host
+    // services). Null (the default, one hart): no locking at all.
+    void set_device_lock(std::recursive_mutex* mu) { device_mu_ = mu; }
+
+    // Holds the device lock, if there is one, for the guard's lifetime
+    std::unique_lock<std::recursive_mutex> device_lock() const {
+        if (device_mu_ == nullptr) return {};
+        return std::unique_lock<std::recursive_mutex>(*device_mu_);
+    }
 
     // Loads/stores used by CPU + loaders
     bool read8 (std::uint32_t addr, std::uint8_t&  out);
@@ -22,16 +42,46 @@ public:
     bool write16(std::uint32_t addr, std::uint16_t val);
     bool write32(std::uint32_t addr, std::uint32_t val);
 
+    // Bulk access (DMA-style devices, debuggers, snapshotters, loaders).
+    // translate() returns a host view of [addr, addr+len) when the whole range
+    // lies in a single RAM region, or an empty span otherwise (MMIO, unmapped,
+    // straddling regions, or len == 0).
+    std::span<std::uint8_t> translate(std::uint32_t addr, std::uint32_t len);
+
+    // The RAM backing [addr, addr+len), or nullptr under the same conditions
+    // translate() returns an empty span. Used by the CPU's TLB, which keeps a
+    // host pointer per page and needs the Memory for dirty tracking.
+    Memory* ram_at(std::uint32_t addr, std::uint32_t len);
+
+    // Copy a guest range in/out. RAM chunks are moved with memcpy; MMIO chunks
+    // fall back to byte-wide device accesses. Ranges may span several regions.
+    // Returns false if any byte of the range is unmapped or a device rejects it.
+    bool read_block (std::uint32_t addr, std::span<std::uint8_t> out);
+    bool write_block(std::uint32_t addr, std::span<const std::uint8_t> data);
+    bool fill       (std::uint32_t addr, std::uint8_t value, std::uint32_t len);
+
 private:
     Region*       find_region_(std::uint32_t addr, std::uint32_t len);
     const Region* find_region_(std::uint32_t addr, std::uint32_t len) const;
 
     // Helpers
-    bool mmio_read_(MmioDevice& dev, std::uint32_t addr, std::uint32_t width, std::uint32_t& out);
-    bool mmio_write_(MmioDevice& dev, std::uint32_t addr, std::uint32_t width, std::uint32_t val);
+    bool mmio_read_(const MmioOps& ops, std::uint32_t addr, std::uint32_t width, std::uint32_t& out) const {
+        const auto lock = device_lock();
+        return ops.read(ops.ctx, addr, width, out);
+    }
+    bool mmio_write_(const MmioOps& ops, std::uint32_t addr, std::uint32_t width, std::uint32_t val) const {
+        const auto lock = device_lock();
+        return ops.write(ops.ctx, addr, width, val);
+    }
+
+    // Whether [addr, addr + len) stays below 4 GiB.
+    static bool fits_address_space_(std::uint32_t addr, std::uint64_t len);
+    // Bytes of `r` available from addr onwards, clamped to `len`.
+    static std::uint32_t chunk_len_(const Region& r, std::uint32_t addr, std::uint64_t len);
 
 private:
     std::vector<Region> regions_;
+    std::recursive_mutex* device_mu_ = nullptr;
 };
 
 } // namespace remu::mem
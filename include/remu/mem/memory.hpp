@@ -1,13 +1,25 @@
 #pragma once
+#include <atomic>
 #include <cstdint>
+#include <memory>
 #include <span>
 #include <vector>
 
 namespace remu::mem {
 
+// Guest RAM. The backing store is an anonymous private mapping, so host
+// pages are only committed once the guest touches them and can be handed
+// back with discard().
 class Memory {
    public:
     Memory(std::uint32_t base, std::uint32_t size_bytes);
+    // Adopt an existing mapping of size_bytes (e.g. a MAP_SHARED view of a
+    // host shared-memory object); it is munmap'd on destruction.
+    Memory(std::uint32_t base, std::uint32_t size_bytes, std::uint8_t* mapping);
+    ~Memory();
+
+    Memory(const Memory&) = delete;
+    Memory& operator=(const Memory&) = delete;
 
     std::uint32_t base() const { return base_; }
     std::uint32_t size() const { return size_; }
@@ -16,6 +28,10 @@ class Memory {
     std::span<std::uint8_t> bytes();
     std::span<const std::uint8_t> bytes() const;
 
+    // Host view of [paddr, paddr+len); empty if the range is not fully inside.
+    std::span<std::uint8_t> view(std::uint32_t paddr, std::uint32_t len);
+    std::span<const std::uint8_t> view(std::uint32_t paddr, std::uint32_t len) const;
+
     // Read/write helpers (little-endian)
     bool read8(std::uint32_t paddr, std::uint8_t& out) const;
     bool read16(std::uint32_t paddr, std::uint16_t& out) const;
@@ -25,13 +41,58 @@ class Memory {
     bool write16(std::uint32_t paddr, std::uint16_t val);
     bool write32(std::uint32_t paddr, std::uint32_t val);
 
+    // Return the host pages behind [paddr, paddr+len) to the OS (madvise
+    // MADV_DONTNEED); the guest reads them back as zeros. Only host pages
+    // wholly inside the range go; returns the bytes released. Host pointers
+    // from bytes()/view() stay valid. Any thread. Does nothing on an adopted
+    // mapping: its pages may be shared with other users.
+    std::uint32_t discard(std::uint32_t paddr, std::uint32_t len);
+
+    // Dirty-page tracking (4 KiB pages), off by default. While enabled, each
+    // store through this object sets its page's bit; while disabled the store
+    // path only tests a flag. Bits are atomic, so stores and collect_dirty()
+    // may run on different threads. Turning tracking on or off is safe while
+    // harts and device workers run: the bitmap, once allocated, lives as long
+    // as the Memory. Call enable_dirty_tracking() from one thread at a time.
+    static constexpr std::uint32_t kPageShift = 12;
+    static constexpr std::uint32_t kPageSize  = 1u << kPageShift;
+
+    void enable_dirty_tracking(bool on);
+    bool dirty_tracking() const { return tracking_.load(std::memory_order_acquire); }
+
+    // For host-side writers that go through bytes()/view() directly.
+    void mark_dirty(std::uint32_t paddr, std::uint32_t len) {
+        if (len != 0 && dirty_tracking()) mark_dirty_range_(paddr, len);
+    }
+
+    // Read-and-clear: appends the guest-physical base address of every page
+    // dirtied since the previous call to `pages`; returns how many were added.
+    std::size_t collect_dirty(std::vector<std::uint32_t>& pages);
+
    private:
     bool check_range_(std::uint32_t paddr, std::uint32_t len) const;
     std::size_t index_(std::uint32_t paddr) const;
 
+    void mark_dirty_page_(std::size_t page) {
+        auto& word = dirty_[page >> 6];
+        const std::uint64_t bit = 1ull << (page & 63u);
+        // Test first: re-dirtying a page is the common case and a plain load
+        // keeps the cache line shared instead of issuing a locked RMW.
+        if ((word.load(std::memory_order_relaxed) & bit) == 0) {
+            word.fetch_or(bit, std::memory_order_relaxed);
+        }
+    }
+    void mark_dirty_range_(std::uint32_t paddr, std::uint32_t len);
+
     std::uint32_t base_{0};
     std::uint32_t size_{0};
-    std::vector<std::uint8_t> data_;
+    std::uint8_t* data_{nullptr}; // mmap'd, size_ bytes
+    bool adopted_{false};
+
+    // Published by the release store of tracking_; never freed before ~Memory
+    std::unique_ptr<std::atomic<std::uint64_t>[]> dirty_;
+    std::size_t dirty_words_{0};
+    std::atomic<bool> tracking_{false};
 };
 
 }  // namespace remu::mem
@@ -7,7 +7,9 @@ namespace remu::mem {
 
 class Memory;  // your direct RAM object (owns bytes)
 
-// Simple MMIO device interface: devices implement this.
+// Optional polymorphic MMIO interface, for devices that are only known
+// through a base pointer. Concrete platform devices don't need it: anything
+// with matching read/write members can be mapped via Bus::map_mmio<Dev>.
 class MmioDevice {
    public:
     virtual ~MmioDevice() = default;
@@ -19,6 +21,34 @@ class MmioDevice {
                        std::uint32_t val) = 0;
 };
 
+// Devirtualized MMIO entry points. bind<Dev>() produces thunks that call
+// Dev's read/write through the concrete type, so for final device classes
+// the access is one indirect call with no vtable load, and the device's own
+// register-map dispatch is inlined into the thunk.
+struct MmioOps {
+    using ReadFn  = bool (*)(void* ctx, std::uint32_t addr,
+                             std::uint32_t width_bytes, std::uint32_t& out);
+    using WriteFn = bool (*)(void* ctx, std::uint32_t addr,
+                             std::uint32_t width_bytes, std::uint32_t val);
+
+    void*   ctx   = nullptr;
+    ReadFn  read  = nullptr;
+    WriteFn write = nullptr;
+
+    template <class Dev>
+    static MmioOps bind(Dev& dev) {
+        return MmioOps{
+            &dev,
+            [](void* c, std::uint32_t addr, std::uint32_t width, std::uint32_t& out) {
+                return static_cast<Dev*>(c)->read(addr, width, out);
+            },
+            [](void* c, std::uint32_t addr, std::uint32_t width, std::uint32_t val) {
+                return static_cast<Dev*>(c)->write(addr, width, val);
+            },
+        };
+    }
+};
+
 struct Region {
     enum class Kind { Ram, Mmio };
 
@@ -26,8 +56,8 @@ struct Region {
     std::uint32_t size = 0;
     Kind kind = Kind::Ram;
 
-    Memory* ram = nullptr;       // valid when kind==Ram
-    MmioDevice* mmio = nullptr;  // valid when kind==Mmio
+    Memory* ram = nullptr;  // valid when kind==Ram
+    MmioOps mmio{};         // valid when kind==Mmio
 
     bool contains(std::uint32_t addr, std::uint32_t len = 1) const {
         // careful about overflow
@@ -40,13 +70,13 @@ struct Region {
     static Region make_ram(std::uint32_t base, std::uint32_t size,
                            Memory* ram) {
         assert(ram != nullptr);
-        return Region{base, size, Kind::Ram, ram, nullptr};
+        return Region{base, size, Kind::Ram, ram, MmioOps{}};
     }
 
     static Region make_mmio(std::uint32_t base, std::uint32_t size,
-                            MmioDevice* dev) {
-        assert(dev != nullptr);
-        return Region{base, size, Kind::Mmio, nullptr, dev};
+                            MmioOps ops) {
+        assert(ops.ctx != nullptr && ops.read != nullptr && ops.write != nullptr);
+        return Region{base, size, Kind::Mmio, nullptr, ops};
     }
 };
 
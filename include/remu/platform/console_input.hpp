@@ -5,8 +5,10 @@
 namespace remu::platform {
 
 // Puts the host terminal into raw mode (if stdin is a TTY) and starts a
-// background thread that forwards every byte typed on stdin into the guest
-// UART's receive register, byte by byte, as they arrive.
+// background thread that forwards everything read from stdin into the guest
+// UART, in batches of up to a page, through the UART's lock-free input ring.
+// When the ring is full the thread waits for the guest to catch up, so large
+// pastes or piped input are never dropped.
 //
 // Raw mode disables host-side line buffering/echo/signal keys so the guest
 // console behaves like a real serial terminal (e.g. Ctrl-C reaches the guest
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+#include <remu/common/result.hpp>
+#include <remu/platform/host_channel.hpp>
+
+namespace remu::platform {
+
+// Buffered sink for the guest UART's transmit side.
+//
+// The hart thread appends bytes to a single-producer/single-consumer ring
+// (put() is a store plus an atomic index update, no syscall); a dedicated
+// I/O thread drains it with writev(), so a boot log costs one syscall per
+// line or per burst instead of one per character. The ring is flushed:
+// - at once on a newline, or when it is more than half full;
+// - otherwise kFlushDelay after the first byte of a burst, so prompts and
+//   echoed keystrokes without a newline still show up promptly.
+// When the backend can't keep up and the ring fills, put() waits for space
+// rather than dropping guest output.
+//
+// Backends are selected by open() with a HostChannel spec: stdout
+// (default), file:PATH, pipe:PATH or unix:PATH.
+class ConsoleOutput {
+public:
+    static constexpr std::size_t kRingSize = 64 * 1024; // power of two
+    static constexpr auto kFlushDelay = std::chrono::milliseconds(5);
+
+    ConsoleOutput() = default;
+    ~ConsoleOutput();
+
+    ConsoleOutput(const ConsoleOutput&) = delete;
+    ConsoleOutput& operator=(const ConsoleOutput&) = delete;
+
+    // Open the backend named by `spec` and start the I/O thread.
+    remu::common::Result<void> open(std::string_view spec);
+
+    // Hart thread: queue one byte of guest output.
+    void put(std::uint8_t byte) {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == kRingSize) wait_for_space_();
+
+        ring_[tail & (kRingSize - 1)] = byte;
+        // Pairs with the consumer's store to head_ before it goes to sleep:
+        // at least one side sees the other, so no byte is left stranded.
+        tail_.store(tail + 1, std::memory_order_seq_cst);
+        const std::size_t used = tail + 1 - head_.load(std::memory_order_seq_cst);
+
+        if (byte == '\n' || used > kRingSize / 2) {
+            signal_(true);
+        } else if (used == 1) {
+            signal_(false);
+        }
+    }
+
+    // Write out everything queued so far and stop the I/O thread. Called by
+    // the destructor; safe to call more than once.
+    void close();
+
+private:
+    void signal_(bool urgent);
+    void wait_for_space_();
+    void io_loop_();
+    void drain_();
+    bool write_all_(const std::uint8_t* a, std::size_t alen,
+                    const std::uint8_t* b, std::size_t blen);
+
+    std::array<std::uint8_t, kRingSize> ring_{};
+    std::atomic<std::size_t> head_{0}; // consumer position
+    std::atomic<std::size_t> tail_{0}; // producer position
+
+    HostChannel channel_;
+    bool failed_ = false; // backend went away; output is discarded
+
+    std::mutex mu_;
+    std::condition_variable cv_;       // I/O thread waits here
+    std::condition_variable space_cv_; // producer waits here when full
+    bool kick_ = false;                // a burst started
+    bool urgent_ = false;              // flush now
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+} // namespace remu::platform
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace remu::platform {
+
+// Writes a flattened device tree (DTB, version 17) in one pass.
+//
+// Nodes are opened and closed in document order; properties go to the
+// innermost open node. Cell values are given in host order and stored
+// big-endian. Property names are de-duplicated in the strings block.
+//
+//   FdtBuilder fdt;
+//   fdt.begin_node("");                  // root
+//   fdt.prop_u32("#address-cells", 2);
+//   fdt.begin_node("chosen");
+//   fdt.prop_string("bootargs", "console=ttyS0");
+//   fdt.end_node();
+//   fdt.end_node();
+//   std::vector<std::uint8_t> dtb = fdt.finish();
+class FdtBuilder {
+public:
+    void begin_node(std::string_view name);
+    void end_node();
+
+    void prop(std::string_view name, std::span<const std::uint8_t> value);
+    void prop_empty(std::string_view name) { prop(name, {}); }
+    void prop_u32(std::string_view name, std::uint32_t value) { prop_cells(name, {value}); }
+    void prop_cells(std::string_view name, std::initializer_list<std::uint32_t> cells);
+    void prop_cells(std::string_view name, std::span<const std::uint32_t> cells);
+    void prop_string(std::string_view name, std::string_view value);
+    // A string list (e.g. compatible = "a", "b")
+    void prop_strings(std::string_view name, std::initializer_list<std::string_view> values);
+
+    // Next unused phandle value (1, 2, ...), for nodes others refer to
+    std::uint32_t alloc_phandle() { return next_phandle_++; }
+
+    // Close the structure block and return the complete blob. All nodes
+    // must have been closed.
+    std::vector<std::uint8_t> finish(std::uint32_t boot_cpuid = 0);
+
+private:
+    void token_(std::uint32_t tok);
+    void u32_(std::uint32_t v);
+    void pad_();
+    std::uint32_t name_offset_(std::string_view name);
+
+    std::vector<std::uint8_t> struct_;
+    std::string strings_;
+    std::unordered_map<std::string, std::uint32_t> string_offsets_;
+    int depth_ = 0;
+    std::uint32_t next_phandle_ = 1;
+};
+
+} // namespace remu::platform
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string_view>
+
+#include <remu/common/result.hpp>
+
+namespace remu::platform {
+
+// A host endpoint for a guest character stream (console output, a
+// virtio-console port), opened from a spec string:
+//   stdout         the host's standard output (output only)
+//   file:PATH      a regular file, created or truncated (output only)
+//   pipe:PATH      a named pipe, created if missing; blocks until a reader
+//                  opens the other end (output only)
+//   unix:PATH      a connection to a listening unix stream socket, in both
+//                  directions
+// For pipe and unix endpoints SIGPIPE is ignored process-wide, so a reader
+// going away surfaces as EPIPE rather than killing remu.
+struct HostChannel {
+    int read_fd = -1;  // -1 if the endpoint is output-only
+    int write_fd = -1;
+    bool owns_fds = false;
+
+    // Close the descriptors if they are ours (stdout is left open).
+    void close();
+};
+
+remu::common::Result<HostChannel> open_host_channel(std::string_view spec);
+
+} // namespace remu::platform
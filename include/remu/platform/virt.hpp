@@ -1,19 +1,84 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <remu/common/event_queue.hpp>
 #include <remu/mem/bus.hpp>
 #include <remu/mem/memory.hpp>
 #include <remu/cpu/cpu.hpp>
+#include <remu/cpu/reservation.hpp>
 
 #include <remu/devices/uart.hpp>
+#include <remu/devices/bulk_op.hpp>
 #include <remu/devices/clint.hpp>
+#include <remu/devices/guest_exit.hpp>
+#include <remu/devices/htif.hpp>
+#include <remu/devices/ivshmem.hpp>
 #include <remu/devices/plic.hpp>
+#include <remu/devices/test_finisher.hpp>
+#include <remu/devices/virtio/virtio_mmio.hpp>
+#include <remu/platform/wakeup.hpp>
 
 namespace remu::platform {
 
 class VirtMachine {
    public:
-    explicit VirtMachine(std::uint32_t mem_size_bytes);
+    // Largest --smp
+    static constexpr std::uint32_t kMaxHarts = 32;
+
+    // virtio-mmio slots: 0x10001000 + 0x1000 * n, PLIC IRQ 1 + n
+    static constexpr std::uint32_t kVirtioSlots = 8;
+
+    // Shared-memory window of an inter-VM device: guest-physical base (open
+    // the IvShmem there) and largest size, up to the start of RAM
+    static constexpr std::uint32_t kIvshmemShmBase = 0x4000'0000;
+    static constexpr std::uint32_t kIvshmemMaxSize = 0x4000'0000;
+
+    // Kernel command line used when the DTB is generated and none is given
+    static constexpr std::string_view kDefaultBootargs =
+        "earlycon=uart8250,mmio,0x10000000,1000000 console=ttyS0";
+
+    // One hart's Cpu and its platform-side state. Each hart thread passes
+    // its own to tick() and idle(); nothing else touches the Cpu while the
+    // hart runs.
+    struct alignas(64) Hart {
+        std::uint32_t id = 0;
+
+        // Cycles passed to tick() on this hart, and the count at which tick()
+        // next services devices: the next event deadline in icount mode, or
+        // the next host clock poll in realtime mode.
+        std::uint64_t ticks = 0;
+        std::uint64_t service_at = 0;
+        // Set (from any thread) when this hart's interrupt state or the
+        // event schedule changed and it should service before its next
+        // instruction.
+        std::atomic<bool> service_pending{true};
+
+        // Wakes the hart out of a realtime-mode WFI or WRS sleep
+        Wakeup wakeup;
+
+        // The reservation line this hart waits on in WRS, or kNoLine; an SC
+        // or AMO there wakes it
+        static constexpr std::uint32_t kNoLine = ~0u;
+        std::atomic<std::uint32_t> wrs_line{kNoLine};
+
+        remu::cpu::Cpu cpu;
+    };
+
+    // `harts` (1..kMaxHarts) harts, numbered from 0, all sharing the RAM,
+    // the devices and the event queue. With more than one, device work is
+    // serialized on the bus's device lock so the harts can run on their own
+    // host threads.
+    explicit VirtMachine(std::uint32_t mem_size_bytes, std::uint32_t harts = 1);
+
+    std::uint32_t num_harts() const { return num_harts_; }
+    Hart& hart(std::uint32_t id) { return harts_[id]; }
 
     // Access bus for CPU + loaders
     remu::mem::Bus& bus() { return bus_; }
@@ -31,31 +96,152 @@ class VirtMachine {
     remu::devices::UartNs16550& uart() { return uart_; }
     const remu::devices::UartNs16550& uart() const { return uart_; }
 
+    // CLINT accessor (timebase selection, time CSR wiring)
+    remu::devices::Clint& clint() { return clint_; }
+    const remu::devices::Clint& clint() const { return clint_; }
+
+    // HTIF accessor (wiring its console output)
+    remu::devices::Htif& htif() { return htif_; }
+
+    // Set once guest software asks to stop, through the test finisher or
+    // HTIF; the first request wins
+    struct ExitRequest {
+        remu::devices::GuestExit kind;
+        std::uint32_t code;
+    };
+    std::optional<ExitRequest> exit_request() const;
+    // Any hart thread: stop the run as a guest exit (devices and semihosting)
+    void request_exit(remu::devices::GuestExit kind, std::uint32_t code);
+
+    // Any thread: stop every hart at its next tick() without a guest exit
+    // (one hart stopped on a fault, or the host is shutting down)
+    void halt();
+
+    // Attach a virtio device to the next free virtio-mmio slot and wire its
+    // interrupt to the PLIC. Call before the hart starts and before
+    // build_dtb(). False if every slot is taken.
+    bool add_virtio(std::unique_ptr<remu::devices::VirtioDevice> dev);
+
+    // Attach the shared-memory inter-VM device: its window as RAM at
+    // kIvshmemShmBase, its registers as MMIO and its interrupt on the PLIC.
+    // Same rules as add_virtio(); false if one is already attached or the
+    // window was not opened at kIvshmemShmBase.
+    bool add_ivshmem(std::unique_ptr<remu::devices::IvShmem> dev);
+
+    // A flattened device tree describing this machine as configured: the
+    // actual RAM size, the fixed devices and every attached virtio device.
+    std::vector<std::uint8_t> build_dtb(std::string_view bootargs) const;
+
     // Convenience accessors (optional)
     std::uint32_t ram_base() const { return ram_base_; }
     std::uint32_t ram_size() const { return mem_size_bytes_; }
     std::uint32_t dtb_base() const { return dtb_base_; }
 
-    // Optional: tick devices (timers/interrupts). Call this from Sim loop.
-    void tick(std::uint64_t cycles, remu::cpu::Cpu& cpu);
+    // Device event queue, keyed on the CLINT's clock (now()). Devices
+    // schedule callbacks here instead of being polled every instruction.
+    remu::common::EventQueue& events() { return events_; }
+
+    // Call from the Sim loop once per instruction, on the hart's thread.
+    // Cheap unless an event is due or interrupt state changed: only then are
+    // events fired and mip refreshed, so device cost scales with events, not
+    // instructions. False once the guest has asked to stop (exit_request())
+    // or the machine was halted.
+    bool tick(std::uint64_t cycles, Hart& hart) {
+        // Icount time counts the instructions of every hart, which then share
+        // one thread; realtime harts keep to their own counters rather than
+        // share a cache line per instruction
+        if (clint_.timebase() == remu::devices::Timebase::Icount) clint_.tick(cycles);
+        hart.ticks += cycles;
+        if (hart.ticks >= hart.service_at ||
+            hart.service_pending.load(std::memory_order_relaxed)) {
+            service_(hart);
+            return !stopping_.load(std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // The hart executed WFI with nothing pending. In icount mode, advance
+    // virtual time straight to the next event (e.g. the timer deadline); in
+    // realtime mode, sleep on the host until then or until a device raises
+    // an interrupt. Refreshes mip either way. Returns the timebase ticks
+    // spent idle (0 if there was nothing to wait for).
+    std::uint64_t idle(Hart& hart);
+
+    // The hart executed WRS (Zawrs) holding a reservation. In realtime mode,
+    // give up the host until another hart writes the reservation set, an
+    // interrupt is pending in mie, or the wait times out: a short timeout
+    // for WRS.STO, the next event or the WFI backstop for WRS.NTO. Spins
+    // with host yields at first, so a quick release costs no sleep. Icount
+    // harts share one thread and have nothing to wait for: returns at once.
+    // Returns the timebase ticks spent waiting.
+    std::uint64_t wait_reservation(Hart& hart, bool short_timeout);
+
+    // For a scheduler running several harts on one thread (icount mode).
+    // resume(): switching to `hart`, whose view of the schedule went stale
+    // while the others moved the shared clock; service it now. True if it
+    // has an interrupt to take (mip & mie), i.e. a WFI it waits in is over.
+    // skip_idle_time(): every hart waits in WFI; jump virtual time to the
+    // next event and fire it. Returns the ticks skipped (0 if nothing is
+    // scheduled).
+    bool resume(Hart& hart);
+    std::uint64_t skip_idle_time();
 
    private:
     void map_devices_();
 
+    // Fire due events, pick the hart's next service point, and refresh its
+    // mip.
+    void service_(Hart& hart);
+    void update_mip_(Hart& hart);
+
+    // Have every hart service before its next instruction (and wake it)
+    void kick_all_();
+
    private:
+    const std::uint32_t num_harts_;
     std::uint32_t ram_base_;
     std::uint32_t mem_size_bytes_;
     std::uint32_t dtb_base_; // optional, for future use
 
+    // Serializes device work across harts (see Bus::set_device_lock); only
+    // installed with more than one hart
+    std::recursive_mutex device_mu_;
+
     // Owned components
     remu::mem::Memory ram_;
     remu::mem::Memory dtb_;
     remu::mem::Bus bus_;
 
+    // Declared before every device: a device thread still draining at
+    // teardown interrupts through the PLIC hook, which kicks the harts
+    remu::common::EventQueue events_;
+
+    // LR/SC reservation sets of all harts
+    remu::cpu::ReservationSets reservations_;
+
+    std::unique_ptr<Hart[]> harts_;
+
     // Minimal compulsory devices for Linux bring-up
     remu::devices::UartNs16550 uart_;
     remu::devices::Clint clint_;
     remu::devices::Plic plic_;
+
+    // Ways for guest software to end the run
+    remu::devices::TestFinisher finisher_;
+    remu::devices::Htif htif_;
+    mutable std::mutex exit_mu_;
+    std::optional<ExitRequest> exit_request_; // guarded by exit_mu_
+    std::atomic<bool> stopping_{false};       // exit requested, or halt()
+
+    // Paravirtual memcpy/memset/CRC engine; declared after RAM so any
+    // interrupt-mode operation finishes before RAM goes
+    remu::devices::BulkOp bulk_;
+
+    // Attached virtio devices, by slot, and the inter-VM device. Declared
+    // after RAM, bus and PLIC so they are torn down (and their in-flight I/O
+    // drained) first.
+    std::vector<std::unique_ptr<remu::devices::VirtioMmio>> virtio_;
+    std::unique_ptr<remu::devices::IvShmem> ivshmem_;
 };
 
 }  // namespace remu::platform
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace remu::platform {
+
+// Lets an idle hart thread (WFI in realtime mode) sleep on the host until
+// either its next timer deadline or until some other thread (console
+// reader, I/O backends) raises an interrupt line.
+//
+// notify() latches: a notification that lands between the hart's last
+// look at mip and its call to wait_until() makes that wait return at once,
+// so no wake-up is lost. Outside that window (the hart is running) notify()
+// is a single atomic load, so it is cheap to call on every interrupt change.
+class Wakeup {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Any thread
+    void notify() {
+        if (armed_.load(std::memory_order_acquire)) notify_slow_();
+    }
+
+    // Hart thread: arm the latch, forgetting earlier notifications (call
+    // before re-reading interrupt state).
+    void arm();
+
+    // Hart thread: drop the latch without sleeping (the re-check found
+    // something pending).
+    void disarm() { armed_.store(false, std::memory_order_relaxed); }
+
+    // Hart thread: block until notified or `deadline`. Returns true if woken
+    // by notify().
+    bool wait_until(Clock::time_point deadline);
+
+private:
+    void notify_slow_();
+
+    std::atomic<bool> armed_{false};
+    std::mutex mu_;
+    std::condition_variable cv_;
+    bool pending_ = false;
+};
+
+} // namespace remu::platform
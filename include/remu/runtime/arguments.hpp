@@ -1,13 +1,67 @@
 #pragma once
+#include <array>
 #include <cstdint>
+#include <optional>
 #include <string>
+#include <vector>
+
+#include <remu/devices/clint.hpp>
 
 namespace remu::runtime {
 
+// A --drive: a raw disk image attached as a virtio-blk device
+struct DriveSpec {
+    std::string path;
+    bool read_only = false;
+};
+
+// A --virtio-console port: a host endpoint (HostChannel spec) and an
+// optional name for the guest
+struct ConsolePortSpec {
+    std::string endpoint;
+    std::string name;
+};
+
+// A --netdev: a virtio-net device on a unix datagram socket bound to
+// `local_path` and talking to `peer_path` (another remu's local path)
+struct NetdevSpec {
+    std::string local_path;
+    std::string peer_path;
+    std::array<std::uint8_t, 6> mac{};
+    bool has_mac = false; // false: 52:54:00:12:34:56 + index
+};
+
+// A --share: a host directory exported over virtio-9p under a mount tag
+struct ShareSpec {
+    std::string path;
+    std::string tag;
+};
+
+// An --ivshmem: the named host shared-memory region this VM joins, with
+// its window size and this VM's peer number
+struct IvshmemSpec {
+    std::string name;
+    std::uint64_t size = 0;
+    std::uint32_t peer = 0;
+};
+
 struct Arguments {
     std::string kernel_path;     // from -k
     std::uint64_t mem_size_bytes = 128ull * 1024 * 1024; // default 128 MiB
-    std::string dtb_path = "resources/dtb/mini.dtb"; // optional, matches the hardcoded remu memmap
+    std::uint32_t harts = 1;     // from --smp
+    std::optional<std::uint64_t> quantum; // from --quantum: instructions per hart turn (icount SMP)
+    std::string dtb_path;        // from -d; empty: generate one for the configured machine
+    std::string bootargs;        // from --bootargs; empty: VirtMachine::kDefaultBootargs
+    bool trap_misaligned = false; // from --trap-misaligned: fault like hardware instead of emulating
+    bool semihosting = false;     // from --semihosting: serve the RISC-V semihosting calls
+    remu::devices::Timebase timebase = remu::devices::Timebase::Icount; // from --timebase
+    std::string console_out = "stdout"; // from --console-out: stdout, file:, pipe: or unix:PATH
+    std::vector<DriveSpec> drives; // from --drive, in virtio slot order
+    std::vector<ConsolePortSpec> console_ports; // from --virtio-console; port 0 first
+    std::vector<NetdevSpec> netdevs; // from --netdev
+    std::vector<ShareSpec> shares;   // from --share
+    std::optional<std::uint64_t> balloon_bytes; // from --balloon: initial balloon size
+    std::optional<IvshmemSpec> ivshmem; // from --ivshmem
 };
 
 } // namespace remu::runtime
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <remu/platform/virt.hpp>
+#include <remu/runtime/arguments.hpp>
+#include <remu/runtime/sim.hpp>
+
+namespace remu::runtime {
+
+// Runs every hart of a machine on the calling thread, in turn, `quantum`
+// instructions at a time. Switching harts is switching Sims, each bound to
+// its own hart's Cpu, so nothing is copied in or out of the loop.
+//
+// With the icount timebase the interleaving depends on nothing but the
+// guest, so an SMP run (its races included) replays the same way every
+// time. Time counts the instructions of all harts. A hart in WFI sits out
+// its turns until it has an interrupt; when every hart waits, time jumps to
+// the next event as on one hart. A smaller quantum interleaves the harts
+// more finely, a larger one switches less often.
+class RoundRobin {
+public:
+    static constexpr std::uint64_t kDefaultQuantum = 1000;
+
+    RoundRobin(remu::platform::VirtMachine& machine, const Arguments& opts,
+               std::uint64_t quantum = kDefaultQuantum);
+
+    // Until any hart stops; the others stop as Halted. One result per hart.
+    std::vector<RunResult> run();
+
+private:
+    remu::platform::VirtMachine& machine_;
+    std::uint64_t quantum_;
+    std::vector<std::unique_ptr<Sim>> sims_; // by hart ID
+};
+
+} // namespace remu::runtime
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <cstdint>
+#include <string_view>
 
 #include <remu/cpu/cpu.hpp>
+#include <remu/cpu/exec_result.hpp>
 #include <remu/platform/virt.hpp>
 #include <remu/runtime/arguments.hpp>
 
@@ -15,20 +17,29 @@ enum class StopReason : std::uint8_t {
     IllegalInstruction,
     ExecuteFailed,
     EcallOrEbreak,
+    GuestPass,      // test finisher / syscon poweroff, or an HTIF exit code of 0
+    GuestFail,      // test finisher failure, or a non-zero HTIF exit code
+    GuestReset,     // syscon reboot: remu stops instead of resetting
+    Halted,         // another hart stopped the machine (VirtMachine::halt())
 };
 
+std::string_view stop_reason_name(StopReason reason);
+
 struct RunResult {
     StopReason reason = StopReason::None;
     std::uint64_t instructions = 0;
     std::uint32_t last_pc = 0;
+    std::uint64_t idle_ticks = 0;   // timebase ticks spent idle in WFI
+    std::uint32_t guest_code = 0;   // status code with GuestPass/GuestFail/GuestReset
 };
 
 // Simple interpreter simulator.
-// Owns nothing: it operates on a machine + cpu provided by caller.
+// Owns nothing: it runs one hart of a machine provided by the caller, on the
+// calling thread.
 class Sim {
 public:
     Sim(remu::platform::VirtMachine& machine,
-        remu::cpu::Cpu& cpu,
+        remu::platform::VirtMachine::Hart& hart,
         const Arguments& opts);
 
     // Execute one instruction. Returns false if stopped.
@@ -38,19 +49,42 @@ public:
     // if max_instructions == 0, no limit (be careful).
     RunResult run(std::uint64_t max_instructions = 0);
 
+    // For a scheduler interleaving several harts on one thread: execute up
+    // to `budget` instructions, carrying the counters over from earlier
+    // slices. Returns early when the hart stops, spin-waits (PAUSE, WRS),
+    // or executes WFI with nothing pending: it is then waiting() rather
+    // than idling the machine, until the scheduler wake()s it.
+    void run_slice(std::uint64_t budget);
+    bool waiting() const { return waiting_; }
+    void wake() { waiting_ = false; }
+    // Timebase ticks the scheduler skipped while this hart waited
+    void add_idle(std::uint64_t ticks);
+
+    // The run so far
+    RunResult result() const;
+
     StopReason stop_reason() const { return stop_reason_; }
     std::uint64_t instructions() const { return instructions_; }
+    std::uint64_t idle_ticks() const { return idle_ticks_; }
 
 private:
-    bool fetch32_(std::uint32_t addr, std::uint32_t& out);
+    remu::cpu::ExecResult fetch32_(std::uint32_t addr, std::uint32_t& out);
+    void wait_for_interrupt_();
+    void spin_wait_(remu::cpu::ExecResult hint);
 
 private:
     remu::platform::VirtMachine& machine_;
+    remu::platform::VirtMachine::Hart& hart_;
     remu::cpu::Cpu& cpu_;
     const Arguments& opts_;
 
     StopReason stop_reason_ = StopReason::None;
     std::uint64_t instructions_ = 0;
+    std::uint64_t idle_ticks_ = 0;
+
+    bool slicing_ = false; // in run_slice(): WFI waits instead of idling
+    bool waiting_ = false;
+    bool yielded_ = false; // PAUSE or WRS ended the slice
 };
 
 } // namespace remu::runtime
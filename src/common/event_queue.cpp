@@ -0,0 +1,44 @@
+#include <remu/common/event_queue.hpp>
+
+#include <algorithm>
+#include <utility>
+
+namespace remu::common {
+
+EventQueue::Id EventQueue::schedule(std::uint64_t when, Callback cb) {
+    const Id id = next_id_++;
+    const bool earliest = when < next_deadline();
+
+    heap_.push_back(Event{when, id, std::move(cb)});
+    std::push_heap(heap_.begin(), heap_.end(), later_);
+
+    if (earliest && rearm_hook_) rearm_hook_();
+    return id;
+}
+
+void EventQueue::cancel(Id id) {
+    if (id == 0) return;
+
+    const auto it = std::find_if(heap_.begin(), heap_.end(),
+                                 [id](const Event& e) { return e.id == id; });
+    if (it == heap_.end()) return;
+
+    if (it != heap_.end() - 1) *it = std::move(heap_.back());
+    heap_.pop_back();
+    std::make_heap(heap_.begin(), heap_.end(), later_);
+}
+
+std::size_t EventQueue::run_due(std::uint64_t now) {
+    std::size_t fired = 0;
+    while (!heap_.empty() && heap_.front().when <= now) {
+        std::pop_heap(heap_.begin(), heap_.end(), later_);
+        Callback cb = std::move(heap_.back().cb);
+        heap_.pop_back();
+
+        cb();
+        ++fired;
+    }
+    return fired;
+}
+
+} // namespace remu::common
@@ -12,6 +12,7 @@ void Cpu::reset(std::uint32_t reset_pc) {
 
     regs.reset();
     csr.reset();
+    tlb = Tlb{};
 
     clear_reservation_();
 }
@@ -29,6 +30,8 @@ void Cpu::tick_counters(std::uint64_t cycles) {
 void Cpu::clear_reservation_() {
     reservation_valid = false;
     reservation_addr = 0;
+    reservation_value = 0;
+    reservation_version = 0;
 }
 
 } // namespace remu::cpu
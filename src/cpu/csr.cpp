@@ -4,9 +4,23 @@ namespace remu::cpu {
 
 namespace {
 // CSR addresses we care about first (RV privileged spec)
-constexpr std::uint16_t CSR_MSTATUS  = 0x300;
+constexpr std::uint16_t CSR_SSTATUS  = csr_addr::Sstatus;
+constexpr std::uint16_t CSR_SIE      = 0x104;
+constexpr std::uint16_t CSR_STVEC    = 0x105;
+constexpr std::uint16_t CSR_SCOUNTEREN = 0x106;
+constexpr std::uint16_t CSR_SSCRATCH = 0x140;
+constexpr std::uint16_t CSR_SEPC     = 0x141;
+constexpr std::uint16_t CSR_SCAUSE   = 0x142;
+constexpr std::uint16_t CSR_STVAL    = 0x143;
+constexpr std::uint16_t CSR_SIP      = 0x144;
+constexpr std::uint16_t CSR_SATP     = csr_addr::Satp;
+
+constexpr std::uint16_t CSR_MSTATUS  = csr_addr::Mstatus;
 constexpr std::uint16_t CSR_MISA     = 0x301;
+constexpr std::uint16_t CSR_MEDELEG  = 0x302;
+constexpr std::uint16_t CSR_MIDELEG  = 0x303;
 constexpr std::uint16_t CSR_MTVEC    = 0x305;
+constexpr std::uint16_t CSR_MCOUNTEREN = 0x306;
 constexpr std::uint16_t CSR_MSCRATCH = 0x340;
 constexpr std::uint16_t CSR_MEPC     = 0x341;
 constexpr std::uint16_t CSR_MCAUSE   = 0x342;
@@ -23,9 +37,40 @@ constexpr std::uint16_t CSR_MIMPID   = 0xF13;
 
 constexpr std::uint16_t CSR_MCYCLE   = 0xB00;
 constexpr std::uint16_t CSR_MINSTRET = 0xB02;
+constexpr std::uint16_t CSR_MCYCLEH  = 0xB80;
+constexpr std::uint16_t CSR_MINSTRETH= 0xB82;
+
+// Unprivileged read-only shadows, gated by mcounteren/scounteren
+constexpr std::uint16_t CSR_CYCLE    = 0xC00;
+constexpr std::uint16_t CSR_TIME     = 0xC01;
+constexpr std::uint16_t CSR_TIMEH    = 0xC81;
+constexpr std::uint16_t CSR_INSTRET  = 0xC02;
+constexpr std::uint16_t CSR_CYCLEH   = 0xC80;
+constexpr std::uint16_t CSR_INSTRETH = 0xC82;
+
+// Writable fields
+constexpr std::uint32_t MSTATUS_WMASK =
+    status::SIE | status::MIE | status::SPIE | status::MPIE | status::SPP |
+    status::MPP_MASK | status::MPRV | status::SUM | status::MXR |
+    status::TVM | status::TW | status::TSR;
+constexpr std::uint32_t SSTATUS_MASK =
+    status::SIE | status::SPIE | status::SPP | status::SUM | status::MXR;
+
+constexpr std::uint32_t S_INTERRUPTS = irq::bit(irq::SSI) | irq::bit(irq::STI) | irq::bit(irq::SEI);
+constexpr std::uint32_t MIE_WMASK = S_INTERRUPTS | irq::bit(irq::MSI) | irq::bit(irq::MTI) | irq::bit(irq::MEI);
+// MSIP/MTIP/MEIP are driven by the CLINT/PLIC, not by software
+constexpr std::uint32_t MIP_WMASK = S_INTERRUPTS;
+constexpr std::uint32_t SIP_WMASK = irq::bit(irq::SSI);
 
-// For RV32, cycle/minstret low halves are enough to start.
-// (Linux might read time via CLINT rather than cycle; still useful.)
+// Every synchronous cause except ecall-from-M can be delegated
+constexpr std::uint32_t MEDELEG_WMASK = 0x0000'B3FFu;
+
+constexpr std::uint32_t SATP_WMASK = satp::MODE_SV32 | satp::PPN_MASK; // ASIDLEN = 0
+
+// xtvec: MODE 0 (direct) and 1 (vectored) are supported
+std::uint32_t legalize_tvec(std::uint32_t v) {
+    return ((v & 0x3u) >= 2) ? (v & ~0x3u) : v;
+}
 } // namespace
 
 CsrFile::CsrFile() {
@@ -42,6 +87,10 @@ void CsrFile::reset() {
     mtval_    = 0;
     mie_      = 0;
     mip_      = 0;
+    seip_sw_  = false;
+    medeleg_  = 0;
+    mideleg_  = 0;
+    mcounteren_ = 0;
     pmpcfg0_  = 0;
     pmpaddr0_ = 0;
     mcycle_   = 0;
@@ -50,6 +99,14 @@ void CsrFile::reset() {
     mvendorid_= 0;
     marchid_  = 0;
     mimpid_   = 0;
+
+    stvec_    = 0;
+    sscratch_ = 0;
+    sepc_     = 0;
+    scause_   = 0;
+    stval_    = 0;
+    satp_     = 0;
+    scounteren_ = 0;
 }
 
 std::uint32_t CsrFile::build_misa_rv32ima_() {
@@ -67,16 +124,54 @@ std::uint32_t CsrFile::build_misa_rv32ima_() {
     ext |= ext_bit('I');
     ext |= ext_bit('M');
     ext |= ext_bit('A');
+    ext |= ext_bit('S');
+    ext |= ext_bit('U');
     // If you later add C, F, D, etc, set bits here.
 
     return MXL_RV32 | ext;
 }
 
+bool CsrFile::accessible(std::uint16_t csr_addr, PrivMode priv, bool writes) const {
+    const auto p = static_cast<std::uint32_t>(priv);
+
+    // addr[9:8]: lowest privilege that may access the CSR
+    if (p < ((csr_addr >> 8) & 0x3u)) return false;
+    // addr[11:10] == 0b11: read-only
+    if (writes && ((csr_addr >> 10) & 0x3u) == 0x3u) return false;
+
+    if (csr_addr == CSR_SATP && priv == PrivMode::Supervisor &&
+        (mstatus_ & status::TVM) != 0) {
+        return false;
+    }
+
+    // cycle/time/instret (and the high halves): bit N of xcounteren
+    if ((csr_addr & 0xF60u) == 0xC00u && (csr_addr & 0x1Fu) < 3) {
+        const std::uint32_t bit = 1u << (csr_addr & 0x1Fu);
+        if (priv != PrivMode::Machine && (mcounteren_ & bit) == 0) return false;
+        if (priv == PrivMode::User && (scounteren_ & bit) == 0) return false;
+    }
+    return true;
+}
+
 bool CsrFile::read(std::uint16_t csr_addr, std::uint32_t& out) const {
     switch (csr_addr) {
+        case CSR_SSTATUS:  out = mstatus_ & SSTATUS_MASK; return true;
+        case CSR_SIE:      out = mie_ & mideleg_; return true;
+        case CSR_STVEC:    out = stvec_;   return true;
+        case CSR_SCOUNTEREN: out = scounteren_; return true;
+        case CSR_SSCRATCH: out = sscratch_;return true;
+        case CSR_SEPC:     out = sepc_;    return true;
+        case CSR_SCAUSE:   out = scause_;  return true;
+        case CSR_STVAL:    out = stval_;   return true;
+        case CSR_SIP:      out = mip_ & mideleg_; return true;
+        case CSR_SATP:     out = satp_;    return true;
+
         case CSR_MSTATUS:  out = mstatus_; return true;
         case CSR_MISA:     out = misa_;    return true;
+        case CSR_MEDELEG:  out = medeleg_; return true;
+        case CSR_MIDELEG:  out = mideleg_; return true;
         case CSR_MTVEC:    out = mtvec_;   return true;
+        case CSR_MCOUNTEREN: out = mcounteren_; return true;
         case CSR_MSCRATCH: out = mscratch_;return true;
         case CSR_MEPC:     out = mepc_;    return true;
         case CSR_MCAUSE:   out = mcause_;  return true;
@@ -89,8 +184,23 @@ bool CsrFile::read(std::uint16_t csr_addr, std::uint32_t& out) const {
         case CSR_MVENDORID:out = mvendorid_; return true;
         case CSR_MARCHID:  out = marchid_; return true;
         case CSR_MIMPID:   out = mimpid_;  return true;
-        case CSR_MCYCLE:   out = static_cast<std::uint32_t>(mcycle_ & 0xFFFF'FFFFull); return true;
-        case CSR_MINSTRET: out = static_cast<std::uint32_t>(minstret_ & 0xFFFF'FFFFull); return true;
+
+        case CSR_MCYCLE:
+        case CSR_CYCLE:    out = static_cast<std::uint32_t>(mcycle_ & 0xFFFF'FFFFull); return true;
+        case CSR_MINSTRET:
+        case CSR_INSTRET:  out = static_cast<std::uint32_t>(minstret_ & 0xFFFF'FFFFull); return true;
+        case CSR_MCYCLEH:
+        case CSR_CYCLEH:   out = static_cast<std::uint32_t>(mcycle_ >> 32); return true;
+        case CSR_MINSTRETH:
+        case CSR_INSTRETH: out = static_cast<std::uint32_t>(minstret_ >> 32); return true;
+
+        case CSR_TIME:
+        case CSR_TIMEH: {
+            if (time_.read == nullptr) return false;
+            const std::uint64_t t = time_.read(time_.ctx);
+            out = static_cast<std::uint32_t>(csr_addr == CSR_TIME ? (t & 0xFFFF'FFFFull) : (t >> 32));
+            return true;
+        }
 
         default:
             return false; // unimplemented CSR for now
@@ -99,18 +209,76 @@ bool CsrFile::read(std::uint16_t csr_addr, std::uint32_t& out) const {
 
 bool CsrFile::write(std::uint16_t csr_addr, std::uint32_t value) {
     switch (csr_addr) {
-        case CSR_MSTATUS:
-            mstatus_ = value;
+        case CSR_SSTATUS:
+            mstatus_ = (mstatus_ & ~SSTATUS_MASK) | (value & SSTATUS_MASK);
+            return true;
+
+        case CSR_SIE:
+            mie_ = (mie_ & ~mideleg_) | (value & mideleg_);
             return true;
 
+        case CSR_STVEC:
+            stvec_ = legalize_tvec(value);
+            return true;
+
+        case CSR_SCOUNTEREN:
+            scounteren_ = value & 0x7u;
+            return true;
+
+        case CSR_SSCRATCH:
+            sscratch_ = value;
+            return true;
+
+        case CSR_SEPC:
+            sepc_ = value & ~0x3u;
+            return true;
+
+        case CSR_SCAUSE:
+            scause_ = value;
+            return true;
+
+        case CSR_STVAL:
+            stval_ = value;
+            return true;
+
+        case CSR_SIP: {
+            const std::uint32_t mask = SIP_WMASK & mideleg_;
+            mip_ = (mip_ & ~mask) | (value & mask);
+            return true;
+        }
+
+        case CSR_SATP:
+            satp_ = value & SATP_WMASK;
+            return true;
+
+        case CSR_MSTATUS: {
+            std::uint32_t v = (mstatus_ & ~MSTATUS_WMASK) | (value & MSTATUS_WMASK);
+            // MPP is WARL: the reserved encoding 2 reads back as U
+            if (((v & status::MPP_MASK) >> status::MPP_SHIFT) == 2u) v &= ~status::MPP_MASK;
+            mstatus_ = v;
+            return true;
+        }
+
         case CSR_MISA:
             // misa is usually read-only for most implementations.
             // For now: ignore writes (return true so SW doesn't crash),
             // or return false if you prefer strictness.
             return true;
 
+        case CSR_MEDELEG:
+            medeleg_ = value & MEDELEG_WMASK;
+            return true;
+
+        case CSR_MIDELEG:
+            mideleg_ = value & S_INTERRUPTS;
+            return true;
+
         case CSR_MTVEC:
-            mtvec_ = value;
+            mtvec_ = legalize_tvec(value);
+            return true;
+
+        case CSR_MCOUNTEREN:
+            mcounteren_ = value & 0x7u;
             return true;
 
         case CSR_MSCRATCH:
@@ -118,7 +286,7 @@ bool CsrFile::write(std::uint16_t csr_addr, std::uint32_t value) {
             return true;
 
         case CSR_MEPC:
-            mepc_ = value;
+            mepc_ = value & ~0x3u;
             return true;
 
         case CSR_MCAUSE:
@@ -130,13 +298,15 @@ bool CsrFile::write(std::uint16_t csr_addr, std::uint32_t value) {
             return true;
 
         case CSR_MIE:
-            mie_ = value;
+            mie_ = value & MIE_WMASK;
             return true;
 
         case CSR_MIP:
-            // Typically some bits are writable, some are read-only (set by hardware).
-            // For now allow writing; you can refine later.
-            mip_ = value;
+            // Only the S-level bits are software-writable; MSIP/MTIP/MEIP
+            // are driven by the CLINT/PLIC (see VirtMachine::tick). SEIP
+            // keeps the written value apart, to OR with the PLIC's level.
+            seip_sw_ = (value & irq::bit(irq::SEI)) != 0;
+            mip_ = (mip_ & ~MIP_WMASK) | (value & MIP_WMASK);
             return true;
         
         case CSR_PMPCFG0:
@@ -146,22 +316,6 @@ bool CsrFile::write(std::uint16_t csr_addr, std::uint32_t value) {
         case CSR_PMPADDR0:
             pmpaddr0_ = value;
             return true;
-        
-        case CSR_MHARTID:
-            mhartid_ = value;
-            return true;
-
-        case CSR_MVENDORID:
-            mvendorid_ = value;
-            return true;
-
-        case CSR_MARCHID:
-            marchid_ = value;
-            return true;
-
-        case CSR_MIMPID:
-            mimpid_ = value;
-            return true;
 
         case CSR_MCYCLE:
             mcycle_ = (mcycle_ & 0xFFFF'FFFF'0000'0000ull) | value;
@@ -171,6 +325,14 @@ bool CsrFile::write(std::uint16_t csr_addr, std::uint32_t value) {
             minstret_ = (minstret_ & 0xFFFF'FFFF'0000'0000ull) | value;
             return true;
 
+        case CSR_MCYCLEH:
+            mcycle_ = (mcycle_ & 0x0000'0000'FFFF'FFFFull) | (static_cast<std::uint64_t>(value) << 32);
+            return true;
+
+        case CSR_MINSTRETH:
+            minstret_ = (minstret_ & 0x0000'0000'FFFF'FFFFull) | (static_cast<std::uint64_t>(value) << 32);
+            return true;
+
         default:
             return false;
     }
@@ -184,22 +184,34 @@ DecodedInsn decode_rv32(std::uint32_t insn) {
 
         case 0x0F: // MISC-MEM
             d.fmt = InsnFormat::I;
-            d.kind = InsnKind::FENCE;
+            d.kind = (insn == 0x0100000F) ? InsnKind::PAUSE : InsnKind::FENCE;
             return d;
 
         case 0x73: { // SYSTEM
             // ECALL/EBREAK if funct3 == 0
             if (funct3 == 0x0) {
+                if (funct7 == 0x09) {
+                    // rs1 = vaddr, rs2 = asid (ignored: no ASIDs)
+                    d.kind = InsnKind::SFENCE_VMA;
+                    d.fmt = InsnFormat::R;
+                    return d;
+                }
                 const std::uint32_t imm12 = get_bits(insn, 31, 20);
                 if (imm12 == 0x105) {
                     d.kind = InsnKind::WFI;
                     d.fmt = InsnFormat::Other;
                     return d;
                 }
+                if (imm12 == 0x00D || imm12 == 0x01D) {
+                    d.kind = (imm12 == 0x00D) ? InsnKind::WRS_NTO : InsnKind::WRS_STO;
+                    d.fmt = InsnFormat::Other;
+                    return d;
+                }
                 d.fmt = InsnFormat::I;
                 d.imm = static_cast<std::int32_t>(imm12);
                 if (imm12 == 0x000) d.kind = InsnKind::ECALL;
                 else if (imm12 == 0x001) d.kind = InsnKind::EBREAK;
+                else if (imm12 == 0x102) d.kind = InsnKind::SRET;
                 else if (imm12 == 0x302) d.kind = InsnKind::MRET;
                 return d;
             }
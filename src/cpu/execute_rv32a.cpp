@@ -1,7 +1,9 @@
-#include <remu/cpu/decode.hpp>
-#include <remu/cpu/cpu.hpp>
-#include <remu/mem/bus.hpp>
+#include <remu/cpu/execute.hpp>
+#include <remu/cpu/exception.hpp>
+#include <remu/cpu/mmu.hpp>
+#include <remu/cpu/reservation.hpp>
 
+#include <atomic>
 #include <cstdint>
 
 namespace remu::cpu {
@@ -17,45 +19,131 @@ inline std::uint32_t amo_max_s(std::uint32_t a, std::uint32_t b) {
 inline std::uint32_t amo_min_u(std::uint32_t a, std::uint32_t b) { return (a < b) ? a : b; }
 inline std::uint32_t amo_max_u(std::uint32_t a, std::uint32_t b) { return (a > b) ? a : b; }
 
+inline std::uint32_t amo_apply(InsnKind kind, std::uint32_t old, std::uint32_t v) {
+    switch (kind) {
+        case InsnKind::AMOSWAP_W: return v;
+        case InsnKind::AMOADD_W:  return old + v;
+        case InsnKind::AMOXOR_W:  return old ^ v;
+        case InsnKind::AMOAND_W:  return old & v;
+        case InsnKind::AMOOR_W:   return old | v;
+        case InsnKind::AMOMIN_W:  return amo_min_s(old, v);
+        case InsnKind::AMOMAX_W:  return amo_max_s(old, v);
+        case InsnKind::AMOMINU_W: return amo_min_u(old, v);
+        case InsnKind::AMOMAXU_W: return amo_max_u(old, v);
+        default:                  return old;
+    }
+}
+
+// Host ordering for the aq/rl bits (insn[26] and insn[25])
+inline std::memory_order amo_order(const DecodedInsn& d) {
+    const bool aq = ((d.raw >> 26) & 1u) != 0;
+    const bool rl = ((d.raw >> 25) & 1u) != 0;
+    if (aq && rl) return std::memory_order_seq_cst;
+    if (aq) return std::memory_order_acquire;
+    if (rl) return std::memory_order_release;
+    return std::memory_order_relaxed;
+}
+
+// The same as a load: LR.rl is only meaningful with aq (sequentially
+// consistent), and a host load can't be release
+inline std::memory_order lr_order(const DecodedInsn& d) {
+    const std::memory_order o = amo_order(d);
+    if (o == std::memory_order_release) return std::memory_order_seq_cst;
+    return o;
+}
+
+// Host-atomic read-modify-write of a RAM word; the fetch_ forms where the
+// host has one, a compare-exchange loop for min/max
+inline std::uint32_t amo_host(InsnKind kind, std::atomic_ref<std::uint32_t> ref,
+                              std::uint32_t v, std::memory_order order) {
+    switch (kind) {
+        case InsnKind::AMOSWAP_W: return ref.exchange(v, order);
+        case InsnKind::AMOADD_W:  return ref.fetch_add(v, order);
+        case InsnKind::AMOXOR_W:  return ref.fetch_xor(v, order);
+        case InsnKind::AMOAND_W:  return ref.fetch_and(v, order);
+        case InsnKind::AMOOR_W:   return ref.fetch_or(v, order);
+        default: {
+            std::uint32_t old = ref.load(std::memory_order_relaxed);
+            while (!ref.compare_exchange_weak(old, amo_apply(kind, old, v), order)) {
+            }
+            return old;
+        }
+    }
+}
+
 } // namespace
 
-bool execute_rv32a(const DecodedInsn& d, Cpu& cpu, remu::mem::Bus& bus) {
+ExecResult execute_rv32a(const DecodedInsn& d, Cpu& cpu, remu::mem::Bus& bus) {
     const std::uint32_t pc = cpu.pc;
     const std::uint32_t rs1u = cpu.regs.read(d.rs1);
     const std::uint32_t rs2u = cpu.regs.read(d.rs2);
-    const std::uint32_t addr = rs1u;
+    const std::uint32_t vaddr = rs1u;
 
     const std::uint32_t next_pc = pc + d.length;
 
-    auto load32 = [&](std::uint32_t& out) -> bool {
-        return bus.read32(addr, out);
-    };
-    auto store32 = [&](std::uint32_t v) -> bool {
-        return bus.write32(addr, v);
-    };
+    // LR/SC/AMOs must be atomic, so a misaligned address is never split
+    // like a plain load/store: it always raises address-misaligned.
+    if ((vaddr & 0x3u) != 0) {
+        const std::uint32_t cause = (d.kind == InsnKind::LR_W) ? exc::LoadAddressMisaligned
+                                                                : exc::StoreAddressMisaligned;
+        cpu.raise_exception(cause, vaddr);
+        return ExecResult::TrapRaised;
+    }
+
+    // Translate once up front (SC/AMOs need write permission, so they fault
+    // as stores); the access itself then goes to the physical address, and
+    // the reservation is tracked physically.
+    std::uint32_t addr = 0;
+    const Access acc = (d.kind == InsnKind::LR_W) ? Access::Load : Access::Store;
+    if (auto r = mmu_translate(cpu, bus, vaddr, acc, addr); r != ExecResult::Ok) return r;
+
+    // RAM words are accessed as host atomics through the TLB entry the
+    // translation just filled, so other harts' threads see them atomic.
+    // MMIO stays a bus read then write, serialized by the device lock.
+    const TlbEntry& e = cpu.tlb.entry(data_priv(cpu), acc, vaddr);
+    std::uint32_t* word = nullptr;
+    if (e.tag == (vaddr >> 12)) word = reinterpret_cast<std::uint32_t*>(e.addend + vaddr);
+
+    ReservationSets* sets = cpu.reservations;
 
     switch (d.kind) {
         case InsnKind::LR_W: {
             std::uint32_t old = 0;
-            if (!load32(old)) return false;
+            // Version first: a write to the line after it shows up below
+            const std::uint32_t version = sets ? sets->version(addr) : 0;
+            if (word != nullptr) {
+                old = std::atomic_ref<std::uint32_t>(*word).load(lr_order(d));
+            } else if (!bus.read32(addr, old)) {
+                return ExecResult::Fault;
+            }
             cpu.regs.write(d.rd, old);
             cpu.reservation_valid = true;
             cpu.reservation_addr = addr;
+            cpu.reservation_value = old;
+            cpu.reservation_version = version;
             cpu.pc = next_pc;
-            return true;
+            return ExecResult::Ok;
         }
 
         case InsnKind::SC_W: {
-            const bool ok = cpu.reservation_valid && (cpu.reservation_addr == addr);
+            // Only an SC to the word its LR loaded can succeed
+            bool ok = cpu.reservation_valid && cpu.reservation_addr == addr &&
+                      (!sets || sets->version(addr) == cpu.reservation_version);
             if (ok) {
-                if (!store32(rs2u)) return false;
-                cpu.regs.write(d.rd, 0); // success
-            } else {
-                cpu.regs.write(d.rd, 1); // failure
+                if (word != nullptr) {
+                    std::uint32_t expected = cpu.reservation_value;
+                    ok = std::atomic_ref<std::uint32_t>(*word).compare_exchange_strong(
+                        expected, rs2u, amo_order(d));
+                    if (ok) e.ram->mark_dirty(addr, 4);
+                } else if (!bus.write32(addr, rs2u)) {
+                    return ExecResult::Fault;
+                }
             }
+            if (ok && sets) sets->bump(addr);
+            cpu.regs.write(d.rd, ok ? 0u : 1u); // 0: success
             cpu.reservation_valid = false;
             cpu.pc = next_pc;
-            return true;
+            return ExecResult::Ok;
         }
 
         case InsnKind::AMOSWAP_W:
@@ -68,32 +156,23 @@ bool execute_rv32a(const DecodedInsn& d, Cpu& cpu, remu::mem::Bus& bus) {
         case InsnKind::AMOMINU_W:
         case InsnKind::AMOMAXU_W: {
             std::uint32_t old = 0;
-            if (!load32(old)) return false;
-
-            std::uint32_t newv = old;
-            switch (d.kind) {
-                case InsnKind::AMOSWAP_W: newv = rs2u; break;
-                case InsnKind::AMOADD_W:  newv = old + rs2u; break;
-                case InsnKind::AMOXOR_W:  newv = old ^ rs2u; break;
-                case InsnKind::AMOAND_W:  newv = old & rs2u; break;
-                case InsnKind::AMOOR_W:   newv = old | rs2u; break;
-                case InsnKind::AMOMIN_W:  newv = amo_min_s(old, rs2u); break;
-                case InsnKind::AMOMAX_W:  newv = amo_max_s(old, rs2u); break;
-                case InsnKind::AMOMINU_W: newv = amo_min_u(old, rs2u); break;
-                case InsnKind::AMOMAXU_W: newv = amo_max_u(old, rs2u); break;
-                default: break;
+            if (word != nullptr) {
+                old = amo_host(d.kind, std::atomic_ref<std::uint32_t>(*word), rs2u, amo_order(d));
+                e.ram->mark_dirty(addr, 4);
+            } else {
+                if (!bus.read32(addr, old)) return ExecResult::Fault;
+                if (!bus.write32(addr, amo_apply(d.kind, old, rs2u))) return ExecResult::Fault;
             }
-
-            if (!store32(newv)) return false;
+            if (sets) sets->bump(addr);
             cpu.regs.write(d.rd, old);
 
-            cpu.reservation_valid = false; // a simple model: any AMO breaks reservations
+            cpu.reservation_valid = false; // a simple model: any AMO breaks this hart's reservation
             cpu.pc = next_pc;
-            return true;
+            return ExecResult::Ok;
         }
 
         default:
-            return false;
+            return ExecResult::Fault;
     }
 }
 
@@ -1,35 +1,25 @@
-#include <remu/cpu/decode.hpp>
-#include <remu/cpu/cpu.hpp>
-#include <remu/mem/bus.hpp>
+#include <remu/cpu/execute.hpp>
 #include <remu/cpu/exception.hpp>
-#include <remu/cpu/exec_result.hpp>
+#include <remu/cpu/mmu.hpp>
+#include <remu/cpu/semihosting.hpp>
 
+#include <atomic>
 #include <cstdint>
 
 namespace remu::cpu {
 
 namespace {
 
-inline std::uint32_t u32(std::int32_t v) { return static_cast<std::uint32_t>(v); }
+// FENCE predecessor/successor bits, and the FENCE.TSO mode
+constexpr std::uint32_t FENCE_W = 1u << 0;
+constexpr std::uint32_t FENCE_R = 1u << 1;
+constexpr std::uint32_t FENCE_FM_TSO = 0x8;
 
-inline bool load_u8(remu::mem::Bus& bus, std::uint32_t addr, std::uint8_t& out) {
-    return bus.read8(addr, out);
-}
-inline bool load_u16(remu::mem::Bus& bus, std::uint32_t addr, std::uint16_t& out) {
-    return bus.read16(addr, out);
-}
-inline bool load_u32(remu::mem::Bus& bus, std::uint32_t addr, std::uint32_t& out) {
-    return bus.read32(addr, out);
-}
+inline std::uint32_t u32(std::int32_t v) { return static_cast<std::uint32_t>(v); }
 
-inline bool store_u8(remu::mem::Bus& bus, std::uint32_t addr, std::uint8_t v) {
-    return bus.write8(addr, v);
-}
-inline bool store_u16(remu::mem::Bus& bus, std::uint32_t addr, std::uint16_t v) {
-    return bus.write16(addr, v);
-}
-inline bool store_u32(remu::mem::Bus& bus, std::uint32_t addr, std::uint32_t v) {
-    return bus.write32(addr, v);
+inline ExecResult illegal(Cpu& cpu, const DecodedInsn& d) {
+    cpu.raise_exception(exc::IllegalInstruction, d.raw);
+    return ExecResult::TrapRaised;
 }
 
 inline std::int32_t sext8(std::uint8_t v)  { return static_cast<std::int32_t>(static_cast<std::int8_t>(v)); }
@@ -92,35 +82,35 @@ remu::cpu::ExecResult execute_rv32i(const DecodedInsn& d, Cpu& cpu, remu::mem::B
         // Loads
         case InsnKind::LB: {
             std::uint8_t b{};
-            if (!load_u8(bus, rs1v + u32(d.imm), b)) return ExecResult::Fault;
+            if (auto r = mmu_load(cpu, bus, rs1v + u32(d.imm), b); r != ExecResult::Ok) return r;
             cpu.regs.write(d.rd, static_cast<std::uint32_t>(sext8(b)));
             cpu.pc = next_pc;
             return ExecResult::Ok;
         }
         case InsnKind::LBU: {
             std::uint8_t b{};
-            if (!load_u8(bus, rs1v + u32(d.imm), b)) return ExecResult::Fault;
+            if (auto r = mmu_load(cpu, bus, rs1v + u32(d.imm), b); r != ExecResult::Ok) return r;
             cpu.regs.write(d.rd, b);
             cpu.pc = next_pc;
             return ExecResult::Ok;
         }
         case InsnKind::LH: {
             std::uint16_t h{};
-            if (!load_u16(bus, rs1v + u32(d.imm), h)) return ExecResult::Fault;
+            if (auto r = mmu_load(cpu, bus, rs1v + u32(d.imm), h); r != ExecResult::Ok) return r;
             cpu.regs.write(d.rd, static_cast<std::uint32_t>(sext16(h)));
             cpu.pc = next_pc;
             return ExecResult::Ok;
         }
         case InsnKind::LHU: {
             std::uint16_t h{};
-            if (!load_u16(bus, rs1v + u32(d.imm), h)) return ExecResult::Fault;
+            if (auto r = mmu_load(cpu, bus, rs1v + u32(d.imm), h); r != ExecResult::Ok) return r;
             cpu.regs.write(d.rd, h);
             cpu.pc = next_pc;
             return ExecResult::Ok;
         }
         case InsnKind::LW: {
             std::uint32_t w{};
-            if (!load_u32(bus, rs1v + u32(d.imm), w)) return ExecResult::Fault;
+            if (auto r = mmu_load(cpu, bus, rs1v + u32(d.imm), w); r != ExecResult::Ok) return r;
             cpu.regs.write(d.rd, w);
             cpu.pc = next_pc;
             return ExecResult::Ok;
@@ -128,15 +118,15 @@ remu::cpu::ExecResult execute_rv32i(const DecodedInsn& d, Cpu& cpu, remu::mem::B
 
         // Stores
         case InsnKind::SB:
-            if (!store_u8(bus, rs1v + u32(d.imm), static_cast<std::uint8_t>(rs2v & 0xFFu))) return ExecResult::Fault;
+            if (auto r = mmu_store(cpu, bus, rs1v + u32(d.imm), static_cast<std::uint8_t>(rs2v & 0xFFu)); r != ExecResult::Ok) return r;
             cpu.pc = next_pc;
             return ExecResult::Ok;
         case InsnKind::SH:
-            if (!store_u16(bus, rs1v + u32(d.imm), static_cast<std::uint16_t>(rs2v & 0xFFFFu))) return ExecResult::Fault;
+            if (auto r = mmu_store(cpu, bus, rs1v + u32(d.imm), static_cast<std::uint16_t>(rs2v & 0xFFFFu)); r != ExecResult::Ok) return r;
             cpu.pc = next_pc;
             return ExecResult::Ok;
         case InsnKind::SW:
-            if (!store_u32(bus, rs1v + u32(d.imm), rs2v)) return ExecResult::Fault;
+            if (auto r = mmu_store(cpu, bus, rs1v + u32(d.imm), rs2v); r != ExecResult::Ok) return r;
             cpu.pc = next_pc;
             return ExecResult::Ok;
 
@@ -220,12 +210,39 @@ remu::cpu::ExecResult execute_rv32i(const DecodedInsn& d, Cpu& cpu, remu::mem::B
             cpu.pc = next_pc;
             return ExecResult::Ok;
 
-        case InsnKind::FENCE:
-            // No-op for now
+        case InsnKind::FENCE: {
+            // Other harts run on other host threads, so order this hart's
+            // accesses with a host fence. Only ordering earlier stores
+            // before later loads needs a full barrier (not FENCE.TSO, which
+            // leaves that out); acquire/release covers the rest.
+            const std::uint32_t fm   = (d.raw >> 28) & 0xFu;
+            const std::uint32_t pred = (d.raw >> 24) & 0xFu;
+            const std::uint32_t succ = (d.raw >> 20) & 0xFu;
+            const bool store_load = fm != FENCE_FM_TSO && (pred & FENCE_W) != 0 &&
+                                    (succ & FENCE_R) != 0;
+            std::atomic_thread_fence(store_load ? std::memory_order_seq_cst
+                                                : std::memory_order_acq_rel);
             cpu.pc = next_pc;
             return ExecResult::Ok;
+        }
+
+        case InsnKind::PAUSE:
+            // Orders nothing (pred = W, succ = 0); the simulator lets
+            // other harts have the host
+            cpu.pc = next_pc;
+            return ExecResult::Pause;
 
-        // CSR ops (minimal: no privilege checks yet)
+        case InsnKind::SFENCE_VMA:
+            if (cpu.priv == PrivMode::User ||
+                (cpu.priv == PrivMode::Supervisor && (cpu.csr.mstatus() & status::TVM) != 0)) {
+                return illegal(cpu, d);
+            }
+            if (d.rs1 == 0) cpu.tlb.flush();
+            else            cpu.tlb.flush_va(rs1v);
+            cpu.pc = next_pc;
+            return ExecResult::Ok;
+
+        // CSR ops
         case InsnKind::CSRRW:
         case InsnKind::CSRRS:
         case InsnKind::CSRRC:
@@ -233,8 +250,6 @@ remu::cpu::ExecResult execute_rv32i(const DecodedInsn& d, Cpu& cpu, remu::mem::B
         case InsnKind::CSRRSI:
         case InsnKind::CSRRCI: {
             const std::uint16_t csr = static_cast<std::uint16_t>(d.imm & 0xFFF);
-            std::uint32_t old = 0;
-            if (!cpu.csr.read(csr, old)) return ExecResult::Fault;
 
             std::uint32_t zimm_or_rs1 = 0;
             if (d.kind == InsnKind::CSRRWI || d.kind == InsnKind::CSRRSI || d.kind == InsnKind::CSRRCI) {
@@ -243,6 +258,21 @@ remu::cpu::ExecResult execute_rv32i(const DecodedInsn& d, Cpu& cpu, remu::mem::B
                 zimm_or_rs1 = rs1v;
             }
 
+            // CSRRS/CSRRC with rs1 = x0 (or zimm = 0) only read
+            const bool writes = d.kind == InsnKind::CSRRW || d.kind == InsnKind::CSRRWI || d.rs1 != 0;
+
+            std::uint32_t old = 0;
+            if (!cpu.csr.accessible(csr, cpu.priv, writes) || !cpu.csr.read(csr, old)) {
+                return illegal(cpu, d);
+            }
+
+            // Setting or clearing mip bits works on the software SEIP, not on
+            // the value OR'd with the PLIC's level
+            std::uint32_t base = old;
+            if (csr == csr_addr::Mip) {
+                base = (old & ~irq::bit(irq::SEI)) | (cpu.csr.software_seip() ? irq::bit(irq::SEI) : 0);
+            }
+
             std::uint32_t newv = old;
             switch (d.kind) {
                 case InsnKind::CSRRW:
@@ -251,18 +281,27 @@ remu::cpu::ExecResult execute_rv32i(const DecodedInsn& d, Cpu& cpu, remu::mem::B
                     break;
                 case InsnKind::CSRRS:
                 case InsnKind::CSRRSI:
-                    if (zimm_or_rs1 != 0) newv = old | zimm_or_rs1;
+                    if (zimm_or_rs1 != 0) newv = base | zimm_or_rs1;
                     break;
                 case InsnKind::CSRRC:
                 case InsnKind::CSRRCI:
-                    if (zimm_or_rs1 != 0) newv = old & ~zimm_or_rs1;
+                    if (zimm_or_rs1 != 0) newv = base & ~zimm_or_rs1;
                     break;
                 default:
                     break;
             }
 
+            if (writes) {
+                const std::uint32_t ms_before = cpu.csr.mstatus();
+                if (!cpu.csr.write(csr, newv)) return illegal(cpu, d);
+
+                // Cached translations depend on satp and on SUM/MXR
+                const std::uint32_t ms_changed = ms_before ^ cpu.csr.mstatus();
+                if (csr == csr_addr::Satp || (ms_changed & (status::SUM | status::MXR)) != 0) {
+                    cpu.tlb.flush();
+                }
+            }
             if (d.rd != 0) cpu.regs.write(d.rd, old);
-            if (!cpu.csr.write(csr, newv)) return ExecResult::Fault;
 
             cpu.pc = next_pc;
             return ExecResult::Ok;
@@ -279,44 +318,93 @@ remu::cpu::ExecResult execute_rv32i(const DecodedInsn& d, Cpu& cpu, remu::mem::B
         }
 
         case InsnKind::EBREAK: {
+            // Semihosting call: served on the host, then on to the srai
+            if (cpu.semihosting != nullptr && cpu.priv == PrivMode::Machine &&
+                d.length == 4 && Semihosting::is_call(bus, pc)) {
+                cpu.semihosting->call(cpu, bus);
+                cpu.pc = next_pc;
+                return ExecResult::Ok;
+            }
             cpu.raise_exception(remu::cpu::exc::Breakpoint, 0);
             return ExecResult::TrapRaised;
         }
 
         case InsnKind::WFI:
+            // Illegal in U-mode, and in S-mode when mstatus.TW is set.
+            if (cpu.priv == PrivMode::User ||
+                (cpu.priv == PrivMode::Supervisor && (cpu.csr.mstatus() & status::TW) != 0)) {
+                return illegal(cpu, d);
+            }
             // Architecturally: wait until interrupt becomes pending.
             // In emulator we request the simulator to idle/tick.
             // PC should advance as if instruction executed.
             cpu.pc = cpu.pc + d.length;
             return remu::cpu::ExecResult::Wfi;
+
+        case InsnKind::WRS_NTO:
+        case InsnKind::WRS_STO:
+            // Without a reservation there is nothing to wait on: it completes
+            if (!cpu.reservation_valid) {
+                cpu.pc = next_pc;
+                return ExecResult::Ok;
+            }
+            // Below M-mode with mstatus.TW, a WRS.NTO that doesn't complete
+            // within a bounded time traps; here that bound is zero.
+            if (d.kind == InsnKind::WRS_NTO && cpu.priv != PrivMode::Machine &&
+                (cpu.csr.mstatus() & status::TW) != 0) {
+                return illegal(cpu, d);
+            }
+            cpu.pc = next_pc;
+            return d.kind == InsnKind::WRS_NTO ? ExecResult::WrsNto : ExecResult::WrsSto;
         
         case InsnKind::MRET: {
-            constexpr std::uint32_t MSTATUS_MIE   = 1u << 3;
-            constexpr std::uint32_t MSTATUS_MPIE  = 1u << 7;
-            constexpr std::uint32_t MSTATUS_MPP_MASK = 3u << 11;
+            if (cpu.priv != PrivMode::Machine) return illegal(cpu, d);
 
             std::uint32_t ms = cpu.csr.mstatus();
 
             // Extract MPP
-            std::uint32_t mpp = (ms & MSTATUS_MPP_MASK) >> 11;
+            const std::uint32_t mpp = (ms & status::MPP_MASK) >> status::MPP_SHIFT;
 
             // MIE <- MPIE
-            if (ms & MSTATUS_MPIE) ms |= MSTATUS_MIE;
-            else                   ms &= ~MSTATUS_MIE;
+            if (ms & status::MPIE) ms |= status::MIE;
+            else                   ms &= ~status::MIE;
 
             // MPIE <- 1
-            ms |= MSTATUS_MPIE;
+            ms |= status::MPIE;
 
-            // MPP <- 0 (U-mode) after return
-            ms &= ~MSTATUS_MPP_MASK;
+            // MPP <- 0 (U-mode) after return; leaving M-mode clears MPRV
+            ms &= ~status::MPP_MASK;
+            if (mpp != static_cast<std::uint32_t>(PrivMode::Machine)) ms &= ~status::MPRV;
 
-            cpu.csr.write(0x300, ms); // or set_mstatus
+            cpu.csr.set_mstatus(ms);
             cpu.priv = static_cast<remu::cpu::PrivMode>(mpp);
 
             cpu.pc = cpu.csr.mepc();
             return ExecResult::Ok;
         }
 
+        case InsnKind::SRET: {
+            if (cpu.priv == PrivMode::User ||
+                (cpu.priv == PrivMode::Supervisor && (cpu.csr.mstatus() & status::TSR) != 0)) {
+                return illegal(cpu, d);
+            }
+
+            std::uint32_t ms = cpu.csr.mstatus();
+            const bool spp = (ms & status::SPP) != 0;
+
+            // SIE <- SPIE, SPIE <- 1, SPP <- U, and MPRV cleared (never returns to M)
+            if (ms & status::SPIE) ms |= status::SIE;
+            else                   ms &= ~status::SIE;
+            ms |= status::SPIE;
+            ms &= ~(status::SPP | status::MPRV);
+
+            cpu.csr.set_mstatus(ms);
+            cpu.priv = spp ? PrivMode::Supervisor : PrivMode::User;
+
+            cpu.pc = cpu.csr.sepc();
+            return ExecResult::Ok;
+        }
+
         default:
             return ExecResult::Fault;
     }
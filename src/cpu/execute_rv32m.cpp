@@ -1,13 +1,11 @@
-#include <remu/cpu/decode.hpp>
-#include <remu/cpu/cpu.hpp>
-#include <remu/mem/bus.hpp>
+#include <remu/cpu/execute.hpp>
 
 #include <cstdint>
 #include <limits>
 
 namespace remu::cpu {
 
-bool execute_rv32m(const DecodedInsn& d, Cpu& cpu, remu::mem::Bus&) {
+ExecResult execute_rv32m(const DecodedInsn& d, Cpu& cpu, remu::mem::Bus&) {
     const std::uint32_t pc = cpu.pc;
     const std::uint32_t rs1u = cpu.regs.read(d.rs1);
     const std::uint32_t rs2u = cpu.regs.read(d.rs2);
@@ -21,13 +19,13 @@ bool execute_rv32m(const DecodedInsn& d, Cpu& cpu, remu::mem::Bus&) {
             std::uint64_t prod = static_cast<std::uint64_t>(rs1u) * static_cast<std::uint64_t>(rs2u);
             cpu.regs.write(d.rd, static_cast<std::uint32_t>(prod));
             cpu.pc = next_pc;
-            return true;
+            return ExecResult::Ok;
         }
         case InsnKind::MULH: {
             std::int64_t prod = static_cast<std::int64_t>(rs1s) * static_cast<std::int64_t>(rs2s);
             cpu.regs.write(d.rd, static_cast<std::uint32_t>(static_cast<std::uint64_t>(prod) >> 32));
             cpu.pc = next_pc;
-            return true;
+            return ExecResult::Ok;
         }
         case InsnKind::MULHSU: {
             std::int64_t  a = static_cast<std::int64_t>(rs1s);
@@ -35,13 +33,13 @@ bool execute_rv32m(const DecodedInsn& d, Cpu& cpu, remu::mem::Bus&) {
             std::int64_t prod = a * static_cast<std::int64_t>(b);
             cpu.regs.write(d.rd, static_cast<std::uint32_t>(static_cast<std::uint64_t>(prod) >> 32));
             cpu.pc = next_pc;
-            return true;
+            return ExecResult::Ok;
         }
         case InsnKind::MULHU: {
             std::uint64_t prod = static_cast<std::uint64_t>(rs1u) * static_cast<std::uint64_t>(rs2u);
             cpu.regs.write(d.rd, static_cast<std::uint32_t>(prod >> 32));
             cpu.pc = next_pc;
-            return true;
+            return ExecResult::Ok;
         }
 
         case InsnKind::DIV: {
@@ -53,7 +51,7 @@ bool execute_rv32m(const DecodedInsn& d, Cpu& cpu, remu::mem::Bus&) {
                 cpu.regs.write(d.rd, static_cast<std::uint32_t>(rs1s / rs2s));
             }
             cpu.pc = next_pc;
-            return true;
+            return ExecResult::Ok;
         }
 
         case InsnKind::DIVU: {
@@ -63,7 +61,7 @@ bool execute_rv32m(const DecodedInsn& d, Cpu& cpu, remu::mem::Bus&) {
                 cpu.regs.write(d.rd, rs1u / rs2u);
             }
             cpu.pc = next_pc;
-            return true;
+            return ExecResult::Ok;
         }
 
         case InsnKind::REM: {
@@ -75,7 +73,7 @@ bool execute_rv32m(const DecodedInsn& d, Cpu& cpu, remu::mem::Bus&) {
                 cpu.regs.write(d.rd, static_cast<std::uint32_t>(rs1s % rs2s));
             }
             cpu.pc = next_pc;
-            return true;
+            return ExecResult::Ok;
         }
 
         case InsnKind::REMU: {
@@ -85,11 +83,11 @@ bool execute_rv32m(const DecodedInsn& d, Cpu& cpu, remu::mem::Bus&) {
                 cpu.regs.write(d.rd, rs1u % rs2u);
             }
             cpu.pc = next_pc;
-            return true;
+            return ExecResult::Ok;
         }
 
         default:
-            return false;
+            return ExecResult::Fault;
     }
 }
 
@@ -0,0 +1,255 @@
+#include <remu/cpu/mmu.hpp>
+#include <remu/cpu/exception.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <span>
+
+namespace remu::cpu {
+
+namespace {
+
+constexpr std::uint32_t PAGE_SIZE = 4096;
+constexpr std::uint32_t PAGE_MASK = PAGE_SIZE - 1;
+
+// Sv32 PTE bits
+constexpr std::uint32_t PTE_V = 1u << 0;
+constexpr std::uint32_t PTE_R = 1u << 1;
+constexpr std::uint32_t PTE_W = 1u << 2;
+constexpr std::uint32_t PTE_X = 1u << 3;
+constexpr std::uint32_t PTE_U = 1u << 4;
+constexpr std::uint32_t PTE_A = 1u << 6;
+constexpr std::uint32_t PTE_D = 1u << 7;
+
+std::uint32_t page_fault_cause(Access acc) {
+    switch (acc) {
+        case Access::Fetch: return exc::InstructionPageFault;
+        case Access::Load:  return exc::LoadPageFault;
+        default:            return exc::StorePageFault;
+    }
+}
+
+std::uint32_t access_fault_cause(Access acc) {
+    switch (acc) {
+        case Access::Fetch: return exc::InstructionAccessFault;
+        case Access::Load:  return exc::LoadAccessFault;
+        default:            return exc::StoreAccessFault;
+    }
+}
+
+ExecResult raise(Cpu& cpu, std::uint32_t cause, std::uint32_t tval) {
+    cpu.raise_exception(cause, tval);
+    return ExecResult::TrapRaised;
+}
+
+// Two-level Sv32 walk. On success `ppage` is the physical base of the 4 KiB
+// page holding vaddr and `mega` says whether it came from a 4 MiB leaf.
+// A/D bits are updated in place (the spec allows either that or a fault),
+// atomically: if another hart changed the PTE since it was read, the walk
+// starts over.
+ExecResult walk(Cpu& cpu, remu::mem::Bus& bus, std::uint32_t vaddr, Access acc,
+                PrivMode priv, std::uint32_t& ppage, bool& mega) {
+    const std::uint32_t ms = cpu.csr.mstatus();
+
+    std::uint64_t table = static_cast<std::uint64_t>(cpu.csr.satp() & satp::PPN_MASK) << 12;
+    std::uint32_t pte = 0;
+    std::uint64_t pte_addr = 0;
+    int level = 1;
+
+    for (;; --level) {
+        const std::uint32_t vpn = (vaddr >> (12 + 10 * level)) & 0x3FFu;
+        pte_addr = table + vpn * 4u;
+        // Page tables above 4 GiB are not reachable on this 32-bit bus.
+        if (pte_addr > 0xFFFF'FFFFull ||
+            !bus.read32(static_cast<std::uint32_t>(pte_addr), pte)) {
+            return raise(cpu, access_fault_cause(acc), vaddr);
+        }
+
+        if ((pte & PTE_V) == 0 || ((pte & PTE_R) == 0 && (pte & PTE_W) != 0)) {
+            return raise(cpu, page_fault_cause(acc), vaddr);
+        }
+        if ((pte & (PTE_R | PTE_X)) != 0) break;  // leaf
+
+        if (level == 0) return raise(cpu, page_fault_cause(acc), vaddr);
+        table = static_cast<std::uint64_t>(pte >> 10) << 12;
+    }
+
+    // Privilege and permission checks
+    if ((pte & PTE_U) != 0) {
+        if (priv == PrivMode::Supervisor &&
+            (acc == Access::Fetch || (ms & status::SUM) == 0)) {
+            return raise(cpu, page_fault_cause(acc), vaddr);
+        }
+    } else if (priv == PrivMode::User) {
+        return raise(cpu, page_fault_cause(acc), vaddr);
+    }
+
+    bool allowed = false;
+    switch (acc) {
+        case Access::Fetch: allowed = (pte & PTE_X) != 0; break;
+        case Access::Load:
+            allowed = (pte & PTE_R) != 0 || ((ms & status::MXR) != 0 && (pte & PTE_X) != 0);
+            break;
+        case Access::Store: allowed = (pte & PTE_W) != 0; break;
+    }
+    if (!allowed) return raise(cpu, page_fault_cause(acc), vaddr);
+
+    const std::uint64_t ppn = pte >> 10;
+    if (level == 1 && (ppn & 0x3FFu) != 0) {
+        return raise(cpu, page_fault_cause(acc), vaddr);  // misaligned megapage
+    }
+
+    const std::uint32_t want = PTE_A | (acc == Access::Store ? PTE_D : 0u);
+    if ((pte & want) != want) {
+        const auto addr = static_cast<std::uint32_t>(pte_addr);
+        if (remu::mem::Memory* ram = bus.ram_at(addr, 4)) {
+            auto* word = reinterpret_cast<std::uint32_t*>(ram->view(addr, 4).data());
+            std::uint32_t expected = pte;
+            if (!std::atomic_ref<std::uint32_t>(*word).compare_exchange_strong(
+                    expected, pte | want, std::memory_order_acq_rel)) {
+                return walk(cpu, bus, vaddr, acc, priv, ppage, mega);
+            }
+            ram->mark_dirty(addr, 4);
+        } else if (!bus.write32(addr, pte | want)) {
+            return raise(cpu, access_fault_cause(acc), vaddr);
+        }
+    }
+
+    std::uint64_t pa = ppn << 12;
+    if (level == 1) pa |= vaddr & 0x003F'F000u;
+    if (pa > 0xFFFF'FFFFull) return raise(cpu, access_fault_cause(acc), vaddr);
+
+    ppage = static_cast<std::uint32_t>(pa);
+    mega = level == 1;
+    return ExecResult::Ok;
+}
+
+ExecResult load_phys(remu::mem::Bus& bus, std::uint32_t paddr, std::uint32_t len, std::uint32_t& out) {
+    bool ok = false;
+    switch (len) {
+        case 1: { std::uint8_t v = 0;  ok = bus.read8(paddr, v);  out = v; break; }
+        case 2: { std::uint16_t v = 0; ok = bus.read16(paddr, v); out = v; break; }
+        default: ok = bus.read32(paddr, out); break;
+    }
+    return ok ? ExecResult::Ok : ExecResult::Fault;
+}
+
+ExecResult store_phys(remu::mem::Bus& bus, std::uint32_t paddr, std::uint32_t len, std::uint32_t val) {
+    bool ok = false;
+    switch (len) {
+        case 1:  ok = bus.write8(paddr, static_cast<std::uint8_t>(val & 0xFFu)); break;
+        case 2:  ok = bus.write16(paddr, static_cast<std::uint16_t>(val & 0xFFFFu)); break;
+        default: ok = bus.write32(paddr, val); break;
+    }
+    return ok ? ExecResult::Ok : ExecResult::Fault;
+}
+
+} // namespace
+
+ExecResult mmu_translate(Cpu& cpu, remu::mem::Bus& bus, std::uint32_t vaddr,
+                         Access acc, std::uint32_t& paddr) {
+    const PrivMode priv = (acc == Access::Fetch) ? cpu.priv : data_priv(cpu);
+    TlbEntry& e = cpu.tlb.entry(priv, acc, vaddr);
+    const std::uint32_t vpn = vaddr >> 12;
+
+    // kInvalid never matches: its VPN bits are above any 20-bit VPN.
+    if ((e.tag & ~TlbEntry::kMmioTag) == vpn) {
+        paddr = e.ppage | (vaddr & PAGE_MASK);
+        return ExecResult::Ok;
+    }
+
+    std::uint32_t ppage = vaddr & ~PAGE_MASK;
+    bool mega = false;
+    if (priv != PrivMode::Machine && (cpu.csr.satp() & satp::MODE_SV32) != 0) {
+        if (auto r = walk(cpu, bus, vaddr, acc, priv, ppage, mega); r != ExecResult::Ok) return r;
+    }
+
+    e = TlbEntry{};
+    e.ppage = ppage;
+    e.mega = mega;
+    if (remu::mem::Memory* ram = bus.ram_at(ppage, PAGE_SIZE)) {
+        const auto host = reinterpret_cast<std::uintptr_t>(ram->view(ppage, PAGE_SIZE).data());
+        e.tag = vpn;
+        e.addend = host - (vaddr & ~PAGE_MASK);
+        e.ram = ram;
+    } else {
+        e.tag = vpn | TlbEntry::kMmioTag;
+    }
+
+    paddr = ppage | (vaddr & PAGE_MASK);
+    return ExecResult::Ok;
+}
+
+ExecResult mmu_load_slow(Cpu& cpu, remu::mem::Bus& bus, std::uint32_t vaddr,
+                         std::uint32_t len, std::uint32_t& out) {
+    if ((vaddr & (len - 1)) == 0) {
+        std::uint32_t paddr = 0;
+        if (auto r = mmu_translate(cpu, bus, vaddr, Access::Load, paddr); r != ExecResult::Ok) return r;
+        return load_phys(bus, paddr, len, out);
+    }
+
+    // Misaligned: trap like hardware without misaligned support, or split
+    // the access at the page boundary and move each piece as a block.
+    if (cpu.trap_misaligned) return raise(cpu, exc::LoadAddressMisaligned, vaddr);
+    ++cpu.misaligned_accesses;
+
+    std::uint8_t buf[4] = {};
+    for (std::uint32_t done = 0; done < len;) {
+        const std::uint32_t va = vaddr + done;
+        const std::uint32_t n = std::min(len - done, PAGE_SIZE - (va & PAGE_MASK));
+        std::uint32_t paddr = 0;
+        if (auto r = mmu_translate(cpu, bus, va, Access::Load, paddr); r != ExecResult::Ok) return r;
+        if (!bus.read_block(paddr, std::span<std::uint8_t>(buf + done, n))) return ExecResult::Fault;
+        done += n;
+    }
+
+    out = 0;
+    for (std::uint32_t i = 0; i < len; ++i) {
+        out |= static_cast<std::uint32_t>(buf[i]) << (8u * i);
+    }
+    return ExecResult::Ok;
+}
+
+ExecResult mmu_store_slow(Cpu& cpu, remu::mem::Bus& bus, std::uint32_t vaddr,
+                          std::uint32_t len, std::uint32_t val) {
+    if ((vaddr & (len - 1)) == 0) {
+        std::uint32_t paddr = 0;
+        if (auto r = mmu_translate(cpu, bus, vaddr, Access::Store, paddr); r != ExecResult::Ok) return r;
+        return store_phys(bus, paddr, len, val);
+    }
+
+    if (cpu.trap_misaligned) return raise(cpu, exc::StoreAddressMisaligned, vaddr);
+    ++cpu.misaligned_accesses;
+
+    // Translate both pages before writing anything, so a fault on the second
+    // page leaves memory untouched.
+    const std::uint32_t first = std::min(len, PAGE_SIZE - (vaddr & PAGE_MASK));
+    std::uint32_t pa0 = 0;
+    std::uint32_t pa1 = 0;
+    if (auto r = mmu_translate(cpu, bus, vaddr, Access::Store, pa0); r != ExecResult::Ok) return r;
+    if (first < len) {
+        if (auto r = mmu_translate(cpu, bus, vaddr + first, Access::Store, pa1); r != ExecResult::Ok) return r;
+    }
+
+    std::uint8_t buf[4] = {};
+    for (std::uint32_t i = 0; i < len; ++i) {
+        buf[i] = static_cast<std::uint8_t>((val >> (8u * i)) & 0xFFu);
+    }
+    if (!bus.write_block(pa0, std::span<const std::uint8_t>(buf, first))) return ExecResult::Fault;
+    if (first < len &&
+        !bus.write_block(pa1, std::span<const std::uint8_t>(buf + first, len - first))) {
+        return ExecResult::Fault;
+    }
+    return ExecResult::Ok;
+}
+
+ExecResult mmu_fetch32_slow(Cpu& cpu, remu::mem::Bus& bus, std::uint32_t vaddr,
+                            std::uint32_t& out) {
+    if ((vaddr & 0x3u) != 0) return raise(cpu, exc::InstructionAddressMisaligned, vaddr);
+
+    std::uint32_t paddr = 0;
+    if (auto r = mmu_translate(cpu, bus, vaddr, Access::Fetch, paddr); r != ExecResult::Ok) return r;
+    return bus.read32(paddr, out) ? ExecResult::Ok : ExecResult::Fault;
+}
+
+} // namespace remu::cpu
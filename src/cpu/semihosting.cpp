@@ -0,0 +1,374 @@
+#include <remu/cpu/semihosting.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <ctime>
+#include <iterator>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <remu/cpu/cpu.hpp>
+#include <remu/mem/bus.hpp>
+#include <remu/mem/memory.hpp>
+
+namespace remu::cpu {
+
+namespace {
+
+// The trap sequence around the EBREAK
+constexpr std::uint32_t SLLI_X0_1F = 0x01F0'1013;
+constexpr std::uint32_t SRAI_X0_7  = 0x4070'5013;
+
+// Operation numbers (Arm semihosting, as adopted by RISC-V)
+constexpr std::uint32_t SYS_OPEN          = 0x01;
+constexpr std::uint32_t SYS_CLOSE         = 0x02;
+constexpr std::uint32_t SYS_WRITEC        = 0x03;
+constexpr std::uint32_t SYS_WRITE0        = 0x04;
+constexpr std::uint32_t SYS_WRITE         = 0x05;
+constexpr std::uint32_t SYS_READ          = 0x06;
+constexpr std::uint32_t SYS_ISERROR       = 0x08;
+constexpr std::uint32_t SYS_ISTTY         = 0x09;
+constexpr std::uint32_t SYS_SEEK          = 0x0A;
+constexpr std::uint32_t SYS_FLEN          = 0x0C;
+constexpr std::uint32_t SYS_REMOVE        = 0x0E;
+constexpr std::uint32_t SYS_CLOCK         = 0x10;
+constexpr std::uint32_t SYS_TIME          = 0x11;
+constexpr std::uint32_t SYS_ERRNO         = 0x13;
+constexpr std::uint32_t SYS_EXIT          = 0x18;
+constexpr std::uint32_t SYS_EXIT_EXTENDED = 0x20;
+constexpr std::uint32_t SYS_ELAPSED       = 0x30;
+constexpr std::uint32_t SYS_TICKFREQ      = 0x31;
+
+constexpr std::uint32_t ADP_STOPPED_APPLICATION_EXIT = 0x20026;
+
+constexpr std::uint32_t RET_ERROR = 0xFFFF'FFFFu; // -1
+
+// ISO C fopen() modes "r", "rb", "r+", "r+b", "w", "wb", "w+", "w+b", "a",
+// "ab", "a+", "a+b", as open(2) flags
+constexpr int OPEN_FLAGS[12] = {
+    O_RDONLY, O_RDONLY, O_RDWR, O_RDWR,
+    O_WRONLY | O_CREAT | O_TRUNC, O_WRONLY | O_CREAT | O_TRUNC,
+    O_RDWR | O_CREAT | O_TRUNC, O_RDWR | O_CREAT | O_TRUNC,
+    O_WRONLY | O_CREAT | O_APPEND, O_WRONLY | O_CREAT | O_APPEND,
+    O_RDWR | O_CREAT | O_APPEND, O_RDWR | O_CREAT | O_APPEND,
+};
+
+// Largest host transfer per SYS_READ/SYS_WRITE chunk when the buffer isn't
+// one RAM range
+constexpr std::uint32_t BOUNCE_SIZE = 64 * 1024;
+
+std::uint32_t arg(remu::mem::Bus& bus, std::uint32_t block, std::uint32_t i) {
+    std::uint32_t v = 0;
+    bus.read32(block + 4 * i, v);
+    return v;
+}
+
+// 0, or the errno for a bad length or an unreadable string. The length is
+// the guest's, so it is checked before anything is allocated for it.
+int read_string(remu::mem::Bus& bus, std::uint32_t addr, std::uint32_t len, std::string& out) {
+    if (len == 0) return EINVAL;
+    if (len >= PATH_MAX) return ENAMETOOLONG;
+    out.resize(len);
+    if (!bus.read_block(addr, {reinterpret_cast<std::uint8_t*>(out.data()), out.size()})) {
+        return EFAULT;
+    }
+    return 0;
+}
+
+} // namespace
+
+Semihosting::Semihosting() : start_(std::chrono::steady_clock::now()) {}
+
+Semihosting::~Semihosting() {
+    for (const File& f : files_) {
+        if (f.open && !f.tty) ::close(f.fd);
+    }
+}
+
+bool Semihosting::is_call(remu::mem::Bus& bus, std::uint32_t pc) {
+    std::uint32_t before = 0, after = 0;
+    return bus.read32(pc - 4, before) && before == SLLI_X0_1F &&
+           bus.read32(pc + 4, after) && after == SRAI_X0_7;
+}
+
+void Semihosting::call(Cpu& cpu, remu::mem::Bus& bus) {
+    const std::uint32_t op = cpu.regs.read(10);    // a0
+    const std::uint32_t param = cpu.regs.read(11); // a1
+    std::uint32_t ret = RET_ERROR;
+
+    // Host state (handles, errno, the console) is shared by all harts
+    const auto lock = bus.device_lock();
+
+    switch (op) {
+        case SYS_OPEN:
+            ret = open_(bus, param);
+            break;
+        case SYS_CLOSE:
+            ret = close_(arg(bus, param, 0));
+            break;
+        case SYS_WRITEC: {
+            std::uint8_t c = 0;
+            if (bus.read8(param, c)) put_(c);
+            ret = 0;
+            break;
+        }
+        case SYS_WRITE0: {
+            std::uint8_t c = 0;
+            for (std::uint32_t p = param; bus.read8(p, c) && c != 0; ++p) put_(c);
+            ret = 0;
+            break;
+        }
+        case SYS_WRITE:
+            ret = write_(bus, arg(bus, param, 0), arg(bus, param, 1), arg(bus, param, 2));
+            break;
+        case SYS_READ:
+            ret = read_(bus, arg(bus, param, 0), arg(bus, param, 1), arg(bus, param, 2));
+            break;
+        case SYS_ISERROR:
+            ret = static_cast<std::int32_t>(arg(bus, param, 0)) < 0 ? 1 : 0;
+            break;
+        case SYS_ISTTY: {
+            const File* f = file_(arg(bus, param, 0));
+            ret = f == nullptr ? fail_(EBADF) : (f->tty ? 1 : 0);
+            break;
+        }
+        case SYS_SEEK:
+            ret = seek_(arg(bus, param, 0), arg(bus, param, 1));
+            break;
+        case SYS_FLEN:
+            ret = flen_(arg(bus, param, 0));
+            break;
+        case SYS_REMOVE:
+            ret = remove_(bus, param);
+            break;
+        case SYS_CLOCK: {
+            const auto cs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                std::chrono::steady_clock::now() - start_).count() / 10;
+            ret = static_cast<std::uint32_t>(cs);
+            break;
+        }
+        case SYS_TIME:
+            ret = static_cast<std::uint32_t>(std::time(nullptr));
+            break;
+        case SYS_ERRNO:
+            ret = static_cast<std::uint32_t>(errno_);
+            break;
+        case SYS_EXIT:
+            // RV32: a1 is the reason code itself, not a block
+            exit_(param == ADP_STOPPED_APPLICATION_EXIT, 1);
+            ret = 0;
+            break;
+        case SYS_EXIT_EXTENDED: {
+            // An application exit carries the status; any other reason fails
+            const bool app_exit = arg(bus, param, 0) == ADP_STOPPED_APPLICATION_EXIT;
+            const std::uint32_t status = arg(bus, param, 1);
+            exit_(app_exit && status == 0, app_exit ? status : 1);
+            ret = 0;
+            break;
+        }
+        case SYS_ELAPSED: {
+            // Nanoseconds since start, as a 64-bit count in two words
+            const auto ns = static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start_).count());
+            const bool ok = bus.write32(param, static_cast<std::uint32_t>(ns)) &&
+                            bus.write32(param + 4, static_cast<std::uint32_t>(ns >> 32));
+            ret = ok ? 0 : RET_ERROR;
+            break;
+        }
+        case SYS_TICKFREQ:
+            ret = 1'000'000'000; // SYS_ELAPSED counts nanoseconds
+            break;
+        default:
+            break;
+    }
+
+    cpu.regs.write(10, ret);
+}
+
+// ---------------- Files ----------------
+
+Semihosting::File* Semihosting::file_(std::uint32_t handle) {
+    if (handle == 0 || handle > files_.size() || !files_[handle - 1].open) return nullptr;
+    return &files_[handle - 1];
+}
+
+std::uint32_t Semihosting::fail_(int err) {
+    errno_ = err;
+    return RET_ERROR;
+}
+
+void Semihosting::put_(std::uint8_t c) {
+    if (console_) {
+        console_(c);
+    } else {
+        std::fputc(c, stdout);
+    }
+}
+
+std::uint32_t Semihosting::open_(remu::mem::Bus& bus, std::uint32_t args) {
+    const std::uint32_t name_ptr = arg(bus, args, 0);
+    const std::uint32_t mode = arg(bus, args, 1);
+    const std::uint32_t name_len = arg(bus, args, 2);
+    if (mode >= std::size(OPEN_FLAGS)) return fail_(EINVAL);
+
+    std::string name;
+    if (const int err = read_string(bus, name_ptr, name_len, name); err != 0) return fail_(err);
+
+    File f;
+    f.open = true;
+    if (name == ":tt") {
+        f.tty = true;
+    } else {
+        f.fd = ::open(name.c_str(), OPEN_FLAGS[mode] | O_CLOEXEC, 0644);
+        if (f.fd < 0) return fail_(errno);
+    }
+
+    // Reuse the lowest closed handle
+    for (std::size_t i = 0; i < files_.size(); ++i) {
+        if (!files_[i].open) {
+            files_[i] = f;
+            return static_cast<std::uint32_t>(i + 1);
+        }
+    }
+    files_.push_back(f);
+    return static_cast<std::uint32_t>(files_.size());
+}
+
+std::uint32_t Semihosting::close_(std::uint32_t handle) {
+    File* f = file_(handle);
+    if (f == nullptr) return fail_(EBADF);
+    if (!f->tty && ::close(f->fd) != 0) {
+        f->open = false;
+        return fail_(errno);
+    }
+    f->open = false;
+    return 0;
+}
+
+std::uint32_t Semihosting::write_(remu::mem::Bus& bus, std::uint32_t handle, std::uint32_t buf,
+                                  std::uint32_t len) {
+    // Returns the number of bytes NOT written
+    File* f = file_(handle);
+    if (f == nullptr) {
+        fail_(EBADF);
+        return len;
+    }
+
+    if (f->tty) {
+        std::uint8_t c = 0;
+        for (std::uint32_t i = 0; i < len; ++i) {
+            if (!bus.read8(buf + i, c)) return len - i;
+            put_(c);
+        }
+        return 0;
+    }
+
+    // Straight from guest RAM when the buffer is one range
+    std::uint32_t done = 0;
+    const std::span<std::uint8_t> direct = bus.translate(buf, len);
+    std::vector<std::uint8_t> bounce;
+    while (done < len) {
+        const std::uint8_t* src;
+        std::uint32_t chunk = len - done;
+        if (!direct.empty()) {
+            src = direct.data() + done;
+        } else {
+            chunk = std::min(chunk, BOUNCE_SIZE);
+            bounce.resize(chunk);
+            if (!bus.read_block(buf + done, bounce)) break;
+            src = bounce.data();
+        }
+        const ssize_t n = ::write(f->fd, src, chunk);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            errno_ = errno;
+            break;
+        }
+        done += static_cast<std::uint32_t>(n);
+    }
+    return len - done;
+}
+
+std::uint32_t Semihosting::read_(remu::mem::Bus& bus, std::uint32_t handle, std::uint32_t buf,
+                                 std::uint32_t len) {
+    // Returns the number of bytes NOT read; len at end of file
+    File* f = file_(handle);
+    if (f == nullptr) {
+        fail_(EBADF);
+        return len;
+    }
+    if (f->tty) return len; // no console input
+
+    // Straight into guest RAM when the buffer is one range
+    remu::mem::Memory* ram = bus.ram_at(buf, len);
+    std::uint8_t* direct = ram != nullptr ? ram->view(buf, len).data() : nullptr;
+
+    std::uint32_t done = 0;
+    std::vector<std::uint8_t> bounce;
+    while (done < len) {
+        std::uint8_t* dst;
+        std::uint32_t chunk = len - done;
+        if (direct != nullptr) {
+            dst = direct + done;
+        } else {
+            chunk = std::min(chunk, BOUNCE_SIZE);
+            bounce.resize(chunk);
+            dst = bounce.data();
+        }
+        const ssize_t n = ::read(f->fd, dst, chunk);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            errno_ = errno;
+            break;
+        }
+        if (n == 0) break; // end of file
+        if (direct == nullptr &&
+            !bus.write_block(buf + done, {bounce.data(), static_cast<std::size_t>(n)})) {
+            break;
+        }
+        done += static_cast<std::uint32_t>(n);
+    }
+    // Dirty once written, so a collection during the read can't miss it
+    if (direct != nullptr) ram->mark_dirty(buf, done);
+    return len - done;
+}
+
+std::uint32_t Semihosting::seek_(std::uint32_t handle, std::uint32_t pos) {
+    File* f = file_(handle);
+    if (f == nullptr || f->tty) return fail_(EBADF);
+    if (::lseek(f->fd, static_cast<off_t>(pos), SEEK_SET) < 0) return fail_(errno);
+    return 0;
+}
+
+std::uint32_t Semihosting::flen_(std::uint32_t handle) {
+    File* f = file_(handle);
+    if (f == nullptr || f->tty) return fail_(EBADF);
+    struct stat st{};
+    if (::fstat(f->fd, &st) != 0) return fail_(errno);
+    return static_cast<std::uint32_t>(st.st_size);
+}
+
+std::uint32_t Semihosting::remove_(remu::mem::Bus& bus, std::uint32_t args) {
+    // Returns 0 or the host error code
+    std::string name;
+    if (const int err = read_string(bus, arg(bus, args, 0), arg(bus, args, 1), name); err != 0) {
+        errno_ = err;
+        return static_cast<std::uint32_t>(err);
+    }
+    if (::unlink(name.c_str()) != 0) {
+        errno_ = errno;
+        return static_cast<std::uint32_t>(errno_);
+    }
+    return 0;
+}
+
+void Semihosting::exit_(bool success, std::uint32_t code) {
+    if (exit_hook_) exit_hook_(success, success ? 0 : code);
+}
+
+} // namespace remu::cpu
@@ -0,0 +1,28 @@
+#include <remu/cpu/tlb.hpp>
+
+namespace remu::cpu {
+
+void Tlb::flush() {
+    for (std::size_t p = 0; p < 2; ++p) {          // User, Supervisor
+        for (Set& set : sets_[p]) set.fill(TlbEntry{});
+    }
+}
+
+void Tlb::flush_va(std::uint32_t vaddr) {
+    const std::uint32_t vpn  = vaddr >> 12;
+    const std::uint32_t vpn1 = vaddr >> 22;
+
+    // A megapage is cached as up to 1024 separate 4 KiB entries spread over
+    // every index, so those have to be found by scanning.
+    for (std::size_t p = 0; p < 2; ++p) {
+        for (Set& set : sets_[p]) {
+            for (TlbEntry& e : set) {
+                if (e.tag == TlbEntry::kInvalid) continue;
+                const std::uint32_t evpn = e.tag & ~TlbEntry::kMmioTag;
+                if (evpn == vpn || (e.mega && (evpn >> 10) == vpn1)) e = TlbEntry{};
+            }
+        }
+    }
+}
+
+} // namespace remu::cpu
@@ -4,25 +4,21 @@ namespace remu::cpu {
 
 namespace {
 
-// mstatus bits
-constexpr std::uint32_t MSTATUS_MIE      = 1u << 3;
-constexpr std::uint32_t MSTATUS_MPIE     = 1u << 7;
-constexpr std::uint32_t MSTATUS_MPP_MASK = 3u << 11;
-
-// mie/mip bits
-constexpr std::uint32_t MIE_MSIE = 1u << 3;
-constexpr std::uint32_t MIP_MSIP = 1u << 3;
-constexpr std::uint32_t MIE_MTIE = 1u << 7;
-constexpr std::uint32_t MIP_MTIP = 1u << 7;
-constexpr std::uint32_t MIE_MEIE = 1u << 11;
-constexpr std::uint32_t MIP_MEIP = 1u << 11;
-
-// mcause values (interrupt bit set + standard cause codes)
-constexpr std::uint32_t MCAUSE_MSI = 0x80000003u; // machine software interrupt
-constexpr std::uint32_t MCAUSE_MTI = 0x80000007u; // machine timer interrupt
-constexpr std::uint32_t MCAUSE_MEI = 0x8000000Bu; // machine external interrupt
-
-// Trap entry common
+constexpr std::uint32_t CAUSE_INTERRUPT = 0x80000000u;
+
+// Interrupts in the order they are taken when several are pending:
+// M-level sources first, then the S-level ones (privileged spec 3.1.9).
+constexpr std::uint32_t IRQ_PRIORITY[] = {
+    irq::MEI, irq::MSI, irq::MTI, irq::SEI, irq::SSI, irq::STI,
+};
+
+inline std::uint32_t trap_vector(std::uint32_t tvec, std::uint32_t code, bool interrupt) {
+    const std::uint32_t base = tvec & ~0x3u;
+    // Vectored mode only applies to interrupts
+    if (interrupt && (tvec & 0x3u) == 1u) return base + 4u * code;
+    return base;
+}
+
 inline void enter_trap_machine(Cpu& cpu, std::uint32_t mcause, std::uint32_t mtval) {
     // mepc points to faulting/trapping instruction address
     cpu.csr.set_mepc(cpu.pc);
@@ -32,51 +28,83 @@ inline void enter_trap_machine(Cpu& cpu, std::uint32_t mcause, std::uint32_t mtv
     // Update mstatus: MPIE <- MIE, MIE <- 0, MPP <- current priv
     std::uint32_t ms = cpu.csr.mstatus();
 
-    const bool prev_mie = (ms & MSTATUS_MIE) != 0;
-    if (prev_mie) ms |= MSTATUS_MPIE;
-    else          ms &= ~MSTATUS_MPIE;
-
-    ms &= ~MSTATUS_MIE;
+    if (ms & status::MIE) ms |= status::MPIE;
+    else                  ms &= ~status::MPIE;
 
-    // Set MPP = current priv (we only model Machine well right now)
-    // Machine=3, Supervisor=1, User=0
-    std::uint32_t mpp = 3u;
-    if (cpu.priv == PrivMode::Supervisor) mpp = 1u;
-    else if (cpu.priv == PrivMode::User) mpp = 0u;
+    ms &= ~status::MIE;
 
-    ms = (ms & ~MSTATUS_MPP_MASK) | (mpp << 11);
+    // Machine=3, Supervisor=1, User=0 (same encoding as MPP)
+    const std::uint32_t mpp = static_cast<std::uint32_t>(cpu.priv);
+    ms = (ms & ~status::MPP_MASK) | (mpp << status::MPP_SHIFT);
     cpu.csr.set_mstatus(ms);
 
-    // Enter machine mode
     cpu.priv = PrivMode::Machine;
+    cpu.pc = trap_vector(cpu.csr.mtvec(), mcause & ~CAUSE_INTERRUPT,
+                         (mcause & CAUSE_INTERRUPT) != 0);
+}
+
+inline void enter_trap_supervisor(Cpu& cpu, std::uint32_t scause, std::uint32_t stval) {
+    cpu.csr.set_sepc(cpu.pc);
+    cpu.csr.set_scause(scause);
+    cpu.csr.set_stval(stval);
+
+    // SPIE <- SIE, SIE <- 0, SPP <- current priv (U=0, S=1)
+    std::uint32_t ms = cpu.csr.mstatus();
+
+    if (ms & status::SIE) ms |= status::SPIE;
+    else                  ms &= ~status::SPIE;
+
+    ms &= ~status::SIE;
+
+    if (cpu.priv == PrivMode::Supervisor) ms |= status::SPP;
+    else                                  ms &= ~status::SPP;
+    cpu.csr.set_mstatus(ms);
 
-    // mtvec direct mode only
-    cpu.pc = cpu.csr.mtvec() & ~0x3u;
+    cpu.priv = PrivMode::Supervisor;
+    cpu.pc = trap_vector(cpu.csr.stvec(), scause & ~CAUSE_INTERRUPT,
+                         (scause & CAUSE_INTERRUPT) != 0);
+}
+
+// Traps taken below M-mode go to S-mode when medeleg/mideleg delegate them;
+// traps are never delegated away from M-mode.
+inline void enter_trap(Cpu& cpu, std::uint32_t cause, std::uint32_t tval) {
+    const bool interrupt = (cause & CAUSE_INTERRUPT) != 0;
+    const std::uint32_t code = cause & ~CAUSE_INTERRUPT;
+    const std::uint32_t deleg = interrupt ? cpu.csr.mideleg() : cpu.csr.medeleg();
+
+    if (cpu.priv != PrivMode::Machine && code < 32 && ((deleg >> code) & 1u) != 0) {
+        enter_trap_supervisor(cpu, cause, tval);
+    } else {
+        enter_trap_machine(cpu, cause, tval);
+    }
 }
 
 } // namespace
 
 bool check_and_take_interrupt(Cpu& cpu) {
-    const std::uint32_t ms = cpu.csr.mstatus();
-    const std::uint32_t mie = cpu.csr.mie();
-    const std::uint32_t mip = cpu.csr.mip();
+    const std::uint32_t pending = cpu.csr.mie() & cpu.csr.mip();
+    if (pending == 0) return false;
 
-    if ((ms & MSTATUS_MIE) == 0) return false;
-
-    // Standard M-mode interrupt priority: external > software > timer.
-    if ((mie & MIE_MEIE) && (mip & MIP_MEIP)) {
-        enter_trap_machine(cpu, MCAUSE_MEI, 0);
-        return true;
-    }
-    if ((mie & MIE_MSIE) && (mip & MIP_MSIP)) {
-        enter_trap_machine(cpu, MCAUSE_MSI, 0);
-        return true;
-    }
-    if ((mie & MIE_MTIE) && (mip & MIP_MTIP)) {
-        enter_trap_machine(cpu, MCAUSE_MTI, 0);
-        return true;
+    const std::uint32_t ms = cpu.csr.mstatus();
+    const std::uint32_t mideleg = cpu.csr.mideleg();
+
+    // M-level interrupts are always enabled below M-mode; delegated ones are
+    // enabled below S-mode, or in S-mode with SIE, and never taken in M-mode.
+    const bool m_enabled = cpu.priv != PrivMode::Machine || (ms & status::MIE) != 0;
+    const bool s_enabled = cpu.priv == PrivMode::User ||
+                           (cpu.priv == PrivMode::Supervisor && (ms & status::SIE) != 0);
+
+    std::uint32_t enabled = 0;
+    if (m_enabled) enabled |= pending & ~mideleg;
+    if (s_enabled) enabled |= pending & mideleg;
+    if (enabled == 0) return false;
+
+    for (std::uint32_t code : IRQ_PRIORITY) {
+        if (enabled & irq::bit(code)) {
+            enter_trap(cpu, CAUSE_INTERRUPT | code, 0);
+            return true;
+        }
     }
-
     return false;
 }
 
@@ -88,7 +116,7 @@ bool take_pending_exception(Cpu& cpu) {
     const std::uint32_t tval  = cpu.exception_tval;
 
     cpu.clear_pending_exception();
-    enter_trap_machine(cpu, cause, tval);
+    enter_trap(cpu, cause, tval);
     return true;
 }
 
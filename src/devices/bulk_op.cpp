@@ -0,0 +1,200 @@
+#include <remu/devices/bulk_op.hpp>
+
+#include <array>
+#include <cstring>
+
+#include <remu/mem/bus.hpp>
+#include <remu/mem/memory.hpp>
+
+namespace remu::devices {
+
+namespace {
+
+constexpr std::uint32_t SRC_OFF = 0x08;
+
+constexpr std::uint32_t CRC32_POLY  = 0xEDB8'8320; // reflected 0x04C11DB7
+constexpr std::uint32_t CRC32C_POLY = 0x82F6'3B78; // reflected 0x1EDC6F41
+
+// Slicing-by-8 tables: table[k][b] is the CRC of byte b followed by k zero
+// bytes, so eight input bytes fold in with eight independent lookups
+using CrcTables = std::array<std::array<std::uint32_t, 256>, 8>;
+
+constexpr CrcTables make_crc_tables(std::uint32_t poly) {
+    CrcTables t{};
+    for (std::uint32_t b = 0; b < 256; ++b) {
+        std::uint32_t c = b;
+        for (int i = 0; i < 8; ++i) c = (c & 1) ? (c >> 1) ^ poly : c >> 1;
+        t[0][b] = c;
+    }
+    for (std::size_t k = 1; k < 8; ++k) {
+        for (std::size_t b = 0; b < 256; ++b) {
+            t[k][b] = (t[k - 1][b] >> 8) ^ t[0][t[k - 1][b] & 0xFF];
+        }
+    }
+    return t;
+}
+
+constexpr CrcTables CRC32_TABLES  = make_crc_tables(CRC32_POLY);
+constexpr CrcTables CRC32C_TABLES = make_crc_tables(CRC32C_POLY);
+
+std::uint32_t crc_update(const CrcTables& t, std::uint32_t crc, const std::uint8_t* p,
+                         std::size_t len) {
+    while (len >= 8) {
+        std::uint32_t lo, hi;
+        std::memcpy(&lo, p, 4);
+        std::memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^
+              t[4][lo >> 24] ^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^
+              t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len-- > 0) crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+    return crc;
+}
+
+} // namespace
+
+BulkOp::BulkOp(remu::mem::Bus& bus) : bus_(bus) {}
+
+void BulkOp::set_irq_line(std::function<void(bool)> line) {
+    std::lock_guard<std::mutex> lock(irq_mu_);
+    irq_line_ = std::move(line);
+}
+
+void BulkOp::update_irq_() {
+    std::lock_guard<std::mutex> lock(irq_mu_);
+    if (irq_line_) irq_line_(intr_.load(std::memory_order_relaxed) != 0);
+}
+
+std::uint8_t* BulkOp::host_(std::uint32_t addr, std::uint32_t len, remu::mem::Memory** ram) {
+    remu::mem::Memory* r = bus_.ram_at(addr, len);
+    if (r == nullptr) return nullptr;
+    if (ram != nullptr) *ram = r;
+    return r->view(addr, len).data();
+}
+
+bool BulkOp::run_(const Job& job, std::uint32_t& result) {
+    if (job.len == 0) {
+        // An empty chunk leaves a running CRC as it is
+        if (job.op == kCrc32 || job.op == kCrc32c) result = job.value;
+        return job.op >= kCopy && job.op <= kCompare;
+    }
+
+    switch (job.op) {
+        case kCopy: {
+            remu::mem::Memory* ram = nullptr;
+            const std::uint8_t* src = host_(job.src, job.len);
+            std::uint8_t* dst = host_(job.dst, job.len, &ram);
+            if (src == nullptr || dst == nullptr) return false;
+            std::memmove(dst, src, job.len);
+            // Dirty once written, so a collection in between can't miss it
+            ram->mark_dirty(job.dst, job.len);
+            return true;
+        }
+        case kFill: {
+            remu::mem::Memory* ram = nullptr;
+            std::uint8_t* dst = host_(job.dst, job.len, &ram);
+            if (dst == nullptr) return false;
+            std::memset(dst, static_cast<int>(job.value & 0xFF), job.len);
+            ram->mark_dirty(job.dst, job.len);
+            return true;
+        }
+        case kCrc32:
+        case kCrc32c: {
+            const std::uint8_t* src = host_(job.src, job.len);
+            if (src == nullptr) return false;
+            result = crc_update(job.op == kCrc32 ? CRC32_TABLES : CRC32C_TABLES, job.value, src,
+                                job.len);
+            return true;
+        }
+        case kCompare: {
+            const std::uint8_t* a = host_(job.src, job.len);
+            const std::uint8_t* b = host_(job.dst, job.len);
+            if (a == nullptr || b == nullptr) return false;
+            const int c = std::memcmp(a, b, job.len);
+            result = c < 0 ? 0xFFFF'FFFFu : (c > 0 ? 1u : 0u);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// ---------------- MMIO ----------------
+
+bool BulkOp::read(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t& out) {
+    out = 0;
+    if (width_bytes != 4) return false;
+    return kRegs_.read(*this, addr & (kWindowSize - 1), out);
+}
+
+bool BulkOp::write(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t val) {
+    if (width_bytes != 4) return false;
+    return kRegs_.write(*this, addr & (kWindowSize - 1), val);
+}
+
+bool BulkOp::id_read_(std::uint32_t, std::uint32_t& out) {
+    out = kId;
+    return true;
+}
+
+bool BulkOp::param_read_(std::uint32_t off, std::uint32_t& out) {
+    out = params_[(off - SRC_OFF) >> 2];
+    return true;
+}
+
+bool BulkOp::param_write_(std::uint32_t off, std::uint32_t val) {
+    params_[(off - SRC_OFF) >> 2] = val;
+    return true;
+}
+
+bool BulkOp::status_read_(std::uint32_t, std::uint32_t& out) {
+    // Acquire: once BUSY reads clear, the worker's stores to RAM are visible
+    out = status_.load(std::memory_order_acquire);
+    return true;
+}
+
+bool BulkOp::result_read_(std::uint32_t, std::uint32_t& out) {
+    out = result_.load(std::memory_order_relaxed);
+    return true;
+}
+
+bool BulkOp::intr_read_(std::uint32_t, std::uint32_t& out) {
+    out = intr_.load(std::memory_order_acquire);
+    return true;
+}
+
+bool BulkOp::intr_write_(std::uint32_t, std::uint32_t val) {
+    intr_.fetch_and(~val, std::memory_order_relaxed);
+    update_irq_();
+    return true;
+}
+
+bool BulkOp::cmd_write_(std::uint32_t, std::uint32_t val) {
+    if (status_.load(std::memory_order_acquire) & kStatusBusy) return true;
+
+    const Job job{val & ~kCmdIrq, params_[0], params_[1], params_[2], params_[3]};
+    if ((val & kCmdIrq) == 0) {
+        std::uint32_t result = 0;
+        const bool ok = run_(job, result);
+        result_.store(result, std::memory_order_relaxed);
+        status_.store(ok ? 0 : kStatusError, std::memory_order_release);
+        return true;
+    }
+
+    status_.store(kStatusBusy, std::memory_order_relaxed);
+    if (!worker_) worker_ = std::make_unique<remu::common::WorkerPool>(1);
+    worker_->submit([this, job] {
+        std::uint32_t result = 0;
+        const bool ok = run_(job, result);
+        result_.store(result, std::memory_order_relaxed);
+        status_.store(ok ? 0 : kStatusError, std::memory_order_release);
+        intr_.fetch_or(1, std::memory_order_release);
+        update_irq_();
+    });
+    return true;
+}
+
+} // namespace remu::devices
@@ -1,119 +1,204 @@
 #include <remu/devices/clint.hpp>
 
+#include <utility>
+
 namespace remu::devices {
 
 namespace {
-constexpr std::uint32_t MSIP0_OFF      = 0x0000;
-constexpr std::uint32_t MTIMECMP0_OFF  = 0x4000; // low 32
-constexpr std::uint32_t MTIMECMP0H_OFF = 0x4004; // high 32
+constexpr std::uint32_t MSIP_BASE      = 0x0000; // + 4 * hart
+constexpr std::uint32_t MTIMECMP_BASE  = 0x4000; // + 8 * hart: low 32, then high 32
 constexpr std::uint32_t MTIME_OFF      = 0xBFF8; // low 32
 constexpr std::uint32_t MTIMEH_OFF     = 0xBFFC; // high 32
-} // namespace
 
-Clint::Clint() = default;
+constexpr std::uint64_t NS_PER_SEC = 1'000'000'000ull;
 
-void Clint::tick(std::uint64_t cycles) {
-    std::lock_guard<std::mutex> lock(mu_);
-    mtime_ += cycles;
+std::uint64_t with_low(std::uint64_t v, std::uint32_t lo) {
+    return (v & 0xFFFF'FFFF'0000'0000ull) | static_cast<std::uint64_t>(lo);
+}
+std::uint64_t with_high(std::uint64_t v, std::uint32_t hi) {
+    return (static_cast<std::uint64_t>(hi) << 32) | (v & 0x0000'0000'FFFF'FFFFull);
 }
+} // namespace
 
-bool Clint::msip_pending() const {
-    std::lock_guard<std::mutex> lock(mu_);
-    return (msip0_ & 0x1u) != 0;
+Clint::Clint(std::uint32_t num_harts)
+    : num_harts_(num_harts),
+      harts_(std::make_unique<HartTimer[]>(num_harts)) {
+    set_timebase(Timebase::Icount);
 }
 
-bool Clint::mtip_pending() const {
-    std::lock_guard<std::mutex> lock(mu_);
-    return mtime_ >= mtimecmp0_;
+void Clint::set_timebase(Timebase tb, std::uint64_t freq_hz) {
+    timebase_ = tb;
+    freq_hz_ = freq_hz != 0 ? freq_hz : kDefaultFreqHz;
+    epoch_ = std::chrono::steady_clock::now();
+    icount_.store(0, std::memory_order_relaxed);
+    offset_.store(0, std::memory_order_relaxed);
+    for (std::uint32_t h = 0; h < num_harts_; ++h) update_deadline_(h);
 }
 
-std::uint64_t Clint::mtime() const {
-    std::lock_guard<std::mutex> lock(mu_);
-    return mtime_;
+void Clint::attach(remu::common::EventQueue& events, std::function<void(std::uint32_t)> on_change) {
+    events_ = &events;
+    on_change_ = std::move(on_change);
+    for (std::uint32_t h = 0; h < num_harts_; ++h) update_deadline_(h);
 }
 
-std::uint64_t Clint::mtimecmp() const {
-    std::lock_guard<std::mutex> lock(mu_);
-    return mtimecmp0_;
+void Clint::sync() {
+    for (std::uint32_t h = 0; h < num_harts_; ++h) update_mtip_(h);
 }
 
-bool Clint::read(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t& out) {
-    std::lock_guard<std::mutex> lock(mu_);
-    out = 0;
+std::uint64_t Clint::now() const {
+    if (timebase_ == Timebase::Icount) return icount_.load(std::memory_order_relaxed);
 
-    // CLINT is usually accessed as 32-bit words on RV32
-    if (width_bytes != 4) return false;
+    const auto ns = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - epoch_).count());
+    // Split to avoid overflowing ns * freq
+    return (ns / NS_PER_SEC) * freq_hz_ + (ns % NS_PER_SEC) * freq_hz_ / NS_PER_SEC;
+}
 
-    const std::uint32_t off = off_(addr);
+std::uint64_t Clint::advance_to(std::uint64_t raw) {
+    if (timebase_ != Timebase::Icount) return 0;
 
-    switch (off) {
-        case MSIP0_OFF:
-            out = msip0_;
-            return true;
+    const std::uint64_t cur = icount_.load(std::memory_order_relaxed);
+    if (raw <= cur) return 0;
 
-        case MTIMECMP0_OFF:
-            out = static_cast<std::uint32_t>(mtimecmp0_ & 0xFFFF'FFFFull);
-            return true;
+    icount_.store(raw, std::memory_order_relaxed);
+    return raw - cur;
+}
 
-        case MTIMECMP0H_OFF:
-            out = static_cast<std::uint32_t>((mtimecmp0_ >> 32) & 0xFFFF'FFFFull);
-            return true;
+std::chrono::steady_clock::time_point Clint::host_time_at(std::uint64_t raw) const {
+    using std::chrono::steady_clock;
+    if (timebase_ != Timebase::Realtime || raw == remu::common::EventQueue::kNever) {
+        return steady_clock::time_point::max();
+    }
 
-        case MTIME_OFF:
-            out = static_cast<std::uint32_t>(mtime_ & 0xFFFF'FFFFull);
-            return true;
+    // Inverse of now(); anything beyond a few years counts as "never"
+    const std::uint64_t secs = raw / freq_hz_;
+    if (secs > (1ull << 27)) return steady_clock::time_point::max();
+    // Round up so now() has reached `raw` by then
+    const std::uint64_t ns = secs * NS_PER_SEC +
+                             ((raw % freq_hz_) * NS_PER_SEC + freq_hz_ - 1) / freq_hz_;
+    return epoch_ + std::chrono::nanoseconds(static_cast<std::int64_t>(ns));
+}
 
-        case MTIMEH_OFF:
-            out = static_cast<std::uint32_t>((mtime_ >> 32) & 0xFFFF'FFFFull);
-            return true;
+void Clint::set_mtime_(std::uint64_t value) {
+    offset_.store(value - now(), std::memory_order_relaxed);
+    for (std::uint32_t h = 0; h < num_harts_; ++h) update_deadline_(h);
+}
 
-        default:
-            out = 0;
-            return true; // unmapped reads return 0 in many simple models
+void Clint::update_deadline_(std::uint32_t hart) {
+    HartTimer& t = harts_[hart];
+
+    // Smallest raw value with raw + offset >= mtimecmp, treating the offset
+    // as signed (guest mtime writes can move time backwards), saturated.
+    const std::uint64_t cmp = t.mtimecmp.load(std::memory_order_relaxed);
+    const auto off = static_cast<std::int64_t>(offset_.load(std::memory_order_relaxed));
+
+    std::uint64_t deadline = 0;
+    if (off >= 0) {
+        const auto o = static_cast<std::uint64_t>(off);
+        deadline = cmp >= o ? cmp - o : 0;
+    } else {
+        const std::uint64_t o = 0 - static_cast<std::uint64_t>(off);
+        deadline = cmp > ~0ull - o ? ~0ull : cmp + o;
+    }
+    t.deadline.store(deadline, std::memory_order_relaxed);
+
+    if (events_ != nullptr) {
+        events_->cancel(t.timer_event);
+        t.timer_event = 0;
+        if (deadline != remu::common::EventQueue::kNever) {
+            t.timer_event = events_->schedule(deadline, [this, hart] {
+                harts_[hart].timer_event = 0;
+                update_mtip_(hart);
+            });
+        }
     }
+
+    update_mtip_(hart);
+    changed_(hart);
 }
 
-bool Clint::write(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t val) {
-    std::lock_guard<std::mutex> lock(mu_);
+void Clint::update_mtip_(std::uint32_t hart) {
+    HartTimer& t = harts_[hart];
+    const bool level = now() >= t.deadline.load(std::memory_order_relaxed);
+    if (t.mtip.exchange(level, std::memory_order_relaxed) != level) changed_(hart);
+}
 
+bool Clint::read(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t& out) {
+    out = 0;
+
+    // CLINT is usually accessed as 32-bit words on RV32
     if (width_bytes != 4) return false;
 
-    const std::uint32_t off = off_(addr);
+    return kRegs_.read(*this, off_(addr), out);
+}
 
-    switch (off) {
-        case MSIP0_OFF:
-            msip0_ = (val & 0x1u);
-            return true;
-
-        case MTIMECMP0_OFF: {
-            // Typical safe programming pattern is write high then low (or vice versa).
-            // We'll just update the low half.
-            const std::uint64_t hi = (mtimecmp0_ & 0xFFFF'FFFF'0000'0000ull);
-            mtimecmp0_ = hi | static_cast<std::uint64_t>(val);
-            return true;
-        }
+bool Clint::write(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t val) {
+    if (width_bytes != 4) return false;
 
-        case MTIMECMP0H_OFF: {
-            const std::uint64_t lo = (mtimecmp0_ & 0x0000'0000'FFFF'FFFFull);
-            mtimecmp0_ = (static_cast<std::uint64_t>(val) << 32) | lo;
-            return true;
-        }
+    return kRegs_.write(*this, off_(addr), val);
+}
 
-        case MTIME_OFF: {
-            const std::uint64_t hi = (mtime_ & 0xFFFF'FFFF'0000'0000ull);
-            mtime_ = hi | static_cast<std::uint64_t>(val);
-            return true;
-        }
+// ---------------- Register handlers ----------------
 
-        case MTIMEH_OFF: {
-            const std::uint64_t lo = (mtime_ & 0x0000'0000'FFFF'FFFFull);
-            mtime_ = (static_cast<std::uint64_t>(val) << 32) | lo;
-            return true;
-        }
+bool Clint::msip_read_(std::uint32_t off, std::uint32_t& out) {
+    const std::uint32_t hart = (off - MSIP_BASE) / 4;
+    out = hart < num_harts_ ? harts_[hart].msip.load(std::memory_order_relaxed) : 0;
+    return true; // unmapped reads return 0 in many simple models
+}
+
+bool Clint::mtimecmp_read_(std::uint32_t off, std::uint32_t& out) {
+    const std::uint32_t hart = (off - MTIMECMP_BASE) / 8;
+    if (hart >= num_harts_) {
+        out = 0;
+        return true;
+    }
+    const std::uint64_t cmp = mtimecmp(hart);
+    out = (off & 4u) == 0 ? static_cast<std::uint32_t>(cmp & 0xFFFF'FFFFull)
+                          : static_cast<std::uint32_t>((cmp >> 32) & 0xFFFF'FFFFull);
+    return true;
+}
+
+bool Clint::mtime_read_(std::uint32_t off, std::uint32_t& out) {
+    switch (off) {
+        case MTIME_OFF:  out = static_cast<std::uint32_t>(mtime() & 0xFFFF'FFFFull); break;
+        case MTIMEH_OFF: out = static_cast<std::uint32_t>((mtime() >> 32) & 0xFFFF'FFFFull); break;
+        default:         out = 0; break;
+    }
+    return true;
+}
+
+bool Clint::msip_write_(std::uint32_t off, std::uint32_t val) {
+    // Any hart may write any hart's msip: that's how IPIs are sent
+    const std::uint32_t hart = (off - MSIP_BASE) / 4;
+    if (hart < num_harts_) {
+        harts_[hart].msip.store(val & 0x1u, std::memory_order_relaxed);
+        changed_(hart);
+    }
+    return true;
+}
+
+bool Clint::mtimecmp_write_(std::uint32_t off, std::uint32_t val) {
+    // Typical safe programming pattern is write high then low (or vice versa);
+    // each half is updated independently.
+    const std::uint32_t hart = (off - MTIMECMP_BASE) / 8;
+    if (hart >= num_harts_) return true;
+
+    auto& cmp = harts_[hart].mtimecmp;
+    const std::uint64_t old = cmp.load(std::memory_order_relaxed);
+    cmp.store((off & 4u) == 0 ? with_low(old, val) : with_high(old, val),
+              std::memory_order_relaxed);
+    update_deadline_(hart);
+    return true;
+}
 
-        default:
-            return true;
+bool Clint::mtime_write_(std::uint32_t off, std::uint32_t val) {
+    if (off == MTIME_OFF) {
+        set_mtime_(with_low(mtime(), val));
+    } else if (off == MTIMEH_OFF) {
+        set_mtime_(with_high(mtime(), val));
     }
+    return true;
 }
 
 } // namespace rvemu::devices
@@ -0,0 +1,119 @@
+#include <remu/devices/htif.hpp>
+
+#include <array>
+#include <cstdio>
+
+#include <remu/mem/bus.hpp>
+
+namespace remu::devices {
+
+namespace {
+constexpr std::uint32_t TOHOST_LO   = 0x0;
+constexpr std::uint32_t TOHOST_HI   = 0x4;
+constexpr std::uint32_t FROMHOST_LO = 0x8;
+constexpr std::uint32_t FROMHOST_HI = 0xC;
+
+constexpr std::uint64_t DEV_SYSCALL = 0;
+constexpr std::uint64_t DEV_CONSOLE = 1;
+constexpr std::uint64_t CMD_PUTCHAR = 1;
+
+constexpr std::uint64_t SYS_WRITE = 64;
+constexpr std::uint64_t ENOSYS_RET = static_cast<std::uint64_t>(-38);
+
+constexpr std::uint64_t PAYLOAD_MASK = (1ull << 48) - 1;
+} // namespace
+
+Htif::Htif(remu::mem::Bus& bus) : bus_(bus) {}
+
+bool Htif::read(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t& out) {
+    out = 0;
+    if (width_bytes != 4) return false;
+    switch (addr & (kWindowSize - 1)) {
+        case TOHOST_LO:   out = static_cast<std::uint32_t>(tohost_); break;
+        case TOHOST_HI:   out = static_cast<std::uint32_t>(tohost_ >> 32); break;
+        case FROMHOST_LO: out = static_cast<std::uint32_t>(fromhost_); break;
+        case FROMHOST_HI: out = static_cast<std::uint32_t>(fromhost_ >> 32); break;
+        default: break;
+    }
+    return true;
+}
+
+bool Htif::write(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t val) {
+    if (width_bytes != 4) return false;
+    switch (addr & (kWindowSize - 1)) {
+        case TOHOST_LO:
+            tohost_ = (tohost_ & ~0xFFFF'FFFFull) | val;
+            break;
+        case TOHOST_HI:
+            tohost_ = (tohost_ & 0xFFFF'FFFFull) | (static_cast<std::uint64_t>(val) << 32);
+            if (tohost_ != 0) command_(tohost_);
+            break;
+        case FROMHOST_LO:
+            fromhost_ = (fromhost_ & ~0xFFFF'FFFFull) | val;
+            break;
+        case FROMHOST_HI:
+            fromhost_ = (fromhost_ & 0xFFFF'FFFFull) | (static_cast<std::uint64_t>(val) << 32);
+            break;
+        case kExitOffset:
+            if ((val & 1) != 0 && exit_hook_) {
+                const std::uint32_t code = val >> 1;
+                exit_hook_(code == 0 ? GuestExit::Pass : GuestExit::Fail, code);
+            }
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+void Htif::command_(std::uint64_t cmd) {
+    const std::uint64_t device = cmd >> 56;
+    const std::uint64_t command = (cmd >> 48) & 0xFF;
+    const std::uint64_t payload = cmd & PAYLOAD_MASK;
+    tohost_ = 0;
+
+    if (device == DEV_SYSCALL && command == 0) {
+        if ((payload & 1) != 0) {
+            const auto code = static_cast<std::uint32_t>(payload >> 1);
+            if (exit_hook_) exit_hook_(code == 0 ? GuestExit::Pass : GuestExit::Fail, code);
+            return;
+        }
+        syscall_(static_cast<std::uint32_t>(payload));
+    } else if (device == DEV_CONSOLE && command == CMD_PUTCHAR) {
+        put_(static_cast<std::uint8_t>(payload & 0xFF));
+    } else {
+        return; // unknown device or command (e.g. console input): no reply
+    }
+    fromhost_ = (device << 56) | (command << 48) | 1;
+}
+
+void Htif::syscall_(std::uint32_t block) {
+    std::array<std::uint64_t, 8> args{};
+    if (!bus_.read_block(block, {reinterpret_cast<std::uint8_t*>(args.data()), sizeof(args)})) {
+        return;
+    }
+
+    std::uint64_t ret = ENOSYS_RET;
+    if (args[0] == SYS_WRITE && (args[1] == 1 || args[1] == 2)) {
+        const auto buf = static_cast<std::uint32_t>(args[2]);
+        const auto len = static_cast<std::uint32_t>(args[3]);
+        ret = 0;
+        for (std::uint32_t i = 0; i < len; ++i) {
+            std::uint8_t c = 0;
+            if (!bus_.read8(buf + i, c)) break;
+            put_(c);
+            ++ret;
+        }
+    }
+    bus_.write_block(block, {reinterpret_cast<const std::uint8_t*>(&ret), sizeof(ret)});
+}
+
+void Htif::put_(std::uint8_t c) {
+    if (tx_sink_) {
+        tx_sink_(c);
+    } else {
+        std::fputc(c, stdout);
+    }
+}
+
+} // namespace remu::devices
@@ -0,0 +1,240 @@
+#include <remu/devices/ivshmem.hpp>
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace remu::devices {
+
+namespace {
+
+using remu::common::Result;
+
+std::string errno_message(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+std::size_t host_page() {
+    static const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    return page;
+}
+
+// How long a joining peer waits for the creator to size the object
+constexpr int SIZE_WAIT_TRIES = 1000;
+constexpr useconds_t SIZE_WAIT_US = 1000;
+
+// Shared futexes (no FUTEX_PRIVATE_FLAG): the waiter may be another process
+void futex_wait(std::uint32_t* word, std::uint32_t expected) {
+    ::syscall(SYS_futex, word, FUTEX_WAIT, expected, nullptr, nullptr, 0);
+}
+
+void futex_wake(std::uint32_t* word) {
+    ::syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+} // namespace
+
+// Start of the shared object, one host page. Each peer's words get their own
+// cache line so doorbells to different peers don't contend.
+struct IvShmem::Control {
+    struct alignas(64) Peer {
+        std::uint32_t seq;     // bumped on every ring; the listener's futex
+        std::uint32_t pending; // vectors rung and not yet latched
+    };
+    Peer peers[kMaxPeers];
+};
+
+Result<std::unique_ptr<IvShmem>> IvShmem::open(const std::string& name, std::uint32_t base,
+                                               std::uint32_t size, std::uint32_t peer) {
+    using R = Result<std::unique_ptr<IvShmem>>;
+
+    if (name.empty() || name.find('/') != std::string::npos) {
+        return R::err("bad shared memory name: " + name);
+    }
+    if (size == 0 || size % host_page() != 0) {
+        return R::err("shared memory size must be a non-zero multiple of the page size");
+    }
+    if (peer >= kMaxPeers) {
+        return R::err("peer number must be below " + std::to_string(kMaxPeers));
+    }
+
+    const std::string path = "/remu-ivshmem-" + name;
+    const std::size_t ctl_len = host_page();
+    const auto total = static_cast<off_t>(ctl_len + size);
+
+    // Exactly one peer creates and sizes the object; the rest open it as it
+    // is, wait for the creator's ftruncate and must agree with its size.
+    // Truncating from a joiner could shrink it under a peer's mapping.
+    int fd = ::shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    const bool created = fd >= 0;
+    if (!created && errno == EEXIST) fd = ::shm_open(path.c_str(), O_RDWR | O_CLOEXEC, 0600);
+    if (fd < 0) return R::err(errno_message("shm_open " + path));
+
+    if (created && ::ftruncate(fd, total) != 0) {
+        auto r = R::err(errno_message("ftruncate " + path));
+        ::close(fd);
+        ::shm_unlink(path.c_str());
+        return r;
+    }
+    struct stat st{};
+    for (int tries = 0;; ++tries) {
+        if (::fstat(fd, &st) != 0) {
+            auto r = R::err(errno_message("fstat " + path));
+            ::close(fd);
+            return r;
+        }
+        if (st.st_size != 0 || tries == SIZE_WAIT_TRIES) break;
+        ::usleep(SIZE_WAIT_US);
+    }
+    if (st.st_size != total) {
+        ::close(fd);
+        return R::err(st.st_size == 0 ? path + " was never sized by its creator"
+                                      : path + " exists with a different size");
+    }
+
+    void* ctl = ::mmap(nullptr, ctl_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ctl == MAP_FAILED) {
+        auto r = R::err(errno_message("mmap " + path));
+        ::close(fd);
+        return r;
+    }
+    void* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                        static_cast<off_t>(ctl_len));
+    if (data == MAP_FAILED) {
+        auto r = R::err(errno_message("mmap " + path));
+        ::munmap(ctl, ctl_len);
+        ::close(fd);
+        return r;
+    }
+    ::close(fd); // the mappings keep the object alive
+
+    auto shm = std::make_unique<remu::mem::Memory>(base, size, static_cast<std::uint8_t*>(data));
+    return R::ok(std::unique_ptr<IvShmem>(
+        new IvShmem(static_cast<Control*>(ctl), std::move(shm), peer)));
+}
+
+IvShmem::IvShmem(Control* control, std::unique_ptr<remu::mem::Memory> shm, std::uint32_t peer)
+    : control_(control), shm_(std::move(shm)), peer_(peer) {
+    listener_ = std::thread(&IvShmem::listen_, this);
+}
+
+IvShmem::~IvShmem() {
+    stop_.store(true, std::memory_order_relaxed);
+    std::uint32_t& seq = control_->peers[peer_].seq;
+    std::atomic_ref<std::uint32_t>(seq).fetch_add(1, std::memory_order_release);
+    futex_wake(&seq);
+    listener_.join();
+    ::munmap(control_, host_page());
+}
+
+void IvShmem::set_irq_line(std::function<void(bool)> line) {
+    {
+        std::lock_guard<std::mutex> lock(irq_mu_);
+        irq_line_ = std::move(line);
+    }
+    update_irq_();
+}
+
+void IvShmem::ring(std::uint32_t peer, std::uint32_t vector) {
+    if (peer >= kMaxPeers || vector >= kVectors) return;
+    Control::Peer& p = control_->peers[peer];
+    // Release: the guest's stores to the window before the doorbell are
+    // visible to the peer once it sees the vector
+    std::atomic_ref<std::uint32_t>(p.pending).fetch_or(1u << vector, std::memory_order_release);
+    std::atomic_ref<std::uint32_t>(p.seq).fetch_add(1, std::memory_order_release);
+    futex_wake(&p.seq);
+}
+
+void IvShmem::listen_() {
+    Control::Peer& p = control_->peers[peer_];
+    const std::atomic_ref<std::uint32_t> seq(p.seq);
+    const std::atomic_ref<std::uint32_t> pending(p.pending);
+
+    while (true) {
+        // Sample seq first: a ring after this point changes it, so the
+        // wait below returns at once instead of missing the wake-up
+        const std::uint32_t seen = seq.load(std::memory_order_acquire);
+        if (stop_.load(std::memory_order_relaxed)) return;
+        if (const std::uint32_t vectors = pending.exchange(0, std::memory_order_acq_rel);
+            vectors != 0) {
+            latch_(vectors);
+        }
+        futex_wait(&p.seq, seen);
+    }
+}
+
+void IvShmem::latch_(std::uint32_t vectors) {
+    status_.fetch_or(vectors, std::memory_order_relaxed);
+    update_irq_();
+}
+
+void IvShmem::update_irq_() {
+    std::lock_guard<std::mutex> lock(irq_mu_);
+    const bool level = (status_.load(std::memory_order_relaxed) &
+                        mask_.load(std::memory_order_relaxed)) != 0;
+    if (irq_line_) irq_line_(level);
+}
+
+// ---------------- MMIO ----------------
+
+bool IvShmem::read(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t& out) {
+    out = 0;
+    if (width_bytes != 4) return false;
+    return kRegs_.read(*this, addr & (kWindowSize - 1), out);
+}
+
+bool IvShmem::write(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t val) {
+    if (width_bytes != 4) return false;
+    return kRegs_.write(*this, addr & (kWindowSize - 1), val);
+}
+
+bool IvShmem::mask_read_(std::uint32_t, std::uint32_t& out) {
+    out = mask_.load(std::memory_order_relaxed);
+    return true;
+}
+
+bool IvShmem::status_read_(std::uint32_t, std::uint32_t& out) {
+    out = status_.load(std::memory_order_relaxed);
+    return true;
+}
+
+bool IvShmem::position_read_(std::uint32_t, std::uint32_t& out) {
+    out = peer_;
+    return true;
+}
+
+bool IvShmem::size_read_(std::uint32_t, std::uint32_t& out) {
+    out = shm_->size();
+    return true;
+}
+
+bool IvShmem::peers_read_(std::uint32_t, std::uint32_t& out) {
+    out = kMaxPeers;
+    return true;
+}
+
+bool IvShmem::mask_write_(std::uint32_t, std::uint32_t val) {
+    mask_.store(val, std::memory_order_relaxed);
+    update_irq_();
+    return true;
+}
+
+bool IvShmem::status_write_(std::uint32_t, std::uint32_t val) {
+    status_.fetch_and(~val, std::memory_order_relaxed);
+    update_irq_();
+    return true;
+}
+
+bool IvShmem::doorbell_write_(std::uint32_t, std::uint32_t val) {
+    ring(val >> 16, val & 0xFFFFu);
+    return true;
+}
+
+} // namespace remu::devices
@@ -1,5 +1,7 @@
 #include <remu/devices/plic.hpp>
 
+#include <bit>
+
 namespace remu::devices {
 
 namespace {
@@ -11,173 +13,228 @@ constexpr std::uint32_t PRIORITY_BASE = 0x0000;
 // Pending: 0x1000 + 4*word
 constexpr std::uint32_t PENDING_BASE  = 0x1000;
 
-// Enable (hart0): 0x2000 + 4*word
+// Enable: 0x2000 + 0x80*context + 4*word
 constexpr std::uint32_t ENABLE_BASE   = 0x2000;
+constexpr std::uint32_t ENABLE_STRIDE = 0x80;
 
-// Context for hart0 M-mode (virt commonly uses context 1 for M-mode hart0)
 // Threshold: 0x200000 + 0x1000*context + 0x0
 // Claim/Complete: 0x200000 + 0x1000*context + 0x4
 constexpr std::uint32_t CONTEXT_BASE  = 0x200000;
 constexpr std::uint32_t CONTEXT_STRIDE= 0x1000;
-// This machine has a single hart with only M-mode (no S-mode), so the PLIC
-// only exposes one context: context 0 = hart0 M-mode external interrupts.
-constexpr std::uint32_t CTX_M_HART0   = 0;
 
 constexpr std::uint32_t THRESHOLD_OFF = 0x0;
 constexpr std::uint32_t CLAIM_OFF     = 0x4;
 
+// Registers are 32-bit views of the 64-bit bitset words
+constexpr std::uint32_t REG_WORDS = (Plic::kMaxIrq + 1) / 32;
+
 inline bool valid_irq(std::uint32_t id) {
     return id >= 1 && id <= Plic::kMaxIrq;
 }
 } // namespace
 
-Plic::Plic() {
+Plic::Plic(std::uint32_t num_contexts)
+    : num_contexts_(num_contexts),
+      contexts_(std::make_unique<Context[]>(num_contexts)) {
     // Default: all priorities 0, disabled, no pending.
-    priority_.fill(0);
-    pending_ = 0;
-    enable0_ = 0;
-    threshold0_ = 0;
 }
 
 void Plic::raise_irq(std::uint32_t irq_id) {
     if (!valid_irq(irq_id)) return;
-    std::lock_guard<std::mutex> lock(mu_);
-    pending_ |= (1ull << irq_id);
+    const std::uint32_t w = word_(irq_id);
+    level_[w].fetch_or(bit_(irq_id), std::memory_order_relaxed);
+    pending_[w].fetch_or(bit_(irq_id), std::memory_order_release);
+    hook_();
 }
 
 void Plic::clear_irq(std::uint32_t irq_id) {
     if (!valid_irq(irq_id)) return;
-    std::lock_guard<std::mutex> lock(mu_);
-    pending_ &= ~(1ull << irq_id);
+    const std::uint32_t w = word_(irq_id);
+    level_[w].fetch_and(~bit_(irq_id), std::memory_order_relaxed);
+    pending_[w].fetch_and(~bit_(irq_id), std::memory_order_release);
+    hook_();
 }
 
-bool Plic::has_pending_for_hart0() const {
-    std::lock_guard<std::mutex> lock(mu_);
-    return pick_best_irq_() != 0;
+std::uint32_t Plic::pick_best_irq_(std::uint32_t ctx) const {
+    if (ctx >= num_contexts_) return 0;
+    const Context& c = contexts_[ctx];
+
+    // Claimable sources for this context; usually all zero, which is the
+    // whole cost of the check
+    std::array<std::uint64_t, kWords> cand{};
+    std::uint64_t any = 0;
+    for (std::uint32_t w = 0; w < kWords; ++w) {
+        cand[w] = pending_[w].load(std::memory_order_acquire) &
+                  ~claimed_[w].load(std::memory_order_relaxed) &
+                  c.enable[w].load(std::memory_order_relaxed);
+        any |= cand[w];
+    }
+    if (any == 0) return 0;
+
+    // Highest priority above the threshold wins; ties go to the lowest ID
+    const std::uint32_t threshold = c.threshold.load(std::memory_order_relaxed);
+    for (std::uint32_t pri = kMaxPriority; pri > threshold; --pri) {
+        for (std::uint32_t w = 0; w < kWords; ++w) {
+            const std::uint64_t bits =
+                cand[w] & by_priority_[pri][w].load(std::memory_order_relaxed);
+            if (bits != 0) {
+                return w * 64 + static_cast<std::uint32_t>(std::countr_zero(bits));
+            }
+        }
+    }
+    return 0;
 }
 
-std::uint32_t Plic::pick_best_irq_() const {
-    // Choose enabled & pending IRQ with priority > threshold.
-    // If tie, choose lowest ID (simple deterministic).
-    std::uint64_t cand = pending_ & enable0_;
+void Plic::set_priority_(std::uint32_t id, std::uint32_t pri) {
+    const std::uint32_t w = word_(id);
+    by_priority_[priority_[id]][w].fetch_and(~bit_(id), std::memory_order_relaxed);
+    priority_[id] = pri;
+    if (pri != 0) by_priority_[pri][w].fetch_or(bit_(id), std::memory_order_relaxed);
+}
 
-    std::uint32_t best_id = 0;
-    std::uint32_t best_pri = 0;
+bool Plic::read(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t& out) {
+    out = 0;
+    if (width_bytes != 4) return false;
 
-    for (std::uint32_t id = 1; id <= kMaxIrq; ++id) {
-        if ((cand & (1ull << id)) == 0) continue;
+    bool ok = false;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        ok = kRegs_.read(*this, off_(addr), out);
+    }
+    hook_(); // a claim read clears pending
+    return ok;
+}
 
-        const std::uint32_t pri = priority_[id];
-        if (pri <= threshold0_) continue;
+bool Plic::write(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t val) {
+    if (width_bytes != 4) return false;
 
-        if (pri > best_pri) {
-            best_pri = pri;
-            best_id = id;
-        } else if (pri == best_pri && best_id != 0 && id < best_id) {
-            best_id = id;
-        } else if (pri == best_pri && best_id == 0) {
-            best_id = id;
-        }
+    bool ok = false;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        ok = kRegs_.write(*this, off_(addr), val);
     }
-
-    return best_id; // 0 if none
+    hook_();
+    return ok;
 }
 
-bool Plic::read(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t& out) {
-    if (width_bytes != 4) return false;
+// ---------------- Register handlers (called with mu_ held) ----------------
 
-    std::lock_guard<std::mutex> lock(mu_);
-    out = 0;
+namespace {
+// 32-bit register `reg` of a 64-bit-word bitset
+template <class Bits>
+std::uint32_t bitset_reg(const Bits& bits, std::uint32_t reg) {
+    const std::uint64_t word = bits[reg / 2].load(std::memory_order_relaxed);
+    return static_cast<std::uint32_t>(word >> (32 * (reg % 2)));
+}
+} // namespace
 
-    const std::uint32_t off = off_(addr);
+bool Plic::sources_read_(std::uint32_t off, std::uint32_t& out) {
+    out = 0;
 
     // 1) Priority
     if (off >= PRIORITY_BASE && off < PRIORITY_BASE + 4 * (kMaxIrq + 1)) {
         const std::uint32_t id = (off - PRIORITY_BASE) / 4;
-        if (id <= kMaxIrq) out = priority_[id];
+        out = priority_[id];
         return true;
     }
 
     // 2) Pending (read-only)
-    if (off >= PENDING_BASE && off < PENDING_BASE + 8) {
-        const std::uint32_t word = (off - PENDING_BASE) / 4; // word 0 or 1 (we only need 64 bits)
-        const std::uint32_t lo = static_cast<std::uint32_t>(pending_ & 0xFFFF'FFFFull);
-        const std::uint32_t hi = static_cast<std::uint32_t>((pending_ >> 32) & 0xFFFF'FFFFull);
-        out = (word == 0) ? lo : hi;
+    if (off >= PENDING_BASE && off < PENDING_BASE + 4 * REG_WORDS) {
+        out = bitset_reg(pending_, (off - PENDING_BASE) / 4);
         return true;
     }
 
-    // 3) Enable (hart0)
-    if (off >= ENABLE_BASE && off < ENABLE_BASE + 8) {
-        const std::uint32_t word = (off - ENABLE_BASE) / 4;
-        const std::uint32_t lo = static_cast<std::uint32_t>(enable0_ & 0xFFFF'FFFFull);
-        const std::uint32_t hi = static_cast<std::uint32_t>((enable0_ >> 32) & 0xFFFF'FFFFull);
-        out = (word == 0) ? lo : hi;
-        return true;
-    }
-
-    // 4) Threshold / Claim for hart0 M-mode context
-    const std::uint32_t ctx_base = CONTEXT_BASE + CTX_M_HART0 * CONTEXT_STRIDE;
-    if (off == ctx_base + THRESHOLD_OFF) {
-        out = threshold0_;
-        return true;
-    }
-    if (off == ctx_base + CLAIM_OFF) {
-        const std::uint32_t id = pick_best_irq_();
-        if (id != 0) {
-            // Claim clears pending (typical PLIC behavior)
-            pending_ &= ~(1ull << id);
+    // 3) Enable, per context
+    if (off >= ENABLE_BASE && off < CONTEXT_BASE) {
+        const std::uint32_t ctx = (off - ENABLE_BASE) / ENABLE_STRIDE;
+        const std::uint32_t reg = (off - ENABLE_BASE) % ENABLE_STRIDE / 4;
+        if (ctx < num_contexts_ && reg < REG_WORDS) {
+            out = bitset_reg(contexts_[ctx].enable, reg);
         }
-        out = id;
         return true;
     }
 
     // Unhandled reads return 0
-    out = 0;
     return true;
 }
 
-bool Plic::write(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t val) {
-    if (width_bytes != 4) return false;
-
-    std::lock_guard<std::mutex> lock(mu_);
-    const std::uint32_t off = off_(addr);
+bool Plic::context_read_(std::uint32_t off, std::uint32_t& out) {
+    out = 0;
+    const std::uint32_t ctx = (off - CONTEXT_BASE) / CONTEXT_STRIDE;
+    if (ctx >= num_contexts_) return true;
+
+    switch ((off - CONTEXT_BASE) % CONTEXT_STRIDE) {
+        case THRESHOLD_OFF:
+            out = contexts_[ctx].threshold.load(std::memory_order_relaxed);
+            break;
+        case CLAIM_OFF: {
+            const std::uint32_t id = pick_best_irq_(ctx);
+            if (id != 0) {
+                // Claim clears pending and holds the source until complete
+                pending_[word_(id)].fetch_and(~bit_(id), std::memory_order_relaxed);
+                claimed_[word_(id)].fetch_or(bit_(id), std::memory_order_relaxed);
+            }
+            out = id;
+            break;
+        }
+        default:
+            break;
+    }
+    return true;
+}
 
+bool Plic::sources_write_(std::uint32_t off, std::uint32_t val) {
     // 1) Priority
     if (off >= PRIORITY_BASE && off < PRIORITY_BASE + 4 * (kMaxIrq + 1)) {
         const std::uint32_t id = (off - PRIORITY_BASE) / 4;
-        if (id == 0 || id > kMaxIrq) return true;
-        priority_[id] = val & 0x7; // keep it small; real PLIC supports more
+        if (id == 0) return true;
+        set_priority_(id, val & kMaxPriority);
         return true;
     }
 
-    // 2) Enable (hart0)
-    if (off >= ENABLE_BASE && off < ENABLE_BASE + 8) {
-        const std::uint32_t word = (off - ENABLE_BASE) / 4;
-        if (word == 0) {
-            enable0_ = (enable0_ & 0xFFFF'FFFF'0000'0000ull) | static_cast<std::uint64_t>(val);
-        } else {
-            enable0_ = (enable0_ & 0x0000'0000'FFFF'FFFFull) | (static_cast<std::uint64_t>(val) << 32);
-        }
-        // Never enable IRQ0
-        enable0_ &= ~1ull;
+    // 2) Enable, per context
+    if (off >= ENABLE_BASE && off < CONTEXT_BASE) {
+        const std::uint32_t ctx = (off - ENABLE_BASE) / ENABLE_STRIDE;
+        const std::uint32_t reg = (off - ENABLE_BASE) % ENABLE_STRIDE / 4;
+        if (ctx >= num_contexts_ || reg >= REG_WORDS) return true;
+
+        auto& word = contexts_[ctx].enable[reg / 2];
+        const unsigned shift = 32 * (reg % 2);
+        std::uint64_t v = word.load(std::memory_order_relaxed);
+        v = (v & ~(0xFFFF'FFFFull << shift)) | (static_cast<std::uint64_t>(val) << shift);
+        if (reg == 0) v &= ~1ull; // never enable IRQ0
+        word.store(v, std::memory_order_relaxed);
         return true;
     }
 
-    // 3) Threshold / Complete for hart0 M-mode context
-    const std::uint32_t ctx_base = CONTEXT_BASE + CTX_M_HART0 * CONTEXT_STRIDE;
-    if (off == ctx_base + THRESHOLD_OFF) {
-        threshold0_ = val & 0x7;
-        return true;
-    }
-    if (off == ctx_base + CLAIM_OFF) {
-        // Complete: writing the claimed ID indicates end of interrupt service.
-        // In minimal model, nothing required.
-        (void)val;
-        return true;
-    }
+    // Ignore other writes (pending is read-only)
+    return true;
+}
 
-    // Ignore other writes
+bool Plic::context_write_(std::uint32_t off, std::uint32_t val) {
+    const std::uint32_t ctx = (off - CONTEXT_BASE) / CONTEXT_STRIDE;
+    if (ctx >= num_contexts_) return true;
+
+    switch ((off - CONTEXT_BASE) % CONTEXT_STRIDE) {
+        case THRESHOLD_OFF:
+            contexts_[ctx].threshold.store(val & kMaxPriority, std::memory_order_relaxed);
+            break;
+        case CLAIM_OFF: {
+            // Complete: ignored unless the ID is claimed and enabled for
+            // this context. A line that is still high pends again.
+            if (!valid_irq(val)) break;
+            const std::uint32_t w = word_(val);
+            const std::uint64_t b = bit_(val);
+            if (!(contexts_[ctx].enable[w].load(std::memory_order_relaxed) & b)) break;
+            if (!(claimed_[w].fetch_and(~b, std::memory_order_relaxed) & b)) break;
+            if (level_[w].load(std::memory_order_acquire) & b) {
+                pending_[w].fetch_or(b, std::memory_order_release);
+            }
+            break;
+        }
+        default:
+            break;
+    }
     return true;
 }
 
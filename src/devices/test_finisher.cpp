@@ -0,0 +1,24 @@
+#include <remu/devices/test_finisher.hpp>
+
+namespace remu::devices {
+
+bool TestFinisher::read(std::uint32_t /*addr*/, std::uint32_t width_bytes, std::uint32_t& out) {
+    out = 0;
+    return width_bytes == 4;
+}
+
+bool TestFinisher::write(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t val) {
+    if (width_bytes != 4) return false;
+    if ((addr & (kWindowSize - 1)) != 0 || !exit_hook_) return true;
+
+    const std::uint32_t code = val >> 16;
+    switch (val & 0xFFFFu) {
+        case kPass:  exit_hook_(GuestExit::Pass, code);  break;
+        case kFail:  exit_hook_(GuestExit::Fail, code);  break;
+        case kReset: exit_hook_(GuestExit::Reset, code); break;
+        default: break;
+    }
+    return true;
+}
+
+} // namespace remu::devices
@@ -6,55 +6,121 @@
 namespace remu::devices {
 
 namespace {
-// Standard 16550 offsets (byte registers)
-constexpr std::uint8_t REG_RBR_THR_DLL = 0x00;
-constexpr std::uint8_t REG_IER_DLM     = 0x01;
-constexpr std::uint8_t REG_IIR_FCR     = 0x02;
-constexpr std::uint8_t REG_LCR         = 0x03;
-constexpr std::uint8_t REG_MCR         = 0x04;
-constexpr std::uint8_t REG_LSR         = 0x05;
-constexpr std::uint8_t REG_MSR         = 0x06;
-constexpr std::uint8_t REG_SCR         = 0x07;
-
 // LSR bits
 constexpr std::uint8_t LSR_DR   = 1u << 0; // data ready
+constexpr std::uint8_t LSR_OE   = 1u << 1; // overrun error
 constexpr std::uint8_t LSR_THRE = 1u << 5; // transmit holding register empty
 constexpr std::uint8_t LSR_TEMT = 1u << 6; // transmitter empty
+
+// IER bits
+constexpr std::uint8_t IER_ERBFI = 1u << 0; // received data available (and timeout)
+constexpr std::uint8_t IER_ETBEI = 1u << 1; // THR empty
+constexpr std::uint8_t IER_ELSI  = 1u << 2; // receiver line status
+
+// IIR interrupt IDs (bits 3:0), highest priority first
+constexpr std::uint8_t IIR_RLS     = 0x06;
+constexpr std::uint8_t IIR_RDA     = 0x04;
+constexpr std::uint8_t IIR_TIMEOUT = 0x0C;
+constexpr std::uint8_t IIR_THRE    = 0x02;
+constexpr std::uint8_t IIR_NONE    = 0x01;
+constexpr std::uint8_t IIR_FIFOS_ENABLED = 0xC0;
+
+// FCR bits
+constexpr std::uint8_t FCR_ENABLE   = 1u << 0;
+constexpr std::uint8_t FCR_CLEAR_RX = 1u << 1;
+constexpr std::uint8_t FCR_TRIGGER_SHIFT = 6;
+
+// RX trigger levels selected by FCR[7:6]
+constexpr std::size_t TRIGGER_16[4] = {1, 4, 8, 14};
+constexpr std::size_t TRIGGER_64[4] = {1, 16, 32, 56};
 } // namespace
 
-UartNs16550::UartNs16550() {
+UartNs16550::UartNs16550(std::size_t fifo_depth)
+    : fifo_depth_(fifo_depth == kMaxFifoDepth ? kMaxFifoDepth : kDefaultFifoDepth) {
     // By default, transmitter is empty.
     lsr_ = static_cast<std::uint8_t>(LSR_THRE | LSR_TEMT);
-    iir_ = 0x01; // no interrupt pending
+}
+
+std::size_t UartNs16550::rx_trigger_() const {
+    if (!fifo_enabled_()) return 1;
+    const auto& levels = fifo_depth_ == kMaxFifoDepth ? TRIGGER_64 : TRIGGER_16;
+    return levels[fcr_ >> FCR_TRIGGER_SHIFT];
+}
+
+void UartNs16550::reset_rx_fifo_() {
+    rx_head_ = 0;
+    rx_count_ = 0;
 }
 
 void UartNs16550::write_tx_(std::uint8_t ch) {
-    // Minimal: print to host stdout immediately.
-    std::putchar(static_cast<int>(ch));
-    std::fflush(stdout);
+    if (tx_sink_) {
+        tx_sink_(ch);
+    } else {
+        std::putchar(static_cast<int>(ch));
+        std::fflush(stdout);
+    }
 
-    // Keep THRE/TEMT set (we model TX as always-ready).
+    // Transmission is instantaneous: THR is empty again right away.
     lsr_ |= static_cast<std::uint8_t>(LSR_THRE | LSR_TEMT);
+    thre_pending_ = true;
+}
+
+std::size_t UartNs16550::push_rx(const std::uint8_t* data, std::size_t len) {
+    const std::size_t n = rx_ring_.push(data, len);
+    if (n != 0) {
+        rx_ready_.store(true, std::memory_order_release);
+        if (rx_doorbell_) rx_doorbell_();
+    }
+    return n;
 }
 
-void UartNs16550::inject_rx_byte(std::uint8_t byte) {
+void UartNs16550::poll_rx_slow_() {
     std::lock_guard<std::mutex> lock(mu_);
-    rbr_ = byte;
-    lsr_ |= LSR_DR;
+    // An RMW, so the clear can't pass the ring reads below: push_rx() stores
+    // the bytes and then the flag, and a plain store here could lose both
+    rx_ready_.exchange(false, std::memory_order_acq_rel);
+    refill_rx_fifo_locked_();
     update_irq_locked_();
 }
 
-void UartNs16550::update_irq_locked_() {
-    // "Received Data Available" interrupt: enabled via IER bit0, active
-    // while DR is set. This is the only RX interrupt source we model.
-    constexpr std::uint8_t IER_RDA = 1u << 0;
-    const bool rda_pending = (ier_ & IER_RDA) && (lsr_ & LSR_DR);
+void UartNs16550::refill_rx_fifo_locked_() {
+    // Fill the FIFO from the host ring, up to its current capacity
+    const std::size_t cap = rx_capacity_();
+    while (rx_count_ < cap) {
+        std::uint8_t b = 0;
+        if (rx_ring_.pop(&b, 1) == 0) break;
+        rx_fifo_[(rx_head_ + rx_count_) % kMaxFifoDepth] = b;
+        ++rx_count_;
+    }
+}
 
-    iir_ = rda_pending ? static_cast<std::uint8_t>(0x04) // ID=RDA, pending
-                       : static_cast<std::uint8_t>(0x01); // no interrupt pending
+void UartNs16550::inject_rx(const std::uint8_t* data, std::size_t len) {
+    std::lock_guard<std::mutex> lock(mu_);
+    const std::size_t cap = rx_capacity_();
+    for (std::size_t i = 0; i < len; ++i) {
+        if (rx_count_ == cap) {
+            lsr_ |= LSR_OE;
+            break;
+        }
+        rx_fifo_[(rx_head_ + rx_count_) % kMaxFifoDepth] = data[i];
+        ++rx_count_;
+    }
+    update_irq_locked_();
+}
 
-    if (rda_pending != irq_asserted_) {
-        irq_asserted_ = rda_pending;
+std::uint8_t UartNs16550::irq_id_() const {
+    if ((ier_ & IER_ELSI) && (lsr_ & LSR_OE)) return IIR_RLS;
+    if ((ier_ & IER_ERBFI) && rx_count_ != 0) {
+        return rx_count_ >= rx_trigger_() ? IIR_RDA : IIR_TIMEOUT;
+    }
+    if ((ier_ & IER_ETBEI) && thre_pending_) return IIR_THRE;
+    return IIR_NONE;
+}
+
+void UartNs16550::update_irq_locked_() {
+    const bool pending = irq_id_() != IIR_NONE;
+    if (pending != irq_asserted_) {
+        irq_asserted_ = pending;
         if (set_irq_) set_irq_(irq_asserted_);
     }
 }
@@ -63,13 +129,15 @@ bool UartNs16550::read(std::uint32_t addr, std::uint32_t width_bytes, std::uint3
     std::lock_guard<std::mutex> lock(mu_);
 
     out = 0;
-    if (width_bytes != 1 && width_bytes != 2 && width_bytes != 4) return false;
+    // Byte accesses (what the 8250 driver issues) are a single table dispatch.
+    if (width_bytes == 1) return kRegs_.read(*this, reg_off_(addr), out);
+    if (width_bytes != 2 && width_bytes != 4) return false;
 
-    // Little-endian assembly from successive byte reads
+    // Little-endian assembly from successive byte registers
     for (std::uint32_t i = 0; i < width_bytes; ++i) {
-        std::uint8_t b = 0;
-        if (!read8_(addr + i, b)) return false;
-        out |= (static_cast<std::uint32_t>(b) << (8u * i));
+        std::uint32_t b = 0;
+        if (!kRegs_.read(*this, reg_off_(addr + i), b)) return false;
+        out |= ((b & 0xFFu) << (8u * i));
     }
     return true;
 }
@@ -77,123 +145,140 @@ bool UartNs16550::read(std::uint32_t addr, std::uint32_t width_bytes, std::uint3
 bool UartNs16550::write(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t val) {
     std::lock_guard<std::mutex> lock(mu_);
 
-    if (width_bytes != 1 && width_bytes != 2 && width_bytes != 4) return false;
+    if (width_bytes == 1) return kRegs_.write(*this, reg_off_(addr), val & 0xFFu);
+    if (width_bytes != 2 && width_bytes != 4) return false;
 
-    // Little-endian disassembly into successive byte writes
+    // Little-endian disassembly into successive byte registers
     for (std::uint32_t i = 0; i < width_bytes; ++i) {
-        const std::uint8_t b = static_cast<std::uint8_t>((val >> (8u * i)) & 0xFFu);
-        if (!write8_(addr + i, b)) return false;
+        const std::uint32_t b = (val >> (8u * i)) & 0xFFu;
+        if (!kRegs_.write(*this, reg_off_(addr + i), b)) return false;
     }
     return true;
 }
 
-bool UartNs16550::read8_(std::uint32_t addr, std::uint8_t& out) {
-    const std::uint8_t off = reg_off_(addr) & 0x07u; // we only implement 0..7
-
-    switch (off) {
-        case REG_RBR_THR_DLL:
-            if (dlab_()) {
-                out = dll_;
-            } else {
-                out = rbr_;
-                // reading RBR clears DR
-                lsr_ = static_cast<std::uint8_t>(lsr_ & ~LSR_DR);
-                update_irq_locked_();
-            }
-            return true;
-
-        case REG_IER_DLM:
-            out = dlab_() ? dlm_ : ier_;
-            return true;
-
-        case REG_IIR_FCR:
-            // read = IIR. (Write is FCR)
-            out = iir_;
-            return true;
-
-        case REG_LCR:
-            out = lcr_;
-            return true;
-
-        case REG_MCR:
-            out = mcr_;
-            return true;
-
-        case REG_LSR:
-            // Keep THRE/TEMT set (always ready to transmit in this minimal model)
-            lsr_ |= static_cast<std::uint8_t>(LSR_THRE | LSR_TEMT);
-            out = lsr_;
-            return true;
-
-        case REG_MSR:
-            out = msr_;
-            return true;
-
-        case REG_SCR:
-            out = scr_;
-            return true;
-
-        default:
-            out = 0;
-            return true;
+// ---------------- Register handlers (called with mu_ held) ----------------
+
+bool UartNs16550::rbr_read_(std::uint32_t, std::uint32_t& out) {
+    if (dlab_()) {
+        out = dll_;
+    } else if (rx_count_ != 0) {
+        out = rx_fifo_[rx_head_];
+        rx_head_ = (rx_head_ + 1) % kMaxFifoDepth;
+        --rx_count_;
+        refill_rx_fifo_locked_();
+        update_irq_locked_();
+    } else {
+        out = 0;
     }
+    return true;
+}
+
+bool UartNs16550::ier_read_(std::uint32_t, std::uint32_t& out) {
+    out = dlab_() ? dlm_ : ier_;
+    return true;
 }
 
-bool UartNs16550::write8_(std::uint32_t addr, std::uint8_t val) {
-    const std::uint8_t off = reg_off_(addr) & 0x07u;
-
-    switch (off) {
-        case REG_RBR_THR_DLL:
-            if (dlab_()) {
-                dll_ = val;
-            } else {
-                thr_ = val;
-                write_tx_(val);
-            }
-            return true;
-
-        case REG_IER_DLM:
-            if (dlab_()) {
-                dlm_ = val;
-            } else {
-                ier_ = val;
-                update_irq_locked_();
-            }
-            return true;
-
-        case REG_IIR_FCR:
-            // write = FCR
-            fcr_ = val;
-            // If FIFOs are "cleared", clear DR bit (minimal behavior)
-            if (val & 0x02u) { // clear RX FIFO
-                lsr_ = static_cast<std::uint8_t>(lsr_ & ~LSR_DR);
-                update_irq_locked_();
-            }
-            return true;
-
-        case REG_LCR:
-            lcr_ = val;
-            return true;
-
-        case REG_MCR:
-            mcr_ = val;
-            return true;
-
-        case REG_LSR:
-            // LSR is read-only in real hardware; ignore writes.
-            return true;
-
-        case REG_MSR:
-            // MSR is mostly read-only; ignore.
-            return true;
-
-        case REG_SCR:
-            scr_ = val;
-            return true;
-
-        default:
-            return true;
+bool UartNs16550::iir_read_(std::uint32_t, std::uint32_t& out) {
+    // read = IIR. (Write is FCR)
+    const std::uint8_t id = irq_id_();
+    out = id;
+    if (fifo_enabled_()) out |= IIR_FIFOS_ENABLED;
+
+    // Reporting THRE is what acknowledges it
+    if (id == IIR_THRE) {
+        thre_pending_ = false;
+        update_irq_locked_();
     }
+    return true;
+}
+
+bool UartNs16550::lcr_read_(std::uint32_t, std::uint32_t& out) {
+    out = lcr_;
+    return true;
+}
+
+bool UartNs16550::mcr_read_(std::uint32_t, std::uint32_t& out) {
+    out = mcr_;
+    return true;
+}
+
+bool UartNs16550::lsr_read_(std::uint32_t, std::uint32_t& out) {
+    // THRE/TEMT stay set (the transmitter never backs up); DR reflects
+    // the RX FIFO
+    out = lsr_ | LSR_THRE | LSR_TEMT;
+    if (rx_count_ != 0) out |= LSR_DR;
+
+    // Error bits clear on read
+    if (lsr_ & LSR_OE) {
+        lsr_ = static_cast<std::uint8_t>(lsr_ & ~LSR_OE);
+        update_irq_locked_();
+    }
+    return true;
+}
+
+bool UartNs16550::msr_read_(std::uint32_t, std::uint32_t& out) {
+    out = msr_;
+    return true;
+}
+
+bool UartNs16550::scr_read_(std::uint32_t, std::uint32_t& out) {
+    out = scr_;
+    return true;
+}
+
+bool UartNs16550::thr_write_(std::uint32_t, std::uint32_t val) {
+    const auto b = static_cast<std::uint8_t>(val);
+    if (dlab_()) {
+        dll_ = b;
+    } else {
+        thr_ = b;
+        write_tx_(b);
+        update_irq_locked_();
+    }
+    return true;
+}
+
+bool UartNs16550::ier_write_(std::uint32_t, std::uint32_t val) {
+    const auto b = static_cast<std::uint8_t>(val);
+    if (dlab_()) {
+        dlm_ = b;
+    } else {
+        // Enabling ETBEI while THR is empty raises THRE at once (the
+        // guest's 8250 driver probes for exactly this)
+        if ((b & IER_ETBEI) && !(ier_ & IER_ETBEI)) thre_pending_ = true;
+        ier_ = static_cast<std::uint8_t>(b & 0x0Fu);
+        update_irq_locked_();
+    }
+    return true;
+}
+
+bool UartNs16550::fcr_write_(std::uint32_t, std::uint32_t val) {
+    const auto b = static_cast<std::uint8_t>(val);
+
+    // Switching FIFO mode on or off empties the FIFOs, as does FCR[1].
+    // (TX has nothing to clear: it never holds data.)
+    if (((b ^ fcr_) & FCR_ENABLE) || (b & FCR_CLEAR_RX)) reset_rx_fifo_();
+
+    // Keep only the persistent bits: enable and trigger level
+    fcr_ = static_cast<std::uint8_t>(b & (FCR_ENABLE | (3u << FCR_TRIGGER_SHIFT)));
+    refill_rx_fifo_locked_(); // host input waiting behind a smaller FIFO
+    update_irq_locked_();
+    return true;
+}
+
+bool UartNs16550::lcr_write_(std::uint32_t, std::uint32_t val) {
+    lcr_ = static_cast<std::uint8_t>(val);
+    return true;
+}
+
+bool UartNs16550::mcr_write_(std::uint32_t, std::uint32_t val) {
+    mcr_ = static_cast<std::uint8_t>(val);
+    return true;
+}
+
+bool UartNs16550::scr_write_(std::uint32_t, std::uint32_t val) {
+    scr_ = static_cast<std::uint8_t>(val);
+    return true;
 }
 
 } // namespace rvemu::devices
@@ -0,0 +1,77 @@
+#include <remu/devices/virtio/iov.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace remu::devices {
+
+void iov_slice(std::span<const iovec> src, std::size_t skip, std::size_t len,
+               std::vector<iovec>& out) {
+    out.clear();
+    for (const iovec& v : src) {
+        if (len == 0) break;
+        if (skip >= v.iov_len) {
+            skip -= v.iov_len;
+            continue;
+        }
+        const std::size_t n = std::min(v.iov_len - skip, len);
+        out.push_back(iovec{static_cast<std::uint8_t*>(v.iov_base) + skip, n});
+        skip = 0;
+        len -= n;
+    }
+}
+
+std::size_t iov_to_buf(std::span<const iovec> src, void* dst, std::size_t len) {
+    auto* d = static_cast<std::uint8_t*>(dst);
+    std::size_t done = 0;
+    for (const iovec& v : src) {
+        if (done == len) break;
+        const std::size_t n = std::min(v.iov_len, len - done);
+        std::memcpy(d + done, v.iov_base, n);
+        done += n;
+    }
+    return done;
+}
+
+std::size_t iov_from_buf(std::span<const iovec> dst, const void* src, std::size_t len) {
+    const auto* s = static_cast<const std::uint8_t*>(src);
+    std::size_t done = 0;
+    for (const iovec& v : dst) {
+        if (done == len) break;
+        const std::size_t n = std::min(v.iov_len, len - done);
+        std::memcpy(v.iov_base, s + done, n);
+        done += n;
+    }
+    return done;
+}
+
+std::size_t iov_copy(std::span<const iovec> dst, std::span<const iovec> src, std::size_t len) {
+    std::size_t di = 0, si = 0;     // entry
+    std::size_t doff = 0, soff = 0; // offset within the entry
+    std::size_t done = 0;
+    while (done < len && di < dst.size() && si < src.size()) {
+        const std::size_t n = std::min({dst[di].iov_len - doff, src[si].iov_len - soff, len - done});
+        std::memcpy(static_cast<std::uint8_t*>(dst[di].iov_base) + doff,
+                    static_cast<const std::uint8_t*>(src[si].iov_base) + soff, n);
+        done += n;
+        doff += n;
+        soff += n;
+        if (doff == dst[di].iov_len) { ++di; doff = 0; }
+        if (soff == src[si].iov_len) { ++si; soff = 0; }
+    }
+    return done;
+}
+
+void iov_advance(std::vector<iovec>& iov, std::size_t& first, std::size_t n) {
+    while (first < iov.size() && n >= iov[first].iov_len) {
+        n -= iov[first].iov_len;
+        ++first;
+    }
+    if (n != 0 && first < iov.size()) {
+        iov[first].iov_base = static_cast<std::uint8_t*>(iov[first].iov_base) + n;
+        iov[first].iov_len -= n;
+    }
+}
+
+} // namespace remu::devices
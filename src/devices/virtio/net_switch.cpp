@@ -0,0 +1,109 @@
+#include <remu/devices/virtio/net_switch.hpp>
+
+#include <algorithm>
+
+#include <remu/devices/virtio/iov.hpp>
+
+namespace remu::devices {
+
+namespace {
+constexpr std::size_t ETH_ADDR_LEN = 6;
+constexpr std::size_t ETH_HEADER_LEN = 14;
+
+std::uint64_t mac_key(const std::uint8_t* mac) {
+    std::uint64_t k = 0;
+    for (std::size_t i = 0; i < ETH_ADDR_LEN; ++i) k = (k << 8) | mac[i];
+    return k;
+}
+} // namespace
+
+class NetSwitch::Port final : public NetBackend {
+public:
+    explicit Port(NetSwitch& sw) : sw_(sw) { sw_.attach_(this); }
+    ~Port() override { sw_.detach_(this); }
+
+    void set_receiver(NetReceiver* rx) override {
+        std::unique_lock<std::shared_mutex> lock(sw_.ports_mu_);
+        receiver = rx;
+    }
+
+    void send(std::span<const iovec> frame, std::size_t len) override {
+        sw_.forward_(*this, frame, len);
+    }
+
+    void end_batch() override {
+        std::shared_lock<std::shared_mutex> lock(sw_.ports_mu_);
+        for (Port* p : touched) {
+            if (p->receiver != nullptr) p->receiver->flush_rx();
+        }
+        touched.clear();
+    }
+
+    // Guarded by the switch's ports_mu_
+    NetReceiver* receiver = nullptr;
+
+    // Ports this one delivered to in the current batch (its sender's hart
+    // thread only). Cleared by the switch when a port goes away.
+    std::vector<Port*> touched;
+
+private:
+    NetSwitch& sw_;
+};
+
+std::unique_ptr<NetBackend> NetSwitch::connect() {
+    return std::make_unique<Port>(*this);
+}
+
+void NetSwitch::attach_(Port* port) {
+    std::unique_lock<std::shared_mutex> lock(ports_mu_);
+    ports_.push_back(port);
+}
+
+void NetSwitch::detach_(Port* port) {
+    std::unique_lock<std::shared_mutex> lock(ports_mu_);
+    std::erase(ports_, port);
+    for (Port* p : ports_) std::erase(p->touched, port);
+    std::lock_guard<std::mutex> fdb_lock(fdb_mu_);
+    std::erase_if(fdb_, [port](const auto& e) { return e.second == port; });
+}
+
+void NetSwitch::forward_(Port& src, std::span<const iovec> frame, std::size_t len) {
+    if (len < ETH_HEADER_LEN) return;
+    std::uint8_t eth[ETH_HEADER_LEN];
+    iov_to_buf(frame, eth, ETH_HEADER_LEN);
+    const std::uint8_t* dst_mac = eth;
+    const std::uint8_t* src_mac = eth + ETH_ADDR_LEN;
+
+    std::shared_lock<std::shared_mutex> lock(ports_mu_);
+
+    Port* dst = nullptr;
+    {
+        std::lock_guard<std::mutex> fdb_lock(fdb_mu_);
+        if ((src_mac[0] & 1) == 0) fdb_[mac_key(src_mac)] = &src;
+        if ((dst_mac[0] & 1) == 0) {
+            const auto it = fdb_.find(mac_key(dst_mac));
+            if (it != fdb_.end()) dst = it->second;
+        }
+    }
+
+    if (dst != nullptr) {
+        if (dst != &src) deliver_(src, *dst, frame, len);
+        return;
+    }
+    for (Port* p : ports_) {
+        if (p != &src) deliver_(src, *p, frame, len);
+    }
+}
+
+void NetSwitch::deliver_(Port& src, Port& dst, std::span<const iovec> frame, std::size_t len) {
+    if (dst.receiver == nullptr) return;
+    const bool delivered = dst.receiver->receive([&](std::span<const iovec> buf) -> ssize_t {
+        if (iov_copy(buf, frame, len) < len) return -1; // doesn't fit: drop
+        return static_cast<ssize_t>(len);
+    });
+    if (delivered && std::find(src.touched.begin(), src.touched.end(), &dst) == src.touched.end()) {
+        src.touched.push_back(&dst);
+    }
+}
+
+} // namespace remu::devices
@@ -0,0 +1,197 @@
+#include <remu/devices/virtio/net_unix_dgram.hpp>
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <remu/common/log.hpp>
+
+namespace remu::devices {
+
+namespace {
+
+using remu::common::Result;
+
+// Frames delivered between two flush_rx() calls
+constexpr int RX_BURST = 64;
+
+std::string errno_message(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+bool make_addr(const std::string& path, sockaddr_un& addr) {
+    addr = sockaddr_un{};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) return false;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+} // namespace
+
+Result<std::unique_ptr<UnixDgramBackend>> UnixDgramBackend::open(const std::string& local_path,
+                                                                 const std::string& peer_path) {
+    using R = Result<std::unique_ptr<UnixDgramBackend>>;
+
+    sockaddr_un local{}, peer{};
+    if (!make_addr(local_path, local)) return R::err("bad unix socket path: " + local_path);
+    if (!make_addr(peer_path, peer)) return R::err("bad unix socket path: " + peer_path);
+
+    const int fd = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return R::err(errno_message("socket"));
+
+    // A socket file left behind by an earlier run would make bind() fail
+    ::unlink(local_path.c_str());
+    if (::bind(fd, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0) {
+        auto r = R::err(errno_message("bind " + local_path));
+        ::close(fd);
+        return r;
+    }
+
+    int wake_fds[2];
+    if (::pipe2(wake_fds, O_CLOEXEC | O_NONBLOCK) != 0) {
+        auto r = R::err(errno_message("pipe"));
+        ::close(fd);
+        ::unlink(local_path.c_str());
+        return r;
+    }
+    return R::ok(std::unique_ptr<UnixDgramBackend>(
+        new UnixDgramBackend(fd, local_path, peer, wake_fds)));
+}
+
+UnixDgramBackend::UnixDgramBackend(int fd, const std::string& local_path, const sockaddr_un& peer,
+                                   const int wake_fds[2])
+    : fd_(fd), local_path_(local_path), peer_(peer) {
+    wake_fds_[0] = wake_fds[0];
+    wake_fds_[1] = wake_fds[1];
+    reader_ = std::thread(&UnixDgramBackend::reader_loop_, this);
+}
+
+UnixDgramBackend::~UnixDgramBackend() {
+    stop_.store(true, std::memory_order_relaxed);
+    wake_reader_();
+    reader_.join();
+    ::close(wake_fds_[0]);
+    ::close(wake_fds_[1]);
+    ::close(fd_);
+    ::unlink(local_path_.c_str());
+}
+
+void UnixDgramBackend::set_receiver(NetReceiver* rx) {
+    {
+        std::lock_guard<std::mutex> lock(rx_mu_);
+        receiver_ = rx;
+    }
+    wake_reader_();
+}
+
+void UnixDgramBackend::rx_buffers_posted() { wake_reader_(); }
+
+void UnixDgramBackend::wake_reader_() {
+    const std::uint8_t byte = 1;
+    while (::write(wake_fds_[1], &byte, 1) < 0 && errno == EINTR) {}
+}
+
+// ---------------- Transmit (hart thread) ----------------
+
+void UnixDgramBackend::send(std::span<const iovec> frame, std::size_t) {
+    tx_frame_start_.push_back(tx_iov_.size());
+    tx_iov_.insert(tx_iov_.end(), frame.begin(), frame.end());
+}
+
+void UnixDgramBackend::end_batch() {
+    const std::size_t n = tx_frame_start_.size();
+    if (n == 0) return;
+
+    // tx_iov_ is complete, so pointers into it are stable now
+    tx_msgs_.assign(n, mmsghdr{});
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::size_t first = tx_frame_start_[i];
+        const std::size_t last = i + 1 < n ? tx_frame_start_[i + 1] : tx_iov_.size();
+        msghdr& h = tx_msgs_[i].msg_hdr;
+        h.msg_name = &peer_;
+        h.msg_namelen = sizeof(peer_);
+        h.msg_iov = tx_iov_.data() + first;
+        h.msg_iovlen = last - first;
+    }
+
+    // Like a wire, drop what can't be sent right now (peer not running,
+    // or its receive buffer full) rather than stall the guest
+    std::size_t sent = 0;
+    while (sent < n) {
+        const int r = ::sendmmsg(fd_, tx_msgs_.data() + sent, static_cast<unsigned>(n - sent),
+                                 MSG_DONTWAIT);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        sent += static_cast<std::size_t>(r);
+    }
+
+    tx_iov_.clear();
+    tx_frame_start_.clear();
+}
+
+// ---------------- Receive (reader thread) ----------------
+
+void UnixDgramBackend::reader_loop_() {
+    // Starved: the guest had no buffer for the datagram at the head of the
+    // socket; leave it there until the next wake-up
+    bool starved = false;
+
+    while (!stop_.load(std::memory_order_relaxed)) {
+        pollfd fds[2] = {
+            {fd_, static_cast<short>(starved ? 0 : POLLIN), 0},
+            {wake_fds_[0], POLLIN, 0},
+        };
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            remu::common::log_warn(errno_message("virtio-net: poll"));
+            return;
+        }
+        if (fds[1].revents != 0) {
+            std::uint8_t drain[16];
+            while (::read(wake_fds_[0], drain, sizeof(drain)) > 0) {}
+            starved = false;
+            continue; // re-check stop_ first
+        }
+        if (fds[0].revents == 0) continue;
+
+        std::lock_guard<std::mutex> lock(rx_mu_);
+        if (receiver_ == nullptr) {
+            starved = true;
+            continue;
+        }
+        for (int burst = 0; burst < RX_BURST; ++burst) {
+            // Anything queued? (a zero-length peek consumes nothing)
+            std::uint8_t probe;
+            if (::recv(fd_, &probe, 0, MSG_PEEK | MSG_DONTWAIT) < 0) break;
+
+            bool consumed = false;
+            const bool delivered = receiver_->receive([this, &consumed](std::span<const iovec> buf) -> ssize_t {
+                consumed = true;
+                msghdr h{};
+                h.msg_iov = const_cast<iovec*>(buf.data());
+                h.msg_iovlen = buf.size();
+                ssize_t n;
+                do {
+                    n = ::recvmsg(fd_, &h, MSG_DONTWAIT);
+                } while (n < 0 && errno == EINTR);
+                // Oversized frames arrive truncated; drop them instead
+                if (n >= 0 && (h.msg_flags & MSG_TRUNC) != 0) return -1;
+                return n;
+            });
+            // Not delivered but consumed: an oversized datagram, dropped
+            if (!delivered && !consumed) {
+                starved = true;
+                break;
+            }
+        }
+        receiver_->flush_rx();
+    }
+}
+
+} // namespace remu::devices
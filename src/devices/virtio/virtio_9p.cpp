@@ -0,0 +1,991 @@
+#include <remu/devices/virtio/virtio_9p.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/openat2.h>
+#include <sys/statfs.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <remu/devices/virtio/iov.hpp>
+
+namespace remu::devices {
+
+namespace {
+
+using remu::common::Result;
+
+// Feature bits (virtio 1.x, 5.13 in the 1.2 draft)
+constexpr std::uint64_t VIRTIO_9P_F_MOUNT_TAG = 1ull << 0;
+
+// 9P2000.L message types; each reply is the request type + 1
+enum : std::uint8_t {
+    P9_RLERROR     = 7,
+    P9_TSTATFS     = 8,
+    P9_TLOPEN      = 12,
+    P9_TLCREATE    = 14,
+    P9_TSYMLINK    = 16,
+    P9_TMKNOD      = 18,
+    P9_TRENAME     = 20,
+    P9_TREADLINK   = 22,
+    P9_TGETATTR    = 24,
+    P9_TSETATTR    = 26,
+    P9_TXATTRWALK  = 30,
+    P9_TREADDIR    = 40,
+    P9_TFSYNC      = 50,
+    P9_TLOCK       = 52,
+    P9_TGETLOCK    = 54,
+    P9_TLINK       = 70,
+    P9_TMKDIR      = 72,
+    P9_TRENAMEAT   = 74,
+    P9_TUNLINKAT   = 76,
+    P9_TVERSION    = 100,
+    P9_TATTACH     = 104,
+    P9_TFLUSH      = 108,
+    P9_TWALK       = 110,
+    P9_TREAD       = 116,
+    P9_TWRITE      = 118,
+    P9_TCLUNK      = 120,
+    P9_TREMOVE     = 122,
+};
+
+constexpr std::uint8_t P9_QTDIR     = 0x80;
+constexpr std::uint8_t P9_QTSYMLINK = 0x02;
+constexpr std::uint8_t P9_QTFILE    = 0x00;
+
+// Tgetattr: everything in the BASIC set is always returned
+constexpr std::uint64_t P9_GETATTR_BASIC = 0x7ff;
+
+// Tsetattr valid bits
+constexpr std::uint32_t P9_SETATTR_MODE      = 1u << 0;
+constexpr std::uint32_t P9_SETATTR_UID       = 1u << 1;
+constexpr std::uint32_t P9_SETATTR_GID       = 1u << 2;
+constexpr std::uint32_t P9_SETATTR_SIZE      = 1u << 3;
+constexpr std::uint32_t P9_SETATTR_ATIME     = 1u << 4;
+constexpr std::uint32_t P9_SETATTR_MTIME     = 1u << 5;
+constexpr std::uint32_t P9_SETATTR_ATIME_SET = 1u << 7;
+constexpr std::uint32_t P9_SETATTR_MTIME_SET = 1u << 8;
+
+// Tlopen/Tlcreate flags (the protocol's own values)
+constexpr std::uint32_t P9_DOTL_ACCMODE   = 03;
+constexpr std::uint32_t P9_DOTL_EXCL      = 0200;
+constexpr std::uint32_t P9_DOTL_TRUNC     = 01000;
+constexpr std::uint32_t P9_DOTL_APPEND    = 02000;
+constexpr std::uint32_t P9_DOTL_NONBLOCK  = 04000;
+constexpr std::uint32_t P9_DOTL_DSYNC     = 010000;
+constexpr std::uint32_t P9_DOTL_DIRECTORY = 0200000;
+constexpr std::uint32_t P9_DOTL_SYNC      = 04000000;
+
+constexpr std::uint32_t P9_AT_REMOVEDIR = 0x200;
+constexpr std::uint8_t P9_LOCK_SUCCESS = 0;
+constexpr std::uint8_t P9_LOCK_TYPE_UNLCK = 2;
+
+constexpr std::size_t HEADER_LEN = 7;     // size[4] type[1] tag[2]
+constexpr std::size_t TWRITE_LEN = 23;    // header fid[4] offset[8] count[4]
+constexpr std::size_t RREAD_LEN = 11;     // header count[4]
+constexpr std::size_t QID_LEN = 13;
+constexpr std::uint32_t NOFID = ~0u;
+
+std::string errno_message(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+// A single path component a client may create or look up
+bool valid_name(const std::string& name) {
+    return !name.empty() && name != "." && name != ".." && name.find('/') == std::string::npos;
+}
+
+std::string join(const std::string& dir, const std::string& name) {
+    return dir.empty() ? name : dir + "/" + name;
+}
+
+int open_flags(std::uint32_t p9) {
+    int f = static_cast<int>(p9 & P9_DOTL_ACCMODE);
+    if (p9 & P9_DOTL_EXCL) f |= O_EXCL;
+    if (p9 & P9_DOTL_TRUNC) f |= O_TRUNC;
+    if (p9 & P9_DOTL_APPEND) f |= O_APPEND;
+    if (p9 & P9_DOTL_NONBLOCK) f |= O_NONBLOCK;
+    if (p9 & P9_DOTL_DSYNC) f |= O_DSYNC;
+    if (p9 & P9_DOTL_DIRECTORY) f |= O_DIRECTORY;
+    if (p9 & P9_DOTL_SYNC) f |= O_SYNC;
+    return f;
+}
+
+std::uint8_t qid_type(mode_t mode) {
+    if (S_ISDIR(mode)) return P9_QTDIR;
+    if (S_ISLNK(mode)) return P9_QTSYMLINK;
+    return P9_QTFILE;
+}
+
+// Closes a file descriptor at the end of a scope
+struct FdGuard {
+    int fd;
+    ~FdGuard() {
+        if (fd >= 0) ::close(fd);
+    }
+};
+
+} // namespace
+
+// A client's handle on a file: a path, plus the host file once opened
+struct Virtio9p::Fid {
+    static constexpr int kOpening = -2; // claimed by a Tlopen/Tlcreate
+
+    std::string path; // guarded by fids_mu_ (renames rewrite it)
+
+    // Requests on one fid run concurrently: an open claims the fid (-1 to
+    // kOpening) so a second one fails, then publishes fd after is_dir
+    std::atomic<int> fd{-1};
+    std::atomic<bool> is_dir{false};
+
+    std::mutex dir_mu; // Treaddir position
+    DIR* dir = nullptr;
+
+    bool claim() {
+        int expected = -1;
+        return fd.compare_exchange_strong(expected, kOpening, std::memory_order_acq_rel);
+    }
+    void unclaim() { fd.store(-1, std::memory_order_relaxed); }
+    void publish(int opened, bool directory) {
+        is_dir.store(directory, std::memory_order_relaxed);
+        fd.store(opened, std::memory_order_release);
+    }
+    // The host file, or negative while there is none
+    int open_fd() const { return fd.load(std::memory_order_acquire); }
+
+    ~Fid() {
+        if (dir != nullptr) ::closedir(dir);
+        if (fd >= 0) ::close(fd);
+    }
+};
+
+// One request being served: the decoded message and its reply
+class Virtio9p::Request {
+public:
+    explicit Request(const VirtqChain& c) : chain(c) {}
+
+    // Gather the message, up to `limit` bytes
+    bool parse(std::size_t limit) {
+        std::uint8_t header[HEADER_LEN];
+        if (iov_to_buf(chain.out, header, HEADER_LEN) < HEADER_LEN) return false;
+        std::uint32_t size = 0;
+        std::memcpy(&size, header, 4);
+        type = header[4];
+        std::memcpy(&tag, header + 5, 2);
+
+        // Twrite's payload stays in guest RAM and is written from there
+        if (type == P9_TWRITE) limit = TWRITE_LEN;
+        const std::size_t n = std::min<std::size_t>({size, chain.out_len, limit});
+        if (n < HEADER_LEN) return false;
+        msg_.resize(n);
+        iov_to_buf(chain.out, msg_.data(), n);
+        pos_ = HEADER_LEN;
+        return true;
+    }
+
+    // Decoding; reading past the end sets bad() and yields zeros
+    std::uint8_t u8() { return get_<std::uint8_t>(); }
+    std::uint16_t u16() { return get_<std::uint16_t>(); }
+    std::uint32_t u32() { return get_<std::uint32_t>(); }
+    std::uint64_t u64() { return get_<std::uint64_t>(); }
+    std::string str() {
+        const std::uint16_t len = u16();
+        if (bad_ || msg_.size() - pos_ < len) {
+            bad_ = true;
+            return {};
+        }
+        std::string s(reinterpret_cast<const char*>(msg_.data() + pos_), len);
+        pos_ += len;
+        return s;
+    }
+    bool bad() const { return bad_; }
+
+    // Reply body, after size/type/tag
+    void put8(std::uint8_t v) { put_(v); }
+    void put16(std::uint16_t v) { put_(v); }
+    void put32(std::uint32_t v) { put_(v); }
+    void put64(std::uint64_t v) { put_(v); }
+    void put_str(std::string_view s) {
+        put16(static_cast<std::uint16_t>(s.size()));
+        body.insert(body.end(), s.begin(), s.end());
+    }
+    void put_qid(const struct stat& st) {
+        put8(qid_type(st.st_mode));
+        put32(0); // version
+        put64(st.st_ino);
+    }
+
+    // Write the reply (or Rlerror for a nonzero `err`) into the chain;
+    // returns the bytes written. `data_len` bytes placed directly after
+    // the body (Rread) are included.
+    std::uint32_t finish(int err) {
+        std::uint8_t rtype = static_cast<std::uint8_t>(type + 1);
+        if (err != 0) {
+            body.clear();
+            data_len = 0;
+            put32(static_cast<std::uint32_t>(err));
+            rtype = P9_RLERROR;
+        }
+        const std::size_t total = HEADER_LEN + body.size() + data_len;
+        std::uint8_t header[HEADER_LEN];
+        const auto size = static_cast<std::uint32_t>(total);
+        std::memcpy(header, &size, 4);
+        header[4] = rtype;
+        std::memcpy(header + 5, &tag, 2);
+
+        std::size_t n = iov_from_buf(chain.in, header, HEADER_LEN);
+        std::vector<iovec> rest;
+        iov_slice(chain.in, HEADER_LEN, body.size(), rest);
+        n += iov_from_buf(rest, body.data(), body.size());
+        return static_cast<std::uint32_t>(std::min(total, n + data_len));
+    }
+
+    const VirtqChain& chain;
+    std::uint8_t type = 0;
+    std::uint16_t tag = 0;
+    std::vector<std::uint8_t> body;
+    std::size_t data_len = 0;
+
+private:
+    template <typename T> T get_() {
+        T v{};
+        if (bad_ || msg_.size() - pos_ < sizeof(T)) {
+            bad_ = true;
+            return v;
+        }
+        std::memcpy(&v, msg_.data() + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return v;
+    }
+    template <typename T> void put_(T v) {
+        std::uint8_t b[sizeof(T)];
+        std::memcpy(b, &v, sizeof(T));
+        body.insert(body.end(), b, b + sizeof(T));
+    }
+
+    std::vector<std::uint8_t> msg_;
+    std::size_t pos_ = 0;
+    bool bad_ = false;
+};
+
+Result<std::unique_ptr<Virtio9p>> Virtio9p::open(const std::string& root, const std::string& tag) {
+    using R = Result<std::unique_ptr<Virtio9p>>;
+
+    if (tag.empty() || tag.size() > UINT16_MAX) return R::err("invalid 9p mount tag: " + tag);
+    const int fd = ::open(root.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return R::err(errno_message("open " + root));
+    return R::ok(std::unique_ptr<Virtio9p>(new Virtio9p(fd, tag)));
+}
+
+Virtio9p::Virtio9p(int root_fd, std::string tag)
+    : root_fd_(root_fd), tag_(std::move(tag)), pool_(kWorkers) {}
+
+Virtio9p::~Virtio9p() {
+    reset(); // no worker may still be using the fids or root_fd_
+    ::close(root_fd_);
+}
+
+std::uint64_t Virtio9p::device_features() const { return VIRTIO_9P_F_MOUNT_TAG; }
+
+void Virtio9p::read_config(std::uint32_t off, std::span<std::uint8_t> out) {
+    // struct virtio_9p_config: tag_len (u16), tag[tag_len]
+    const auto len = static_cast<std::uint16_t>(tag_.size());
+    std::vector<std::uint8_t> layout{static_cast<std::uint8_t>(len),
+                                     static_cast<std::uint8_t>(len >> 8)};
+    layout.insert(layout.end(), tag_.begin(), tag_.end());
+    copy_config(layout, off, out);
+}
+
+void Virtio9p::queue_notify(std::uint32_t q) {
+    VirtqChain chain;
+    while (queue(q).pop(chain)) {
+        {
+            std::lock_guard<std::mutex> lock(inflight_mu_);
+            ++inflight_;
+        }
+        pool_.submit([this, c = std::move(chain)] { handle_(c); });
+        chain = VirtqChain{};
+    }
+}
+
+void Virtio9p::reset() {
+    {
+        std::unique_lock<std::mutex> lock(inflight_mu_);
+        inflight_cv_.wait(lock, [this] { return inflight_ == 0; });
+    }
+    std::lock_guard<std::mutex> lock(fids_mu_);
+    fids_.clear();
+}
+
+void Virtio9p::handle_(const VirtqChain& chain) {
+    Request req(chain);
+    std::uint32_t written = 0;
+    if (req.parse(msize_.load(std::memory_order_relaxed))) written = req.finish(dispatch_(req));
+    queue(0).push(chain, written);
+    notify_used(0);
+
+    std::lock_guard<std::mutex> lock(inflight_mu_);
+    if (--inflight_ == 0) inflight_cv_.notify_all();
+}
+
+int Virtio9p::dispatch_(Request& req) {
+    int err = EOPNOTSUPP;
+    switch (req.type) {
+        case P9_TVERSION:   err = version_(req); break;
+        case P9_TATTACH:    err = attach_(req); break;
+        case P9_TWALK:      err = walk_(req); break;
+        case P9_TGETATTR:   err = getattr_(req); break;
+        case P9_TSETATTR:   err = setattr_(req); break;
+        case P9_TLOPEN:     err = lopen_(req); break;
+        case P9_TLCREATE:   err = lcreate_(req); break;
+        case P9_TREAD:      err = read_(req); break;
+        case P9_TWRITE:     err = write_(req); break;
+        case P9_TREADDIR:   err = readdir_(req); break;
+        case P9_TCLUNK:     err = clunk_(req, false); break;
+        case P9_TREMOVE:    err = clunk_(req, true); break;
+        case P9_TSTATFS:    err = statfs_(req); break;
+        case P9_TMKDIR:     err = mkdir_(req); break;
+        case P9_TSYMLINK:   err = symlink_(req); break;
+        case P9_TMKNOD:     err = mknod_(req); break;
+        case P9_TREADLINK:  err = readlink_(req); break;
+        case P9_TLINK:      err = link_(req); break;
+        case P9_TRENAME:    err = rename_(req); break;
+        case P9_TRENAMEAT:  err = renameat_(req); break;
+        case P9_TUNLINKAT:  err = unlinkat_(req); break;
+        case P9_TFSYNC:     err = fsync_(req); break;
+        case P9_TLOCK:      err = lock_(req); break;
+        case P9_TGETLOCK:   err = getlock_(req); break;
+        case P9_TFLUSH:     err = 0; break; // nothing is cancellable; the old request completes
+        default:            break;          // includes xattrs: not supported
+    }
+    return req.bad() ? EINVAL : err;
+}
+
+// ---------------- Fids and paths ----------------
+
+std::shared_ptr<Virtio9p::Fid> Virtio9p::fid_(std::uint32_t id) {
+    std::lock_guard<std::mutex> lock(fids_mu_);
+    const auto it = fids_.find(id);
+    return it == fids_.end() ? nullptr : it->second;
+}
+
+bool Virtio9p::put_fid_(std::uint32_t id, std::shared_ptr<Fid> fid) {
+    if (id == NOFID) return false;
+    std::lock_guard<std::mutex> lock(fids_mu_);
+    return fids_.emplace(id, std::move(fid)).second;
+}
+
+std::string Virtio9p::path_of_(const Fid& fid) {
+    std::lock_guard<std::mutex> lock(fids_mu_);
+    return fid.path;
+}
+
+void Virtio9p::rename_fids_(const std::string& from, const std::string& to) {
+    std::lock_guard<std::mutex> lock(fids_mu_);
+    for (auto& [id, fid] : fids_) {
+        if (fid->path == from) {
+            fid->path = to;
+        } else if (fid->path.size() > from.size() && fid->path.starts_with(from) &&
+                   fid->path[from.size()] == '/') {
+            fid->path = to + fid->path.substr(from.size());
+        }
+    }
+}
+
+int Virtio9p::open_path_(const std::string& path, int flags, int mode) const {
+    open_how how{};
+    how.flags = static_cast<decltype(how.flags)>(flags | O_CLOEXEC);
+    how.mode = static_cast<decltype(how.mode)>(mode);
+    how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+    const char* p = path.empty() ? "." : path.c_str();
+    long fd;
+    do {
+        fd = ::syscall(SYS_openat2, root_fd_, p, &how, sizeof(how));
+    } while (fd < 0 && errno == EINTR);
+    return fd < 0 ? -errno : static_cast<int>(fd);
+}
+
+int Virtio9p::open_parent_(const std::string& path, std::string& leaf) const {
+    // The root is "." in itself
+    const auto slash = path.rfind('/');
+    const std::size_t leaf_at = slash == std::string::npos ? 0 : slash + 1;
+    leaf = path.empty() ? std::string(1, '.') : path.substr(leaf_at);
+    return open_path_(leaf_at == 0 ? std::string() : path.substr(0, slash), O_PATH | O_DIRECTORY);
+}
+
+int Virtio9p::stat_path_(const std::string& path, struct stat& st) const {
+    if (path.empty()) return ::fstat(root_fd_, &st) == 0 ? 0 : errno;
+    std::string leaf;
+    const FdGuard dir{open_parent_(path, leaf)};
+    if (dir.fd < 0) return -dir.fd;
+    return ::fstatat(dir.fd, leaf.c_str(), &st, AT_SYMLINK_NOFOLLOW) == 0 ? 0 : errno;
+}
+
+// ---------------- Session ----------------
+
+int Virtio9p::version_(Request& req) {
+    const std::uint32_t msize = std::min(req.u32(), kMaxMsize);
+    const std::string version = req.str();
+    if (req.bad() || msize < 4096) return EINVAL;
+
+    // A new session: every fid from the previous one is gone
+    {
+        std::lock_guard<std::mutex> lock(fids_mu_);
+        fids_.clear();
+    }
+    msize_.store(msize, std::memory_order_relaxed);
+    req.put32(msize);
+    req.put_str(version == "9P2000.L" ? "9P2000.L" : "unknown");
+    return 0;
+}
+
+int Virtio9p::attach_(Request& req) {
+    const std::uint32_t fid = req.u32();
+    req.u32(); // afid: no authentication
+    req.str(); // uname
+    req.str(); // aname: there is one tree
+    req.u32(); // n_uname
+    if (req.bad()) return EINVAL;
+
+    struct stat st{};
+    if (const int err = stat_path_("", st); err != 0) return err;
+    if (!put_fid_(fid, std::make_shared<Fid>())) return EBADF;
+    req.put_qid(st);
+    return 0;
+}
+
+int Virtio9p::walk_(Request& req) {
+    const std::uint32_t fid_id = req.u32();
+    const std::uint32_t newfid_id = req.u32();
+    const std::uint16_t nwname = req.u16();
+    std::vector<std::string> names(nwname);
+    for (auto& n : names) n = req.str();
+    if (req.bad()) return EINVAL;
+
+    const auto fid = fid_(fid_id);
+    if (!fid) return EBADF;
+    std::string path = path_of_(*fid);
+
+    // One qid per component walked; stop at the first that doesn't exist
+    std::vector<struct stat> qids;
+    for (const std::string& name : names) {
+        std::string next;
+        if (name == "..") {
+            const auto slash = path.rfind('/');
+            next = slash == std::string::npos ? "" : path.substr(0, slash); // stays at the root
+        } else if (name == "." || valid_name(name)) {
+            next = name == "." ? path : join(path, name);
+        } else {
+            if (qids.empty()) return ENOENT;
+            break;
+        }
+        struct stat st{};
+        if (const int err = stat_path_(next, st); err != 0) {
+            if (qids.empty()) return err;
+            break;
+        }
+        qids.push_back(st);
+        path = std::move(next);
+    }
+
+    // newfid only comes into being if the whole walk succeeded
+    if (qids.size() == names.size()) {
+        if (newfid_id == fid_id) {
+            std::lock_guard<std::mutex> lock(fids_mu_);
+            fid->path = path;
+        } else {
+            auto nf = std::make_shared<Fid>();
+            nf->path = path;
+            if (!put_fid_(newfid_id, std::move(nf))) return EBADF;
+        }
+    }
+    req.put16(static_cast<std::uint16_t>(qids.size()));
+    for (const auto& st : qids) req.put_qid(st);
+    return 0;
+}
+
+int Virtio9p::clunk_(Request& req, bool remove) {
+    const std::uint32_t id = req.u32();
+    std::shared_ptr<Fid> fid;
+    {
+        std::lock_guard<std::mutex> lock(fids_mu_);
+        const auto it = fids_.find(id);
+        if (it == fids_.end()) return EBADF;
+        fid = std::move(it->second);
+        fids_.erase(it);
+    }
+    if (!remove) return 0;
+
+    // Tremove clunks the fid even if the removal fails
+    const std::string path = path_of_(*fid);
+    if (path.empty()) return EBUSY;
+    struct stat st{};
+    if (const int err = stat_path_(path, st); err != 0) return err;
+    std::string leaf;
+    const FdGuard dir{open_parent_(path, leaf)};
+    if (dir.fd < 0) return -dir.fd;
+    const int flags = S_ISDIR(st.st_mode) ? AT_REMOVEDIR : 0;
+    return ::unlinkat(dir.fd, leaf.c_str(), flags) == 0 ? 0 : errno;
+}
+
+// ---------------- Attributes ----------------
+
+int Virtio9p::getattr_(Request& req) {
+    const auto fid = fid_(req.u32());
+    req.u64(); // request_mask: the basic set is always returned
+    if (!fid) return EBADF;
+
+    struct stat st{};
+    if (const int fd = fid->open_fd(); fd >= 0) {
+        if (::fstat(fd, &st) != 0) return errno;
+    } else if (const int err = stat_path_(path_of_(*fid), st); err != 0) {
+        return err;
+    }
+
+    req.put64(P9_GETATTR_BASIC);
+    req.put_qid(st);
+    req.put32(st.st_mode);
+    req.put32(st.st_uid);
+    req.put32(st.st_gid);
+    req.put64(st.st_nlink);
+    req.put64(st.st_rdev);
+    req.put64(static_cast<std::uint64_t>(st.st_size));
+    req.put64(static_cast<std::uint64_t>(st.st_blksize));
+    req.put64(static_cast<std::uint64_t>(st.st_blocks));
+    for (const timespec& t : {st.st_atim, st.st_mtim, st.st_ctim}) {
+        req.put64(static_cast<std::uint64_t>(t.tv_sec));
+        req.put64(static_cast<std::uint64_t>(t.tv_nsec));
+    }
+    for (int i = 0; i < 4; ++i) req.put64(0); // btime, gen, data_version
+    return 0;
+}
+
+int Virtio9p::setattr_(Request& req) {
+    const auto fid = fid_(req.u32());
+    const std::uint32_t valid = req.u32();
+    const std::uint32_t mode = req.u32();
+    const std::uint32_t uid = req.u32();
+    const std::uint32_t gid = req.u32();
+    const std::uint64_t size = req.u64();
+    timespec times[2];
+    for (timespec& t : times) {
+        t.tv_sec = static_cast<time_t>(req.u64());
+        t.tv_nsec = static_cast<long>(req.u64());
+    }
+    if (req.bad()) return EINVAL;
+    if (!fid) return EBADF;
+
+    const std::string path = path_of_(*fid);
+    std::string leaf;
+    const FdGuard dir{open_parent_(path, leaf)};
+    if (dir.fd < 0) return -dir.fd;
+    const char* name = leaf.c_str();
+
+    // Nothing here follows a symlink: its target may be outside the share
+    if ((valid & P9_SETATTR_MODE) != 0 &&
+        ::fchmodat(dir.fd, name, mode & 07777, AT_SYMLINK_NOFOLLOW) != 0) {
+        return errno;
+    }
+    if ((valid & (P9_SETATTR_UID | P9_SETATTR_GID)) != 0 &&
+        ::fchownat(dir.fd, name, (valid & P9_SETATTR_UID) ? uid : static_cast<uid_t>(-1),
+                   (valid & P9_SETATTR_GID) ? gid : static_cast<gid_t>(-1),
+                   AT_SYMLINK_NOFOLLOW) != 0) {
+        return errno;
+    }
+    if ((valid & P9_SETATTR_SIZE) != 0) {
+        const FdGuard f{open_path_(path, O_WRONLY | O_NOFOLLOW)};
+        if (f.fd < 0) return -f.fd;
+        if (::ftruncate(f.fd, static_cast<off_t>(size)) != 0) return errno;
+    }
+    if ((valid & (P9_SETATTR_ATIME | P9_SETATTR_MTIME)) != 0) {
+        if ((valid & P9_SETATTR_ATIME) == 0) times[0].tv_nsec = UTIME_OMIT;
+        else if ((valid & P9_SETATTR_ATIME_SET) == 0) times[0].tv_nsec = UTIME_NOW;
+        if ((valid & P9_SETATTR_MTIME) == 0) times[1].tv_nsec = UTIME_OMIT;
+        else if ((valid & P9_SETATTR_MTIME_SET) == 0) times[1].tv_nsec = UTIME_NOW;
+        if (::utimensat(dir.fd, name, times, AT_SYMLINK_NOFOLLOW) != 0) return errno;
+    }
+    return 0;
+}
+
+int Virtio9p::statfs_(Request& req) {
+    const auto fid = fid_(req.u32());
+    if (!fid) return EBADF;
+    const FdGuard f{open_path_(path_of_(*fid), O_PATH)};
+    if (f.fd < 0) return -f.fd;
+    struct statfs sf{};
+    if (::fstatfs(f.fd, &sf) != 0) return errno;
+
+    std::uint64_t fsid = 0;
+    std::memcpy(&fsid, &sf.f_fsid, std::min(sizeof(fsid), sizeof(sf.f_fsid)));
+    req.put32(static_cast<std::uint32_t>(sf.f_type));
+    req.put32(static_cast<std::uint32_t>(sf.f_bsize));
+    req.put64(sf.f_blocks);
+    req.put64(sf.f_bfree);
+    req.put64(sf.f_bavail);
+    req.put64(sf.f_files);
+    req.put64(sf.f_ffree);
+    req.put64(fsid);
+    req.put32(static_cast<std::uint32_t>(sf.f_namelen));
+    return 0;
+}
+
+// ---------------- Open files ----------------
+
+int Virtio9p::lopen_(Request& req) {
+    const auto fid = fid_(req.u32());
+    const std::uint32_t flags = req.u32();
+    if (req.bad()) return EINVAL;
+    if (!fid) return EBADF;
+    if (!fid->claim()) return EBADF; // already open, or being opened
+
+    const std::string path = path_of_(*fid);
+    struct stat st{};
+    if (const int err = stat_path_(path, st); err != 0) {
+        fid->unclaim();
+        return err;
+    }
+    const bool is_dir = S_ISDIR(st.st_mode);
+    const int fd = open_path_(path, is_dir ? O_RDONLY | O_DIRECTORY
+                                           : (open_flags(flags) & ~O_EXCL) | O_NOFOLLOW);
+    if (fd < 0) {
+        fid->unclaim();
+        return -fd;
+    }
+    if (::fstat(fd, &st) != 0) {
+        const int err = errno;
+        ::close(fd);
+        fid->unclaim();
+        return err;
+    }
+    fid->publish(fd, is_dir);
+    req.put_qid(st);
+    req.put32(0); // iounit: as much as fits in msize
+    return 0;
+}
+
+int Virtio9p::lcreate_(Request& req) {
+    const auto fid = fid_(req.u32());
+    const std::string name = req.str();
+    const std::uint32_t flags = req.u32();
+    const std::uint32_t mode = req.u32();
+    req.u32(); // gid: files belong to the host user
+    if (req.bad()) return EINVAL;
+    if (!fid) return EBADF;
+    if (!valid_name(name)) return EINVAL;
+    if (!fid->claim()) return EBADF;
+
+    const std::string path = join(path_of_(*fid), name);
+    const int fd = open_path_(path, open_flags(flags) | O_CREAT | O_NOFOLLOW,
+                              static_cast<int>(mode & 07777));
+    if (fd < 0) {
+        fid->unclaim();
+        return -fd;
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) {
+        const int err = errno;
+        ::close(fd);
+        fid->unclaim();
+        return err;
+    }
+    // The fid now stands for the new, open file
+    {
+        std::lock_guard<std::mutex> lock(fids_mu_);
+        fid->path = path;
+    }
+    fid->publish(fd, false);
+    req.put_qid(st);
+    req.put32(0);
+    return 0;
+}
+
+int Virtio9p::read_(Request& req) {
+    const auto fid = fid_(req.u32());
+    const std::uint64_t offset = req.u64();
+    std::uint32_t count = req.u32();
+    if (req.bad()) return EINVAL;
+    if (!fid) return EBADF;
+    const int fd = fid->open_fd();
+    if (fd < 0 || fid->is_dir.load(std::memory_order_relaxed)) return EBADF;
+
+    // Straight into the guest's buffers, after the Rread header
+    const std::size_t room = req.chain.in_len > RREAD_LEN ? req.chain.in_len - RREAD_LEN : 0;
+    const std::size_t limit = msize_.load(std::memory_order_relaxed) - RREAD_LEN;
+    count = static_cast<std::uint32_t>(std::min<std::size_t>({count, room, limit}));
+    std::vector<iovec> iov;
+    iov_slice(req.chain.in, RREAD_LEN, count, iov);
+    ssize_t n = 0;
+    if (!iov.empty()) {
+        do {
+            n = ::preadv(fd, iov.data(), static_cast<int>(std::min<std::size_t>(iov.size(), IOV_MAX)),
+                         static_cast<off_t>(offset));
+        } while (n < 0 && errno == EINTR);
+        if (n < 0) return errno;
+    }
+    req.put32(static_cast<std::uint32_t>(n));
+    req.data_len = static_cast<std::size_t>(n);
+    return 0;
+}
+
+int Virtio9p::write_(Request& req) {
+    const auto fid = fid_(req.u32());
+    const std::uint64_t offset = req.u64();
+    const std::uint32_t count = req.u32();
+    if (req.bad()) return EINVAL;
+    if (!fid) return EBADF;
+    const int fd = fid->open_fd();
+    if (fd < 0 || fid->is_dir.load(std::memory_order_relaxed)) return EBADF;
+
+    // Straight from the guest's buffers, after the Twrite header
+    const std::size_t avail = req.chain.out_len - TWRITE_LEN;
+    std::vector<iovec> iov;
+    iov_slice(req.chain.out, TWRITE_LEN, std::min<std::size_t>(count, avail), iov);
+    ssize_t n = 0;
+    if (!iov.empty()) {
+        do {
+            n = ::pwritev(fd, iov.data(), static_cast<int>(std::min<std::size_t>(iov.size(), IOV_MAX)),
+                          static_cast<off_t>(offset));
+        } while (n < 0 && errno == EINTR);
+        if (n < 0) return errno;
+    }
+    req.put32(static_cast<std::uint32_t>(n));
+    return 0;
+}
+
+int Virtio9p::readdir_(Request& req) {
+    const auto fid = fid_(req.u32());
+    const std::uint64_t offset = req.u64();
+    const std::uint32_t count = req.u32();
+    if (req.bad()) return EINVAL;
+    if (!fid) return EBADF;
+    const int dir_fd = fid->open_fd();
+    if (dir_fd < 0 || !fid->is_dir.load(std::memory_order_relaxed)) return EBADF;
+
+    std::lock_guard<std::mutex> lock(fid->dir_mu);
+    if (fid->dir == nullptr) {
+        const int fd = ::dup(dir_fd);
+        if (fd < 0) return errno;
+        fid->dir = ::fdopendir(fd);
+        if (fid->dir == nullptr) {
+            const int err = errno;
+            ::close(fd);
+            return err;
+        }
+    }
+    if (offset == 0) ::rewinddir(fid->dir);
+    else ::seekdir(fid->dir, static_cast<long>(offset));
+
+    // Entries: qid, offset of the next entry, type, name
+    const std::size_t room = std::min<std::size_t>(
+        {count, msize_.load(std::memory_order_relaxed) - RREAD_LEN,
+         req.chain.in_len > RREAD_LEN ? req.chain.in_len - RREAD_LEN : 0});
+    req.put32(0); // count, patched below
+    std::size_t used = 0;
+    while (true) {
+        const long pos = ::telldir(fid->dir);
+        errno = 0;
+        const dirent* e = ::readdir(fid->dir);
+        if (e == nullptr) {
+            if (errno != 0 && used == 0) return errno;
+            break;
+        }
+        const std::size_t name_len = std::strlen(e->d_name);
+        const std::size_t len = QID_LEN + 8 + 1 + 2 + name_len;
+        if (used + len > room) {
+            ::seekdir(fid->dir, pos); // next time
+            break;
+        }
+        req.put8(e->d_type == DT_DIR ? P9_QTDIR : e->d_type == DT_LNK ? P9_QTSYMLINK : P9_QTFILE);
+        req.put32(0);
+        req.put64(e->d_ino);
+        req.put64(static_cast<std::uint64_t>(::telldir(fid->dir)));
+        req.put8(e->d_type);
+        req.put_str(std::string_view(e->d_name, name_len));
+        used += len;
+    }
+    const auto n = static_cast<std::uint32_t>(used);
+    std::memcpy(req.body.data(), &n, 4);
+    return 0;
+}
+
+int Virtio9p::fsync_(Request& req) {
+    const auto fid = fid_(req.u32());
+    const std::uint32_t datasync = req.u32();
+    if (req.bad()) return EINVAL;
+    if (!fid) return EBADF;
+    const int fd = fid->open_fd();
+    if (fd < 0) return EBADF;
+    const int r = datasync != 0 ? ::fdatasync(fd) : ::fsync(fd);
+    return r == 0 ? 0 : errno;
+}
+
+int Virtio9p::lock_(Request& req) {
+    // Advisory locks are left to the guest; only one client mounts the share
+    const auto fid = fid_(req.u32());
+    if (!fid) return EBADF;
+    req.put8(P9_LOCK_SUCCESS);
+    return 0;
+}
+
+int Virtio9p::getlock_(Request& req) {
+    const auto fid = fid_(req.u32());
+    req.u8(); // type
+    const std::uint64_t start = req.u64();
+    const std::uint64_t length = req.u64();
+    const std::uint32_t proc_id = req.u32();
+    const std::string client_id = req.str();
+    if (req.bad()) return EINVAL;
+    if (!fid) return EBADF;
+    req.put8(P9_LOCK_TYPE_UNLCK);
+    req.put64(start);
+    req.put64(length);
+    req.put32(proc_id);
+    req.put_str(client_id);
+    return 0;
+}
+
+// ---------------- Directory entries ----------------
+
+int Virtio9p::mkdir_(Request& req) {
+    const auto dfid = fid_(req.u32());
+    const std::string name = req.str();
+    const std::uint32_t mode = req.u32();
+    req.u32(); // gid
+    if (req.bad() || !valid_name(name)) return EINVAL;
+    if (!dfid) return EBADF;
+
+    const FdGuard dir{open_path_(path_of_(*dfid), O_PATH | O_DIRECTORY)};
+    if (dir.fd < 0) return -dir.fd;
+    if (::mkdirat(dir.fd, name.c_str(), mode & 07777) != 0) return errno;
+    struct stat st{};
+    if (::fstatat(dir.fd, name.c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0) return errno;
+    req.put_qid(st);
+    return 0;
+}
+
+int Virtio9p::symlink_(Request& req) {
+    const auto dfid = fid_(req.u32());
+    const std::string name = req.str();
+    const std::string target = req.str();
+    req.u32(); // gid
+    if (req.bad() || !valid_name(name)) return EINVAL;
+    if (!dfid) return EBADF;
+
+    const FdGuard dir{open_path_(path_of_(*dfid), O_PATH | O_DIRECTORY)};
+    if (dir.fd < 0) return -dir.fd;
+    if (::symlinkat(target.c_str(), dir.fd, name.c_str()) != 0) return errno;
+    struct stat st{};
+    if (::fstatat(dir.fd, name.c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0) return errno;
+    req.put_qid(st);
+    return 0;
+}
+
+int Virtio9p::mknod_(Request& req) {
+    const auto dfid = fid_(req.u32());
+    const std::string name = req.str();
+    const std::uint32_t mode = req.u32();
+    const std::uint32_t major = req.u32();
+    const std::uint32_t minor = req.u32();
+    req.u32(); // gid
+    if (req.bad() || !valid_name(name)) return EINVAL;
+    if (!dfid) return EBADF;
+
+    const FdGuard dir{open_path_(path_of_(*dfid), O_PATH | O_DIRECTORY)};
+    if (dir.fd < 0) return -dir.fd;
+    if (::mknodat(dir.fd, name.c_str(), mode, makedev(major, minor)) != 0) return errno;
+    struct stat st{};
+    if (::fstatat(dir.fd, name.c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0) return errno;
+    req.put_qid(st);
+    return 0;
+}
+
+int Virtio9p::readlink_(Request& req) {
+    const auto fid = fid_(req.u32());
+    if (!fid) return EBADF;
+    std::string leaf;
+    const FdGuard dir{open_parent_(path_of_(*fid), leaf)};
+    if (dir.fd < 0) return -dir.fd;
+
+    char buf[PATH_MAX];
+    const ssize_t n = ::readlinkat(dir.fd, leaf.c_str(), buf, sizeof(buf));
+    if (n < 0) return errno;
+    req.put_str(std::string_view(buf, static_cast<std::size_t>(n)));
+    return 0;
+}
+
+int Virtio9p::link_(Request& req) {
+    const auto dfid = fid_(req.u32());
+    const auto fid = fid_(req.u32());
+    const std::string name = req.str();
+    if (req.bad() || !valid_name(name)) return EINVAL;
+    if (!dfid || !fid) return EBADF;
+
+    std::string leaf;
+    const FdGuard from{open_parent_(path_of_(*fid), leaf)};
+    if (from.fd < 0) return -from.fd;
+    const FdGuard to{open_path_(path_of_(*dfid), O_PATH | O_DIRECTORY)};
+    if (to.fd < 0) return -to.fd;
+    return ::linkat(from.fd, leaf.c_str(), to.fd, name.c_str(), 0) == 0 ? 0 : errno;
+}
+
+int Virtio9p::rename_(Request& req) {
+    const auto fid = fid_(req.u32());
+    const auto dfid = fid_(req.u32());
+    const std::string name = req.str();
+    if (req.bad() || !valid_name(name)) return EINVAL;
+    if (!fid || !dfid) return EBADF;
+
+    const std::string from_path = path_of_(*fid);
+    const std::string to_path = join(path_of_(*dfid), name);
+    std::string leaf;
+    const FdGuard from{open_parent_(from_path, leaf)};
+    if (from.fd < 0) return -from.fd;
+    const FdGuard to{open_path_(path_of_(*dfid), O_PATH | O_DIRECTORY)};
+    if (to.fd < 0) return -to.fd;
+    if (::renameat(from.fd, leaf.c_str(), to.fd, name.c_str()) != 0) return errno;
+    rename_fids_(from_path, to_path);
+    return 0;
+}
+
+int Virtio9p::renameat_(Request& req) {
+    const auto olddir = fid_(req.u32());
+    const std::string oldname = req.str();
+    const auto newdir = fid_(req.u32());
+    const std::string newname = req.str();
+    if (req.bad() || !valid_name(oldname) || !valid_name(newname)) return EINVAL;
+    if (!olddir || !newdir) return EBADF;
+
+    const std::string old_dir_path = path_of_(*olddir);
+    const std::string new_dir_path = path_of_(*newdir);
+    const FdGuard from{open_path_(old_dir_path, O_PATH | O_DIRECTORY)};
+    if (from.fd < 0) return -from.fd;
+    const FdGuard to{open_path_(new_dir_path, O_PATH | O_DIRECTORY)};
+    if (to.fd < 0) return -to.fd;
+    if (::renameat(from.fd, oldname.c_str(), to.fd, newname.c_str()) != 0) return errno;
+    rename_fids_(join(old_dir_path, oldname), join(new_dir_path, newname));
+    return 0;
+}
+
+int Virtio9p::unlinkat_(Request& req) {
+    const auto dfid = fid_(req.u32());
+    const std::string name = req.str();
+    const std::uint32_t flags = req.u32();
+    if (req.bad() || !valid_name(name)) return EINVAL;
+    if (!dfid) return EBADF;
+
+    const FdGuard dir{open_path_(path_of_(*dfid), O_PATH | O_DIRECTORY)};
+    if (dir.fd < 0) return -dir.fd;
+    const int f = (flags & P9_AT_REMOVEDIR) != 0 ? AT_REMOVEDIR : 0;
+    return ::unlinkat(dir.fd, name.c_str(), f) == 0 ? 0 : errno;
+}
+
+} // namespace remu::devices
@@ -0,0 +1,108 @@
+#include <remu/devices/virtio/virtio_balloon.hpp>
+
+#include <cstring>
+#include <vector>
+
+#include <remu/devices/virtio/iov.hpp>
+#include <remu/mem/memory.hpp>
+
+namespace remu::devices {
+
+namespace {
+// Feature bits (virtio 1.x, 5.5.3)
+constexpr std::uint64_t VIRTIO_BALLOON_F_DEFLATE_ON_OOM = 1ull << 2;
+constexpr std::uint64_t VIRTIO_BALLOON_F_REPORTING      = 1ull << 5;
+
+// Config space: num_pages, actual, free_page_hint_cmd_id, poison_val (u32)
+constexpr std::uint32_t CONFIG_ACTUAL = 4;
+constexpr std::uint32_t CONFIG_LEN = 16;
+
+constexpr std::uint32_t PFN_SHIFT = 12;
+} // namespace
+
+VirtioBalloon::VirtioBalloon(remu::mem::Memory& ram, std::uint32_t target_pages)
+    : ram_(ram), target_(target_pages) {}
+
+void VirtioBalloon::set_target_pages(std::uint32_t pages) {
+    if (target_.exchange(pages, std::memory_order_relaxed) != pages) notify_config();
+}
+
+std::uint64_t VirtioBalloon::device_features() const {
+    return VIRTIO_BALLOON_F_DEFLATE_ON_OOM | VIRTIO_BALLOON_F_REPORTING;
+}
+
+void VirtioBalloon::read_config(std::uint32_t off, std::span<std::uint8_t> out) {
+    std::uint8_t layout[CONFIG_LEN] = {};
+    const std::uint32_t num_pages = target_pages();
+    const std::uint32_t actual = actual_pages();
+    std::memcpy(layout, &num_pages, 4);
+    std::memcpy(layout + CONFIG_ACTUAL, &actual, 4);
+    copy_config(layout, off, out);
+}
+
+void VirtioBalloon::write_config(std::uint32_t off, std::span<const std::uint8_t> in) {
+    // Only `actual` is driver-writable; it is written as one 32-bit value
+    if (off != CONFIG_ACTUAL || in.size() != 4) return;
+    std::uint32_t actual = 0;
+    std::memcpy(&actual, in.data(), 4);
+    actual_.store(actual, std::memory_order_relaxed);
+}
+
+void VirtioBalloon::queue_notify(std::uint32_t q) {
+    if (q > kReportingQueue) return;
+    bool pushed = false;
+    VirtqChain chain;
+    while (queue(q).pop(chain)) {
+        if (q == kInflateQueue) inflate_(chain);
+        else if (q == kReportingQueue) report_(chain);
+        // Deflated pages need no work: they fault back in on first use
+        queue(q).push(chain, 0);
+        pushed = true;
+    }
+    if (pushed) notify_used(q);
+}
+
+void VirtioBalloon::reset() {
+    // A new driver starts with every page its own again
+    actual_.store(0, std::memory_order_relaxed);
+}
+
+void VirtioBalloon::inflate_(const VirtqChain& chain) {
+    // An array of 32-bit page frame numbers; coalesce runs of consecutive
+    // frames into one discard each
+    std::vector<std::uint32_t> pfns(chain.out_len / sizeof(std::uint32_t));
+    iov_to_buf(chain.out, pfns.data(), pfns.size() * sizeof(std::uint32_t));
+
+    std::size_t i = 0;
+    while (i < pfns.size()) {
+        std::size_t j = i + 1;
+        while (j < pfns.size() && pfns[j] == pfns[j - 1] + 1) ++j;
+        const std::uint64_t addr = static_cast<std::uint64_t>(pfns[i]) << PFN_SHIFT;
+        const std::uint64_t len = static_cast<std::uint64_t>(j - i) * kPageSize;
+        if (addr + len <= UINT32_MAX + 1ull) {
+            released_.fetch_add(ram_.discard(static_cast<std::uint32_t>(addr),
+                                             static_cast<std::uint32_t>(len)),
+                                std::memory_order_relaxed);
+        }
+        i = j;
+    }
+}
+
+void VirtioBalloon::report_(const VirtqChain& chain) {
+    // Each device-writable buffer is a free range of guest RAM; the iovecs
+    // already point at it, so map them back to guest-physical addresses
+    const std::span<std::uint8_t> ram = ram_.bytes();
+    const auto* ram_begin = ram.data();
+    for (const iovec& v : chain.in) {
+        const auto* p = static_cast<const std::uint8_t*>(v.iov_base);
+        if (p < ram_begin || v.iov_len > ram.size() ||
+            static_cast<std::size_t>(p - ram_begin) > ram.size() - v.iov_len) {
+            continue; // not RAM (never the case for Linux)
+        }
+        const auto paddr = ram_.base() + static_cast<std::uint32_t>(p - ram_begin);
+        released_.fetch_add(ram_.discard(paddr, static_cast<std::uint32_t>(v.iov_len)),
+                            std::memory_order_relaxed);
+    }
+}
+
+} // namespace remu::devices
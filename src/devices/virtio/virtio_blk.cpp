@@ -0,0 +1,205 @@
+#include <remu/devices/virtio/virtio_blk.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <remu/devices/virtio/iov.hpp>
+
+namespace remu::devices {
+
+namespace {
+
+using remu::common::Result;
+
+// Feature bits (virtio 1.x, 5.2.3)
+constexpr std::uint64_t VIRTIO_BLK_F_SEG_MAX  = 1ull << 2;
+constexpr std::uint64_t VIRTIO_BLK_F_RO       = 1ull << 5;
+constexpr std::uint64_t VIRTIO_BLK_F_BLK_SIZE = 1ull << 6;
+constexpr std::uint64_t VIRTIO_BLK_F_FLUSH    = 1ull << 9;
+
+// Request types and status values
+constexpr std::uint32_t VIRTIO_BLK_T_IN     = 0;
+constexpr std::uint32_t VIRTIO_BLK_T_OUT    = 1;
+constexpr std::uint32_t VIRTIO_BLK_T_FLUSH  = 4;
+constexpr std::uint32_t VIRTIO_BLK_T_GET_ID = 8;
+
+constexpr std::uint8_t VIRTIO_BLK_S_OK     = 0;
+constexpr std::uint8_t VIRTIO_BLK_S_IOERR  = 1;
+constexpr std::uint8_t VIRTIO_BLK_S_UNSUPP = 2;
+
+constexpr std::uint32_t SECTOR_SIZE = 512;
+constexpr std::size_t HEADER_LEN = 16; // type, reserved, sector
+constexpr std::size_t ID_LEN = 20;
+constexpr char DEVICE_ID[] = "remu-virtio-blk";
+
+std::string errno_message(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+// preadv/pwritev the whole list, resuming after short transfers. False on
+// error or (for reads) end of file.
+bool transfer_all(int fd, std::vector<iovec> iov, off_t off, bool write) {
+    std::size_t first = 0;
+    while (first < iov.size()) {
+        const int cnt = static_cast<int>(std::min<std::size_t>(iov.size() - first, IOV_MAX));
+        const ssize_t n = write ? ::pwritev(fd, iov.data() + first, cnt, off)
+                                : ::preadv(fd, iov.data() + first, cnt, off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (n == 0) return false;
+
+        off += n;
+        iov_advance(iov, first, static_cast<std::size_t>(n));
+    }
+    return true;
+}
+
+} // namespace
+
+Result<std::unique_ptr<VirtioBlk>> VirtioBlk::open(const std::string& path, bool read_only) {
+    using R = Result<std::unique_ptr<VirtioBlk>>;
+
+    const int fd = ::open(path.c_str(), (read_only ? O_RDONLY : O_RDWR) | O_CLOEXEC);
+    if (fd < 0) return R::err(errno_message("open " + path));
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) {
+        auto r = R::err(errno_message("stat " + path));
+        ::close(fd);
+        return r;
+    }
+    const auto capacity = static_cast<std::uint64_t>(st.st_size) / SECTOR_SIZE;
+    if (capacity == 0) {
+        ::close(fd);
+        return R::err(path + ": image is smaller than one sector");
+    }
+    return R::ok(std::unique_ptr<VirtioBlk>(new VirtioBlk(fd, capacity, read_only)));
+}
+
+VirtioBlk::VirtioBlk(int fd, std::uint64_t capacity, bool read_only)
+    : fd_(fd), capacity_(capacity), read_only_(read_only), pool_(kWorkers) {}
+
+VirtioBlk::~VirtioBlk() {
+    reset(); // no worker may still be using fd_
+    ::close(fd_);
+}
+
+std::uint64_t VirtioBlk::device_features() const {
+    std::uint64_t f = VIRTIO_BLK_F_SEG_MAX | VIRTIO_BLK_F_BLK_SIZE | VIRTIO_BLK_F_FLUSH;
+    if (read_only_) f |= VIRTIO_BLK_F_RO;
+    return f;
+}
+
+void VirtioBlk::read_config(std::uint32_t off, std::span<std::uint8_t> out) {
+    // struct virtio_blk_config up to blk_size: capacity (u64), size_max,
+    // seg_max, geometry (u16 + 2 x u8), blk_size
+    std::uint8_t layout[24] = {};
+    const std::uint32_t seg_max = kQueueSize - 2; // header + status
+    std::memcpy(layout + 0, &capacity_, 8);
+    std::memcpy(layout + 12, &seg_max, 4);
+    std::memcpy(layout + 20, &SECTOR_SIZE, 4);
+    copy_config(layout, off, out);
+}
+
+void VirtioBlk::queue_notify(std::uint32_t q) {
+    VirtqChain chain;
+    while (queue(q).pop(chain)) {
+        {
+            std::lock_guard<std::mutex> lock(inflight_mu_);
+            ++inflight_;
+        }
+        pool_.submit([this, c = std::move(chain)] { handle_(c); });
+        chain = VirtqChain{};
+    }
+}
+
+void VirtioBlk::reset() {
+    std::unique_lock<std::mutex> lock(inflight_mu_);
+    inflight_cv_.wait(lock, [this] { return inflight_ == 0; });
+}
+
+void VirtioBlk::handle_(const VirtqChain& chain) {
+    std::uint32_t written = 0;
+
+    // Need at least the header to read and the status byte to write back
+    if (chain.out_len >= HEADER_LEN && chain.in_len >= 1) {
+        std::uint8_t header[HEADER_LEN];
+        iov_to_buf(chain.out, header, HEADER_LEN);
+        std::uint32_t type = 0;
+        std::uint64_t sector = 0;
+        std::memcpy(&type, header, 4);
+        std::memcpy(&sector, header + 8, 8);
+
+        const std::uint8_t status = do_io_(type, sector, chain, chain.out_len - HEADER_LEN,
+                                           chain.in_len - 1, written);
+        // Status is the chain's last writable byte
+        const iovec& last = chain.in.back();
+        static_cast<std::uint8_t*>(last.iov_base)[last.iov_len - 1] = status;
+        ++written;
+    }
+    complete_(chain, written);
+}
+
+std::uint8_t VirtioBlk::do_io_(std::uint32_t type, std::uint64_t sector, const VirtqChain& chain,
+                               std::size_t data_out, std::size_t data_in,
+                               std::uint32_t& written) {
+    auto in_range = [&](std::size_t len) {
+        if (len % SECTOR_SIZE != 0) return false;
+        const std::uint64_t n = len / SECTOR_SIZE;
+        return sector <= capacity_ && n <= capacity_ - sector;
+    };
+    const auto off = static_cast<off_t>(sector * SECTOR_SIZE);
+    std::vector<iovec> data;
+
+    switch (type) {
+        case VIRTIO_BLK_T_IN: {
+            if (!in_range(data_in)) return VIRTIO_BLK_S_IOERR;
+            iov_slice(chain.in, 0, data_in, data);
+            if (!transfer_all(fd_, std::move(data), off, false)) {
+                return VIRTIO_BLK_S_IOERR;
+            }
+            written = static_cast<std::uint32_t>(data_in);
+            return VIRTIO_BLK_S_OK;
+        }
+        case VIRTIO_BLK_T_OUT: {
+            if (read_only_ || !in_range(data_out)) return VIRTIO_BLK_S_IOERR;
+            iov_slice(chain.out, HEADER_LEN, data_out, data);
+            if (!transfer_all(fd_, std::move(data), off, true)) {
+                return VIRTIO_BLK_S_IOERR;
+            }
+            return VIRTIO_BLK_S_OK;
+        }
+        case VIRTIO_BLK_T_FLUSH:
+            return ::fdatasync(fd_) == 0 ? VIRTIO_BLK_S_OK : VIRTIO_BLK_S_IOERR;
+        case VIRTIO_BLK_T_GET_ID: {
+            char id[ID_LEN] = {};
+            std::memcpy(id, DEVICE_ID, std::min(sizeof(DEVICE_ID), ID_LEN));
+            const std::size_t n = std::min(data_in, ID_LEN);
+            iov_from_buf(chain.in, id, n);
+            written = static_cast<std::uint32_t>(n);
+            return VIRTIO_BLK_S_OK;
+        }
+        default:
+            return VIRTIO_BLK_S_UNSUPP;
+    }
+}
+
+void VirtioBlk::complete_(const VirtqChain& chain, std::uint32_t written) {
+    queue(0).push(chain, written);
+    notify_used(0);
+
+    std::lock_guard<std::mutex> lock(inflight_mu_);
+    if (--inflight_ == 0) inflight_cv_.notify_all();
+}
+
+} // namespace remu::devices
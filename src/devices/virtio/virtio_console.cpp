@@ -0,0 +1,324 @@
+#include <remu/devices/virtio/virtio_console.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <functional>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <remu/common/log.hpp>
+#include <remu/devices/virtio/iov.hpp>
+
+namespace remu::devices {
+
+namespace {
+// Feature bits (virtio 1.x, 5.3.3)
+constexpr std::uint64_t VIRTIO_CONSOLE_F_MULTIPORT   = 1ull << 1;
+constexpr std::uint64_t VIRTIO_CONSOLE_F_EMERG_WRITE = 1ull << 2;
+
+// Control events (5.3.6.2)
+constexpr std::uint16_t VIRTIO_CONSOLE_DEVICE_READY  = 0;
+constexpr std::uint16_t VIRTIO_CONSOLE_DEVICE_ADD    = 1;
+constexpr std::uint16_t VIRTIO_CONSOLE_PORT_READY    = 3;
+constexpr std::uint16_t VIRTIO_CONSOLE_CONSOLE_PORT  = 4;
+constexpr std::uint16_t VIRTIO_CONSOLE_PORT_OPEN     = 6;
+constexpr std::uint16_t VIRTIO_CONSOLE_PORT_NAME     = 7;
+
+constexpr std::size_t CONTROL_LEN = 8; // id (u32), event (u16), value (u16)
+
+// Config space: cols (u16), rows (u16), max_nr_ports (u32), emerg_wr (u32)
+constexpr std::uint32_t CONFIG_EMERG_WR = 8;
+constexpr std::uint32_t CONFIG_LEN = 12;
+} // namespace
+
+VirtioConsole::VirtioConsole(std::vector<PortConfig> ports) {
+    const auto n = std::min<std::size_t>(ports.size(), kMaxPorts);
+    for (std::size_t i = 0; i < n; ++i) {
+        auto port = std::make_unique<Port>();
+        port->id = static_cast<std::uint32_t>(i);
+        port->cfg = std::move(ports[i]);
+        port->writer = std::make_unique<remu::common::WorkerPool>(1);
+        if (port->cfg.in_fd >= 0) {
+            if (::pipe2(port->wake_fds, O_CLOEXEC | O_NONBLOCK) != 0) {
+                remu::common::log_warn("virtio-console: no wake pipe; port " +
+                                       std::to_string(i) + " input disabled");
+            } else {
+                port->reader = std::thread(&VirtioConsole::reader_loop_, this, std::ref(*port));
+            }
+        }
+        ports_.push_back(std::move(port));
+    }
+}
+
+VirtioConsole::~VirtioConsole() {
+    reset();
+    for (auto& port : ports_) {
+        if (port->reader.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(port->mu);
+                port->stop = true;
+            }
+            port->cv.notify_all();
+            port->reader.join();
+        }
+        port->writer.reset();
+        for (int fd : port->wake_fds) {
+            if (fd >= 0) ::close(fd);
+        }
+        if (port->cfg.owns_fds) {
+            if (port->cfg.in_fd >= 0 && port->cfg.in_fd != port->cfg.out_fd) ::close(port->cfg.in_fd);
+            if (port->cfg.out_fd >= 0) ::close(port->cfg.out_fd);
+        }
+    }
+}
+
+std::uint64_t VirtioConsole::device_features() const {
+    return VIRTIO_CONSOLE_F_MULTIPORT | VIRTIO_CONSOLE_F_EMERG_WRITE;
+}
+
+std::uint32_t VirtioConsole::num_queues() const {
+    return 2 * (static_cast<std::uint32_t>(ports_.size()) + 1);
+}
+
+void VirtioConsole::read_config(std::uint32_t off, std::span<std::uint8_t> out) {
+    std::uint8_t layout[CONFIG_LEN] = {};
+    const auto max_ports = static_cast<std::uint32_t>(ports_.size());
+    std::memcpy(layout + 4, &max_ports, 4);
+    copy_config(layout, off, out);
+}
+
+void VirtioConsole::write_config(std::uint32_t off, std::span<const std::uint8_t> in) {
+    if (off != CONFIG_EMERG_WR || in.empty() || ports_.empty()) return;
+    // Goes through port 0's writer so it stays ordered with queued output
+    Port& port = *ports_[0];
+    const std::uint8_t byte = in[0];
+    port.writer->submit([&port, byte] {
+        if (port.cfg.out_fd < 0 || port.output_failed) return;
+        while (::write(port.cfg.out_fd, &byte, 1) < 0 && errno == EINTR) {}
+    });
+}
+
+void VirtioConsole::activate() {
+    for (auto& port : ports_) {
+        {
+            std::lock_guard<std::mutex> lock(port->mu);
+            port->rx_enabled = true;
+            port->rx_kick = true;
+        }
+        port->cv.notify_all();
+    }
+}
+
+void VirtioConsole::queue_notify(std::uint32_t q) {
+    if (q == kCtrlRx) {
+        flush_control_();
+        return;
+    }
+    if (q == kCtrlTx) {
+        handle_control_();
+        return;
+    }
+
+    const std::uint32_t port_id = q < 2 ? 0 : (q - 2) / 2;
+    if (port_id >= ports_.size()) return;
+    Port& port = *ports_[port_id];
+
+    if (q == tx_queue_(port_id)) {
+        transmit_(port, q);
+    } else {
+        {
+            std::lock_guard<std::mutex> lock(port.mu);
+            port.rx_kick = true;
+        }
+        port.cv.notify_all();
+    }
+}
+
+void VirtioConsole::reset() {
+    for (auto& port : ports_) {
+        std::unique_lock<std::mutex> lock(port->mu);
+        port->rx_enabled = false;
+        port->rx_kick = false;
+        lock.unlock();
+        stop_reader_io_(*port);
+        lock.lock();
+        port->cv.wait(lock, [&] { return !port->rx_busy && port->tx_inflight == 0; });
+
+        // Swallow the wake-up if the reader never saw it
+        std::uint8_t drain[16];
+        while (port->wake_fds[0] >= 0 && ::read(port->wake_fds[0], drain, sizeof(drain)) > 0) {}
+    }
+    control_out_.clear();
+}
+
+// ---------------- Guest -> host ----------------
+
+void VirtioConsole::transmit_(Port& port, std::uint32_t q) {
+    VirtqChain chain;
+    while (queue(q).pop(chain)) {
+        {
+            std::lock_guard<std::mutex> lock(port.mu);
+            ++port.tx_inflight;
+        }
+        port.writer->submit([this, &port, q, c = std::move(chain)] {
+            write_out_(port, c);
+            queue(q).push(c, 0);
+            notify_used(q);
+
+            std::lock_guard<std::mutex> lock(port.mu);
+            if (--port.tx_inflight == 0) port.cv.notify_all();
+        });
+        chain = VirtqChain{};
+    }
+}
+
+void VirtioConsole::write_out_(Port& port, const VirtqChain& chain) {
+    if (port.cfg.out_fd < 0 || port.output_failed || chain.out.empty()) return;
+
+    std::vector<iovec> iov = chain.out;
+    std::size_t first = 0;
+    while (first < iov.size()) {
+        const int cnt = static_cast<int>(std::min<std::size_t>(iov.size() - first, IOV_MAX));
+        const ssize_t n = ::writev(port.cfg.out_fd, iov.data() + first, cnt);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            port.output_failed = true;
+            remu::common::log_warn("virtio-console: port " + std::to_string(port.id) +
+                                   " output failed (" + std::strerror(errno) +
+                                   "); discarding further output");
+            return;
+        }
+        iov_advance(iov, first, static_cast<std::size_t>(n));
+    }
+}
+
+// ---------------- Host -> guest ----------------
+
+void VirtioConsole::reader_loop_(Port& port) {
+    const std::uint32_t q = rx_queue_(port.id);
+    VirtqChain chain;
+
+    std::unique_lock<std::mutex> lock(port.mu);
+    while (true) {
+        port.cv.wait(lock, [&] {
+            return port.stop || (port.rx_enabled && port.rx_kick && !port.in_eof);
+        });
+        if (port.stop) return;
+        port.rx_kick = false;
+        port.rx_busy = true;
+        lock.unlock();
+
+        // Fill posted buffers as host data arrives. A chain popped when
+        // reset() interrupts the wait is simply dropped with the ring.
+        bool eof = false;
+        while (queue(q).pop(chain)) {
+            if (!wait_readable_(port)) break;
+            ssize_t n;
+            do {
+                n = ::readv(port.cfg.in_fd, chain.in.data(),
+                            static_cast<int>(std::min<std::size_t>(chain.in.size(), IOV_MAX)));
+            } while (n < 0 && errno == EINTR);
+            if (n <= 0) {
+                eof = true;
+                break;
+            }
+            queue(q).push(chain, static_cast<std::uint32_t>(n));
+            notify_used(q);
+        }
+
+        lock.lock();
+        if (eof) port.in_eof = true;
+        port.rx_busy = false;
+        port.cv.notify_all();
+    }
+}
+
+bool VirtioConsole::wait_readable_(Port& port) {
+    pollfd fds[2] = {
+        {port.cfg.in_fd, POLLIN, 0},
+        {port.wake_fds[0], POLLIN, 0},
+    };
+    while (true) {
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (fds[1].revents != 0) return false;
+        if (fds[0].revents != 0) return true;
+    }
+}
+
+void VirtioConsole::stop_reader_io_(Port& port) {
+    if (port.wake_fds[1] < 0) return;
+    const std::uint8_t byte = 1;
+    while (::write(port.wake_fds[1], &byte, 1) < 0 && errno == EINTR) {}
+}
+
+// ---------------- Control protocol (hart thread) ----------------
+
+void VirtioConsole::handle_control_() {
+    bool pushed = false;
+    VirtqChain chain;
+    while (queue(kCtrlTx).pop(chain)) {
+        if (chain.out_len >= CONTROL_LEN) {
+            std::uint8_t msg[CONTROL_LEN];
+            iov_to_buf(chain.out, msg, CONTROL_LEN);
+            std::uint32_t id = 0;
+            std::uint16_t event = 0, value = 0;
+            std::memcpy(&id, msg, 4);
+            std::memcpy(&event, msg + 4, 2);
+            std::memcpy(&value, msg + 6, 2);
+
+            if (event == VIRTIO_CONSOLE_DEVICE_READY && value == 1) {
+                for (auto& port : ports_) send_control_(port->id, VIRTIO_CONSOLE_DEVICE_ADD, 0);
+            } else if (event == VIRTIO_CONSOLE_PORT_READY && value == 1 && id < ports_.size()) {
+                const Port& port = *ports_[id];
+                if (id == 0) send_control_(id, VIRTIO_CONSOLE_CONSOLE_PORT, 1);
+                if (!port.cfg.name.empty()) {
+                    send_control_(id, VIRTIO_CONSOLE_PORT_NAME, 0, port.cfg.name);
+                }
+                // The host end is connected from the start
+                send_control_(id, VIRTIO_CONSOLE_PORT_OPEN, 1);
+            }
+            // The guest's PORT_OPEN needs nothing: host input goes to the
+            // port's receive queue whether or not a process has it open
+        }
+        queue(kCtrlTx).push(chain, 0);
+        pushed = true;
+    }
+    if (pushed) notify_used(kCtrlTx);
+    flush_control_();
+}
+
+void VirtioConsole::send_control_(std::uint32_t id, std::uint16_t event, std::uint16_t value,
+                                  std::string_view extra) {
+    std::uint8_t header[CONTROL_LEN];
+    std::memcpy(header, &id, 4);
+    std::memcpy(header + 4, &event, 2);
+    std::memcpy(header + 6, &value, 2);
+
+    std::vector<std::uint8_t> msg(header, header + CONTROL_LEN);
+    msg.insert(msg.end(), extra.begin(), extra.end());
+    control_out_.push_back(std::move(msg));
+}
+
+void VirtioConsole::flush_control_() {
+    bool pushed = false;
+    VirtqChain chain;
+    while (!control_out_.empty() && queue(kCtrlRx).pop(chain)) {
+        const std::vector<std::uint8_t>& msg = control_out_.front();
+        const std::size_t n = std::min(msg.size(), chain.in_len);
+        iov_from_buf(chain.in, msg.data(), n);
+        queue(kCtrlRx).push(chain, static_cast<std::uint32_t>(n));
+        control_out_.pop_front();
+        pushed = true;
+    }
+    if (pushed) notify_used(kCtrlRx);
+}
+
+} // namespace remu::devices
@@ -0,0 +1,294 @@
+#include <remu/devices/virtio/virtio_mmio.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include <remu/mem/bus.hpp>
+
+namespace remu::devices {
+
+namespace {
+constexpr std::uint32_t MAGIC     = 0x7472'6976; // "virt"
+constexpr std::uint32_t VERSION   = 2;
+constexpr std::uint32_t VENDOR_ID = 0x756D'6572; // "remu"
+
+constexpr std::uint32_t CONFIG_OFF = 0x100;
+
+// Device status bits
+constexpr std::uint32_t STATUS_FEATURES_OK       = 8;
+constexpr std::uint32_t STATUS_DRIVER_OK         = 4;
+constexpr std::uint32_t STATUS_DEVICE_NEEDS_RESET = 64;
+
+constexpr std::uint64_t TRANSPORT_FEATURES =
+    virtio::F_VERSION_1 | virtio::F_RING_INDIRECT_DESC | virtio::F_RING_EVENT_IDX;
+} // namespace
+
+// ---------------- VirtioDevice ----------------
+
+void VirtioDevice::read_config(std::uint32_t /*off*/, std::span<std::uint8_t> out) {
+    std::fill(out.begin(), out.end(), std::uint8_t{0});
+}
+
+void VirtioDevice::copy_config(std::span<const std::uint8_t> layout, std::uint32_t off,
+                               std::span<std::uint8_t> out) {
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        const std::size_t src = off + i;
+        out[i] = src < layout.size() ? layout[src] : std::uint8_t{0};
+    }
+}
+
+Virtqueue& VirtioDevice::queue(std::uint32_t q) { return transport_->queue(q); }
+
+bool VirtioDevice::has_feature(std::uint64_t f) const { return transport_->has_feature(f); }
+
+void VirtioDevice::notify_used(std::uint32_t q) {
+    if (transport_->queue(q).should_interrupt()) transport_->interrupt_used();
+}
+
+void VirtioDevice::notify_config() { transport_->interrupt_config(); }
+
+// ---------------- VirtioMmio ----------------
+
+VirtioMmio::VirtioMmio(remu::mem::Bus& bus, std::unique_ptr<VirtioDevice> dev)
+    : bus_(bus),
+      dev_(std::move(dev)),
+      num_queues_(dev_->num_queues()),
+      device_features_(dev_->device_features() | TRANSPORT_FEATURES) {
+    queues_ = std::make_unique<Virtqueue[]>(num_queues_);
+    dev_->transport_ = this;
+}
+
+VirtioMmio::~VirtioMmio() {
+    // Let in-flight work finish, and the device's own threads go away,
+    // while the queues and IRQ line still exist
+    dev_->reset();
+    dev_.reset();
+}
+
+bool VirtioMmio::read(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t& out) {
+    std::lock_guard<std::mutex> lock(mu_);
+
+    out = 0;
+    const std::uint32_t off = off_(addr);
+    if (off >= CONFIG_OFF) {
+        if (width_bytes != 1 && width_bytes != 2 && width_bytes != 4) return false;
+        std::uint8_t bytes[4] = {};
+        dev_->read_config(off - CONFIG_OFF, std::span<std::uint8_t>(bytes, width_bytes));
+        std::memcpy(&out, bytes, width_bytes); // little-endian host
+        return true;
+    }
+    if (width_bytes != 4 || (off & 3) != 0) return false;
+    return kRegs_.read(*this, off, out);
+}
+
+bool VirtioMmio::write(std::uint32_t addr, std::uint32_t width_bytes, std::uint32_t val) {
+    std::lock_guard<std::mutex> lock(mu_);
+
+    const std::uint32_t off = off_(addr);
+    if (off >= CONFIG_OFF) {
+        if (width_bytes != 1 && width_bytes != 2 && width_bytes != 4) return false;
+        std::uint8_t bytes[4] = {};
+        std::memcpy(bytes, &val, width_bytes);
+        dev_->write_config(off - CONFIG_OFF, std::span<const std::uint8_t>(bytes, width_bytes));
+        return true;
+    }
+    if (width_bytes != 4 || (off & 3) != 0) return false;
+    return kRegs_.write(*this, off, val);
+}
+
+void VirtioMmio::raise_interrupt_(std::uint32_t cause) {
+    std::lock_guard<std::mutex> lock(irq_mu_);
+    const bool was = interrupt_status_ != 0;
+    interrupt_status_ |= cause;
+    if (!was && set_irq_) set_irq_(true);
+}
+
+void VirtioMmio::ack_interrupt_(std::uint32_t cause) {
+    std::lock_guard<std::mutex> lock(irq_mu_);
+    const bool was = interrupt_status_ != 0;
+    interrupt_status_ &= ~cause;
+    if (was && interrupt_status_ == 0 && set_irq_) set_irq_(false);
+}
+
+void VirtioMmio::reset_() {
+    // The device first stops touching the rings (waiting out in-flight
+    // I/O), then the rings go away.
+    dev_->reset();
+    for (std::uint32_t q = 0; q < num_queues_; ++q) queues_[q].reset();
+
+    driver_features_ = 0;
+    dev_features_sel_ = 0;
+    drv_features_sel_ = 0;
+    queue_sel_ = 0;
+    status_ = 0;
+    ack_interrupt_(INT_USED | INT_CONFIG);
+}
+
+void VirtioMmio::set_status_(std::uint32_t val) {
+    if (val == 0) {
+        reset_();
+        return;
+    }
+
+    // FEATURES_OK only sticks if the driver accepted a subset of what was
+    // offered, including VERSION_1 (no legacy interface here).
+    if ((val & STATUS_FEATURES_OK) && !(status_ & STATUS_FEATURES_OK)) {
+        const bool subset = (driver_features_ & ~device_features_) == 0;
+        if (!subset || !has_feature(virtio::F_VERSION_1)) val &= ~STATUS_FEATURES_OK;
+    }
+
+    const bool activate = (val & STATUS_DRIVER_OK) && !(status_ & STATUS_DRIVER_OK);
+    status_ = val | (status_ & STATUS_DEVICE_NEEDS_RESET);
+    if (activate) dev_->activate();
+}
+
+Virtqueue* VirtioMmio::selected_() {
+    return queue_sel_ < num_queues_ ? &queues_[queue_sel_] : nullptr;
+}
+
+// ---------------- Register handlers (called with mu_ held) ----------------
+
+bool VirtioMmio::magic_read_(std::uint32_t, std::uint32_t& out) {
+    out = MAGIC;
+    return true;
+}
+
+bool VirtioMmio::version_read_(std::uint32_t, std::uint32_t& out) {
+    out = VERSION;
+    return true;
+}
+
+bool VirtioMmio::device_id_read_(std::uint32_t, std::uint32_t& out) {
+    out = dev_->device_id();
+    return true;
+}
+
+bool VirtioMmio::vendor_id_read_(std::uint32_t, std::uint32_t& out) {
+    out = VENDOR_ID;
+    return true;
+}
+
+bool VirtioMmio::dev_features_read_(std::uint32_t, std::uint32_t& out) {
+    out = dev_features_sel_ < 2
+              ? static_cast<std::uint32_t>(device_features_ >> (32u * dev_features_sel_))
+              : 0;
+    return true;
+}
+
+bool VirtioMmio::dev_features_sel_write_(std::uint32_t, std::uint32_t val) {
+    dev_features_sel_ = val;
+    return true;
+}
+
+bool VirtioMmio::drv_features_write_(std::uint32_t, std::uint32_t val) {
+    // Features are frozen once FEATURES_OK is set
+    if (drv_features_sel_ >= 2 || (status_ & STATUS_FEATURES_OK)) return true;
+    const unsigned shift = 32u * drv_features_sel_;
+    driver_features_ = (driver_features_ & ~(0xFFFF'FFFFull << shift)) |
+                       (static_cast<std::uint64_t>(val) << shift);
+    return true;
+}
+
+bool VirtioMmio::drv_features_sel_write_(std::uint32_t, std::uint32_t val) {
+    drv_features_sel_ = val;
+    return true;
+}
+
+bool VirtioMmio::queue_sel_write_(std::uint32_t, std::uint32_t val) {
+    queue_sel_ = val;
+    return true;
+}
+
+bool VirtioMmio::queue_num_max_read_(std::uint32_t, std::uint32_t& out) {
+    out = queue_sel_ < num_queues_ ? dev_->queue_max_size(queue_sel_) : 0;
+    return true;
+}
+
+bool VirtioMmio::queue_num_write_(std::uint32_t, std::uint32_t val) {
+    Virtqueue* q = selected_();
+    if (q && !q->ready() && val <= dev_->queue_max_size(queue_sel_)) {
+        q->set_size(static_cast<std::uint16_t>(val));
+    }
+    return true;
+}
+
+bool VirtioMmio::queue_ready_read_(std::uint32_t, std::uint32_t& out) {
+    const Virtqueue* q = selected_();
+    out = (q && q->ready()) ? 1u : 0u;
+    return true;
+}
+
+bool VirtioMmio::queue_ready_write_(std::uint32_t, std::uint32_t val) {
+    Virtqueue* q = selected_();
+    if (q == nullptr) return true;
+    if (val & 1u) {
+        // A bad size or ring address leaves the queue disabled, which the
+        // driver sees when it reads QueueReady back.
+        if (!q->ready()) q->enable(bus_, has_feature(virtio::F_RING_EVENT_IDX));
+    } else if (q->ready()) {
+        // Per-queue reset isn't negotiated; treat it like a device reset
+        reset_();
+    }
+    return true;
+}
+
+bool VirtioMmio::queue_notify_write_(std::uint32_t, std::uint32_t val) {
+    if (val >= num_queues_ || !(status_ & STATUS_DRIVER_OK)) return true;
+    if (!queues_[val].ready()) return true;
+
+    dev_->queue_notify(val);
+
+    // A malformed chain stops the queue until the driver resets us
+    if (queues_[val].broken() && !(status_ & STATUS_DEVICE_NEEDS_RESET)) {
+        status_ |= STATUS_DEVICE_NEEDS_RESET;
+        raise_interrupt_(INT_CONFIG);
+    }
+    return true;
+}
+
+bool VirtioMmio::int_status_read_(std::uint32_t, std::uint32_t& out) {
+    std::lock_guard<std::mutex> lock(irq_mu_);
+    out = interrupt_status_;
+    return true;
+}
+
+bool VirtioMmio::int_ack_write_(std::uint32_t, std::uint32_t val) {
+    ack_interrupt_(val & (INT_USED | INT_CONFIG));
+    return true;
+}
+
+bool VirtioMmio::status_read_(std::uint32_t, std::uint32_t& out) {
+    out = status_;
+    return true;
+}
+
+bool VirtioMmio::status_write_(std::uint32_t, std::uint32_t val) {
+    set_status_(val & 0xFFu);
+    return true;
+}
+
+bool VirtioMmio::queue_addr_write_(std::uint32_t off, std::uint32_t val) {
+    Virtqueue* q = selected_();
+    if (q == nullptr || q->ready()) return true;
+
+    // 0x80/0x84 desc, 0x90/0x94 driver (avail), 0xa0/0xa4 device (used)
+    const bool high = (off & 4u) != 0;
+    auto merge = [&](std::uint64_t cur) {
+        return high ? ((cur & 0xFFFF'FFFFull) | (static_cast<std::uint64_t>(val) << 32))
+                    : ((cur & ~0xFFFF'FFFFull) | val);
+    };
+    switch (off & ~4u) {
+        case 0x80: q->set_desc_addr(merge(q->desc_addr())); break;
+        case 0x90: q->set_avail_addr(merge(q->avail_addr())); break;
+        case 0xA0: q->set_used_addr(merge(q->used_addr())); break;
+        default: break;
+    }
+    return true;
+}
+
+bool VirtioMmio::config_gen_read_(std::uint32_t, std::uint32_t& out) {
+    out = config_generation_.load(std::memory_order_relaxed);
+    return true;
+}
+
+} // namespace remu::devices
@@ -0,0 +1,134 @@
+#include <remu/devices/virtio/virtio_net.hpp>
+
+#include <cstring>
+
+#include <remu/devices/virtio/iov.hpp>
+
+namespace remu::devices {
+
+namespace {
+// Feature bits (virtio 1.x, 5.1.3)
+constexpr std::uint64_t VIRTIO_NET_F_MAC    = 1ull << 5;
+constexpr std::uint64_t VIRTIO_NET_F_STATUS = 1ull << 16;
+
+constexpr std::uint16_t VIRTIO_NET_S_LINK_UP = 1;
+
+// struct virtio_net_hdr with VERSION_1: flags, gso_type (u8), hdr_len,
+// gso_size, csum_start, csum_offset, num_buffers (u16)
+constexpr std::size_t HEADER_LEN = 12;
+constexpr std::size_t NUM_BUFFERS_OFF = 10;
+
+// Config space: mac[6], status (u16)
+constexpr std::uint32_t CONFIG_LEN = 8;
+} // namespace
+
+VirtioNet::VirtioNet(const Mac& mac, std::unique_ptr<NetBackend> backend)
+    : mac_(mac), backend_(std::move(backend)) {
+    tx_chains_.resize(kTxBatch);
+    backend_->set_receiver(this);
+}
+
+VirtioNet::~VirtioNet() {
+    // Nothing may call receive() once we start going away
+    backend_->set_receiver(nullptr);
+    backend_.reset();
+}
+
+std::uint64_t VirtioNet::device_features() const {
+    return VIRTIO_NET_F_MAC | VIRTIO_NET_F_STATUS;
+}
+
+void VirtioNet::read_config(std::uint32_t off, std::span<std::uint8_t> out) {
+    std::uint8_t layout[CONFIG_LEN] = {};
+    std::memcpy(layout, mac_.data(), mac_.size());
+    const std::uint16_t status = VIRTIO_NET_S_LINK_UP;
+    std::memcpy(layout + 6, &status, 2);
+    copy_config(layout, off, out);
+}
+
+void VirtioNet::activate() {
+    {
+        std::lock_guard<std::mutex> lock(rx_mu_);
+        rx_enabled_ = true;
+    }
+    backend_->rx_buffers_posted();
+}
+
+void VirtioNet::queue_notify(std::uint32_t q) {
+    if (q == kTxQueue) {
+        transmit_();
+    } else if (q == kRxQueue) {
+        backend_->rx_buffers_posted();
+    }
+}
+
+void VirtioNet::reset() {
+    // Waits out a receive() in progress; later ones see the device disabled
+    std::lock_guard<std::mutex> lock(rx_mu_);
+    rx_enabled_ = false;
+    rx_unsignalled_.store(false, std::memory_order_relaxed);
+}
+
+// ---------------- Guest -> backend (hart thread) ----------------
+
+void VirtioNet::transmit_() {
+    Virtqueue& txq = queue(kTxQueue);
+    while (true) {
+        std::size_t n = 0;
+        while (n < kTxBatch && txq.pop(tx_chains_[n])) ++n;
+        if (n == 0) return;
+
+        // The frames stay in guest RAM until the backend is done with the
+        // batch; only then are the buffers handed back
+        for (std::size_t i = 0; i < n; ++i) {
+            const VirtqChain& c = tx_chains_[i];
+            if (c.out_len <= HEADER_LEN) continue;
+            iov_slice(c.out, HEADER_LEN, c.out_len - HEADER_LEN, tx_frame_);
+            backend_->send(tx_frame_, c.out_len - HEADER_LEN);
+        }
+        backend_->end_batch();
+
+        for (std::size_t i = 0; i < n; ++i) txq.push(tx_chains_[i], 0);
+        notify_used(kTxQueue);
+    }
+}
+
+// ---------------- Backend -> guest (any thread) ----------------
+
+bool VirtioNet::receive(const Fill& fill) {
+    std::lock_guard<std::mutex> lock(rx_mu_);
+    if (!rx_enabled_) return false;
+    Virtqueue& rxq = queue(kRxQueue);
+    if (!rxq.pop(rx_chain_)) return false;
+
+    if (rx_chain_.in_len <= HEADER_LEN) {
+        rxq.push(rx_chain_, 0); // useless buffer; hand it back empty
+        rx_unsignalled_.store(true, std::memory_order_relaxed);
+        return false;
+    }
+
+    std::uint8_t header[HEADER_LEN] = {};
+    const std::uint16_t num_buffers = 1;
+    std::memcpy(header + NUM_BUFFERS_OFF, &num_buffers, 2);
+    iov_from_buf(rx_chain_.in, header, HEADER_LEN);
+
+    iov_slice(rx_chain_.in, HEADER_LEN, rx_chain_.in_len - HEADER_LEN, rx_frame_);
+    const ssize_t n = fill(rx_frame_);
+    if (n <= 0) {
+        // No frame after all (e.g. an oversized one was dropped): hand the
+        // buffer back empty rather than as an empty frame
+        rxq.push(rx_chain_, 0);
+        rx_unsignalled_.store(true, std::memory_order_relaxed);
+        return false;
+    }
+
+    rxq.push(rx_chain_, static_cast<std::uint32_t>(HEADER_LEN + static_cast<std::size_t>(n)));
+    rx_unsignalled_.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void VirtioNet::flush_rx() {
+    if (rx_unsignalled_.exchange(false, std::memory_order_relaxed)) notify_used(kRxQueue);
+}
+
+} // namespace remu::devices
@@ -0,0 +1,234 @@
+#include <remu/devices/virtio/virtqueue.hpp>
+
+#include <atomic>
+#include <bit>
+#include <cstring>
+
+#include <remu/mem/bus.hpp>
+#include <remu/mem/memory.hpp>
+
+namespace remu::devices {
+
+static_assert(std::endian::native == std::endian::little,
+              "virtio rings are little-endian and accessed in place");
+
+namespace {
+// Descriptor flags
+constexpr std::uint16_t VIRTQ_DESC_F_NEXT     = 1;
+constexpr std::uint16_t VIRTQ_DESC_F_WRITE    = 2;
+constexpr std::uint16_t VIRTQ_DESC_F_INDIRECT = 4;
+
+// avail->flags
+constexpr std::uint16_t VIRTQ_AVAIL_F_NO_INTERRUPT = 1;
+
+constexpr std::uint32_t DESC_SIZE = 16;
+constexpr std::uint32_t USED_ELEM_SIZE = 8;
+
+// Ring fields shared with the driver on the other hart(s) are accessed
+// atomically in place.
+std::uint16_t load16(const std::uint8_t* p, std::memory_order order) {
+    auto* q = reinterpret_cast<std::uint16_t*>(const_cast<std::uint8_t*>(p));
+    return std::atomic_ref<std::uint16_t>(*q).load(order);
+}
+
+void store16(std::uint8_t* p, std::uint16_t v, std::memory_order order) {
+    std::atomic_ref<std::uint16_t>(*reinterpret_cast<std::uint16_t*>(p)).store(v, order);
+}
+
+// Guest-physical [addr, addr+len) as host memory, or nullptr
+std::uint8_t* resolve(remu::mem::Bus& bus, std::uint64_t addr, std::uint32_t len,
+                      remu::mem::Memory** mem = nullptr) {
+    if (addr > 0xFFFF'FFFFull) return nullptr;
+    const auto a = static_cast<std::uint32_t>(addr);
+    remu::mem::Memory* m = bus.ram_at(a, len);
+    if (m == nullptr) return nullptr;
+    if (mem) *mem = m;
+    return m->view(a, len).data();
+}
+} // namespace
+
+bool Virtqueue::enable(remu::mem::Bus& bus, bool event_idx) {
+    ready_ = false;
+    if (size_ == 0 || size_ > kMaxSize || !std::has_single_bit(size_)) return false;
+    if ((desc_addr_ % 16) != 0 || (avail_addr_ % 2) != 0 || (used_addr_ % 4) != 0) return false;
+
+    const std::uint32_t desc_len  = DESC_SIZE * size_;
+    const std::uint32_t avail_len = 6u + 2u * size_;
+    const std::uint32_t used_len  = 6u + USED_ELEM_SIZE * size_;
+
+    desc_  = resolve(bus, desc_addr_, desc_len);
+    avail_ = resolve(bus, avail_addr_, avail_len);
+    used_  = resolve(bus, used_addr_, used_len, &used_mem_);
+    if (!desc_ || !avail_ || !used_) return false;
+
+    bus_ = &bus;
+    event_idx_ = event_idx;
+    broken_ = false;
+    last_avail_ = 0;
+    {
+        std::lock_guard<std::mutex> lock(used_mu_);
+        used_idx_ = 0;
+        signalled_valid_ = false;
+        ready_ = true;
+    }
+    return true;
+}
+
+void Virtqueue::reset() {
+    std::lock_guard<std::mutex> lock(used_mu_);
+    ready_ = false;
+    broken_ = false;
+    size_ = 0;
+    desc_addr_ = avail_addr_ = used_addr_ = 0;
+    desc_ = nullptr;
+    avail_ = used_ = nullptr;
+    used_mem_ = nullptr;
+    last_avail_ = 0;
+    used_idx_ = 0;
+    signalled_used_ = 0;
+    signalled_valid_ = false;
+}
+
+std::uint16_t Virtqueue::avail_idx_() const {
+    return load16(avail_ + 2, std::memory_order_acquire);
+}
+
+std::uint16_t Virtqueue::avail_flags_() const {
+    return load16(avail_, std::memory_order_relaxed);
+}
+
+std::uint16_t Virtqueue::used_event_() const {
+    return load16(avail_ + 4 + 2u * size_, std::memory_order_relaxed);
+}
+
+void Virtqueue::set_avail_event_(std::uint16_t v) {
+    store16(used_ + 4 + USED_ELEM_SIZE * size_, v, std::memory_order_relaxed);
+}
+
+bool Virtqueue::pop(VirtqChain& chain) {
+    if (!ready_ || broken_) return false;
+
+    std::uint16_t avail = avail_idx_();
+    if (avail == last_avail_) {
+        if (!event_idx_) return false;
+        // Ask for a kick on the next buffer, then re-check so one that
+        // raced with the request isn't missed
+        set_avail_event_(last_avail_);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        avail = avail_idx_();
+        if (avail == last_avail_) return false;
+    }
+    if (static_cast<std::uint16_t>(avail - last_avail_) > size_) {
+        broken_ = true;
+        return false;
+    }
+
+    std::uint16_t head = 0;
+    std::memcpy(&head, avail_ + 4 + 2u * (last_avail_ % size_), 2);
+    ++last_avail_;
+    if (event_idx_) set_avail_event_(last_avail_);
+
+    chain.clear();
+    chain.head = head;
+
+    std::uint16_t idx = head;
+    for (std::uint32_t count = 0;; ++count) {
+        if (idx >= size_ || count >= size_) {
+            broken_ = true;
+            return false;
+        }
+        Desc d{};
+        std::memcpy(&d, desc_ + DESC_SIZE * idx, DESC_SIZE);
+
+        const bool ok = (d.flags & VIRTQ_DESC_F_INDIRECT) ? walk_indirect_(chain, d)
+                                                          : add_buffer_(chain, d);
+        if (!ok) {
+            broken_ = true;
+            return false;
+        }
+        if (!(d.flags & VIRTQ_DESC_F_NEXT)) break;
+        idx = d.next;
+    }
+    return true;
+}
+
+bool Virtqueue::add_buffer_(VirtqChain& chain, const Desc& d) {
+    if (d.len == 0) return true;
+
+    const bool writable = (d.flags & VIRTQ_DESC_F_WRITE) != 0;
+    // Device-readable buffers must all come before the writable ones
+    if (!writable && !chain.in.empty()) return false;
+
+    remu::mem::Memory* mem = nullptr;
+    std::uint8_t* host = resolve(*bus_, d.addr, d.len, &mem);
+    if (host == nullptr) return false;
+
+    if (writable) {
+        chain.in.push_back(iovec{host, d.len});
+        chain.in_ranges.push_back({mem, static_cast<std::uint32_t>(d.addr), d.len});
+        chain.in_len += d.len;
+    } else {
+        chain.out.push_back(iovec{host, d.len});
+        chain.out_len += d.len;
+    }
+    return true;
+}
+
+bool Virtqueue::walk_indirect_(VirtqChain& chain, const Desc& d) {
+    // An indirect descriptor is a table of further descriptors; it can't
+    // itself chain on (NEXT) or be writable.
+    if ((d.flags & (VIRTQ_DESC_F_NEXT | VIRTQ_DESC_F_WRITE)) != 0) return false;
+    if (d.len == 0 || d.len % DESC_SIZE != 0) return false;
+
+    const std::uint8_t* table = resolve(*bus_, d.addr, d.len);
+    if (table == nullptr) return false;
+    const std::uint32_t n = d.len / DESC_SIZE;
+
+    std::uint32_t idx = 0;
+    for (std::uint32_t count = 0;; ++count) {
+        if (idx >= n || count >= n) return false;
+        Desc e{};
+        std::memcpy(&e, table + DESC_SIZE * idx, DESC_SIZE);
+        if (e.flags & VIRTQ_DESC_F_INDIRECT) return false; // no nesting
+        if (!add_buffer_(chain, e)) return false;
+        if (!(e.flags & VIRTQ_DESC_F_NEXT)) return true;
+        idx = e.next;
+    }
+}
+
+void Virtqueue::push(const VirtqChain& chain, std::uint32_t written) {
+    for (const VirtqChain::InRange& r : chain.in_ranges) r.mem->mark_dirty(r.addr, r.len);
+
+    std::lock_guard<std::mutex> lock(used_mu_);
+    if (!ready_) return;
+
+    const std::uint32_t elem[2] = {chain.head, written};
+    std::memcpy(used_ + 4 + USED_ELEM_SIZE * (used_idx_ % size_), elem, sizeof(elem));
+    ++used_idx_;
+    store16(used_ + 2, used_idx_, std::memory_order_release);
+    used_mem_->mark_dirty(static_cast<std::uint32_t>(used_addr_), 6u + USED_ELEM_SIZE * size_);
+}
+
+bool Virtqueue::should_interrupt() {
+    std::lock_guard<std::mutex> lock(used_mu_);
+    if (!ready_) return false;
+
+    // The used index must be visible before the driver's flags/event are read
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (!event_idx_) return (avail_flags_() & VIRTQ_AVAIL_F_NO_INTERRUPT) == 0;
+
+    const std::uint16_t old_idx = signalled_used_;
+    const bool valid = signalled_valid_;
+    const std::uint16_t new_idx = used_idx_;
+    signalled_used_ = new_idx;
+    signalled_valid_ = true;
+    if (!valid) return true;
+
+    // vring_need_event(): did used_idx step past the driver's used_event?
+    const std::uint16_t event = used_event_();
+    return static_cast<std::uint16_t>(new_idx - event - 1) <
+           static_cast<std::uint16_t>(new_idx - old_idx);
+}
+
+} // namespace remu::devices
@@ -39,4 +39,16 @@ remu::common::Result<long> load_file_into_guest(remu::mem::Memory& ram,
     return remu::common::Result<long>::ok(size);
 }
 
+remu::common::Result<long> load_bytes_into_guest(remu::mem::Memory& mem,
+                                                 std::span<const std::uint8_t> image) {
+    auto dst = mem.bytes();
+    if (image.size() > dst.size()) {
+        return remu::common::Result<long>::err(
+            "image of " + std::to_string(image.size()) + " bytes exceeds the " +
+            std::to_string(dst.size()) + "-byte window");
+    }
+    std::memcpy(dst.data(), image.data(), image.size());
+    return remu::common::Result<long>::ok(static_cast<long>(image.size()));
+}
+
 }  // namespace remu::loaders
@@ -1,16 +1,15 @@
 #include <remu/mem/bus.hpp>
 #include <remu/mem/memory.hpp>   // your Memory class (direct RAM)
 
+#include <algorithm>
+#include <cstring>
+
 namespace remu::mem {
 
 void Bus::map_ram(std::uint32_t base, std::uint32_t size, Memory& ram) {
     regions_.push_back(Region::make_ram(base, size, &ram));
 }
 
-void Bus::map_mmio(std::uint32_t base, std::uint32_t size, MmioDevice& dev) {
-    regions_.push_back(Region::make_mmio(base, size, &dev));
-}
-
 Region* Bus::find_region_(std::uint32_t addr, std::uint32_t len) {
     for (auto& r : regions_) {
         if (r.contains(addr, len)) return &r;
@@ -25,14 +24,6 @@ const Region* Bus::find_region_(std::uint32_t addr, std::uint32_t len) const {
     return nullptr;
 }
 
-bool Bus::mmio_read_(MmioDevice& dev, std::uint32_t addr, std::uint32_t width, std::uint32_t& out) {
-    return dev.read(addr, width, out);
-}
-
-bool Bus::mmio_write_(MmioDevice& dev, std::uint32_t addr, std::uint32_t width, std::uint32_t val) {
-    return dev.write(addr, width, val);
-}
-
 // ---------------- Reads ----------------
 
 bool Bus::read8(std::uint32_t addr, std::uint8_t& out) {
@@ -43,7 +34,7 @@ bool Bus::read8(std::uint32_t addr, std::uint8_t& out) {
         return r->ram->read8(addr, out);
     } else {
         std::uint32_t tmp = 0;
-        if (!mmio_read_(*r->mmio, addr, 1, tmp)) return false;
+        if (!mmio_read_(r->mmio, addr, 1, tmp)) return false;
         out = static_cast<std::uint8_t>(tmp & 0xFFu);
         return true;
     }
@@ -57,7 +48,7 @@ bool Bus::read16(std::uint32_t addr, std::uint16_t& out) {
         return r->ram->read16(addr, out);
     } else {
         std::uint32_t tmp = 0;
-        if (!mmio_read_(*r->mmio, addr, 2, tmp)) return false;
+        if (!mmio_read_(r->mmio, addr, 2, tmp)) return false;
         out = static_cast<std::uint16_t>(tmp & 0xFFFFu);
         return true;
     }
@@ -71,7 +62,7 @@ bool Bus::read32(std::uint32_t addr, std::uint32_t& out) {
         return r->ram->read32(addr, out);
     } else {
         std::uint32_t tmp = 0;
-        if (!mmio_read_(*r->mmio, addr, 4, tmp)) return false;
+        if (!mmio_read_(r->mmio, addr, 4, tmp)) return false;
         out = tmp;
         return true;
     }
@@ -86,7 +77,7 @@ bool Bus::write8(std::uint32_t addr, std::uint8_t val) {
     if (r->kind == Region::Kind::Ram) {
         return r->ram->write8(addr, val);
     } else {
-        return mmio_write_(*r->mmio, addr, 1, static_cast<std::uint32_t>(val));
+        return mmio_write_(r->mmio, addr, 1, static_cast<std::uint32_t>(val));
     }
 }
 
@@ -97,7 +88,7 @@ bool Bus::write16(std::uint32_t addr, std::uint16_t val) {
     if (r->kind == Region::Kind::Ram) {
         return r->ram->write16(addr, val);
     } else {
-        return mmio_write_(*r->mmio, addr, 2, static_cast<std::uint32_t>(val));
+        return mmio_write_(r->mmio, addr, 2, static_cast<std::uint32_t>(val));
     }
 }
 
@@ -108,8 +99,116 @@ bool Bus::write32(std::uint32_t addr, std::uint32_t val) {
     if (r->kind == Region::Kind::Ram) {
         return r->ram->write32(addr, val);
     } else {
-        return mmio_write_(*r->mmio, addr, 4, val);
+        return mmio_write_(r->mmio, addr, 4, val);
+    }
+}
+
+// ---------------- Bulk access ----------------
+
+std::uint32_t Bus::chunk_len_(const Region& r, std::uint32_t addr, std::uint64_t len) {
+    const std::uint64_t region_end = static_cast<std::uint64_t>(r.base) + r.size;
+    return static_cast<std::uint32_t>(std::min<std::uint64_t>(len, region_end - addr));
+}
+
+bool Bus::fits_address_space_(std::uint32_t addr, std::uint64_t len) {
+    return static_cast<std::uint64_t>(addr) + len <= (1ull << 32);
+}
+
+std::span<std::uint8_t> Bus::translate(std::uint32_t addr, std::uint32_t len) {
+    if (len == 0) return {};
+
+    Region* r = find_region_(addr, len);
+    if (!r || r->kind != Region::Kind::Ram) return {};
+    return r->ram->view(addr, len);
+}
+
+Memory* Bus::ram_at(std::uint32_t addr, std::uint32_t len) {
+    if (len == 0) return nullptr;
+
+    Region* r = find_region_(addr, len);
+    if (!r || r->kind != Region::Kind::Ram) return nullptr;
+    return r->ram;
+}
+
+bool Bus::read_block(std::uint32_t addr, std::span<std::uint8_t> out) {
+    if (!fits_address_space_(addr, out.size())) return false;
+
+    std::uint64_t done = 0;
+    while (done < out.size()) {
+        const std::uint32_t a = static_cast<std::uint32_t>(addr + done);
+        Region* r = find_region_(a, 1);
+        if (!r) return false;
+
+        const std::uint32_t n = chunk_len_(*r, a, out.size() - done);
+        std::uint8_t* dst = out.data() + done;
+
+        if (r->kind == Region::Kind::Ram) {
+            auto src = r->ram->view(a, n);
+            if (src.empty()) return false;
+            std::memcpy(dst, src.data(), n);
+        } else {
+            for (std::uint32_t i = 0; i < n; ++i) {
+                std::uint32_t tmp = 0;
+                if (!mmio_read_(r->mmio, a + i, 1, tmp)) return false;
+                dst[i] = static_cast<std::uint8_t>(tmp & 0xFFu);
+            }
+        }
+        done += n;
+    }
+    return true;
+}
+
+bool Bus::write_block(std::uint32_t addr, std::span<const std::uint8_t> data) {
+    if (!fits_address_space_(addr, data.size())) return false;
+
+    std::uint64_t done = 0;
+    while (done < data.size()) {
+        const std::uint32_t a = static_cast<std::uint32_t>(addr + done);
+        Region* r = find_region_(a, 1);
+        if (!r) return false;
+
+        const std::uint32_t n = chunk_len_(*r, a, data.size() - done);
+        const std::uint8_t* src = data.data() + done;
+
+        if (r->kind == Region::Kind::Ram) {
+            auto dst = r->ram->view(a, n);
+            if (dst.empty()) return false;
+            std::memcpy(dst.data(), src, n);
+            r->ram->mark_dirty(a, n);
+        } else {
+            for (std::uint32_t i = 0; i < n; ++i) {
+                if (!mmio_write_(r->mmio, a + i, 1, src[i])) return false;
+            }
+        }
+        done += n;
+    }
+    return true;
+}
+
+bool Bus::fill(std::uint32_t addr, std::uint8_t value, std::uint32_t len) {
+    if (!fits_address_space_(addr, len)) return false;
+
+    std::uint64_t done = 0;
+    while (done < len) {
+        const std::uint32_t a = static_cast<std::uint32_t>(addr + done);
+        Region* r = find_region_(a, 1);
+        if (!r) return false;
+
+        const std::uint32_t n = chunk_len_(*r, a, len - done);
+
+        if (r->kind == Region::Kind::Ram) {
+            auto dst = r->ram->view(a, n);
+            if (dst.empty()) return false;
+            std::memset(dst.data(), value, n);
+            r->ram->mark_dirty(a, n);
+        } else {
+            for (std::uint32_t i = 0; i < n; ++i) {
+                if (!mmio_write_(r->mmio, a + i, 1, value)) return false;
+            }
+        }
+        done += n;
     }
+    return true;
 }
 
 } // namespace remu::mem
@@ -1,12 +1,44 @@
 #include <remu/mem/memory.hpp>
 
+#include <bit>
+#include <cstring>
+#include <new>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
 namespace remu::mem {
 
 Memory::Memory(std::uint32_t base, std::uint32_t size_bytes)
-    : base_(base), size_(size_bytes), data_(size_bytes, 0) {}
+    : base_(base), size_(size_bytes) {
+    if (size_ == 0) return;
+    // Zero-filled on first touch; NORESERVE so a large -m doesn't need the
+    // whole size in swap up front
+    void* p = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) throw std::bad_alloc();
+    data_ = static_cast<std::uint8_t*>(p);
+}
+
+Memory::Memory(std::uint32_t base, std::uint32_t size_bytes, std::uint8_t* mapping)
+    : base_(base), size_(size_bytes), data_(mapping), adopted_(true) {}
+
+Memory::~Memory() {
+    if (data_ != nullptr) ::munmap(data_, size_);
+}
 
-std::span<std::uint8_t> Memory::bytes() { return data_; }
-std::span<const std::uint8_t> Memory::bytes() const { return data_; }
+std::span<std::uint8_t> Memory::bytes() { return {data_, size_}; }
+std::span<const std::uint8_t> Memory::bytes() const { return {data_, size_}; }
+
+std::span<std::uint8_t> Memory::view(std::uint32_t paddr, std::uint32_t len) {
+    if (len == 0 || !check_range_(paddr, len)) return {};
+    return bytes().subspan(index_(paddr), len);
+}
+
+std::span<const std::uint8_t> Memory::view(std::uint32_t paddr, std::uint32_t len) const {
+    if (len == 0 || !check_range_(paddr, len)) return {};
+    return bytes().subspan(index_(paddr), len);
+}
 
 bool Memory::check_range_(std::uint32_t paddr, std::uint32_t len) const {
     if (paddr < base_) return false;
@@ -27,44 +59,107 @@ bool Memory::read8(std::uint32_t paddr, std::uint8_t& out) const {
 
 bool Memory::write8(std::uint32_t paddr, std::uint8_t val) {
     if (!check_range_(paddr, 1)) return false;
+    mark_dirty(paddr, 1);
     data_[index_(paddr)] = val;
     return true;
 }
 
+// 16/32-bit accesses are single host loads/stores (the host is little-endian,
+// like the guest), so an aligned word stored by one hart is never seen torn
+// by another
+static_assert(std::endian::native == std::endian::little);
+
 bool Memory::read16(std::uint32_t paddr, std::uint16_t& out) const {
     if (!check_range_(paddr, 2)) return false;
-    const auto i = index_(paddr);
-    out = static_cast<std::uint16_t>(data_[i]) |
-          (static_cast<std::uint16_t>(data_[i + 1]) << 8);
+    std::memcpy(&out, data_ + index_(paddr), sizeof(out));
     return true;
 }
 
 bool Memory::write16(std::uint32_t paddr, std::uint16_t val) {
     if (!check_range_(paddr, 2)) return false;
-    const auto i = index_(paddr);
-    data_[i] = static_cast<std::uint8_t>(val & 0xFF);
-    data_[i + 1] = static_cast<std::uint8_t>((val >> 8) & 0xFF);
+    mark_dirty(paddr, 2);
+    std::memcpy(data_ + index_(paddr), &val, sizeof(val));
     return true;
 }
 
 bool Memory::read32(std::uint32_t paddr, std::uint32_t& out) const {
     if (!check_range_(paddr, 4)) return false;
-    const auto i = index_(paddr);
-    out = static_cast<std::uint32_t>(data_[i]) |
-          (static_cast<std::uint32_t>(data_[i + 1]) << 8) |
-          (static_cast<std::uint32_t>(data_[i + 2]) << 16) |
-          (static_cast<std::uint32_t>(data_[i + 3]) << 24);
+    std::memcpy(&out, data_ + index_(paddr), sizeof(out));
     return true;
 }
 
 bool Memory::write32(std::uint32_t paddr, std::uint32_t val) {
     if (!check_range_(paddr, 4)) return false;
-    const auto i = index_(paddr);
-    data_[i] = static_cast<std::uint8_t>(val & 0xFF);
-    data_[i + 1] = static_cast<std::uint8_t>((val >> 8) & 0xFF);
-    data_[i + 2] = static_cast<std::uint8_t>((val >> 16) & 0xFF);
-    data_[i + 3] = static_cast<std::uint8_t>((val >> 24) & 0xFF);
+    mark_dirty(paddr, 4);
+    std::memcpy(data_ + index_(paddr), &val, sizeof(val));
     return true;
 }
 
+std::uint32_t Memory::discard(std::uint32_t paddr, std::uint32_t len) {
+    if (adopted_ || len == 0 || !check_range_(paddr, len)) return 0;
+
+    // Whole host pages only (which may be larger than the guest's 4 KiB)
+    static const auto host_page = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+    const auto start = reinterpret_cast<std::uintptr_t>(data_ + index_(paddr));
+    const std::uintptr_t first = (start + host_page - 1) & ~(host_page - 1);
+    const std::uintptr_t last = (start + len) & ~(host_page - 1);
+    if (first >= last) return 0;
+
+    if (::madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED) != 0) return 0;
+    // The contents changed (to zeros) as far as a snapshot is concerned
+    mark_dirty(paddr + static_cast<std::uint32_t>(first - start),
+               static_cast<std::uint32_t>(last - first));
+    return static_cast<std::uint32_t>(last - first);
+}
+
+void Memory::enable_dirty_tracking(bool on) {
+    // Off only drops the flag: a store that saw it set may still be marking
+    if (!on) {
+        tracking_.store(false, std::memory_order_release);
+        return;
+    }
+    if (dirty_tracking()) return;
+
+    if (!dirty_) {
+        const std::size_t pages = (static_cast<std::size_t>(size_) + kPageSize - 1) >> kPageShift;
+        dirty_words_ = (pages + 63) / 64;
+        dirty_ = std::make_unique<std::atomic<std::uint64_t>[]>(dirty_words_);
+    }
+    // Start clean, as a fresh bitmap would; a late mark from before the
+    // last disable only over-reports
+    for (std::size_t i = 0; i < dirty_words_; ++i) {
+        dirty_[i].store(0, std::memory_order_relaxed);
+    }
+    tracking_.store(true, std::memory_order_release);
+}
+
+void Memory::mark_dirty_range_(std::uint32_t paddr, std::uint32_t len) {
+    if (!check_range_(paddr, len)) return;
+    const std::size_t first = index_(paddr) >> kPageShift;
+    const std::size_t last  = (index_(paddr) + len - 1) >> kPageShift;
+    for (std::size_t page = first; page <= last; ++page) {
+        mark_dirty_page_(page);
+    }
+}
+
+std::size_t Memory::collect_dirty(std::vector<std::uint32_t>& pages) {
+    if (!dirty_tracking()) return 0;
+
+    const std::size_t before = pages.size();
+    for (std::size_t w = 0; w < dirty_words_; ++w) {
+        // Skip clean words with a plain load; only swap out words that have
+        // something in them, then walk the set bits.
+        if (dirty_[w].load(std::memory_order_relaxed) == 0) continue;
+
+        std::uint64_t bits = dirty_[w].exchange(0, std::memory_order_acq_rel);
+        while (bits != 0) {
+            const auto bit = static_cast<std::size_t>(std::countr_zero(bits));
+            bits &= bits - 1;
+            const std::size_t page = w * 64 + bit;
+            pages.push_back(base_ + static_cast<std::uint32_t>(page << kPageShift));
+        }
+    }
+    return pages.size() - before;
+}
+
 }  // namespace remu::mem
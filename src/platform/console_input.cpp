@@ -1,5 +1,6 @@
 #include <remu/platform/console_input.hpp>
 
+#include <array>
 #include <csignal>
 #include <cstdlib>
 #include <thread>
@@ -14,6 +15,7 @@ namespace remu::platform {
 namespace {
 
 constexpr unsigned char kQuitKey = 0x1D; // Ctrl-]
+constexpr std::size_t kReadChunk = 4096;
 
 termios g_orig_termios{};
 bool g_have_orig_termios = false;
@@ -52,18 +54,34 @@ void enable_raw_mode() {
     tcsetattr(STDIN_FILENO, TCSANOW, &raw);
 }
 
+// Hand `len` bytes to the UART, waiting (without holding anything the hart
+// needs) whenever its input ring is full.
+void forward(remu::devices::UartNs16550* uart, const unsigned char* data, std::size_t len) {
+    std::size_t done = 0;
+    while (done < len) {
+        done += uart->push_rx(data + done, len - done);
+        if (done < len) uart->wait_rx_space();
+    }
+}
+
 void reader_loop(remu::devices::UartNs16550* uart) {
-    unsigned char byte = 0;
+    // Take whatever is available, up to a page, per read() (a paste or a
+    // piped script arrives in large chunks; typing, one byte at a time).
+    std::array<unsigned char, kReadChunk> buf{};
     while (true) {
-        const ssize_t n = ::read(STDIN_FILENO, &byte, 1);
+        const ssize_t n = ::read(STDIN_FILENO, buf.data(), buf.size());
         if (n <= 0) break; // EOF or error on stdin
 
-        if (byte == kQuitKey) {
-            restore_terminal();
-            std::exit(0);
+        const auto len = static_cast<std::size_t>(n);
+        for (std::size_t i = 0; i < len; ++i) {
+            if (buf[i] == kQuitKey) {
+                forward(uart, buf.data(), i);
+                restore_terminal();
+                std::exit(0);
+            }
         }
 
-        uart->inject_rx_byte(byte);
+        forward(uart, buf.data(), len);
     }
 }
 
@@ -0,0 +1,144 @@
+#include <remu/platform/console_output.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include <sys/uio.h>
+
+#include <remu/common/log.hpp>
+
+namespace remu::platform {
+
+namespace {
+
+using remu::common::Result;
+
+std::string errno_message(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+} // namespace
+
+ConsoleOutput::~ConsoleOutput() {
+    close();
+}
+
+Result<void> ConsoleOutput::open(std::string_view spec) {
+    if (thread_.joinable()) return Result<void>::err("console output already open");
+
+    auto channel = open_host_channel(spec);
+    if (!channel) return Result<void>::err(channel.error());
+    channel_ = channel.value();
+
+    thread_ = std::thread(&ConsoleOutput::io_loop_, this);
+    return Result<void>::ok();
+}
+
+void ConsoleOutput::close() {
+    if (thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+    }
+    channel_.close();
+}
+
+void ConsoleOutput::signal_(bool urgent) {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (urgent) urgent_ = true;
+        else        kick_ = true;
+    }
+    cv_.notify_one();
+}
+
+void ConsoleOutput::wait_for_space_() {
+    signal_(true);
+    std::unique_lock<std::mutex> lock(mu_);
+    space_cv_.wait(lock, [this] {
+        return stop_ || tail_.load(std::memory_order_relaxed) -
+                                head_.load(std::memory_order_acquire) < kRingSize;
+    });
+}
+
+void ConsoleOutput::io_loop_() {
+    std::unique_lock<std::mutex> lock(mu_);
+    while (true) {
+        cv_.wait(lock, [this] { return stop_ || kick_ || urgent_; });
+        // Give a burst without a newline a moment to grow before writing it
+        if (!urgent_ && !stop_) {
+            cv_.wait_for(lock, kFlushDelay, [this] { return stop_ || urgent_; });
+        }
+        kick_ = false;
+        urgent_ = false;
+        const bool stopping = stop_;
+
+        lock.unlock();
+        drain_();
+        lock.lock();
+        space_cv_.notify_all();
+
+        if (stopping) break;
+        // Bytes queued while draining whose producer still saw a non-empty
+        // ring didn't kick us; pick them up without waiting for another.
+        if (tail_.load(std::memory_order_seq_cst) != head_.load(std::memory_order_relaxed)) {
+            kick_ = true;
+        }
+    }
+}
+
+void ConsoleOutput::drain_() {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    const std::size_t tail = tail_.load(std::memory_order_acquire);
+    if (head == tail) return;
+
+    // The pending bytes wrap around the end of the ring at most once
+    const std::size_t start = head & (kRingSize - 1);
+    const std::size_t len = tail - head;
+    const std::size_t first = std::min(len, kRingSize - start);
+
+    if (!failed_ && !write_all_(ring_.data() + start, first, ring_.data(), len - first)) {
+        failed_ = true;
+        remu::common::log_warn(errno_message("Console output failed; discarding further output"));
+    }
+
+    head_.store(tail, std::memory_order_seq_cst);
+}
+
+bool ConsoleOutput::write_all_(const std::uint8_t* a, std::size_t alen,
+                               const std::uint8_t* b, std::size_t blen) {
+    iovec iov[2] = {
+        {const_cast<std::uint8_t*>(a), alen},
+        {const_cast<std::uint8_t*>(b), blen},
+    };
+    iovec* v = iov;
+    int count = blen != 0 ? 2 : 1;
+
+    while (count > 0) {
+        const ssize_t n = ::writev(channel_.write_fd, v, count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        // Skip what was written, resuming mid-segment after a short write
+        auto done = static_cast<std::size_t>(n);
+        while (count > 0 && done >= v->iov_len) {
+            done -= v->iov_len;
+            ++v;
+            --count;
+        }
+        if (count > 0) {
+            v->iov_base = static_cast<std::uint8_t*>(v->iov_base) + done;
+            v->iov_len -= done;
+        }
+    }
+    return true;
+}
+
+} // namespace remu::platform
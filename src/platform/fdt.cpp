@@ -0,0 +1,118 @@
+#include <remu/platform/fdt.hpp>
+
+#include <cassert>
+
+namespace remu::platform {
+
+namespace {
+constexpr std::uint32_t FDT_MAGIC      = 0xD00D'FEEDu;
+constexpr std::uint32_t FDT_VERSION    = 17;
+constexpr std::uint32_t FDT_LAST_COMP  = 16;
+constexpr std::uint32_t FDT_HEADER_LEN = 40;
+constexpr std::uint32_t FDT_RSVMAP_LEN = 16; // just the terminating entry
+
+constexpr std::uint32_t FDT_BEGIN_NODE = 1;
+constexpr std::uint32_t FDT_END_NODE   = 2;
+constexpr std::uint32_t FDT_PROP       = 3;
+constexpr std::uint32_t FDT_END        = 9;
+
+void put_be32(std::vector<std::uint8_t>& out, std::uint32_t v) {
+    out.push_back(static_cast<std::uint8_t>(v >> 24));
+    out.push_back(static_cast<std::uint8_t>(v >> 16));
+    out.push_back(static_cast<std::uint8_t>(v >> 8));
+    out.push_back(static_cast<std::uint8_t>(v));
+}
+} // namespace
+
+void FdtBuilder::token_(std::uint32_t tok) {
+    u32_(tok);
+}
+
+void FdtBuilder::u32_(std::uint32_t v) {
+    put_be32(struct_, v);
+}
+
+void FdtBuilder::pad_() {
+    while (struct_.size() % 4 != 0) struct_.push_back(0);
+}
+
+std::uint32_t FdtBuilder::name_offset_(std::string_view name) {
+    const auto [it, inserted] =
+        string_offsets_.try_emplace(std::string(name), static_cast<std::uint32_t>(strings_.size()));
+    if (inserted) {
+        strings_.append(name);
+        strings_.push_back('\0');
+    }
+    return it->second;
+}
+
+void FdtBuilder::begin_node(std::string_view name) {
+    token_(FDT_BEGIN_NODE);
+    struct_.insert(struct_.end(), name.begin(), name.end());
+    struct_.push_back(0);
+    pad_();
+    ++depth_;
+}
+
+void FdtBuilder::end_node() {
+    assert(depth_ > 0);
+    token_(FDT_END_NODE);
+    --depth_;
+}
+
+void FdtBuilder::prop(std::string_view name, std::span<const std::uint8_t> value) {
+    token_(FDT_PROP);
+    u32_(static_cast<std::uint32_t>(value.size()));
+    u32_(name_offset_(name));
+    struct_.insert(struct_.end(), value.begin(), value.end());
+    pad_();
+}
+
+void FdtBuilder::prop_cells(std::string_view name, std::initializer_list<std::uint32_t> cells) {
+    prop_cells(name, std::span<const std::uint32_t>(cells.begin(), cells.size()));
+}
+
+void FdtBuilder::prop_cells(std::string_view name, std::span<const std::uint32_t> cells) {
+    std::vector<std::uint8_t> bytes;
+    bytes.reserve(cells.size() * 4);
+    for (std::uint32_t c : cells) put_be32(bytes, c);
+    prop(name, bytes);
+}
+
+void FdtBuilder::prop_string(std::string_view name, std::string_view value) {
+    prop_strings(name, {value});
+}
+
+void FdtBuilder::prop_strings(std::string_view name, std::initializer_list<std::string_view> values) {
+    std::vector<std::uint8_t> bytes;
+    for (std::string_view v : values) {
+        bytes.insert(bytes.end(), v.begin(), v.end());
+        bytes.push_back(0);
+    }
+    prop(name, bytes);
+}
+
+std::vector<std::uint8_t> FdtBuilder::finish(std::uint32_t boot_cpuid) {
+    assert(depth_ == 0);
+    token_(FDT_END);
+
+    const auto struct_len = static_cast<std::uint32_t>(struct_.size());
+    const auto strings_len = static_cast<std::uint32_t>(strings_.size());
+    const std::uint32_t off_rsvmap = FDT_HEADER_LEN;             // 8-byte aligned
+    const std::uint32_t off_struct = off_rsvmap + FDT_RSVMAP_LEN;
+    const std::uint32_t off_strings = off_struct + struct_len;
+    const std::uint32_t total = off_strings + strings_len;
+
+    std::vector<std::uint8_t> out;
+    out.reserve(total);
+    for (std::uint32_t v : {FDT_MAGIC, total, off_struct, off_strings, off_rsvmap,
+                            FDT_VERSION, FDT_LAST_COMP, boot_cpuid, strings_len, struct_len}) {
+        put_be32(out, v);
+    }
+    out.resize(out.size() + FDT_RSVMAP_LEN, 0);
+    out.insert(out.end(), struct_.begin(), struct_.end());
+    out.insert(out.end(), strings_.begin(), strings_.end());
+    return out;
+}
+
+} // namespace remu::platform
@@ -0,0 +1,98 @@
+#include <remu/platform/host_channel.hpp>
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <remu/common/log.hpp>
+
+namespace remu::platform {
+
+namespace {
+
+using remu::common::Result;
+
+std::string errno_message(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+Result<int> open_unix_socket(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        return Result<int>::err("unix socket path too long: " + path);
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return Result<int>::err(errno_message("socket"));
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+        auto r = Result<int>::err(errno_message("connect " + path));
+        ::close(fd);
+        return r;
+    }
+    return Result<int>::ok(fd);
+}
+
+} // namespace
+
+void HostChannel::close() {
+    if (owns_fds) {
+        if (read_fd >= 0 && read_fd != write_fd) ::close(read_fd);
+        if (write_fd >= 0) ::close(write_fd);
+    }
+    read_fd = write_fd = -1;
+    owns_fds = false;
+}
+
+Result<HostChannel> open_host_channel(std::string_view spec) {
+    using R = Result<HostChannel>;
+
+    const auto arg = [&](std::string_view prefix) {
+        return std::string(spec.substr(prefix.size()));
+    };
+
+    HostChannel ch;
+    if (spec == "stdout") {
+        ch.write_fd = STDOUT_FILENO;
+        return R::ok(ch);
+    }
+
+    ch.owns_fds = true;
+    if (spec.starts_with("file:")) {
+        const std::string path = arg("file:");
+        ch.write_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (ch.write_fd < 0) return R::err(errno_message("open " + path));
+        return R::ok(ch);
+    }
+
+    if (spec.starts_with("pipe:")) {
+        const std::string path = arg("pipe:");
+        if (::mkfifo(path.c_str(), 0644) != 0 && errno != EEXIST) {
+            return R::err(errno_message("mkfifo " + path));
+        }
+        remu::common::log_info("Waiting for a reader on " + path);
+        ch.write_fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+        if (ch.write_fd < 0) return R::err(errno_message("open " + path));
+    } else if (spec.starts_with("unix:")) {
+        auto fd = open_unix_socket(arg("unix:"));
+        if (!fd) return R::err(fd.error());
+        ch.read_fd = ch.write_fd = fd.value();
+    } else {
+        return R::err("unknown host endpoint '" + std::string(spec) +
+                      "' (expected stdout, file:PATH, pipe:PATH or unix:PATH)");
+    }
+
+    // A reader that goes away should surface as EPIPE, not kill the process
+    std::signal(SIGPIPE, SIG_IGN);
+    return R::ok(ch);
+}
+
+} // namespace remu::platform
@@ -1,5 +1,14 @@
 #include <remu/platform/virt.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include <remu/platform/fdt.hpp>
+
 namespace remu::platform {
 
 namespace memmap {
@@ -11,12 +20,38 @@ static constexpr std::uint32_t CLINT_SIZE =
 static constexpr std::uint32_t PLIC_BASE = 0x0C00'0000;
 static constexpr std::uint32_t PLIC_SIZE =
     0x0400'0000;  // stub big window (you can refine later)
+// PLIC contexts, QEMU virt order: hart0 M-mode, hart0 S-mode, hart1 M-mode
+// and so on. Context 0 is the one mini.dtb's interrupts-extended lists.
+static constexpr std::uint32_t PLIC_CONTEXTS_PER_HART = 2;
+constexpr std::uint32_t plic_ctx_m(std::uint32_t hart) { return PLIC_CONTEXTS_PER_HART * hart; }
+constexpr std::uint32_t plic_ctx_s(std::uint32_t hart) { return PLIC_CONTEXTS_PER_HART * hart + 1; }
 
 static constexpr std::uint32_t UART_BASE = 0x1000'0000;
 static constexpr std::uint32_t UART_SIZE =
     0x0000'0100;  // 256 bytes window typical
 static constexpr std::uint32_t UART_IRQ = 10;  // must match the DTB's uart "interrupts" cell
 
+// virtio-mmio transports, QEMU virt layout: one 4 KiB window per slot
+static constexpr std::uint32_t VIRTIO_BASE = 0x1000'1000;
+static constexpr std::uint32_t VIRTIO_STRIDE = 0x1000;
+static constexpr std::uint32_t VIRTIO_IRQ_BASE = 1;  // slot n -> PLIC IRQ 1 + n
+
+// Inter-VM shared memory: register window and PLIC IRQ (the window itself
+// is VirtMachine::kIvshmemShmBase)
+static constexpr std::uint32_t IVSHMEM_BASE = 0x1010'0000;
+static constexpr std::uint32_t IVSHMEM_IRQ = 11;
+
+// SiFive test finisher, also the syscon behind poweroff/reboot (the values
+// are the finisher's pass and reset codes)
+static constexpr std::uint32_t FINISHER_BASE = 0x1110'0000;
+
+// HTIF tohost/fromhost mailbox
+static constexpr std::uint32_t HTIF_BASE = 0x1010'2000;
+
+// Bulk-operation engine
+static constexpr std::uint32_t BULK_BASE = 0x1010'1000;
+static constexpr std::uint32_t BULK_IRQ = 12;
+
 static constexpr std::uint32_t RAM_BASE = 0x8000'0000;
 static constexpr std::uint32_t DTB_SIZE = 2 * 1024 * 1024;  // 2 MiB for DTB
 
@@ -24,20 +59,52 @@ static constexpr std::uint32_t MIP_MSIP =
     (1u << 3);  // Machine Software Interrupt Pending
 static constexpr std::uint32_t MIP_MTIP =
     (1u << 7);  // Machine Timer Interrupt Pending
+static constexpr std::uint32_t MIP_SEIP = (1u << 9);  // Supervisor External Interrupt Pending
 static constexpr std::uint32_t MIP_MEIP = (1u << 11); // Machine External Interrupt Pending
+
+// Upper bound on one realtime WFI sleep, as a backstop for wake-ups that
+// don't go through the PLIC.
+static constexpr auto MAX_IDLE_SLEEP = std::chrono::milliseconds(100);
+
+// WRS waits: host yields before parking, the re-check interval while
+// parked (plain stores to the reserved word don't wake the hart), and the
+// WRS.STO timeout
+static constexpr int WRS_SPIN_YIELDS = 64;
+static constexpr auto WRS_POLL = std::chrono::microseconds(50);
+static constexpr auto WRS_STO_TIMEOUT = std::chrono::microseconds(500);
+
+// Realtime mode: instructions between host clock polls for due events
+// (a few microseconds of guest execution).
+static constexpr std::uint64_t REALTIME_POLL_INTERVAL = 1024;
 }  // namespace memmap
 
-VirtMachine::VirtMachine(std::uint32_t mem_size_bytes)
-    : ram_base_(memmap::RAM_BASE),
+VirtMachine::VirtMachine(std::uint32_t mem_size_bytes, std::uint32_t harts)
+    : num_harts_(std::clamp<std::uint32_t>(harts, 1, kMaxHarts)),
+      ram_base_(memmap::RAM_BASE),
       mem_size_bytes_(mem_size_bytes),
       dtb_base_(memmap::RAM_BASE + mem_size_bytes_),  // place DTB at end of RAM
       ram_(ram_base_, mem_size_bytes_),
       dtb_(dtb_base_, memmap::DTB_SIZE),  // 2 MiB DTB memory
       bus_(),
+      harts_(std::make_unique<Hart[]>(num_harts_)),
       uart_(),
-      clint_(),
-      plic_() 
-      {
+      clint_(num_harts_),
+      plic_(memmap::PLIC_CONTEXTS_PER_HART * num_harts_),
+      htif_(bus_),
+      bulk_(bus_) {
+    for (std::uint32_t h = 0; h < num_harts_; ++h) {
+        harts_[h].id = h;
+        harts_[h].cpu.reservations = &reservations_;
+    }
+    if (num_harts_ > 1) bus_.set_device_lock(&device_mu_);
+    // An SC or AMO wakes the harts waiting in WRS on its line
+    reservations_.set_watch_hook([this](std::uint32_t line) {
+        for (std::uint32_t h = 0; h < num_harts_; ++h) {
+            if (harts_[h].wrs_line.load(std::memory_order_relaxed) == line) {
+                harts_[h].wakeup.notify();
+            }
+        }
+    });
     map_devices_();
 }
 
@@ -55,34 +122,448 @@ void VirtMachine::map_devices_() {
         else          plic_.clear_irq(memmap::UART_IRQ);
     });
 
+    // Interrupt state changes (from any thread) get serviced before the
+    // next instruction, and end a WFI sleep. Any hart's contexts may have
+    // changed, so every hart re-checks.
+    plic_.set_change_hook([this] { kick_all_(); });
+
+    // Host console input: have a hart pull it into the RX FIFO, and end a
+    // WFI sleep
+    uart_.set_rx_doorbell([this] {
+        harts_[0].service_pending.store(true, std::memory_order_release);
+        harts_[0].wakeup.notify();
+    });
+
+    // Timer compares run off the event queue; msip/mtip changes go to the
+    // hart they belong to (an IPI wakes a sleeping target)
+    clint_.attach(events_, [this](std::uint32_t hart) {
+        harts_[hart].service_pending.store(true, std::memory_order_relaxed);
+        harts_[hart].wakeup.notify();
+    });
+
+    // Pull the service point forward when something schedules an earlier
+    // event; any hart may be the one to fire it
+    events_.set_rearm_hook([this] {
+        for (std::uint32_t h = 0; h < num_harts_; ++h) {
+            harts_[h].service_pending.store(true, std::memory_order_relaxed);
+        }
+    });
+
     // // 3) CLINT (mtime/mtimecmp/msip)
     bus_.map_mmio(memmap::CLINT_BASE, memmap::CLINT_SIZE, clint_);
 
     // // 4) PLIC (stub for now)
     bus_.map_mmio(memmap::PLIC_BASE, memmap::PLIC_SIZE, plic_);
+
+    // 5) Test finisher / syscon and HTIF: guest-requested exits
+    finisher_.set_exit_hook([this](remu::devices::GuestExit kind, std::uint32_t code) {
+        request_exit(kind, code);
+    });
+    htif_.set_exit_hook([this](remu::devices::GuestExit kind, std::uint32_t code) {
+        request_exit(kind, code);
+    });
+    bus_.map_mmio(memmap::FINISHER_BASE, remu::devices::TestFinisher::kWindowSize, finisher_);
+    bus_.map_mmio(memmap::HTIF_BASE, remu::devices::Htif::kWindowSize, htif_);
+
+    // 6) Bulk-operation engine
+    bus_.map_mmio(memmap::BULK_BASE, remu::devices::BulkOp::kWindowSize, bulk_);
+    bulk_.set_irq_line([this](bool asserted) {
+        if (asserted) plic_.raise_irq(memmap::BULK_IRQ);
+        else          plic_.clear_irq(memmap::BULK_IRQ);
+    });
+}
+
+bool VirtMachine::add_virtio(std::unique_ptr<remu::devices::VirtioDevice> dev) {
+    const auto slot = static_cast<std::uint32_t>(virtio_.size());
+    if (slot >= kVirtioSlots) return false;
+
+    auto transport = std::make_unique<remu::devices::VirtioMmio>(bus_, std::move(dev));
+    const std::uint32_t irq = memmap::VIRTIO_IRQ_BASE + slot;
+    transport->set_irq_line([this, irq](bool asserted) {
+        if (asserted) plic_.raise_irq(irq);
+        else          plic_.clear_irq(irq);
+    });
+    bus_.map_mmio(memmap::VIRTIO_BASE + slot * memmap::VIRTIO_STRIDE,
+                  remu::devices::VirtioMmio::kWindowSize, *transport);
+    virtio_.push_back(std::move(transport));
+    return true;
+}
+
+std::optional<VirtMachine::ExitRequest> VirtMachine::exit_request() const {
+    std::lock_guard<std::mutex> lock(exit_mu_);
+    return exit_request_;
+}
+
+void VirtMachine::request_exit(remu::devices::GuestExit kind, std::uint32_t code) {
+    {
+        std::lock_guard<std::mutex> lock(exit_mu_);
+        if (exit_request_) return;
+        exit_request_ = ExitRequest{kind, code};
+    }
+    halt();
+}
+
+void VirtMachine::halt() {
+    // Have every hart's next tick() service, and report the stop
+    stopping_.store(true, std::memory_order_relaxed);
+    kick_all_();
+}
+
+void VirtMachine::kick_all_() {
+    for (std::uint32_t h = 0; h < num_harts_; ++h) {
+        harts_[h].service_pending.store(true, std::memory_order_relaxed);
+        harts_[h].wakeup.notify();
+    }
+}
+
+bool VirtMachine::add_ivshmem(std::unique_ptr<remu::devices::IvShmem> dev) {
+    if (ivshmem_ || dev->shm().base() != kIvshmemShmBase ||
+        dev->shm().size() > kIvshmemMaxSize) {
+        return false;
+    }
+
+    dev->set_irq_line([this](bool asserted) {
+        if (asserted) plic_.raise_irq(memmap::IVSHMEM_IRQ);
+        else          plic_.clear_irq(memmap::IVSHMEM_IRQ);
+    });
+    bus_.map_ram(kIvshmemShmBase, dev->shm().size(), dev->shm());
+    bus_.map_mmio(memmap::IVSHMEM_BASE, remu::devices::IvShmem::kWindowSize, *dev);
+    ivshmem_ = std::move(dev);
+    return true;
+}
+
+namespace {
+std::string unit_name(const char* node, std::uint32_t addr) {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%s@%x", node, addr);
+    return buf;
 }
+}  // namespace
 
-void VirtMachine::tick(std::uint64_t cycles, remu::cpu::Cpu& cpu) {
-    clint_.tick(cycles);
+std::vector<std::uint8_t> VirtMachine::build_dtb(std::string_view bootargs) const {
+    // Same shape as resources/dtb/mini.dtb (M-mode, no-MMU harts, as the
+    // bundled kernel expects), with the real hart count and RAM size and
+    // whatever virtio devices are attached.
+    FdtBuilder fdt;
+    std::vector<std::uint32_t> cpu_phandles;
+    std::vector<std::uint32_t> intc_phandles;
+    for (std::uint32_t h = 0; h < num_harts_; ++h) {
+        cpu_phandles.push_back(fdt.alloc_phandle());
+        intc_phandles.push_back(fdt.alloc_phandle());
+    }
+    const std::uint32_t plic_phandle = fdt.alloc_phandle();
 
+    fdt.begin_node("");
+    fdt.prop_u32("#address-cells", 2);
+    fdt.prop_u32("#size-cells", 2);
+    fdt.prop_string("compatible", "riscv-minimal-nommu");
+    fdt.prop_string("model", "riscv-minimal-nommu,remu");
+
+    fdt.begin_node("chosen");
+    fdt.prop_string("bootargs", bootargs);
+    fdt.end_node();
+
+    fdt.begin_node(unit_name("memory", ram_base_));
+    fdt.prop_string("device_type", "memory");
+    fdt.prop_cells("reg", {0, ram_base_, 0, mem_size_bytes_});
+    fdt.end_node();
+
+    fdt.begin_node("cpus");
+    fdt.prop_u32("#address-cells", 1);
+    fdt.prop_u32("#size-cells", 0);
+    fdt.prop_u32("timebase-frequency",
+                 static_cast<std::uint32_t>(remu::devices::Clint::kDefaultFreqHz));
+    for (std::uint32_t h = 0; h < num_harts_; ++h) {
+        fdt.begin_node(unit_name("cpu", h));
+        fdt.prop_u32("phandle", cpu_phandles[h]);
+        fdt.prop_string("device_type", "cpu");
+        fdt.prop_u32("reg", h);
+        fdt.prop_string("status", "okay");
+        fdt.prop_string("compatible", "riscv");
+        fdt.prop_string("riscv,isa", "rv32ima_zihintpause_zawrs");
+        fdt.prop_string("mmu-type", "riscv,none");
+        fdt.begin_node("interrupt-controller");
+        fdt.prop_u32("#interrupt-cells", 1);
+        fdt.prop_empty("interrupt-controller");
+        fdt.prop_string("compatible", "riscv,cpu-intc");
+        fdt.prop_u32("phandle", intc_phandles[h]);
+        fdt.end_node();
+        fdt.end_node();  // cpu@h
+    }
+    fdt.begin_node("cpu-map");
+    fdt.begin_node("cluster0");
+    for (std::uint32_t h = 0; h < num_harts_; ++h) {
+        fdt.begin_node("core" + std::to_string(h));
+        fdt.prop_u32("cpu", cpu_phandles[h]);
+        fdt.end_node();
+    }
+    fdt.end_node();
+    fdt.end_node();  // cpu-map
+    fdt.end_node();  // cpus
+
+    fdt.begin_node("soc");
+    fdt.prop_u32("#address-cells", 2);
+    fdt.prop_u32("#size-cells", 2);
+    fdt.prop_string("compatible", "simple-bus");
+    fdt.prop_empty("ranges");
+
+    fdt.begin_node(unit_name("uart", memmap::UART_BASE));
+    fdt.prop_u32("interrupt-parent", plic_phandle);
+    fdt.prop_u32("interrupts", memmap::UART_IRQ);
+    fdt.prop_u32("clock-frequency", 0x100'0000);
+    fdt.prop_cells("reg", {0, memmap::UART_BASE, 0, memmap::UART_SIZE});
+    fdt.prop_string("compatible", "ns16550a");
+    fdt.end_node();
+
+    for (std::uint32_t slot = 0; slot < virtio_.size(); ++slot) {
+        const std::uint32_t base = memmap::VIRTIO_BASE + slot * memmap::VIRTIO_STRIDE;
+        fdt.begin_node(unit_name("virtio_mmio", base));
+        fdt.prop_u32("interrupt-parent", plic_phandle);
+        fdt.prop_u32("interrupts", memmap::VIRTIO_IRQ_BASE + slot);
+        fdt.prop_cells("reg", {0, base, 0, remu::devices::VirtioMmio::kWindowSize});
+        fdt.prop_string("compatible", "virtio,mmio");
+        fdt.end_node();
+    }
+
+    const std::uint32_t syscon_phandle = fdt.alloc_phandle();
+    fdt.begin_node("poweroff");
+    fdt.prop_u32("value", remu::devices::TestFinisher::kPass);
+    fdt.prop_u32("offset", 0);
+    fdt.prop_u32("regmap", syscon_phandle);
+    fdt.prop_string("compatible", "syscon-poweroff");
+    fdt.end_node();
+
+    fdt.begin_node("reboot");
+    fdt.prop_u32("value", remu::devices::TestFinisher::kReset);
+    fdt.prop_u32("offset", 0);
+    fdt.prop_u32("regmap", syscon_phandle);
+    fdt.prop_string("compatible", "syscon-reboot");
+    fdt.end_node();
+
+    fdt.begin_node(unit_name("test", memmap::FINISHER_BASE));
+    fdt.prop_u32("phandle", syscon_phandle);
+    fdt.prop_cells("reg", {0, memmap::FINISHER_BASE, 0, remu::devices::TestFinisher::kWindowSize});
+    fdt.prop_strings("compatible", {"sifive,test1", "sifive,test0", "syscon"});
+    fdt.end_node();
+
+    fdt.begin_node(unit_name("htif", memmap::HTIF_BASE));
+    fdt.prop_cells("reg", {0, memmap::HTIF_BASE, 0, remu::devices::Htif::kWindowSize});
+    fdt.prop_string("compatible", "ucb,htif0");
+    fdt.end_node();
+
+    fdt.begin_node(unit_name("bulkop", memmap::BULK_BASE));
+    fdt.prop_u32("interrupt-parent", plic_phandle);
+    fdt.prop_u32("interrupts", memmap::BULK_IRQ);
+    fdt.prop_cells("reg", {0, memmap::BULK_BASE, 0, remu::devices::BulkOp::kWindowSize});
+    fdt.prop_string("compatible", "remu,bulkop");
+    fdt.end_node();
+
+    if (ivshmem_) {
+        // Registers first, then the shared window
+        fdt.begin_node(unit_name("ivshmem", memmap::IVSHMEM_BASE));
+        fdt.prop_u32("interrupt-parent", plic_phandle);
+        fdt.prop_u32("interrupts", memmap::IVSHMEM_IRQ);
+        fdt.prop_cells("reg", {0, memmap::IVSHMEM_BASE, 0, remu::devices::IvShmem::kWindowSize,
+                               0, kIvshmemShmBase, 0, ivshmem_->shm().size()});
+        fdt.prop_u32("remu,peer", ivshmem_->peer());
+        fdt.prop_string("compatible", "remu,ivshmem");
+        fdt.end_node();
+    }
+
+    // Per hart: software (3) and timer (7) for the CLINT; M-mode external
+    // (11) and S-mode external (9) for the PLIC, in context order
+    std::vector<std::uint32_t> clint_irqs;
+    std::vector<std::uint32_t> plic_irqs;
+    for (const std::uint32_t intc : intc_phandles) {
+        clint_irqs.insert(clint_irqs.end(), {intc, 3, intc, 7});
+        plic_irqs.insert(plic_irqs.end(), {intc, 11, intc, 9});
+    }
+
+    fdt.begin_node(unit_name("clint", memmap::CLINT_BASE));
+    fdt.prop_cells("interrupts-extended", clint_irqs);
+    fdt.prop_cells("reg", {0, memmap::CLINT_BASE, 0, memmap::CLINT_SIZE});
+    fdt.prop_strings("compatible", {"sifive,clint0", "riscv,clint0"});
+    fdt.end_node();
+
+    fdt.begin_node(unit_name("plic", memmap::PLIC_BASE));
+    fdt.prop_u32("phandle", plic_phandle);
+    fdt.prop_u32("riscv,ndev", remu::devices::Plic::kMaxIrq);
+    fdt.prop_cells("reg", {0, memmap::PLIC_BASE, 0, memmap::PLIC_SIZE});
+    fdt.prop_cells("interrupts-extended", plic_irqs);
+    fdt.prop_empty("interrupt-controller");
+    fdt.prop_strings("compatible", {"sifive,plic-1.0.0", "riscv,plic0"});
+    fdt.prop_u32("#address-cells", 0);
+    fdt.prop_u32("#interrupt-cells", 1);
+    fdt.end_node();
+
+    fdt.end_node();  // soc
+    fdt.end_node();  // root
+    return fdt.finish();
+}
+
+void VirtMachine::service_(Hart& hart) {
+    // Cleared with an RMW before polling, as the UART clears rx_ready_: a
+    // doorbell rung after the poll's look at the ring is never lost
+    hart.service_pending.exchange(false, std::memory_order_acq_rel);
+
+    {
+        const auto lock = bus_.device_lock();
+        events_.run_due(clint_.now());
+        uart_.poll_rx();
+
+        if (clint_.timebase() == remu::devices::Timebase::Icount) {
+            // The next deadline, as this hart's tick count
+            const std::uint64_t next = events_.next_deadline();
+            const std::uint64_t now = clint_.icount();
+            hart.service_at = next == remu::common::EventQueue::kNever
+                                  ? next
+                                  : hart.ticks + (next > now ? next - now : 0);
+        } else {
+            hart.service_at = hart.ticks + memmap::REALTIME_POLL_INTERVAL;
+        }
+    }
+
+    update_mip_(hart);
+
+    // Stay pending so every later tick() reports the stop, even if an idle
+    // wait serviced first
+    if (stopping_.load(std::memory_order_relaxed)) {
+        hart.service_pending.store(true, std::memory_order_relaxed);
+    }
+}
+
+void VirtMachine::update_mip_(Hart& hart) {
     // Update CPU mip bits based on CLINT state
+    remu::cpu::Cpu& cpu = hart.cpu;
     std::uint32_t mip = cpu.csr.mip();
 
-    if (clint_.msip_pending())
+    if (clint_.msip_pending(hart.id))
         mip |= memmap::MIP_MSIP;
     else
         mip &= ~memmap::MIP_MSIP;
 
-    if (clint_.mtip_pending())
+    if (clint_.mtip_pending(hart.id))
         mip |= memmap::MIP_MTIP;
     else
         mip &= ~memmap::MIP_MTIP;
 
-    // PLIC → MEIP
-    if (plic_.has_pending_for_hart0()) mip |= memmap::MIP_MEIP;
-    else                               mip &= ~memmap::MIP_MEIP;
+    // PLIC → MEIP/SEIP; SEIP also stays set while software holds it set
+    if (plic_.has_pending(memmap::plic_ctx_m(hart.id))) mip |= memmap::MIP_MEIP;
+    else                                               mip &= ~memmap::MIP_MEIP;
+    if (plic_.has_pending(memmap::plic_ctx_s(hart.id)) || cpu.csr.software_seip())
+        mip |= memmap::MIP_SEIP;
+    else
+        mip &= ~memmap::MIP_SEIP;
 
     cpu.csr.set_mip(mip);
 }
 
+std::uint64_t VirtMachine::idle(Hart& hart) {
+    if (clint_.timebase() == remu::devices::Timebase::Icount) {
+        // Nothing but a scheduled event can wake the hart deterministically
+        const std::uint64_t skipped = skip_idle_time();
+        if (skipped != 0) service_(hart);
+        return skipped;
+    }
+
+    // Realtime: re-check with fresh device state first; anything raised
+    // after this point latches in the hart's wakeup and cuts the sleep short.
+    hart.wakeup.arm();
+    service_(hart);
+    if ((hart.cpu.csr.mip() & hart.cpu.csr.mie()) != 0 ||
+        stopping_.load(std::memory_order_relaxed)) {
+        hart.wakeup.disarm();
+        return 0;
+    }
+
+    std::uint64_t next = 0;
+    {
+        const auto lock = bus_.device_lock();
+        next = events_.next_deadline();
+    }
+    const std::uint64_t before = clint_.now();
+    const auto cap = Wakeup::Clock::now() + memmap::MAX_IDLE_SLEEP;
+    hart.wakeup.wait_until(std::min(clint_.host_time_at(next), cap));
+
+    service_(hart);
+    return clint_.now() - before;
+}
+
+bool VirtMachine::resume(Hart& hart) {
+    service_(hart);
+    return (hart.cpu.csr.mip() & hart.cpu.csr.mie()) != 0;
+}
+
+std::uint64_t VirtMachine::skip_idle_time() {
+    const auto lock = bus_.device_lock();
+    // With nothing scheduled there is nothing to skip to
+    const std::uint64_t next = events_.next_deadline();
+    if (next == remu::common::EventQueue::kNever) return 0;
+    const std::uint64_t skipped = clint_.advance_to(next);
+    if (skipped != 0) events_.run_due(clint_.now());
+    return skipped;
+}
+
+std::uint64_t VirtMachine::wait_reservation(Hart& hart, bool short_timeout) {
+    if (clint_.timebase() != remu::devices::Timebase::Realtime) return 0;
+
+    remu::cpu::Cpu& cpu = hart.cpu;
+    const std::uint32_t addr = cpu.reservation_addr;
+    // The wait is over once the reservation is gone: its line was written
+    // by an SC or AMO (version) or the word itself by a plain store (value).
+    // Only a RAM word is polled; reading MMIO again could have side effects
+    remu::mem::Memory* ram = bus_.ram_at(addr, 4);
+    auto* word = ram != nullptr
+                     ? reinterpret_cast<std::uint32_t*>(ram->view(addr, 4).data())
+                     : nullptr;
+    const auto intact = [&] {
+        return reservations_.version(addr) == cpu.reservation_version &&
+               (word == nullptr || std::atomic_ref<std::uint32_t>(*word).load(
+                                       std::memory_order_relaxed) == cpu.reservation_value);
+    };
+    const auto over = [&] {
+        return (cpu.csr.mip() & cpu.csr.mie()) != 0 ||
+               stopping_.load(std::memory_order_relaxed) || !intact();
+    };
+
+    const std::uint64_t before = clint_.now();
+    hart.wrs_line.store(remu::cpu::ReservationSets::line(addr), std::memory_order_relaxed);
+    reservations_.watch();
+
+    // A holder on another core releases soon; one that lost its core gets
+    // it back
+    bool done = false;
+    for (int i = 0; i < memmap::WRS_SPIN_YIELDS && !done; ++i) {
+        std::this_thread::yield();
+        done = hart.service_pending.load(std::memory_order_relaxed) || over();
+    }
+
+    if (!done) {
+        std::uint64_t next = 0;
+        {
+            const auto lock = bus_.device_lock();
+            next = events_.next_deadline();
+        }
+        const Wakeup::Clock::duration limit =
+            short_timeout ? Wakeup::Clock::duration(memmap::WRS_STO_TIMEOUT)
+                          : Wakeup::Clock::duration(memmap::MAX_IDLE_SLEEP);
+        const auto end = std::min(clint_.host_time_at(next), Wakeup::Clock::now() + limit);
+        for (;;) {
+            // Same latch protocol as idle(): arm, then look
+            hart.wakeup.arm();
+            service_(hart);
+            const auto now = Wakeup::Clock::now();
+            if (over() || now >= end) {
+                hart.wakeup.disarm();
+                break;
+            }
+            hart.wakeup.wait_until(std::min(end, now + memmap::WRS_POLL));
+        }
+    }
+
+    reservations_.unwatch();
+    hart.wrs_line.store(Hart::kNoLine, std::memory_order_relaxed);
+    return clint_.now() - before;
+}
+
 }  // namespace remu::platform
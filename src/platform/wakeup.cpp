@@ -0,0 +1,27 @@
+#include <remu/platform/wakeup.hpp>
+
+namespace remu::platform {
+
+void Wakeup::notify_slow_() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        pending_ = true;
+    }
+    cv_.notify_one();
+}
+
+void Wakeup::arm() {
+    std::lock_guard<std::mutex> lock(mu_);
+    pending_ = false;
+    armed_.store(true, std::memory_order_seq_cst);
+}
+
+bool Wakeup::wait_until(Clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mu_);
+    const bool woken = cv_.wait_until(lock, deadline, [this] { return pending_; });
+    pending_ = false;
+    armed_.store(false, std::memory_order_relaxed);
+    return woken;
+}
+
+} // namespace remu::platform
@@ -0,0 +1,59 @@
+#include <remu/runtime/round_robin.hpp>
+
+#include <algorithm>
+
+namespace remu::runtime {
+
+RoundRobin::RoundRobin(remu::platform::VirtMachine& machine, const Arguments& opts,
+                       std::uint64_t quantum)
+    : machine_(machine), quantum_(std::max<std::uint64_t>(quantum, 1)) {
+    for (std::uint32_t h = 0; h < machine_.num_harts(); ++h) {
+        sims_.push_back(std::make_unique<Sim>(machine_, machine_.hart(h), opts));
+    }
+}
+
+std::vector<RunResult> RoundRobin::run() {
+    for (;;) {
+        bool ran = false;
+        for (std::uint32_t h = 0; h < sims_.size(); ++h) {
+            Sim& sim = *sims_[h];
+            // The other harts moved the clock since this one's last turn
+            const bool interrupt = machine_.resume(machine_.hart(h));
+            if (sim.waiting()) {
+                if (!interrupt) continue;
+                sim.wake();
+            }
+            ran = true;
+            sim.run_slice(quantum_);
+            if (sim.stop_reason() != StopReason::None) break;
+        }
+
+        const bool stopped = std::any_of(sims_.begin(), sims_.end(), [](const auto& sim) {
+            return sim->stop_reason() != StopReason::None;
+        });
+        if (stopped) break;
+        if (ran) continue;
+
+        // Every hart waits in WFI
+        const std::uint64_t skipped = machine_.skip_idle_time();
+        for (auto& sim : sims_) {
+            sim->add_idle(skipped);
+            // Nothing is scheduled to end the wait; WFI may complete anyway
+            if (skipped == 0) sim->wake();
+        }
+    }
+
+    // The others see the halt at their next tick, as hart threads do
+    machine_.halt();
+    std::vector<RunResult> results;
+    for (auto& sim : sims_) {
+        if (sim->stop_reason() == StopReason::None) {
+            sim->wake();
+            sim->run_slice(1);
+        }
+        results.push_back(sim->result());
+    }
+    return results;
+}
+
+} // namespace remu::runtime
@@ -1,21 +1,94 @@
+#include <thread>
+#include <vector>
+
 #include <remu/common/log.hpp>
+#include <remu/cpu/semihosting.hpp>
+#include <remu/devices/virtio/net_unix_dgram.hpp>
+#include <remu/devices/virtio/virtio_9p.hpp>
+#include <remu/devices/virtio/virtio_balloon.hpp>
+#include <remu/devices/virtio/virtio_blk.hpp>
+#include <remu/devices/virtio/virtio_console.hpp>
+#include <remu/devices/virtio/virtio_net.hpp>
 #include <remu/loaders/image_loader.hpp>
 #include <remu/platform/console_input.hpp>
+#include <remu/platform/console_output.hpp>
+#include <remu/platform/host_channel.hpp>
 #include <remu/platform/virt.hpp>
+#include <remu/runtime/round_robin.hpp>
 #include <remu/runtime/runner.hpp>
 #include <remu/runtime/sim.hpp>
 
 namespace remu::runtime {
+
+namespace {
+// Process exit status for a finished run: what the guest asked for, or 1
+// when emulation itself stopped on a fault
+int exit_status(const RunResult& result) {
+    switch (result.reason) {
+        case StopReason::GuestFail: {
+            const int code = static_cast<int>(result.guest_code & 0xFF);
+            return code != 0 ? code : 1;
+        }
+        case StopReason::BusFaultFetch:
+        case StopReason::IllegalInstruction:
+        case StopReason::ExecuteFailed:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Run one hart to completion on the calling thread, then stop the others
+RunResult run_hart(remu::platform::VirtMachine& machine, std::uint32_t hart,
+                   const Arguments& args) {
+    Sim sim(machine, machine.hart(hart), args);
+    const RunResult result = sim.run();
+    machine.halt();
+    return result;
+}
+} // namespace
+
 int run(const Arguments& args) {
     using remu::common::log_error;
     using remu::common::log_info;
 
+    // Guest console output, buffered and written by its own I/O thread
+    remu::platform::ConsoleOutput console_out;
+    if (auto opened = console_out.open(args.console_out); !opened) {
+        log_error("Failed to open console output: " + opened.error());
+        return 1;
+    }
+
     remu::platform::VirtMachine machine(
-        static_cast<uint32_t>(args.mem_size_bytes));
-    remu::cpu::Cpu cpu;
+        static_cast<uint32_t>(args.mem_size_bytes), args.harts);
+
+    machine.uart().set_tx_sink([&console_out](std::uint8_t b) { console_out.put(b); });
+    machine.htif().set_tx_sink([&console_out](std::uint8_t b) { console_out.put(b); });
+
+    // Semihosting: host files for bare-metal programs, console output in
+    // order with the UART's, and exits that stop the run like the finisher
+    remu::cpu::Semihosting semihosting;
+    if (args.semihosting) {
+        semihosting.set_console_sink([&console_out](std::uint8_t b) { console_out.put(b); });
+        semihosting.set_exit_hook([&machine](bool success, std::uint32_t code) {
+            machine.request_exit(success ? remu::devices::GuestExit::Pass
+                                         : remu::devices::GuestExit::Fail,
+                                 code);
+        });
+    }
 
-    // Set up initial CPU state (e.g. PC, a0/a1 for Linux boot convention)
-    cpu.reset(machine.ram_base());
+    machine.clint().set_timebase(args.timebase);
+
+    // Set up initial CPU state: every hart starts at the image with its
+    // hart ID in mhartid (a0/a1 come once the DTB is placed)
+    for (std::uint32_t h = 0; h < machine.num_harts(); ++h) {
+        remu::cpu::Cpu& cpu = machine.hart(h).cpu;
+        cpu.reset(machine.ram_base());
+        cpu.csr.set_mhartid(h);
+        cpu.trap_misaligned = args.trap_misaligned;
+        cpu.csr.set_time_source(remu::cpu::TimeSource::bind(machine.clint()));
+        if (args.semihosting) cpu.semihosting = &semihosting;
+    }
 
     auto size =
         remu::loaders::load_file_into_guest(machine.ram(), args.kernel_path);
@@ -26,8 +99,114 @@ int run(const Arguments& args) {
     log_info("Kernel loaded into guest RAM at 0x8000000 (size: " +
              std::to_string(size.value()) + " bytes)");
 
+    // Block devices, one virtio-mmio slot each
+    for (const DriveSpec& drive : args.drives) {
+        auto blk = remu::devices::VirtioBlk::open(drive.path, drive.read_only);
+        if (!blk) {
+            log_error("Failed to open drive: " + blk.error());
+            return 1;
+        }
+        if (!machine.add_virtio(std::move(blk.value()))) {
+            log_error("Too many virtio devices (at most " +
+                      std::to_string(remu::platform::VirtMachine::kVirtioSlots) + ")");
+            return 1;
+        }
+        log_info("virtio-blk: " + drive.path + (drive.read_only ? " (read-only)" : ""));
+    }
+
+    // One virtio-console with a port per --virtio-console
+    if (!args.console_ports.empty()) {
+        std::vector<remu::devices::VirtioConsole::PortConfig> ports;
+        for (const ConsolePortSpec& spec : args.console_ports) {
+            auto channel = remu::platform::open_host_channel(spec.endpoint);
+            if (!channel) {
+                log_error("Failed to open virtio-console port: " + channel.error());
+                return 1;  // ports opened so far are closed with the process
+            }
+            const auto& ch = channel.value();
+            ports.push_back({spec.name, ch.read_fd, ch.write_fd, ch.owns_fds});
+        }
+        if (!machine.add_virtio(
+                std::make_unique<remu::devices::VirtioConsole>(std::move(ports)))) {
+            log_error("Too many virtio devices (at most " +
+                      std::to_string(remu::platform::VirtMachine::kVirtioSlots) + ")");
+            return 1;
+        }
+        log_info("virtio-console: " + std::to_string(args.console_ports.size()) + " port(s)");
+    }
+
+    // Network devices, each on its own datagram socket
+    for (std::size_t i = 0; i < args.netdevs.size(); ++i) {
+        const NetdevSpec& spec = args.netdevs[i];
+        auto backend = remu::devices::UnixDgramBackend::open(spec.local_path, spec.peer_path);
+        if (!backend) {
+            log_error("Failed to open netdev: " + backend.error());
+            return 1;
+        }
+        remu::devices::VirtioNet::Mac mac = spec.mac;
+        if (!spec.has_mac) {
+            mac = {0x52, 0x54, 0x00, 0x12, 0x34, static_cast<std::uint8_t>(0x56 + i)};
+        }
+        if (!machine.add_virtio(
+                std::make_unique<remu::devices::VirtioNet>(mac, std::move(backend.value())))) {
+            log_error("Too many virtio devices (at most " +
+                      std::to_string(remu::platform::VirtMachine::kVirtioSlots) + ")");
+            return 1;
+        }
+        log_info("virtio-net: " + spec.local_path + " -> " + spec.peer_path);
+    }
+
+    // Shared host directories, one virtio-9p device each
+    for (const ShareSpec& share : args.shares) {
+        auto p9 = remu::devices::Virtio9p::open(share.path, share.tag);
+        if (!p9) {
+            log_error("Failed to open shared directory: " + p9.error());
+            return 1;
+        }
+        if (!machine.add_virtio(std::move(p9.value()))) {
+            log_error("Too many virtio devices (at most " +
+                      std::to_string(remu::platform::VirtMachine::kVirtioSlots) + ")");
+            return 1;
+        }
+        log_info("virtio-9p: " + share.path + " as '" + share.tag + "'");
+    }
+
+    if (args.balloon_bytes) {
+        const auto pages = static_cast<std::uint32_t>(
+            *args.balloon_bytes / remu::devices::VirtioBalloon::kPageSize);
+        if (!machine.add_virtio(
+                std::make_unique<remu::devices::VirtioBalloon>(machine.ram(), pages))) {
+            log_error("Too many virtio devices (at most " +
+                      std::to_string(remu::platform::VirtMachine::kVirtioSlots) + ")");
+            return 1;
+        }
+        log_info("virtio-balloon: target " + std::to_string(pages) + " pages");
+    }
+
+    if (args.ivshmem) {
+        const IvshmemSpec& spec = *args.ivshmem;
+        auto shm = remu::devices::IvShmem::open(
+            spec.name, remu::platform::VirtMachine::kIvshmemShmBase,
+            static_cast<std::uint32_t>(spec.size), spec.peer);
+        if (!shm) {
+            log_error("Failed to open shared memory: " + shm.error());
+            return 1;
+        }
+        if (!machine.add_ivshmem(std::move(shm.value()))) {
+            log_error("Failed to attach shared memory '" + spec.name + "'");
+            return 1;
+        }
+        log_info("ivshmem: '" + spec.name + "' as peer " + std::to_string(spec.peer));
+    }
+
+    // The DTB: a file from -d, or generated to match the machine as built
+    const std::string_view bootargs =
+        args.bootargs.empty() ? remu::platform::VirtMachine::kDefaultBootargs
+                              : std::string_view(args.bootargs);
     auto dtb_size =
-        remu::loaders::load_file_into_guest(machine.dtb(), args.dtb_path);
+        args.dtb_path.empty()
+            ? remu::loaders::load_bytes_into_guest(machine.dtb(), machine.build_dtb(bootargs))
+            : remu::loaders::load_file_into_guest(machine.dtb(), args.dtb_path);
     if (!dtb_size) {
         log_error("Failed to load DTB into guest RAM: " + dtb_size.error());
         return 1;
@@ -35,20 +214,68 @@ int run(const Arguments& args) {
     log_info("DTB loaded into guest RAM at 0x" + std::to_string(machine.dtb_base()) +
              " (size: " + std::to_string(dtb_size.value()) + " bytes)");
 
-    // Set up a0/a1 for Linux boot convention
-    cpu.set_boot_args(0, machine.dtb_base());
+    // Set up a0/a1 for Linux boot convention: each hart gets its own ID
+    // and the shared DTB, and the kernel picks one to boot on
+    for (std::uint32_t h = 0; h < machine.num_harts(); ++h) {
+        machine.hart(h).cpu.set_boot_args(h, machine.dtb_base());
+    }
 
     // Forward host stdin keystrokes into the guest UART so the console is
     // actually interactive (raw terminal mode, one thread per process).
     remu::platform::start_console_input(machine.uart());
 
-    remu::runtime::Sim sim(machine, cpu, args);
-    const auto result = sim.run();
-    log_info("Simulation stopped after " + std::to_string(result.instructions) +
-             " instructions");
-    log_info("Stop reason: " +
-             std::to_string(static_cast<std::uint8_t>(result.reason)));
+    // Icount harts take turns on this thread, so the run is reproducible.
+    // Realtime harts run in parallel: hart 0 here, the others on threads of
+    // their own. Either way the first hart to stop halts the rest.
+    std::vector<RunResult> results(machine.num_harts());
+    if (machine.num_harts() > 1 && args.timebase == remu::devices::Timebase::Icount) {
+        const std::uint64_t quantum = args.quantum.value_or(RoundRobin::kDefaultQuantum);
+        log_info(std::to_string(machine.num_harts()) + " harts in turns of " +
+                 std::to_string(quantum) + " instructions");
+        results = RoundRobin(machine, args, quantum).run();
+    } else {
+        std::vector<std::jthread> threads;
+        for (std::uint32_t h = 1; h < machine.num_harts(); ++h) {
+            threads.emplace_back([&machine, &results, &args, h] {
+                results[h] = run_hart(machine, h, args);
+            });
+        }
+        results[0] = run_hart(machine, 0, args);
+    }
+    console_out.close();
+
+    // Report the hart that stopped the machine; the rest just followed it
+    std::uint32_t stopper = 0;
+    std::uint64_t instructions = 0;
+    std::uint64_t idle_ticks = 0;
+    std::uint64_t misaligned = 0;
+    for (std::uint32_t h = 0; h < machine.num_harts(); ++h) {
+        if (results[stopper].reason == StopReason::Halted &&
+            results[h].reason != StopReason::Halted) {
+            stopper = h;
+        }
+        instructions += results[h].instructions;
+        idle_ticks += results[h].idle_ticks;
+        misaligned += machine.hart(h).cpu.misaligned_accesses;
+    }
+    const RunResult& result = results[stopper];
+
+    log_info("Simulation stopped after " + std::to_string(instructions) + " instructions" +
+             (machine.num_harts() > 1
+                  ? " on " + std::to_string(machine.num_harts()) + " harts"
+                  : ""));
+    log_info("Stop reason: " + std::string(stop_reason_name(result.reason)) +
+             (result.reason == StopReason::GuestFail
+                  ? " (code " + std::to_string(result.guest_code) + ")"
+                  : "") +
+             (machine.num_harts() > 1 ? " on hart " + std::to_string(stopper) : ""));
+    if (idle_ticks != 0) {
+        log_info("Idle time in WFI: " + std::to_string(idle_ticks) + " timer ticks");
+    }
+    if (misaligned != 0) {
+        log_info("Misaligned loads/stores emulated: " + std::to_string(misaligned));
+    }
 
-    return 0;
+    return exit_status(result);
 }
 }  // namespace remu::runtime
\ No newline at end of file
@@ -1,28 +1,100 @@
 #include <remu/runtime/sim.hpp>
 
+#include <thread>
+
 #include <remu/common/log.hpp>
 #include <remu/cpu/decode.hpp>
 #include <remu/cpu/execute.hpp>
+#include <remu/cpu/mmu.hpp>
+#include <remu/cpu/exception.hpp>
 #include <remu/mem/bus.hpp>
 #include <remu/cpu/trap.hpp>
 #include <remu/cpu/exec_result.hpp>
 
 namespace remu::runtime {
 
+std::string_view stop_reason_name(StopReason reason) {
+    switch (reason) {
+        case StopReason::None:               return "none";
+        case StopReason::InstructionLimit:   return "instruction limit";
+        case StopReason::BusFaultFetch:      return "bus fault on fetch";
+        case StopReason::IllegalInstruction: return "illegal instruction";
+        case StopReason::ExecuteFailed:      return "execute failed";
+        case StopReason::EcallOrEbreak:      return "ecall/ebreak";
+        case StopReason::GuestPass:          return "guest poweroff/pass";
+        case StopReason::GuestFail:          return "guest failure";
+        case StopReason::GuestReset:         return "guest reboot";
+        case StopReason::Halted:             return "halted with the machine";
+    }
+    return "unknown";
+}
+
 Sim::Sim(remu::platform::VirtMachine& machine,
-         remu::cpu::Cpu& cpu,
+         remu::platform::VirtMachine::Hart& hart,
          const Arguments& opts)
-    : machine_(machine), cpu_(cpu), opts_(opts) {}
+    : machine_(machine), hart_(hart), cpu_(hart.cpu), opts_(opts) {}
+
+remu::cpu::ExecResult Sim::fetch32_(std::uint32_t addr, std::uint32_t& out) {
+    return remu::cpu::mmu_fetch32(cpu_, machine_.bus(), addr, out);
+}
+
+void Sim::wait_for_interrupt_() {
+    // WFI resumes on any interrupt pending in mie, even when globally
+    // disabled, so there is nothing to wait for in that case.
+    if ((cpu_.csr.mip() & cpu_.csr.mie()) != 0) return;
+
+    // Other harts share the thread: leave time to them and the scheduler
+    if (slicing_) {
+        waiting_ = true;
+        return;
+    }
 
-bool Sim::fetch32_(std::uint32_t addr, std::uint32_t& out) {
-    return machine_.bus().read32(addr, out);
+    // Icount mode jumps virtual time to the next timer deadline; realtime
+    // mode sleeps on the host until then or until a device interrupt.
+    // Either way the guest's idle loop doesn't spin.
+    const std::uint64_t idle = machine_.idle(hart_);
+    cpu_.csr.increment_cycle(idle);
+    idle_ticks_ += idle;
+}
+
+void Sim::spin_wait_(remu::cpu::ExecResult hint) {
+    // The hart being waited for shares this thread: hand it the turn
+    if (slicing_) {
+        yielded_ = true;
+        return;
+    }
+
+    if (hint == remu::cpu::ExecResult::Pause) {
+        // One host thread per hart: a hart that lost its host core to this
+        // spinner gets it back
+        if (machine_.num_harts() > 1) std::this_thread::yield();
+        return;
+    }
+
+    const std::uint64_t waited =
+        machine_.wait_reservation(hart_, hint == remu::cpu::ExecResult::WrsSto);
+    cpu_.csr.increment_cycle(waited);
+    idle_ticks_ += waited;
 }
 
 bool Sim::step() {
     if (stop_reason_ != StopReason::None) return false;
 
-    // Still tick time forward
-    machine_.tick(1, cpu_);
+    // Still tick time forward; stop once the guest has asked to, or the
+    // machine was halted
+    if (!machine_.tick(1, hart_)) {
+        const auto req = machine_.exit_request();
+        if (!req) {
+            stop_reason_ = StopReason::Halted;
+            return false;
+        }
+        switch (req->kind) {
+            case remu::devices::GuestExit::Pass:  stop_reason_ = StopReason::GuestPass;  break;
+            case remu::devices::GuestExit::Fail:  stop_reason_ = StopReason::GuestFail;  break;
+            case remu::devices::GuestExit::Reset: stop_reason_ = StopReason::GuestReset; break;
+        }
+        return false;
+    }
     cpu_.csr.increment_cycle(1);
 
     // Check for interrupts (trap handling)
@@ -34,7 +106,13 @@ bool Sim::step() {
 
     // 1) Fetch
     std::uint32_t insn = 0;
-    if (!fetch32_(pc, insn)) {
+    const auto fetched = fetch32_(pc, insn);
+    if (fetched == remu::cpu::ExecResult::TrapRaised) {
+        // Instruction page fault / misaligned PC
+        remu::cpu::take_pending_exception(cpu_);
+        return true;
+    }
+    if (fetched != remu::cpu::ExecResult::Ok) {
         stop_reason_ = StopReason::BusFaultFetch;
         return false;
     }
@@ -42,8 +120,15 @@ bool Sim::step() {
     // 2) Decode
     const remu::cpu::DecodedInsn d = remu::cpu::decode_rv32(insn);
     if (d.kind == remu::cpu::InsnKind::Illegal) {
-        stop_reason_ = StopReason::IllegalInstruction;
-        return false;
+        // Below M-mode the kernel/firmware handles it (e.g. SIGILL); in
+        // M-mode there is nobody to hand it to, so stop like before.
+        if (cpu_.priv == remu::cpu::PrivMode::Machine) {
+            stop_reason_ = StopReason::IllegalInstruction;
+            return false;
+        }
+        cpu_.raise_exception(remu::cpu::exc::IllegalInstruction, insn);
+        remu::cpu::take_pending_exception(cpu_);
+        return true;
     }
 
     // Optional trace hook
@@ -67,30 +152,12 @@ bool Sim::step() {
         return true;
     }
 
-    // if (ok == remu::cpu::ExecResult::Wfi) {
-    //     // If already pending, no need to idle.
-    //     // Otherwise tick until something becomes pending.
-    //     // Keep it bounded to avoid infinite loops if interrupts never come.
-    //     constexpr std::uint64_t kMaxIdleTicks = 10'000'000;
-
-    //     std::uint64_t idle = 0;
-    //     while (idle < kMaxIdleTicks) {
-    //         // Let time pass
-    //         machine_.tick(1, cpu_);
-    //         cpu_.csr.increment_cycle(1);
-
-    //         // If an interrupt is now pending+enabled and global MIE set,
-    //         // the next check will take it.
-    //         if (remu::cpu::check_and_take_interrupt(cpu_)) {
-    //             return true;
-    //         }
-    //         idle++;
-    //     }
-
-    //     // If we get here, nothing woke us up: treat as stop/fault (or just return true).
-    //     stop_reason_ = StopReason::InstructionLimit; // or new StopReason::WfiStuck
-    //     return false;
-    // }
+    if (ok == remu::cpu::ExecResult::Wfi) {
+        wait_for_interrupt_();
+    } else if (ok == remu::cpu::ExecResult::Pause || ok == remu::cpu::ExecResult::WrsNto ||
+               ok == remu::cpu::ExecResult::WrsSto) {
+        spin_wait_(ok);
+    }
 
     return true;
 }
@@ -98,6 +165,7 @@ bool Sim::step() {
 RunResult Sim::run(std::uint64_t max_instructions) {
     stop_reason_ = StopReason::None;
     instructions_ = 0;
+    idle_ticks_ = 0;
 
     // Use override if provided, else default to "no limit" for now.
     const std::uint64_t limit = (max_instructions != 0) ? max_instructions : 0;
@@ -110,10 +178,30 @@ RunResult Sim::run(std::uint64_t max_instructions) {
         if (!step()) break;
     }
 
+    return result();
+}
+
+void Sim::run_slice(std::uint64_t budget) {
+    slicing_ = true;
+    yielded_ = false;
+    for (std::uint64_t i = 0; i < budget && !waiting_ && !yielded_; ++i) {
+        if (!step()) break;
+    }
+    slicing_ = false;
+}
+
+void Sim::add_idle(std::uint64_t ticks) {
+    cpu_.csr.increment_cycle(ticks);
+    idle_ticks_ += ticks;
+}
+
+RunResult Sim::result() const {
     RunResult rr;
     rr.reason = stop_reason_;
     rr.instructions = instructions_;
     rr.last_pc = cpu_.pc;
+    rr.idle_ticks = idle_ticks_;
+    if (const auto req = machine_.exit_request()) rr.guest_code = req->code;
     return rr;
 }
 